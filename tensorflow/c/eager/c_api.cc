@@ -657,6 +657,16 @@ tensorflow::Status OpInferInputListAttrs(TFE_Op* op, TFE_TensorHandle** inputs,
   return tensorflow::Status::OK();
 }
 
+// Deleted ops, kept for reuse by the next TFE_NewOp on the same thread so that
+// ops dispatched one after the other reuse their allocations, and their
+// AttrBuilder keeps the fingerprints of the op name and device.
+constexpr int kMaxPooledOps = 8;
+
+std::vector<std::unique_ptr<TFE_Op>>* ThreadOpPool() {
+  thread_local std::vector<std::unique_ptr<TFE_Op>> pool;  // NOLINT
+  return &pool;
+}
+
 }  // namespace
 
 extern "C" {
@@ -923,11 +933,30 @@ TF_Tensor* TFE_TensorHandleResolve(TFE_TensorHandle* h, TF_Status* status) {
 
 TFE_Op* TFE_NewOp(TFE_Context* ctx, const char* op_or_function_name,
                   TF_Status* status) {
-  return NewOrResetOp(ctx, op_or_function_name, status,
-                      /* op_to_reset= */ nullptr);
+  auto* pool = ThreadOpPool();
+  if (pool->empty()) {
+    return NewOrResetOp(ctx, op_or_function_name, status,
+                        /* op_to_reset= */ nullptr);
+  }
+  std::unique_ptr<TFE_Op> op = std::move(pool->back());
+  pool->pop_back();
+  if (NewOrResetOp(ctx, op_or_function_name, status, op.get()) == nullptr) {
+    pool->push_back(std::move(op));
+    return nullptr;
+  }
+  return op.release();
 }
 
-void TFE_DeleteOp(TFE_Op* op) { delete op; }
+void TFE_DeleteOp(TFE_Op* op) {
+  if (op == nullptr) return;
+  auto* pool = ThreadOpPool();
+  if (pool->size() >= kMaxPooledOps) {
+    delete op;
+    return;
+  }
+  op->Clear();
+  pool->emplace_back(op);
+}
 
 void TFE_OpSetDevice(TFE_Op* op, const char* device_name, TF_Status* status) {
   status->status = op->operation.SetDeviceName(device_name);
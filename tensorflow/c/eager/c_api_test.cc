@@ -17,6 +17,9 @@ limitations under the License.
 
 #include <string.h>
 
+#include <thread>  // NOLINT
+#include <vector>
+
 #include "absl/strings/match.h"
 #include "tensorflow/c/eager/c_api_experimental.h"
 #include "tensorflow/c/eager/c_api_internal.h"
@@ -127,6 +130,47 @@ void BM_Execute_Identity(int iters, int async) {
 }
 BENCHMARK(BM_Execute_Identity)->Arg(0)->Arg(1);
 
+// Creates, executes and deletes an op in every iteration, like the dispatch of
+// an op from Python, on `num_threads` threads at once.
+void BM_Dispatch_Identity(int iters, int num_threads) {
+  tensorflow::testing::StopTiming();
+  TF_Status* status = TF_NewStatus();
+  TFE_ContextOptions* opts = TFE_NewContextOptions();
+  TFE_Context* ctx = TFE_NewContext(opts, status);
+  CHECK_EQ(TF_OK, TF_GetCode(status)) << TF_Message(status);
+  TFE_DeleteContextOptions(opts);
+
+  TFE_TensorHandle* m = TestMatrixTensorHandle();
+  auto dispatch = [ctx, m](int num_iters) {
+    TF_Status* status = TF_NewStatus();
+    for (int i = 0; i < num_iters; ++i) {
+      TFE_Op* identity = IdentityOp(ctx, m);
+      TFE_TensorHandle* retvals[1];
+      int num_retvals = 1;
+      TFE_Execute(identity, &retvals[0], &num_retvals, status);
+      CHECK_EQ(TF_OK, TF_GetCode(status)) << TF_Message(status);
+      TFE_DeleteTensorHandle(retvals[0]);
+      TFE_DeleteOp(identity);
+    }
+    TF_DeleteStatus(status);
+  };
+  // Warms up the kernel cache.
+  dispatch(1);
+  tensorflow::testing::StartTiming();
+  std::vector<std::thread> threads;
+  for (int t = 0; t < num_threads; ++t) {
+    threads.emplace_back(dispatch, iters / num_threads);
+  }
+  for (std::thread& thread : threads) {
+    thread.join();
+  }
+  tensorflow::testing::StopTiming();
+  TFE_DeleteTensorHandle(m);
+  TFE_DeleteContext(ctx);
+  TF_DeleteStatus(status);
+}
+BENCHMARK(BM_Dispatch_Identity)->Arg(1)->Arg(4)->Arg(16);
+
 TEST(CAPI, Context) {
   TF_Status* status = TF_NewStatus();
   TFE_ContextOptions* opts = TFE_NewContextOptions();
@@ -626,6 +670,45 @@ void Execute_MatMul_CPU(bool async) {
 TEST(CAPI, Execute_MatMul_CPU) { Execute_MatMul_CPU(false); }
 TEST(CAPI, Execute_MatMul_CPUAsync) { Execute_MatMul_CPU(true); }
 
+TEST(CAPI, Execute_MatMul_CPUAfterDeletingOpsAndContexts) {
+  TF_Status* status = TF_NewStatus();
+  TFE_TensorHandle* m = TestMatrixTensorHandle();
+  for (int i = 0; i < 2; ++i) {
+    TFE_ContextOptions* opts = TFE_NewContextOptions();
+    TFE_Context* ctx = TFE_NewContext(opts, status);
+    CHECK_EQ(TF_OK, TF_GetCode(status)) << TF_Message(status);
+    TFE_DeleteContextOptions(opts);
+
+    // The deleted op may be reused by the next one, which must not see its
+    // attributes.
+    TFE_Op* transposed = MatMulOp(ctx, m, m);
+    TFE_OpSetAttrBool(transposed, "transpose_a", 1);
+    TFE_DeleteOp(transposed);
+
+    TFE_Op* matmul = MatMulOp(ctx, m, m);
+    TFE_TensorHandle* retvals[1] = {nullptr};
+    int num_retvals = 1;
+    TFE_Execute(matmul, &retvals[0], &num_retvals, status);
+    ASSERT_EQ(TF_OK, TF_GetCode(status)) << TF_Message(status);
+    TFE_DeleteOp(matmul);
+
+    TF_Tensor* t = TFE_TensorHandleResolve(retvals[0], status);
+    ASSERT_EQ(TF_OK, TF_GetCode(status)) << TF_Message(status);
+    TFE_DeleteTensorHandle(retvals[0]);
+    float product[4] = {0};
+    memcpy(&product[0], TF_TensorData(t), TF_TensorByteSize(t));
+    TF_DeleteTensor(t);
+    EXPECT_EQ(7, product[0]);
+    EXPECT_EQ(10, product[1]);
+    EXPECT_EQ(15, product[2]);
+    EXPECT_EQ(22, product[3]);
+    // The next context starts with an empty kernel cache.
+    TFE_DeleteContext(ctx);
+  }
+  TFE_DeleteTensorHandle(m);
+  TF_DeleteStatus(status);
+}
+
 void Execute_MatMul_CPU_Runtime_Error(bool async) {
   TF_Status* status = TF_NewStatus();
   TFE_ContextOptions* opts = TFE_NewContextOptions();
@@ -973,6 +1056,59 @@ void FunctionDefAndExecute(bool async) {
 TEST(CAPI, FunctionDefAndExecute) { FunctionDefAndExecute(false); }
 TEST(CAPI, FunctionDefAndExecuteAsync) { FunctionDefAndExecute(true); }
 
+TEST(CAPI, ExecuteRedefinedFunction) {
+  TF_Status* status = TF_NewStatus();
+  TFE_ContextOptions* opts = TFE_NewContextOptions();
+  TFE_Context* ctx = TFE_NewContext(opts, status);
+  CHECK_EQ(TF_OK, TF_GetCode(status)) << TF_Message(status);
+  TFE_DeleteContextOptions(opts);
+
+  // The same function, redefined to return a + a.
+  tensorflow::FunctionDef add_def;
+  CHECK(add_def.ParseFromString(MatMulFunction()));
+  add_def.mutable_node_def(0)->set_op("Add");
+  (*add_def.mutable_ret())["m"] = "matmul:z";
+
+  TFE_TensorHandle* m = TestMatrixTensorHandle();
+  TFE_Op* op = TFE_NewOp(ctx, "MatMulFunction", status);
+  ASSERT_EQ(TF_OK, TF_GetCode(status)) << TF_Message(status);
+  TFE_OpAddInput(op, m, status);
+  ASSERT_EQ(TF_OK, TF_GetCode(status)) << TF_Message(status);
+  // The first execution caches the kernel of the function for this thread,
+  // which must not be found once the function is removed.
+  for (bool redefined : {false, true}) {
+    const string function_def =
+        redefined ? add_def.SerializeAsString() : MatMulFunction();
+    TFE_ContextAddFunctionDef(ctx, function_def.data(), function_def.size(),
+                              status);
+    ASSERT_EQ(TF_OK, TF_GetCode(status)) << TF_Message(status);
+    TFE_TensorHandle* retval[1] = {nullptr};
+    int num_retvals = 1;
+    TFE_Execute(op, &retval[0], &num_retvals, status);
+    ASSERT_EQ(TF_OK, TF_GetCode(status)) << TF_Message(status);
+    TF_Tensor* t = TFE_TensorHandleResolve(retval[0], status);
+    TFE_DeleteTensorHandle(retval[0]);
+    ASSERT_EQ(TF_OK, TF_GetCode(status)) << TF_Message(status);
+    float result[4] = {0};
+    EXPECT_EQ(sizeof(result), TF_TensorByteSize(t));
+    memcpy(&result[0], TF_TensorData(t), TF_TensorByteSize(t));
+    TF_DeleteTensor(t);
+    if (redefined) {
+      EXPECT_EQ(2, result[0]);
+      EXPECT_EQ(8, result[3]);
+    } else {
+      EXPECT_EQ(7, result[0]);
+      EXPECT_EQ(22, result[3]);
+    }
+    TFE_ContextRemoveFunction(ctx, "MatMulFunction", status);
+    ASSERT_EQ(TF_OK, TF_GetCode(status)) << TF_Message(status);
+  }
+  TFE_DeleteOp(op);
+  TFE_DeleteTensorHandle(m);
+  TFE_DeleteContext(ctx);
+  TF_DeleteStatus(status);
+}
+
 void BM_ExecuteFunction(int iters, int async) {
   tensorflow::testing::StopTiming();
   tensorflow::testing::SetLabel(async ? "ExecuteFunctionAsync"
@@ -17,12 +17,15 @@ limitations under the License.
 
 #include <atomic>
 
+#include "absl/memory/memory.h"
+
 #include "tensorflow/core/common_runtime/allocator_retry.h"
 #include "tensorflow/core/lib/core/bits.h"
 #include "tensorflow/core/lib/gtl/stl_util.h"
 #include "tensorflow/core/lib/strings/numbers.h"
 #include "tensorflow/core/lib/strings/str_util.h"
 #include "tensorflow/core/lib/strings/strcat.h"
+#include "tensorflow/core/platform/cpu_info.h"
 #include "tensorflow/core/platform/file_system.h"
 #include "tensorflow/core/platform/logging.h"
 #include "tensorflow/core/platform/mutex.h"
@@ -34,9 +37,29 @@ limitations under the License.
 
 namespace tensorflow {
 
+namespace {
+
+// The maximum number of chunks of a size class that a thread cache holds is
+// twice the number that are returned to the bins at once.
+size_t ThreadCacheFlushBatchSize(size_t rounded_bytes) {
+  constexpr size_t kFlushBatchBytes = 64 << 10;
+  constexpr size_t kMaxFlushBatchSize = 32;
+  return std::max<size_t>(
+      2, std::min(kMaxFlushBatchSize, kFlushBatchBytes / rounded_bytes));
+}
+
+// The maximum number of bytes that a thread cache holds.
+constexpr size_t kMaxThreadCacheBytes = 2 << 20;
+
+}  // namespace
+
+constexpr size_t BFCAllocator::kMaxThreadCacheChunkBytes;
+constexpr int BFCAllocator::kNumThreadCacheSizeClasses;
+constexpr int BFCAllocator::kNumCacheableAllocationShards;
+
 BFCAllocator::BFCAllocator(SubAllocator* sub_allocator, size_t total_memory,
                            bool allow_growth, const string& name,
-                           bool garbage_collection)
+                           bool garbage_collection, bool thread_cache)
     : garbage_collection_(garbage_collection),
       sub_allocator_(sub_allocator),
       name_(name),
@@ -72,6 +95,17 @@ BFCAllocator::BFCAllocator(SubAllocator* sub_allocator, size_t total_memory,
       CHECK_NE(BinForSize(bin_size * 2), BinFromIndex(b));
     }
   }
+
+  if (thread_cache) {
+    const int num_caches = std::max(1, port::NumSchedulableCPUs());
+    for (int i = 0; i < num_caches; ++i) {
+      thread_caches_.push_back(absl::make_unique<ThreadCache>());
+    }
+    cacheable_allocations_.reset(
+        new CacheableAllocationShard[kNumCacheableAllocationShards]);
+    VLOG(1) << "Enabled the thread cache of " << name << " for " << num_caches
+            << " CPUs";
+  }
 }
 
 BFCAllocator::~BFCAllocator() {
@@ -226,6 +260,29 @@ void* BFCAllocator::AllocateRawInternalWithRetry(
 void* BFCAllocator::AllocateRaw(size_t unused_alignment, size_t num_bytes,
                                 const AllocationAttributes& allocation_attr) {
   VLOG(1) << "AllocateRaw " << Name() << "  " << num_bytes;
+  // Chunks that were freed after a timestamp have to go through the bins, so
+  // the thread cache is bypassed when timestamps are in use.
+  const size_t rounded_bytes = RoundedBytes(num_bytes);
+  const bool cacheable = !thread_caches_.empty() && num_bytes > 0 &&
+                         rounded_bytes <= kMaxThreadCacheChunkBytes &&
+                         allocation_attr.freed_by_func == nullptr &&
+                         timing_counter_ == nullptr;
+  if (cacheable) {
+    void* ptr = AllocateFromThreadCache(num_bytes, rounded_bytes);
+    if (ptr != nullptr) {
+      return ptr;
+    }
+  }
+  void* ptr = AllocateRawFromBins(unused_alignment, num_bytes, allocation_attr);
+  if (cacheable && ptr != nullptr) {
+    RecordCacheableAllocation(ptr, rounded_bytes);
+  }
+  return ptr;
+}
+
+void* BFCAllocator::AllocateRawFromBins(
+    size_t unused_alignment, size_t num_bytes,
+    const AllocationAttributes& allocation_attr) {
   if (allocation_attr.no_retry_on_failure) {
     // Return immediately upon the first failure if this is for allocating an
     // optional scratch space.
@@ -405,6 +462,15 @@ void* BFCAllocator::AllocateRawInternal(size_t unused_alignment,
     }
   }
 
+  // The thread caches may hold chunks that can be coalesced into a chunk that
+  // satisfies the request.
+  if (!thread_caches_.empty() && DrainThreadCaches()) {
+    ptr = FindChunkPtr(bin_num, rounded_bytes, num_bytes, freed_before);
+    if (ptr != nullptr) {
+      return ptr;
+    }
+  }
+
   // Reaching this point means that no chunks can satisfy the request. Also,
   // the unallocated bytes cannot satisfy the request. Before giving up, let's
   // try deallocating free regions so that suballocator can combine them with
@@ -549,6 +615,10 @@ void BFCAllocator::SplitChunk(BFCAllocator::ChunkHandle h, size_t num_bytes) {
 void BFCAllocator::DeallocateRaw(void* ptr) {
   VLOG(1) << "DeallocateRaw " << Name() << " "
           << (ptr ? RequestedSize(ptr) : 0);
+  if (ptr != nullptr && !thread_caches_.empty() &&
+      DeallocateToThreadCache(ptr)) {
+    return;
+  }
   DeallocateRawInternal(ptr);
   retry_helper_.NotifyDealloc();
 }
@@ -559,7 +629,10 @@ void BFCAllocator::DeallocateRawInternal(void* ptr) {
     return;
   }
   mutex_lock l(lock_);
+  DeallocateRawLocked(ptr);
+}
 
+void BFCAllocator::DeallocateRawLocked(void* ptr) {
   // Find the chunk from the ptr.
   BFCAllocator::ChunkHandle h = region_manager_.get_handle(ptr);
   CHECK(h != kInvalidChunkHandle);
@@ -579,6 +652,166 @@ void BFCAllocator::DeallocateRawInternal(void* ptr) {
   }
 }
 
+BFCAllocator::ThreadCache* BFCAllocator::CurrentThreadCache() {
+  int cpu = port::GetCurrentCPU();
+  if (cpu < 0) {
+    // Spreads the threads over the caches if the CPU is unknown.
+    static std::atomic<int> next_cpu{0};
+    static thread_local int thread_cpu = next_cpu.fetch_add(1);
+    cpu = thread_cpu;
+  }
+  return thread_caches_[cpu % thread_caches_.size()].get();
+}
+
+void* BFCAllocator::AllocateFromThreadCache(size_t num_bytes,
+                                            size_t rounded_bytes) {
+  const int size_class = (rounded_bytes >> kMinAllocationBits) - 1;
+  void* ptr = nullptr;
+  {
+    ThreadCache* cache = CurrentThreadCache();
+    mutex_lock l(cache->mu);
+    std::vector<void*>& free_chunks = cache->free_chunks[size_class];
+    if (!free_chunks.empty()) {
+      ptr = free_chunks.back();
+      free_chunks.pop_back();
+      cache->bytes_cached -= rounded_bytes;
+    }
+  }
+  if (ptr == nullptr) {
+    thread_cache_misses_.fetch_add(1, std::memory_order_relaxed);
+    return nullptr;
+  }
+  thread_cache_hits_.fetch_add(1, std::memory_order_relaxed);
+  thread_cache_bytes_.fetch_sub(rounded_bytes, std::memory_order_relaxed);
+  CacheableAllocationShard* shard = CacheableAllocationShardFor(ptr);
+  mutex_lock l(shard->mu);
+  CacheableAllocation& allocation = shard->allocations[ptr];
+  DCHECK_EQ(allocation.rounded_bytes, rounded_bytes);
+  allocation.requested_size = num_bytes;
+  allocation.allocation_id = next_allocation_id_++;
+  return ptr;
+}
+
+void BFCAllocator::RecordCacheableAllocation(void* ptr, size_t rounded_bytes) {
+  CacheableAllocationShard* shard = CacheableAllocationShardFor(ptr);
+  mutex_lock l(shard->mu);
+  CacheableAllocation& allocation = shard->allocations[ptr];
+  allocation.rounded_bytes = rounded_bytes;
+  allocation.requested_size = 0;
+  allocation.allocation_id = -1;
+}
+
+bool BFCAllocator::DeallocateToThreadCache(void* ptr) {
+  size_t rounded_bytes;
+  {
+    CacheableAllocationShard* shard = CacheableAllocationShardFor(ptr);
+    mutex_lock l(shard->mu);
+    auto it = shard->allocations.find(ptr);
+    if (it == shard->allocations.end()) {
+      return false;
+    }
+    if (timing_counter_ != nullptr) {
+      // The chunk has to be freed with a timestamp, so it goes to the bins.
+      shard->allocations.erase(it);
+      return false;
+    }
+    rounded_bytes = it->second.rounded_bytes;
+  }
+  const int size_class = (rounded_bytes >> kMinAllocationBits) - 1;
+  std::vector<void*> to_return;
+  {
+    ThreadCache* cache = CurrentThreadCache();
+    mutex_lock l(cache->mu);
+    std::vector<void*>& free_chunks = cache->free_chunks[size_class];
+    free_chunks.push_back(ptr);
+    cache->bytes_cached += rounded_bytes;
+    const size_t batch_size = ThreadCacheFlushBatchSize(rounded_bytes);
+    if (free_chunks.size() > 2 * batch_size ||
+        cache->bytes_cached > kMaxThreadCacheBytes) {
+      // Returns the least recently cached chunks to the bins, where they can
+      // be coalesced, and keeps the rest.
+      const size_t num_to_return = std::min(batch_size, free_chunks.size());
+      to_return.assign(free_chunks.begin(),
+                       free_chunks.begin() + num_to_return);
+      free_chunks.erase(free_chunks.begin(),
+                        free_chunks.begin() + num_to_return);
+      cache->bytes_cached -= num_to_return * rounded_bytes;
+    }
+  }
+  thread_cache_bytes_.fetch_add(rounded_bytes, std::memory_order_relaxed);
+  if (!to_return.empty()) {
+    thread_cache_bytes_.fetch_sub(to_return.size() * rounded_bytes,
+                                  std::memory_order_relaxed);
+    ReturnToBins(to_return);
+  }
+  return true;
+}
+
+void BFCAllocator::ReturnToBins(const std::vector<void*>& ptrs) {
+  {
+    mutex_lock l(lock_);
+    ReturnToBinsLocked(ptrs);
+  }
+  retry_helper_.NotifyDealloc();
+}
+
+void BFCAllocator::ReturnToBinsLocked(const std::vector<void*>& ptrs) {
+  thread_cache_flushes_.fetch_add(1, std::memory_order_relaxed);
+  for (void* ptr : ptrs) {
+    CacheableAllocationShard* shard = CacheableAllocationShardFor(ptr);
+    {
+      mutex_lock l(shard->mu);
+      shard->allocations.erase(ptr);
+    }
+    DeallocateRawLocked(ptr);
+  }
+}
+
+bool BFCAllocator::DrainThreadCaches() {
+  std::vector<void*> ptrs;
+  for (auto& cache : thread_caches_) {
+    mutex_lock l(cache->mu);
+    for (std::vector<void*>& free_chunks : cache->free_chunks) {
+      ptrs.insert(ptrs.end(), free_chunks.begin(), free_chunks.end());
+      free_chunks.clear();
+    }
+    thread_cache_bytes_.fetch_sub(cache->bytes_cached,
+                                  std::memory_order_relaxed);
+    cache->bytes_cached = 0;
+  }
+  if (ptrs.empty()) {
+    return false;
+  }
+  VLOG(1) << "Draining " << ptrs.size() << " chunks from the thread caches of "
+          << Name();
+  ReturnToBinsLocked(ptrs);
+  return true;
+}
+
+bool BFCAllocator::FindCachedAllocation(
+    const void* ptr, CacheableAllocation* allocation) const {
+  if (thread_caches_.empty()) {
+    return false;
+  }
+  CacheableAllocationShard* shard = CacheableAllocationShardFor(ptr);
+  mutex_lock l(shard->mu);
+  auto it = shard->allocations.find(ptr);
+  if (it == shard->allocations.end() || it->second.allocation_id == -1) {
+    return false;
+  }
+  *allocation = it->second;
+  return true;
+}
+
+BFCAllocator::ThreadCacheStats BFCAllocator::GetThreadCacheStats() const {
+  ThreadCacheStats stats;
+  stats.num_hits = thread_cache_hits_.load(std::memory_order_relaxed);
+  stats.num_misses = thread_cache_misses_.load(std::memory_order_relaxed);
+  stats.num_flushes = thread_cache_flushes_.load(std::memory_order_relaxed);
+  stats.bytes_cached = thread_cache_bytes_.load(std::memory_order_relaxed);
+  return stats;
+}
+
 // Merges h1 and h2 when Chunk(h1)->next is h2 and Chunk(h2)->prev is c1.
 // We merge Chunk(h2) into Chunk(h1).
 void BFCAllocator::Merge(BFCAllocator::ChunkHandle h1,
@@ -793,6 +1026,10 @@ bool BFCAllocator::TracksAllocationSizes() const { return true; }
 
 size_t BFCAllocator::RequestedSize(const void* ptr) const {
   CHECK(ptr);
+  CacheableAllocation allocation;
+  if (FindCachedAllocation(ptr, &allocation)) {
+    return allocation.requested_size;
+  }
   mutex_lock l(lock_);
   BFCAllocator::ChunkHandle h = region_manager_.get_handle(ptr);
   CHECK(h != kInvalidChunkHandle)
@@ -811,6 +1048,10 @@ size_t BFCAllocator::AllocatedSize(const void* ptr) const {
 }
 
 int64 BFCAllocator::AllocationId(const void* ptr) const {
+  CacheableAllocation allocation;
+  if (FindCachedAllocation(ptr, &allocation)) {
+    return allocation.allocation_id;
+  }
   mutex_lock l(lock_);
   BFCAllocator::ChunkHandle h = region_manager_.get_handle(ptr);
   CHECK(h != kInvalidChunkHandle)
@@ -1070,12 +1311,20 @@ MemoryDump BFCAllocator::RecordMemoryMapInternal() {
 
 absl::optional<AllocatorStats> BFCAllocator::GetStats() {
   mutex_lock l(lock_);
-  return stats_;
+  AllocatorStats stats = stats_;
+  // The bins count the chunks held by the thread caches as in use, and do not
+  // see the allocations served from them.
+  stats.num_allocs += thread_cache_hits_.load(std::memory_order_relaxed) -
+                      thread_cache_hits_at_clear_;
+  stats.bytes_in_use -= thread_cache_bytes_.load(std::memory_order_relaxed);
+  return stats;
 }
 
 void BFCAllocator::ClearStats() {
   mutex_lock l(lock_);
   stats_.num_allocs = 0;
+  thread_cache_hits_at_clear_ =
+      thread_cache_hits_.load(std::memory_order_relaxed);
   stats_.peak_bytes_in_use = stats_.bytes_in_use;
   stats_.largest_alloc_size = 0;
 }
@@ -17,12 +17,14 @@ limitations under the License.
 #define TENSORFLOW_CORE_COMMON_RUNTIME_BFC_ALLOCATOR_H_
 
 #include <array>
+#include <atomic>
 #include <deque>
 #include <memory>
 #include <string>
 #include <unordered_map>
 #include <vector>
 
+#include "absl/container/flat_hash_map.h"
 #include "absl/container/flat_hash_set.h"
 #include "tensorflow/core/common_runtime/allocator_retry.h"
 #include "tensorflow/core/common_runtime/shared_counter.h"
@@ -47,12 +49,24 @@ class MemoryDump;
 // coalescing.  One assumption we make is that the process using this
 // allocator owns pretty much all of the memory, and that nearly
 // all requests to allocate memory go through this interface.
+//
+// Optionally, small allocations are served from per-CPU caches of chunks in
+// front of the bins (the "thread cache"), so that threads allocating and
+// deallocating small buffers concurrently do not all contend for the
+// allocator lock.
 class BFCAllocator : public Allocator {
  public:
   // Takes ownership of sub_allocator.
+  //
+  // If `thread_cache` is true, the chunks of deallocated buffers of up to
+  // kMaxThreadCacheChunkBytes bytes are kept in a cache of the CPU that
+  // deallocates them, and later allocations of the same rounded size on that
+  // CPU are served from the cache. The cached chunks are returned to the bins
+  // in batches when a cache grows too large, and all of them are returned when
+  // an allocation cannot be satisfied otherwise.
   BFCAllocator(SubAllocator* sub_allocator, size_t total_memory,
                bool allow_growth, const string& name,
-               bool garbage_collection = false);
+               bool garbage_collection = false, bool thread_cache = false);
   ~BFCAllocator() override;
 
   string Name() override { return name_; }
@@ -86,6 +100,25 @@ class BFCAllocator : public Allocator {
 
   MemoryDump RecordMemoryMap();
 
+  // Statistics of the thread cache.
+  struct ThreadCacheStats {
+    // Number of allocations served from a cache.
+    int64 num_hits = 0;
+    // Number of cacheable allocations served from the bins.
+    int64 num_misses = 0;
+    // Number of times that chunks were returned from a cache to the bins.
+    int64 num_flushes = 0;
+    // Number of bytes of the chunks held in the caches.
+    int64 bytes_cached = 0;
+  };
+
+  // Returns the statistics of the thread cache, which are all zero if it is
+  // disabled.
+  ThreadCacheStats GetThreadCacheStats() const;
+
+  // The largest allocation that is served from the thread cache.
+  static constexpr size_t kMaxThreadCacheChunkBytes = 32 << 10;
+
  private:
   struct Bin;
 
@@ -97,8 +130,36 @@ class BFCAllocator : public Allocator {
       size_t alignment, size_t num_bytes,
       const AllocationAttributes& allocation_attr);
 
+  void* AllocateRawFromBins(size_t alignment, size_t num_bytes,
+                            const AllocationAttributes& allocation_attr);
+
   void DeallocateRawInternal(void* ptr);
 
+  // Frees the chunk of `ptr` into its bin.
+  void DeallocateRawLocked(void* ptr) EXCLUSIVE_LOCKS_REQUIRED(lock_);
+
+  // Returns a chunk of `rounded_bytes` bytes from the cache of the current
+  // CPU, or nullptr if it has none.
+  void* AllocateFromThreadCache(size_t num_bytes, size_t rounded_bytes);
+
+  // Records that `ptr`, which was allocated from the bins, is of size class
+  // `rounded_bytes`, so that it is returned to the thread cache.
+  void RecordCacheableAllocation(void* ptr, size_t rounded_bytes);
+
+  // Moves the chunk of `ptr` to the cache of the current CPU. Returns false
+  // if `ptr` is not cacheable.
+  bool DeallocateToThreadCache(void* ptr);
+
+  // Frees the chunks of `ptrs`, which are held by a thread cache, into their
+  // bins.
+  void ReturnToBins(const std::vector<void*>& ptrs) LOCKS_EXCLUDED(lock_);
+  void ReturnToBinsLocked(const std::vector<void*>& ptrs)
+      EXCLUSIVE_LOCKS_REQUIRED(lock_);
+
+  // Frees all chunks held by the thread caches into their bins. Returns true
+  // if there were any.
+  bool DrainThreadCaches() EXCLUSIVE_LOCKS_REQUIRED(lock_);
+
   // Chunks whose freed_at_count is later than the safe frontier value are kept
   // on a special list and not subject to merging immediately upon being freed.
   //
@@ -443,6 +504,46 @@ class BFCAllocator : public Allocator {
   ChunkHandle TryToCoalesce(ChunkHandle h, bool ignore_freed_at)
       EXCLUSIVE_LOCKS_REQUIRED(lock_);
 
+  // The thread cache of a CPU: the free chunks of each size class, which the
+  // bins consider to be in use.
+  static constexpr int kNumThreadCacheSizeClasses =
+      kMaxThreadCacheChunkBytes >> kMinAllocationBits;
+  struct ThreadCache {
+    mutex mu;
+    std::vector<void*> free_chunks[kNumThreadCacheSizeClasses] GUARDED_BY(mu);
+    size_t bytes_cached GUARDED_BY(mu) = 0;
+  };
+
+  // Returns the thread cache of the CPU of the calling thread.
+  ThreadCache* CurrentThreadCache();
+
+  // The size class and the allocation of a chunk that is, or will be, held by
+  // a thread cache. `requested_size` and `allocation_id` are set when the
+  // chunk is served from a cache, and take precedence over the stale values
+  // of the chunk; otherwise `allocation_id` is -1.
+  struct CacheableAllocation {
+    size_t rounded_bytes = 0;
+    size_t requested_size = 0;
+    int64 allocation_id = -1;
+  };
+  // The cacheable allocations, sharded by address.
+  static constexpr int kNumCacheableAllocationShards = 64;
+  struct CacheableAllocationShard {
+    mutex mu;
+    absl::flat_hash_map<const void*, CacheableAllocation> allocations
+        GUARDED_BY(mu);
+  };
+  CacheableAllocationShard* CacheableAllocationShardFor(const void* ptr) const {
+    const std::uintptr_t p = reinterpret_cast<std::uintptr_t>(ptr);
+    return &cacheable_allocations_[(p >> kMinAllocationBits) %
+                                   kNumCacheableAllocationShards];
+  }
+
+  // Looks up the cacheable allocation of `ptr` that was served from a thread
+  // cache. Returns false if there is none.
+  bool FindCachedAllocation(const void* ptr,
+                            CacheableAllocation* allocation) const;
+
   // Information about a Bin that is useful for debugging.
   struct BinDebugInfo {
     size_t total_bytes_in_use = 0;
@@ -530,8 +631,20 @@ class BFCAllocator : public Allocator {
   ChunkHandle free_chunks_list_ GUARDED_BY(lock_);
 
   // Counter containing the next unique identifier to assign to a
-  // newly-created chunk.
-  int64 next_allocation_id_ GUARDED_BY(lock_);
+  // newly-created chunk, or to a chunk served from a thread cache.
+  std::atomic<int64> next_allocation_id_;
+
+  // The thread caches, one per schedulable CPU, and the allocations that they
+  // hold or that are returned to them. Empty if the thread cache is disabled.
+  // Locks are acquired in the order `lock_`, `ThreadCache::mu`,
+  // `CacheableAllocationShard::mu`.
+  std::vector<std::unique_ptr<ThreadCache>> thread_caches_;
+  std::unique_ptr<CacheableAllocationShard[]> cacheable_allocations_;
+  std::atomic<int64> thread_cache_hits_{0};
+  std::atomic<int64> thread_cache_misses_{0};
+  std::atomic<int64> thread_cache_flushes_{0};
+  std::atomic<int64> thread_cache_bytes_{0};
+  int64 thread_cache_hits_at_clear_ GUARDED_BY(lock_) = 0;
 
   // Stats.
   AllocatorStats stats_ GUARDED_BY(lock_);
@@ -0,0 +1,208 @@
+/* Copyright 2019 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/common_runtime/bfc_allocator.h"
+
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+#include "absl/memory/memory.h"
+#include "tensorflow/core/common_runtime/pool_allocator.h"
+#include "tensorflow/core/lib/core/blocking_counter.h"
+#include "tensorflow/core/lib/core/threadpool.h"
+#include "tensorflow/core/lib/random/simple_philox.h"
+#include "tensorflow/core/platform/numa.h"
+#include "tensorflow/core/platform/test.h"
+#include "tensorflow/core/platform/test_benchmark.h"
+
+namespace tensorflow {
+namespace {
+
+std::unique_ptr<BFCAllocator> MakeAllocator(size_t total_memory,
+                                            bool allow_growth,
+                                            bool thread_cache) {
+  return absl::make_unique<BFCAllocator>(
+      new BasicCPUAllocator(port::kNUMANoAffinity, {}, {}), total_memory,
+      allow_growth, "bfc_test", /*garbage_collection=*/false, thread_cache);
+}
+
+TEST(BFCAllocatorTest, ThreadCacheDisabledByDefault) {
+  auto a = MakeAllocator(1 << 20, /*allow_growth=*/true,
+                         /*thread_cache=*/false);
+  for (int i = 0; i < 10; ++i) {
+    a->DeallocateRaw(a->AllocateRaw(1, 1024));
+  }
+  BFCAllocator::ThreadCacheStats stats = a->GetThreadCacheStats();
+  EXPECT_EQ(0, stats.num_hits);
+  EXPECT_EQ(0, stats.num_misses);
+  EXPECT_EQ(0, stats.bytes_cached);
+  EXPECT_EQ(10, a->GetStats()->num_allocs);
+}
+
+TEST(BFCAllocatorTest, ThreadCacheServesSmallAllocations) {
+  auto a = MakeAllocator(1 << 20, /*allow_growth=*/true,
+                         /*thread_cache=*/true);
+  const int kIterations = 100;
+  std::vector<int64> allocation_ids;
+  for (int i = 0; i < kIterations; ++i) {
+    void* ptr = a->AllocateRaw(1, 1000 + i % 2);
+    ASSERT_NE(nullptr, ptr);
+    EXPECT_EQ(1000 + i % 2, a->RequestedSize(ptr));
+    EXPECT_EQ(1024, a->AllocatedSize(ptr));
+    allocation_ids.push_back(a->AllocationId(ptr));
+    a->DeallocateRaw(ptr);
+  }
+  // Each allocation has a distinct id, even if its chunk was reused.
+  std::sort(allocation_ids.begin(), allocation_ids.end());
+  EXPECT_EQ(allocation_ids.end(),
+            std::adjacent_find(allocation_ids.begin(), allocation_ids.end()));
+
+  // The thread may move between CPUs, but it finds most chunks in a cache.
+  BFCAllocator::ThreadCacheStats stats = a->GetThreadCacheStats();
+  EXPECT_EQ(kIterations, stats.num_hits + stats.num_misses);
+  EXPECT_GT(stats.num_hits, kIterations / 2);
+  EXPECT_GT(stats.bytes_cached, 0);
+  EXPECT_EQ(kIterations, a->GetStats()->num_allocs);
+  EXPECT_EQ(0, a->GetStats()->bytes_in_use);
+}
+
+TEST(BFCAllocatorTest, ThreadCacheBypassesLargeAllocations) {
+  auto a = MakeAllocator(1 << 20, /*allow_growth=*/true,
+                         /*thread_cache=*/true);
+  const size_t num_bytes = BFCAllocator::kMaxThreadCacheChunkBytes + 1;
+  for (int i = 0; i < 10; ++i) {
+    a->DeallocateRaw(a->AllocateRaw(1, num_bytes));
+  }
+  BFCAllocator::ThreadCacheStats stats = a->GetThreadCacheStats();
+  EXPECT_EQ(0, stats.num_hits + stats.num_misses);
+  EXPECT_EQ(0, stats.bytes_cached);
+}
+
+TEST(BFCAllocatorTest, ThreadCacheReturnsChunksInBatches) {
+  auto a = MakeAllocator(16 << 20, /*allow_growth=*/true,
+                         /*thread_cache=*/true);
+  std::vector<void*> ptrs;
+  for (int i = 0; i < 1000; ++i) {
+    ptrs.push_back(a->AllocateRaw(1, 4096));
+  }
+  for (void* ptr : ptrs) {
+    a->DeallocateRaw(ptr);
+  }
+  // The caches hold a bounded number of chunks per size class.
+  BFCAllocator::ThreadCacheStats stats = a->GetThreadCacheStats();
+  EXPECT_GT(stats.num_flushes, 0);
+  EXPECT_LT(stats.bytes_cached, 1000 * 4096);
+  EXPECT_EQ(0, a->GetStats()->bytes_in_use);
+}
+
+TEST(BFCAllocatorTest, ThreadCacheIsDrainedWhenOutOfMemory) {
+  const size_t kTotalMemory = 1 << 20;
+  auto a = MakeAllocator(kTotalMemory, /*allow_growth=*/false,
+                         /*thread_cache=*/true);
+  std::vector<void*> ptrs;
+  for (int i = 0; i < 8; ++i) {
+    ptrs.push_back(a->AllocateRaw(1, 1024));
+  }
+  for (void* ptr : ptrs) {
+    a->DeallocateRaw(ptr);
+  }
+  ASSERT_GT(a->GetThreadCacheStats().bytes_cached, 0);
+
+  // Only the coalesced chunks of the cache can satisfy the allocation.
+  AllocationAttributes attrs;
+  attrs.no_retry_on_failure = true;
+  void* ptr = a->AllocateRaw(1, kTotalMemory, attrs);
+  ASSERT_NE(nullptr, ptr);
+  EXPECT_EQ(0, a->GetThreadCacheStats().bytes_cached);
+  a->DeallocateRaw(ptr);
+}
+
+TEST(BFCAllocatorTest, ThreadCacheWithConcurrentThreads) {
+  auto a = MakeAllocator(256 << 20, /*allow_growth=*/true,
+                         /*thread_cache=*/true);
+  const int kNumThreads = 8;
+  {
+    thread::ThreadPool pool(Env::Default(), "bfc_test", kNumThreads);
+    for (int t = 0; t < kNumThreads; ++t) {
+      pool.Schedule([&a, t]() {
+        random::PhiloxRandom philox(t, 17);
+        random::SimplePhilox rand(&philox);
+        std::vector<std::pair<char*, size_t>> live;
+        for (int i = 0; i < 2000; ++i) {
+          if (live.size() < 16 && rand.Uniform(3) != 0) {
+            const size_t num_bytes = 1 + rand.Uniform(8192);
+            char* ptr = static_cast<char*>(a->AllocateRaw(1, num_bytes));
+            ASSERT_NE(nullptr, ptr);
+            memset(ptr, t, num_bytes);
+            live.emplace_back(ptr, num_bytes);
+          } else if (!live.empty()) {
+            auto entry = live.back();
+            live.pop_back();
+            // No other thread wrote to the buffer while it was allocated.
+            for (size_t j = 0; j < entry.second; ++j) {
+              ASSERT_EQ(static_cast<char>(t), entry.first[j]);
+            }
+            a->DeallocateRaw(entry.first);
+          }
+        }
+        for (auto& entry : live) {
+          a->DeallocateRaw(entry.first);
+        }
+      });
+    }
+  }
+  BFCAllocator::ThreadCacheStats stats = a->GetThreadCacheStats();
+  EXPECT_GT(stats.num_hits, 0);
+}
+
+static void BM_AllocationThreaded(int iters, int num_threads,
+                                  bool thread_cache) {
+  testing::StopTiming();
+  auto a = MakeAllocator(1 << 30, /*allow_growth=*/true, thread_cache);
+  thread::ThreadPool pool(Env::Default(), "bfc_bench", num_threads);
+  BlockingCounter counter(num_threads);
+  const std::vector<int> sizes = {256, 1024, 4096, 16384};
+  testing::StartTiming();
+  for (int t = 0; t < num_threads; ++t) {
+    pool.Schedule([&a, &counter, &sizes, iters, num_threads]() {
+      for (int i = 0; i < iters / num_threads; ++i) {
+        void* ptrs[4];
+        for (int j = 0; j < 4; ++j) {
+          ptrs[j] = a->AllocateRaw(1, sizes[(i + j) % sizes.size()]);
+        }
+        for (int j = 0; j < 4; ++j) {
+          a->DeallocateRaw(ptrs[j]);
+        }
+      }
+      counter.DecrementCount();
+    });
+  }
+  counter.Wait();
+  testing::StopTiming();
+}
+
+static void BM_AllocationThreadedWithoutCache(int iters, int num_threads) {
+  BM_AllocationThreaded(iters, num_threads, /*thread_cache=*/false);
+}
+BENCHMARK(BM_AllocationThreadedWithoutCache)->Arg(1)->Arg(4)->Arg(16);
+
+static void BM_AllocationThreadedWithCache(int iters, int num_threads) {
+  BM_AllocationThreaded(iters, num_threads, /*thread_cache=*/true);
+}
+BENCHMARK(BM_AllocationThreadedWithCache)->Arg(1)->Arg(4)->Arg(16);
+
+}  // namespace
+}  // namespace tensorflow
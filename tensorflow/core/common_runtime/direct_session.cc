@@ -20,6 +20,7 @@ limitations under the License.
 #include <vector>
 
 #include "absl/container/flat_hash_set.h"
+#include "absl/strings/ascii.h"
 #include "tensorflow/core/common_runtime/collective_executor_mgr.h"
 #include "tensorflow/core/common_runtime/collective_param_resolver_local.h"
 #include "tensorflow/core/common_runtime/constant_folding.h"
@@ -64,9 +65,11 @@ limitations under the License.
 #include "tensorflow/core/lib/random/random.h"
 #include "tensorflow/core/lib/strings/numbers.h"
 #include "tensorflow/core/lib/strings/str_util.h"
+#include "tensorflow/core/lib/strings/proto_serialization.h"
 #include "tensorflow/core/lib/strings/strcat.h"
 #include "tensorflow/core/platform/byte_order.h"
 #include "tensorflow/core/platform/cpu_info.h"
+#include "tensorflow/core/platform/fingerprint.h"
 #include "tensorflow/core/platform/logging.h"
 #include "tensorflow/core/platform/mutex.h"
 #include "tensorflow/core/platform/tracing.h"
@@ -74,6 +77,7 @@ limitations under the License.
 #include "tensorflow/core/profiler/lib/profiler_session.h"
 #include "tensorflow/core/profiler/lib/traceme.h"
 #include "tensorflow/core/protobuf/config.pb.h"
+#include "tensorflow/core/public/version.h"
 #include "tensorflow/core/util/device_name_utils.h"
 #include "tensorflow/core/util/env_var.h"
 
@@ -151,6 +155,30 @@ string GetRendezvousKey(const string& tensor_name,
                          frame_iter.frame_id, ":", frame_iter.iter_id);
 }
 
+// Returns the key of the prepared executors of `callable_options`.
+string PreparedExecutorsKey(const CallableOptions& callable_options) {
+  string key;
+  SerializeToStringDeterministic(callable_options, &key);
+  return key;
+}
+
+// Returns true if `name` has the form "<prefix>/_<n>" of the names of the
+// nodes that partitioning adds, and sets `*prefix` and `*n`.
+bool ParsePartitionNodeName(StringPiece name, StringPiece* prefix, int64* n) {
+  const size_t pos = name.rfind("/_");
+  if (pos == StringPiece::npos || pos + 2 == name.size()) {
+    return false;
+  }
+  const StringPiece digits = name.substr(pos + 2);
+  for (char c : digits) {
+    if (!absl::ascii_isdigit(c)) {
+      return false;
+    }
+  }
+  *prefix = name.substr(0, pos);
+  return strings::safe_strto64(digits, n);
+}
+
 }  // namespace
 
 class DirectSessionFactory : public SessionFactory {
@@ -422,6 +450,10 @@ Status DirectSession::Extend(GraphDef&& graph) {
 }
 
 Status DirectSession::ExtendLocked(GraphDef graph) {
+  string serialized_graph;
+  SerializeToStringDeterministic(graph, &serialized_graph);
+  graph_fingerprint_ =
+      FingerprintCat64(graph_fingerprint_, Fingerprint64(serialized_graph));
   if (!(flib_def_ && execution_state_)) {
     // If this is the first call, we can initialize the execution state
     // with `graph` and do not need to call `Extend()`.
@@ -657,7 +689,9 @@ Status DirectSession::RunInternal(
   if (ShouldUseRunHandlerPool(run_options) &&
       run_options.experimental().use_run_handler_pool()) {
     VLOG(1) << "Using RunHandler to scheduler inter-op closures.";
-    handler = GetOrCreateRunHandlerPool(options_)->Get(step_id);
+    handler = GetOrCreateRunHandlerPool(options_)->Get(
+        step_id, run_options.timeout_in_ms(),
+        run_options.experimental().run_handler_pool_options());
   }
   auto* handler_ptr = handler.get();
 
@@ -1237,14 +1271,11 @@ Status DirectSession::CheckFetch(const NamedTensorList& feeds,
   return Status::OK();
 }
 
-Status DirectSession::CreateExecutors(
-    const CallableOptions& callable_options,
-    std::unique_ptr<ExecutorsAndKeys>* out_executors_and_keys,
-    std::unique_ptr<FunctionInfo>* out_func_info,
-    RunStateArgs* run_state_args) {
+BuildGraphOptions DirectSession::MakeBuildGraphOptions(
+    const CallableOptions& callable_options, bool is_partial_run) const {
   BuildGraphOptions options;
   options.callable_options = callable_options;
-  options.use_function_convention = !run_state_args->is_partial_run;
+  options.use_function_convention = !is_partial_run;
   options.collective_graph_key =
       callable_options.run_options().experimental().collective_graph_key();
   if (options_.config.experimental()
@@ -1253,6 +1284,16 @@ Status DirectSession::CreateExecutors(
   } else if (options_.config.experimental().collective_nccl()) {
     options.collective_order = GraphCollectiveOrder::kAttrs;
   }
+  return options;
+}
+
+Status DirectSession::CreateExecutors(
+    const CallableOptions& callable_options,
+    std::unique_ptr<ExecutorsAndKeys>* out_executors_and_keys,
+    std::unique_ptr<FunctionInfo>* out_func_info,
+    RunStateArgs* run_state_args) {
+  const BuildGraphOptions options =
+      MakeBuildGraphOptions(callable_options, run_state_args->is_partial_run);
 
   std::unique_ptr<FunctionInfo> func_info(new FunctionInfo);
   std::unique_ptr<ExecutorsAndKeys> ek(new ExecutorsAndKeys);
@@ -1344,6 +1385,14 @@ Status DirectSession::CreateExecutors(
       *r = new IntraProcessRendezvous(device_mgr);
       return Status::OK();
     };
+    params.use_step_arena =
+        options_.config.experimental().use_step_arena_allocator() &&
+        device->device_type() == DEVICE_CPU;
+    params.use_static_memory_plan =
+        options_.config.experimental().use_static_memory_plan() &&
+        device->device_type() == DEVICE_CPU;
+    params.use_step_ready_queue =
+        options_.config.experimental().use_step_ready_queue();
 
     optimizer.Optimize(lib, options_.env, device, &partition_graph,
                        /*shape_map=*/nullptr);
@@ -1532,6 +1581,15 @@ Status DirectSession::CreateGraphs(
     RunStateArgs* run_state_args, DataTypeVector* input_types,
     DataTypeVector* output_types, int64* collective_graph_key) {
   mutex_lock l(graph_state_lock_);
+  if (!run_state_args->is_partial_run) {
+    auto it = prepared_executors_.find(
+        PreparedExecutorsKey(subgraph_options.callable_options));
+    if (it != prepared_executors_.end()) {
+      return CreateGraphsFromPrepared(*it->second, outputs, flib_def,
+                                      input_types, output_types,
+                                      collective_graph_key);
+    }
+  }
   std::unique_ptr<ClientGraph> client_graph;
 
   std::unique_ptr<GraphExecutionState> temp_exec_state_holder;
@@ -1680,6 +1738,189 @@ Status DirectSession::CreateGraphs(
   return s;
 }
 
+Status DirectSession::CreateGraphsFromPrepared(
+    const PreparedExecutors& prepared,
+    std::unordered_map<string, std::unique_ptr<Graph>>* outputs,
+    std::unique_ptr<FunctionLibraryDefinition>* flib_def,
+    DataTypeVector* input_types, DataTypeVector* output_types,
+    int64* collective_graph_key) {
+  VLOG(1) << "Creating the graphs of " << prepared.partition_graphs_size()
+          << " partitions from prepared executors.";
+  flib_def->reset(
+      new FunctionLibraryDefinition(OpRegistry::Global(), prepared.library()));
+  for (const auto& partition : prepared.partition_graphs()) {
+    std::unique_ptr<Graph> device_graph(new Graph(flib_def->get()));
+    GraphConstructorOptions device_opts;
+    device_opts.allow_internal_ops = true;
+    device_opts.expect_device_spec = true;
+    TF_RETURN_IF_ERROR(ConvertGraphDefToGraph(device_opts, partition.second,
+                                              device_graph.get()));
+    outputs->emplace(partition.first, std::move(device_graph));
+  }
+  input_types->clear();
+  for (int dtype : prepared.feed_types()) {
+    input_types->push_back(static_cast<DataType>(dtype));
+  }
+  output_types->clear();
+  for (int dtype : prepared.fetch_types()) {
+    output_types->push_back(static_cast<DataType>(dtype));
+  }
+  *collective_graph_key = prepared.collective_graph_key();
+  return Status::OK();
+}
+
+uint64 DirectSession::PreparedExecutorsFingerprint(
+    const CallableOptions& callable_options) {
+  uint64 fingerprint = FingerprintCat64(
+      graph_fingerprint_,
+      Fingerprint64(PreparedExecutorsKey(callable_options)));
+  for (const Device* device : devices_) {
+    fingerprint = FingerprintCat64(fingerprint, Fingerprint64(device->name()));
+    fingerprint =
+        FingerprintCat64(fingerprint, Fingerprint64(device->device_type()));
+  }
+  string graph_options;
+  SerializeToStringDeterministic(options_.config.graph_options(),
+                                 &graph_options);
+  fingerprint = FingerprintCat64(fingerprint, Fingerprint64(graph_options));
+  // The graphs are only valid for the kernels and optimizations of the same
+  // version of TensorFlow.
+  return FingerprintCat64(fingerprint, Fingerprint64(tf_git_version()));
+}
+
+void DirectSession::RenamePartitionNodes(PreparedExecutors* prepared) {
+  std::unordered_set<string> graph_node_names;
+  for (const Node* n : execution_state_->full_graph()->nodes()) {
+    graph_node_names.insert(n->name());
+  }
+  auto is_partition_node = [&graph_node_names](const string& name,
+                                               StringPiece* prefix, int64* n) {
+    return graph_node_names.count(name) == 0 &&
+           ParsePartitionNodeName(name, prefix, n);
+  };
+  StringPiece prefix;
+  int64 n;
+  int64 max_n = -1;
+  for (const auto& partition : prepared->partition_graphs()) {
+    for (const NodeDef& node : partition.second.node()) {
+      if (is_partition_node(node.name(), &prefix, &n)) {
+        max_n = std::max(max_n, n);
+      }
+    }
+  }
+  if (max_n < 0) {
+    return;
+  }
+  // Stateful kernels, such as those of _Send and _Recv, are shared between
+  // the graphs of the session by node name. Moves the suffixes of the names
+  // past those that this session generated, and reserves them.
+  const int64 offset = edge_name_counter_.fetch_add(max_n + 1);
+  std::unordered_map<string, string> new_names;
+  for (auto& partition : *prepared->mutable_partition_graphs()) {
+    for (NodeDef& node : *partition.second.mutable_node()) {
+      if (is_partition_node(node.name(), &prefix, &n)) {
+        string new_name = strings::StrCat(prefix, "/_", n + offset);
+        new_names.emplace(node.name(), new_name);
+        node.set_name(std::move(new_name));
+      }
+    }
+  }
+  for (auto& partition : *prepared->mutable_partition_graphs()) {
+    for (NodeDef& node : *partition.second.mutable_node()) {
+      for (string& input : *node.mutable_input()) {
+        const TensorId id = ParseTensorName(input);
+        auto it = new_names.find(string(id.node()));
+        if (it == new_names.end()) {
+          continue;
+        }
+        if (id.index() == Graph::kControlSlot) {
+          input = strings::StrCat("^", it->second);
+        } else {
+          input = strings::StrCat(it->second, ":", id.index());
+        }
+      }
+    }
+  }
+}
+
+Status DirectSession::ExportPreparedExecutors(
+    const CallableOptions& callable_options, PreparedExecutors* prepared) {
+  TF_RETURN_IF_ERROR(CheckNotClosed());
+  TF_RETURN_IF_ERROR(CheckGraphCreated("ExportPreparedExecutors()"));
+  RunStateArgs run_state_args(callable_options.run_options().debug_options());
+  std::unordered_map<string, std::unique_ptr<Graph>> graphs;
+  std::unique_ptr<FunctionLibraryDefinition> flib_def;
+  DataTypeVector input_types;
+  DataTypeVector output_types;
+  int64 collective_graph_key;
+  TF_RETURN_IF_ERROR(CreateGraphs(
+      MakeBuildGraphOptions(callable_options, /*is_partial_run=*/false),
+      &graphs, &flib_def, &run_state_args, &input_types, &output_types,
+      &collective_graph_key));
+
+  prepared->Clear();
+  *prepared->mutable_callable_options() = callable_options;
+  for (const auto& partition : graphs) {
+    partition.second->ToGraphDef(
+        &(*prepared->mutable_partition_graphs())[partition.first]);
+  }
+  *prepared->mutable_library() = flib_def->ToProto();
+  for (DataType dtype : input_types) {
+    prepared->add_feed_types(dtype);
+  }
+  for (DataType dtype : output_types) {
+    prepared->add_fetch_types(dtype);
+  }
+  prepared->set_collective_graph_key(collective_graph_key);
+
+  mutex_lock l(graph_state_lock_);
+  for (const auto& placement : stateful_placements_) {
+    (*prepared->mutable_stateful_placements())[placement.first] =
+        placement.second;
+  }
+  prepared->set_fingerprint(PreparedExecutorsFingerprint(callable_options));
+  return Status::OK();
+}
+
+Status DirectSession::ImportPreparedExecutors(
+    const PreparedExecutors& prepared) {
+  TF_RETURN_IF_ERROR(CheckNotClosed());
+  mutex_lock l(graph_state_lock_);
+  if (!graph_created_) {
+    return errors::InvalidArgument(
+        "Session was not created with a graph before "
+        "ImportPreparedExecutors()!");
+  }
+  if (prepared.fingerprint() !=
+      PreparedExecutorsFingerprint(prepared.callable_options())) {
+    return errors::FailedPrecondition(
+        "The prepared executors were exported from a session with a "
+        "different graph, devices, graph options or version of TensorFlow.");
+  }
+  for (const auto& partition : prepared.partition_graphs()) {
+    Device* device;
+    TF_RETURN_IF_ERROR(device_mgr_->LookupDevice(partition.first, &device));
+  }
+  for (const auto& placement : prepared.stateful_placements()) {
+    auto iter = stateful_placements_.find(placement.first);
+    if (iter != stateful_placements_.end() &&
+        iter->second != placement.second) {
+      return errors::FailedPrecondition(
+          "Stateful placement mismatch. Current assignment of ",
+          placement.first, " to ", iter->second, " does not match ",
+          placement.second);
+    }
+  }
+  std::unique_ptr<PreparedExecutors> renamed(new PreparedExecutors(prepared));
+  RenamePartitionNodes(renamed.get());
+  for (const auto& placement : prepared.stateful_placements()) {
+    stateful_placements_.insert({placement.first, placement.second});
+  }
+  prepared_executors_[PreparedExecutorsKey(prepared.callable_options())] =
+      std::move(renamed);
+  return Status::OK();
+}
+
 ::tensorflow::Status DirectSession::ListDevices(
     std::vector<DeviceAttributes>* response) {
   response->clear();
@@ -43,6 +43,7 @@ limitations under the License.
 #include "tensorflow/core/platform/mutex.h"
 #include "tensorflow/core/platform/thread_annotations.h"
 #include "tensorflow/core/platform/types.h"
+#include "tensorflow/core/protobuf/prepared_executors.pb.h"
 #include "tensorflow/core/public/session.h"
 
 namespace tensorflow {
@@ -110,6 +111,19 @@ class DirectSession : public Session {
     cost_model_manager_.ExportCostModels(cost_models);
   }
 
+  // Places, optimizes and partitions the graphs that run `callable_options`,
+  // and exports them to `prepared`. Another session can import them with
+  // ImportPreparedExecutors() to skip building the graphs on its first run.
+  ::tensorflow::Status ExportPreparedExecutors(
+      const CallableOptions& callable_options, PreparedExecutors* prepared);
+
+  // Makes the executors of `prepared.callable_options()` run the graphs of
+  // `prepared` instead of building them. Returns an error if `prepared` was
+  // exported from a session with a different graph, devices or graph
+  // options.
+  ::tensorflow::Status ImportPreparedExecutors(
+      const PreparedExecutors& prepared);
+
   ::tensorflow::Status MakeCallable(const CallableOptions& callable_options,
                                     CallableHandle* out_handle) override;
 
@@ -238,6 +252,10 @@ class DirectSession : public Session {
       std::unique_ptr<FunctionInfo>* out_func_info,
       RunStateArgs* run_state_args);
 
+  // Returns the options to build the graphs that run `callable_options`.
+  BuildGraphOptions MakeBuildGraphOptions(
+      const CallableOptions& callable_options, bool is_partial_run) const;
+
   // Creates several graphs given the existing graph_def_ and the
   // input feeds and fetches, given 'devices'. The graphs share a common
   // function library 'flib_def'.
@@ -248,6 +266,25 @@ class DirectSession : public Session {
       RunStateArgs* run_state_args, DataTypeVector* input_types,
       DataTypeVector* output_types, int64* collective_graph_key);
 
+  // Creates the graphs of `prepared`, like CreateGraphs().
+  ::tensorflow::Status CreateGraphsFromPrepared(
+      const PreparedExecutors& prepared,
+      std::unordered_map<string, std::unique_ptr<Graph>>* outputs,
+      std::unique_ptr<FunctionLibraryDefinition>* flib_def,
+      DataTypeVector* input_types, DataTypeVector* output_types,
+      int64* collective_graph_key);
+
+  // Returns the fingerprint that prepared executors of `callable_options`
+  // must have to run in this session.
+  uint64 PreparedExecutorsFingerprint(const CallableOptions& callable_options)
+      EXCLUSIVE_LOCKS_REQUIRED(graph_state_lock_);
+
+  // Renames the nodes that partitioning added to the graphs of `prepared`,
+  // so that they do not share kernels with the nodes of other graphs of this
+  // session.
+  void RenamePartitionNodes(PreparedExecutors* prepared)
+      EXCLUSIVE_LOCKS_REQUIRED(graph_state_lock_);
+
   ::tensorflow::Status RunInternal(
       int64 step_id, const RunOptions& run_options,
       CallFrameInterface* call_frame, ExecutorsAndKeys* executors_and_keys,
@@ -378,6 +415,14 @@ class DirectSession : public Session {
   std::unordered_map<string, string> stateful_placements_
       GUARDED_BY(graph_state_lock_);
 
+  // The fingerprint of the GraphDefs that created and extended the graph.
+  uint64 graph_fingerprint_ GUARDED_BY(graph_state_lock_) = 0;
+
+  // The imported prepared executors, keyed by their serialized callable
+  // options.
+  std::unordered_map<string, std::unique_ptr<PreparedExecutors>>
+      prepared_executors_ GUARDED_BY(graph_state_lock_);
+
   // Execution_state; used when placing the entire graph.
   std::unique_ptr<GraphExecutionState> execution_state_
       GUARDED_BY(graph_state_lock_);
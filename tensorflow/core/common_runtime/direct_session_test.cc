@@ -196,6 +196,74 @@ TEST_F(DirectSessionMinusAXTest, RunSimpleNetwork_Callable) {
   }
 }
 
+TEST_F(DirectSessionMinusAXTest, ImportPreparedExecutors) {
+  Initialize({3, 2, -1, 0});
+  const CallableOptions callable_options =
+      MakeCallableOptions({x_ + ":0"}, {y_neg_ + ":0"}, {});
+  PreparedExecutors prepared;
+  {
+    auto session = CreateSession();
+    ASSERT_TRUE(session != nullptr);
+    TF_ASSERT_OK(session->Create(def_));
+    TF_ASSERT_OK(static_cast<DirectSession*>(session.get())
+                     ->ExportPreparedExecutors(callable_options, &prepared));
+  }
+  EXPECT_EQ(2, prepared.partition_graphs_size());
+  // Removes the negation, so that the result shows which graphs ran.
+  int num_negs = 0;
+  for (auto& partition : *prepared.mutable_partition_graphs()) {
+    for (NodeDef& node : *partition.second.mutable_node()) {
+      if (node.op() == "Neg") {
+        node.set_op("Identity");
+        ++num_negs;
+      }
+    }
+  }
+  ASSERT_EQ(1, num_negs);
+
+  auto session = CreateSession();
+  ASSERT_TRUE(session != nullptr);
+  TF_ASSERT_OK(session->Create(def_));
+  // Partitions the graph of another run first, so that the nodes that
+  // partitioning added to the prepared graphs must be renamed.
+  std::vector<Tensor> outputs;
+  TF_ASSERT_OK(session->Run({}, {y_neg_ + ":0"}, {}, &outputs));
+  TF_ASSERT_OK(static_cast<DirectSession*>(session.get())
+                   ->ImportPreparedExecutors(prepared));
+
+  Session::CallableHandle handle;
+  TF_ASSERT_OK(session->MakeCallable(callable_options, &handle));
+  Tensor x(DT_FLOAT, TensorShape({2, 1}));
+  test::FillValues<float>(&x, {1, 1});
+  TF_ASSERT_OK(session->RunCallable(handle, {x}, &outputs, nullptr));
+  ASSERT_EQ(1, outputs.size());
+  test::ExpectTensorEqual<float>(test::AsTensor<float>({5, -1}, {2, 1}),
+                                 outputs[0]);
+  TF_ASSERT_OK(session->ReleaseCallable(handle));
+}
+
+TEST_F(DirectSessionMinusAXTest, ImportPreparedExecutorsOfAnotherGraphFails) {
+  Initialize({3, 2, -1, 0});
+  const CallableOptions callable_options =
+      MakeCallableOptions({}, {y_neg_ + ":0"}, {});
+  PreparedExecutors prepared;
+  {
+    auto session = CreateSession();
+    ASSERT_TRUE(session != nullptr);
+    TF_ASSERT_OK(session->Create(def_));
+    TF_ASSERT_OK(static_cast<DirectSession*>(session.get())
+                     ->ExportPreparedExecutors(callable_options, &prepared));
+  }
+
+  Initialize({1, 2, 3, 4});
+  auto session = CreateSession();
+  ASSERT_TRUE(session != nullptr);
+  TF_ASSERT_OK(session->Create(def_));
+  Status s = static_cast<DirectSession*>(session.get())
+                 ->ImportPreparedExecutors(prepared);
+  EXPECT_TRUE(errors::IsFailedPrecondition(s)) << s;
+}
+
 TEST_F(DirectSessionMinusAXTest, RunSimpleNetwork_OptimizeForStaticGraph) {
   Initialize({3, 2, -1, 0});
   SessionOptions options(DefaultSessionOptions());
@@ -767,6 +835,37 @@ TEST(DirectSessionTest, KeepsStateAcrossRunsOfSession) {
   EXPECT_EQ(20.0, outputs[0].flat<float>()(0));
 }
 
+TEST(DirectSessionTest, WideFanOutWithStepReadyQueue) {
+  // b <- a * 128, with the 64 sums of a + a handed off between threads.
+  GraphDef def;
+  Graph g(OpRegistry::Global());
+  Tensor zero(DT_FLOAT, TensorShape({}));
+  zero.scalar<float>()() = 0.0;
+  Node* a = test::graph::Constant(&g, zero);
+  std::vector<Node*> sums;
+  for (int i = 0; i < 64; ++i) {
+    sums.push_back(test::graph::Add(&g, a, a));
+  }
+  Node* b = test::graph::Multi(&g, "AddN", sums);
+  g.ToGraphDef(&def);
+
+  SessionOptions options(DefaultSessionOptions());
+  options.config.mutable_experimental()->set_use_step_ready_queue(true);
+  auto session = absl::WrapUnique(NewSession(options));
+  ASSERT_TRUE(session != nullptr);
+  TF_ASSERT_OK(session->Create(def));
+
+  for (int step = 0; step < 3; ++step) {
+    Tensor a_value(DT_FLOAT, TensorShape({}));
+    a_value.scalar<float>()() = step;
+    std::vector<Tensor> outputs;
+    TF_ASSERT_OK(session->Run({{a->name() + ":0", a_value}},
+                              {b->name() + ":0"}, {}, &outputs));
+    ASSERT_EQ(1, outputs.size());
+    EXPECT_EQ(128.0 * step, outputs[0].scalar<float>()());
+  }
+}
+
 TEST(DirectSessionTest, MultipleFeedTest) {
   GraphDef def;
   Graph g(OpRegistry::Global());
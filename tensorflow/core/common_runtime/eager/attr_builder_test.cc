@@ -83,6 +83,32 @@ TEST(AttrTypeMap, CacheKey) {
   ASSERT_FALSE(cache_key == a.CacheKey("cpu:0"));
 }
 
+TEST(AttrTypeMap, CacheKeyIsIncremental) {
+  AttrBuilder a("op_name");
+  a.Set("T", TF_FLOAT);
+  a.Set("x", 1.0);
+  tensorflow::Fprint128 cache_key = a.CacheKey("cpu:0");
+
+  // The order of the attributes does not matter, and setting an attribute
+  // again keeps its first value.
+  AttrBuilder b("op_name");
+  b.Set("x", 1.0);
+  b.Set("T", TF_FLOAT);
+  b.Set("T", TF_INT32);
+  ASSERT_TRUE(cache_key == b.CacheKey("cpu:0"));
+
+  // A reset builder computes the same keys as a new one.
+  b.Reset("other_op");
+  b.Set("T", TF_FLOAT);
+  AttrBuilder c("other_op");
+  c.Set("T", TF_FLOAT);
+  ASSERT_TRUE(c.CacheKey("cpu:0") == b.CacheKey("cpu:0"));
+  b.Reset("op_name");
+  b.Set("T", TF_FLOAT);
+  b.Set("x", 1.0);
+  ASSERT_TRUE(cache_key == b.CacheKey("cpu:0"));
+}
+
 string ToString(const AttrValueMap& m) {
   std::vector<string> strs;
   for (const auto& e : m) {
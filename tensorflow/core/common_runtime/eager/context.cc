@@ -15,6 +15,9 @@ limitations under the License.
 
 #include "tensorflow/core/common_runtime/eager/context.h"
 
+#include <atomic>
+#include <thread>  // NOLINT
+#include <unordered_set>
 #include <vector>
 
 // clang-format off
@@ -64,6 +67,137 @@ auto* eager_context_created =
     monitoring::Gauge<bool, 0>::New("/tensorflow/core/eager_context_created",
                                     "True if an eager context was created.");
 
+// A small cache of kernels in front of the kernel caches of the contexts, so
+// that a thread that dispatches the same ops over and over finds their
+// kernels without taking any lock.
+//
+// Each context has a generation, which it bumps whenever kernels leave its
+// cache. An entry is only valid for the generation that it was inserted in,
+// so the entries of the other threads are invalidated without touching them,
+// and are overwritten lazily, unless the context must release their kernels
+// (`ReleaseContext`). Only the thread that owns a cache inserts into
+// it, under `mu_`; `Lookup` only reads it, and announces itself through
+// `in_lookup_` instead of taking `mu_`.
+class ThreadKernelCache {
+ public:
+  static ThreadKernelCache* Get() {
+    thread_local ThreadKernelCache cache;
+    return &cache;
+  }
+
+  core::RefCountPtr<KernelAndDevice> Lookup(
+      uint64 context_id, const std::atomic<uint64>& generation,
+      const Fprint128& cache_key) {
+    // Pairs with `ReleaseContext`: either it waits for this lookup to take
+    // its reference, or this lookup sees the new generation.
+    in_lookup_.store(true, std::memory_order_seq_cst);
+    const Entry& entry = EntryFor(cache_key);
+    core::RefCountPtr<KernelAndDevice> new_ref;
+    if (entry.context_id == context_id &&
+        entry.generation == generation.load(std::memory_order_seq_cst) &&
+        entry.cache_key == cache_key) {
+      new_ref.reset(entry.kernel.get());
+      new_ref->Ref();
+    }
+    in_lookup_.store(false, std::memory_order_release);
+    return new_ref;
+  }
+
+  // The caller must hold the lock of the kernel cache of the context, so that
+  // the generation cannot change in the meantime.
+  void Insert(uint64 context_id, const std::atomic<uint64>& generation,
+              const Fprint128& cache_key, KernelAndDevice* kernel) {
+    mutex_lock l(mu_);
+    Entry& entry = EntryFor(cache_key);
+    kernel->Ref();
+    entry.kernel.reset(kernel);
+    entry.context_id = context_id;
+    entry.generation = generation.load(std::memory_order_relaxed);
+    entry.cache_key = cache_key;
+  }
+
+  // Invalidates the entries of a context in the caches of all threads. The
+  // caller must hold the lock of the kernel cache of the context. The stale
+  // entries keep their kernels alive until they are overwritten, or until
+  // `ReleaseContext`.
+  static void InvalidateContext(std::atomic<uint64>* generation) {
+    generation->fetch_add(1, std::memory_order_seq_cst);
+  }
+
+  // Invalidates the entries of `context_id` and drops their kernels from the
+  // caches of all threads, e.g. before the devices that the kernels use go
+  // away. The caller must hold the lock of the kernel cache of the context.
+  static void ReleaseContext(uint64 context_id,
+                             std::atomic<uint64>* generation) {
+    InvalidateContext(generation);
+    mutex_lock l(*registry_mu());
+    for (ThreadKernelCache* cache : *registry()) {
+      // A lookup that started before the new generation may still be taking
+      // a reference to one of the kernels; the later ones miss.
+      while (cache->in_lookup_.load(std::memory_order_seq_cst)) {
+        std::this_thread::yield();
+      }
+      mutex_lock cache_lock(cache->mu_);
+      for (Entry& entry : cache->entries_) {
+        if (entry.context_id == context_id) {
+          entry.kernel.reset();
+        }
+      }
+    }
+  }
+
+ private:
+  static constexpr int kNumEntries = 64;
+
+  struct Entry {
+    uint64 context_id = 0;
+    uint64 generation = 0;
+    Fprint128 cache_key = {0, 0};
+    core::RefCountPtr<KernelAndDevice> kernel;
+  };
+
+  static mutex* registry_mu() {
+    static mutex* mu = new mutex;
+    return mu;
+  }
+  static std::unordered_set<ThreadKernelCache*>* registry() {
+    static auto* caches = new std::unordered_set<ThreadKernelCache*>;
+    return caches;
+  }
+
+  ThreadKernelCache() {
+    mutex_lock l(*registry_mu());
+    registry()->insert(this);
+  }
+
+  ~ThreadKernelCache() {
+    // The entries are released while the cache is still registered, so that
+    // no context can go away before they are.
+    mutex_lock l(*registry_mu());
+    {
+      mutex_lock cache_lock(mu_);
+      for (Entry& entry : entries_) {
+        entry.kernel.reset();
+      }
+    }
+    registry()->erase(this);
+  }
+
+  Entry& EntryFor(const Fprint128& cache_key) {
+    return entries_[cache_key.low64 % kNumEntries];
+  }
+
+  // Serializes the writes to `entries_`, which `Lookup` reads without it.
+  mutex mu_;
+  std::atomic<bool> in_lookup_{false};
+  Entry entries_[kNumEntries];
+};
+
+uint64 NewKernelCacheId() {
+  static std::atomic<uint64> next_id(1);
+  return next_id.fetch_add(1, std::memory_order_relaxed);
+}
+
 }  // namespace
 
 EagerContext::EagerContext(
@@ -104,6 +238,7 @@ EagerContext::EagerContext(
     local_unowned_device_manager_ = device_mgr;
   }
   InitDeviceMapAndAsync();
+  kernel_cache_id_ = NewKernelCacheId();
   runner_ = [this](std::function<void()> closure) {
     this->thread_pool_->Schedule(std::move(closure));
   };
@@ -170,6 +305,8 @@ void EagerContext::ClearCaches() {
     // as well.
     mutex_lock ml(cache_mu_);
     default_executor_.WaitForAllPendingNodes().IgnoreError();
+    ThreadKernelCache::ReleaseContext(kernel_cache_id_,
+                                      &kernel_cache_generation_);
     kernel_cache_.clear();
     for (auto& entry : registered_functions_) {
       entry.second->cached_kernel_keys->clear();
@@ -504,6 +641,7 @@ Status EagerContext::RemoveFunction(const string& func) {
     }
     is_last_ref = registered_function->RefCountIsOne();
     if (is_last_ref) {
+      ThreadKernelCache::InvalidateContext(&kernel_cache_generation_);
       for (auto& key : *registered_function->cached_kernel_keys) {
         kernel_cache_.erase(key);
       }
@@ -520,11 +658,20 @@ Status EagerContext::RemoveFunction(const string& func) {
 
 core::RefCountPtr<KernelAndDevice> EagerContext::GetCachedKernel(
     Fprint128 cache_key) {
+  ThreadKernelCache* thread_cache = ThreadKernelCache::Get();
+  core::RefCountPtr<KernelAndDevice> kernel =
+      thread_cache->Lookup(kernel_cache_id_, kernel_cache_generation_,
+                           cache_key);
+  if (kernel) {
+    return kernel;
+  }
   tf_shared_lock l(cache_mu_);
   auto iter = kernel_cache_.find(cache_key);
   if (iter == kernel_cache_.end()) {
     return nullptr;
   }
+  thread_cache->Insert(kernel_cache_id_, kernel_cache_generation_, cache_key,
+                       iter->second.get());
   core::RefCountPtr<KernelAndDevice> new_ref(iter->second.get());
   new_ref->Ref();
   return new_ref;
@@ -536,6 +683,8 @@ void EagerContext::AddKernelToCache(Fprint128 cache_key,
   core::RefCountPtr<KernelAndDevice> new_ref(kernel);
   new_ref->Ref();
   kernel_cache_[cache_key] = std::move(new_ref);
+  ThreadKernelCache::Get()->Insert(kernel_cache_id_, kernel_cache_generation_,
+                                   cache_key, kernel);
   auto* registered_function =
       gtl::FindPtrOrNull(registered_functions_, kernel->name());
   // The kernel name can be either a primitive op or a function.
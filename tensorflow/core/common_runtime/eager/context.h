@@ -421,6 +421,12 @@ class EagerContext : public core::RefCounted {
   std::function<void(std::function<void()>)> runner_;
 
   mutex cache_mu_;
+  // Identifies the entries of this context in the per-thread kernel caches
+  // that `GetCachedKernel` consults before `kernel_cache_`.
+  uint64 kernel_cache_id_;
+  // Bumped under `cache_mu_` whenever kernels leave `kernel_cache_`, which
+  // invalidates the entries of the per-thread kernel caches.
+  std::atomic<uint64> kernel_cache_generation_{0};
   struct RegisteredFunction : public core::RefCounted {
     ~RegisteredFunction() override {}
 
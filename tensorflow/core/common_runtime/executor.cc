@@ -28,6 +28,8 @@ limitations under the License.
 #include "tensorflow/core/common_runtime/executor_factory.h"
 #include "tensorflow/core/common_runtime/pending_counts.h"
 #include "tensorflow/core/common_runtime/renamed_device.h"
+#include "tensorflow/core/common_runtime/static_memory_plan.h"
+#include "tensorflow/core/common_runtime/step_arena_allocator.h"
 #include "tensorflow/core/common_runtime/step_stats_collector.h"
 #include "tensorflow/core/framework/allocator.h"
 #include "tensorflow/core/framework/cancellation.h"
@@ -40,6 +42,7 @@ limitations under the License.
 #include "tensorflow/core/framework/op_segment.h"
 #include "tensorflow/core/framework/tensor.h"
 #include "tensorflow/core/framework/tensor_reference.h"
+#include "tensorflow/core/framework/tensor_util.h"
 #include "tensorflow/core/framework/types.h"
 #include "tensorflow/core/framework/types.pb.h"
 #include "tensorflow/core/graph/edgeset.h"
@@ -76,6 +79,27 @@ namespace {
 // 1-D, 0 element tensor.
 static const Tensor* const kEmptyTensor = new Tensor;
 
+// The size of the blocks of the step arena allocator, the largest output
+// that it allocates, and the most memory that it holds per step. The arena
+// reuses the blocks whose outputs were all released, so it only needs to hold
+// the outputs that are live at the same time.
+constexpr size_t kStepArenaBlockBytes = 1 << 20;
+constexpr size_t kStepArenaMaxAllocationBytes = 64 << 10;
+constexpr size_t kStepArenaMaxBytes = 16 << 20;
+
+// Every this many steps of an executor, the kernels that it runs inline are
+// timed too, so that a kernel whose cost grows is dispatched again.
+constexpr int64 kCostResamplingSteps = 64;
+
+// The most inexpensive nodes that are made ready outside a running thread,
+// e.g. the roots of a step, and that a single closure runs one after the
+// other. Larger groups are split so that they still run in parallel.
+constexpr size_t kMaxInexpensiveNodesPerClosure = 16;
+
+// The most ready nodes that a step queues for its workers. The other ready
+// nodes are scheduled one by one.
+constexpr size_t kMaxStepReadyQueueCapacity = 1024;
+
 bool IsInitializationOp(const Node* node) {
   return node->op_def().allows_uninitialized_input();
 }
@@ -173,6 +197,9 @@ struct NodeItem {
   bool is_initialization_op : 1;  // True iff IsInitializationOp(node)
   bool is_recv_or_switch : 1;     // True iff IsRecv(node) || IsSwitch(node)
   bool is_next_iteration : 1;     // True iff IsNextIteration(node)
+  // True iff an output of this node may be retained beyond the step by a
+  // consumer. Only set if the executor uses a step arena allocator.
+  bool is_step_arena_escape : 1;
 
   // The kernel for this node.
   OpKernel* kernel = nullptr;
@@ -186,6 +213,9 @@ struct NodeItem {
   // for this node.
   int input_start = 0;
 
+  // The id of the 1st output of this node in the static memory plan.
+  int output_start = 0;
+
   PendingCounts::Handle pending_id;
 
   // Number of output edges.
@@ -219,6 +249,10 @@ struct NodeItem {
   // 0... for forward from that input.
   const int* forward_from() const { return forward_from_base(); }
 
+  // Return array of per-output flags, true for the outputs that may be
+  // allocated from the step arena allocator.
+  const bool* step_arena_outputs() const { return step_arena_output_base(); }
+
   string DebugString() const {
     string ret = strings::StrCat("{name:'", kernel->name(), "' id:", node_id);
     if (is_source) {
@@ -241,6 +275,7 @@ struct NodeItem {
   //   int                 forward_from[num_outputs];
   //   uint8               input_type[num_inputs];
   //   uint8               output_type[num_outputs];
+  //   bool                step_arena_output[num_outputs];
 
   // Return pointer to variable length section.
   char* var() const {
@@ -270,6 +305,12 @@ struct NodeItem {
         sizeof(AllocatorAttributes) * num_outputs + sizeof(int) * num_outputs +
         sizeof(uint8) * num_inputs);
   }
+  bool* step_arena_output_base() const {
+    return reinterpret_cast<bool*>(
+        var() + sizeof(EdgeInfo) * num_output_edges +
+        sizeof(AllocatorAttributes) * num_outputs + sizeof(int) * num_outputs +
+        sizeof(uint8) * num_inputs + sizeof(uint8) * num_outputs);
+  }
 
   TF_DISALLOW_COPY_AND_ASSIGN(NodeItem);
 };
@@ -286,6 +327,7 @@ class GraphView {
   void Initialize(const Graph* g);
   Status SetAllocAttrs(const Graph* g, const Device* device);
   void SetScopedAllocatorAttrs(const std::vector<const Node*>& sa_nodes);
+  void SetStepArenaOutputs(const Graph* g);
 
   NodeItem* node(size_t id) const {
     DCHECK_GE(id, 0);
@@ -379,6 +421,8 @@ class ExecutorImpl : public Executor {
 
   static Status BuildControlFlowInfo(const Graph* graph,
                                      ControlFlowInfo* cf_info);
+  void InitializeMemoryPlanner(const Graph& graph,
+                               const ControlFlowInfo& cf_info);
   void InitializePending(const Graph* graph, const ControlFlowInfo& cf_info);
 
   FrameInfo* EnsureFrameInfo(const string& fname) {
@@ -389,10 +433,51 @@ class ExecutorImpl : public Executor {
     return *slot;
   }
 
+  // Returns the memory of the static memory plan for a new step, or nullptr
+  // if there is no plan. Builds the plan if a step has recorded the sizes
+  // of the outputs. Sets `*record_output_bytes` if the step should record
+  // them.
+  StaticMemoryPlan::StepMemory* AcquireStepMemory(
+      bool* record_output_bytes) const;
+
+  // Records the size of output `output_id` in a step.
+  void RecordOutputBytes(int output_id, int64 num_bytes) const;
+
+  // Called when a step that recorded the sizes of the outputs succeeds.
+  void OutputBytesRecorded() const;
+
+  // Counts a new step. Returns true if the step should time every kernel.
+  bool StartStep() const {
+    return num_steps_.fetch_add(1, std::memory_order_relaxed) %
+               kCostResamplingSteps ==
+           0;
+  }
+
   // Owned.
   LocalExecutorParams params_;
   GraphView gview_;
 
+  // The number of outputs of the nodes of the graph.
+  int total_outputs_ = 0;
+
+  // The outputs whose memory may be planned ahead of a step, by output id,
+  // and the largest size of each output in the steps that ran before the
+  // plan was built. Only set if params_.use_static_memory_plan.
+  std::vector<int> planned_output_ids_;
+  std::unique_ptr<std::atomic<int64>[]> output_bytes_;
+
+  mutable mutex memory_plan_mu_;
+  // Released once the plan is built.
+  mutable std::unique_ptr<StaticMemoryPlan::Planner> memory_planner_
+      GUARDED_BY(memory_plan_mu_);
+  mutable bool output_bytes_recorded_ GUARDED_BY(memory_plan_mu_) = false;
+  mutable std::shared_ptr<StaticMemoryPlan> memory_plan_
+      GUARDED_BY(memory_plan_mu_);
+
+  // The number of steps started, which decides the steps that time every
+  // kernel.
+  mutable std::atomic<int64> num_steps_{0};
+
   // A cached value of params_
   bool device_record_tensor_accesses_ = false;
 
@@ -446,7 +531,8 @@ size_t GraphView::NodeItemBytes(const Node* n) {
       + num_outputs * sizeof(AllocatorAttributes)  // output_attr[...]
       + num_outputs * sizeof(int)                  // forward_from[num_outputs]
       + num_inputs * sizeof(uint8)                 // input_type[num_inputs]
-      + num_outputs * sizeof(uint8);               // output_type[num_outputs]
+      + num_outputs * sizeof(uint8)                // output_type[num_outputs]
+      + num_outputs * sizeof(bool);  // step_arena_output[num_outputs]
   static constexpr size_t kItemAlignment = sizeof(NodeItem*);
   static_assert(kItemAlignment % alignof(NodeItem) == 0,
                 "NodeItem must be aligned with kItemAlignment");
@@ -541,9 +627,11 @@ char* GraphView::InitializeNode(char* ptr, const Node* n) {
 
     int* forward_from = item->forward_from_base();
     uint8* output_types = item->output_type_base();
+    bool* step_arena_outputs = item->step_arena_output_base();
     for (int i = 0; i < num_outputs; ++i) {
       output_types[i] = static_cast<uint8>(n->output_type(i));
       DCHECK_EQ(item->output_type(i), n->output_type(i));
+      step_arena_outputs[i] = false;
 
       forward_from[i] = OpKernelContext::Params::kNoReservation;
       if (sa_status.ok()) {
@@ -648,6 +736,9 @@ Status ExecutorImpl::Initialize(const Graph& graph) {
     item->input_start = frame_info->total_inputs;
     frame_info->total_inputs += n->num_inputs();
 
+    item->output_start = total_outputs_;
+    total_outputs_ += n->num_outputs();
+
     Status s = params_.create_kernel(n->def(), &item->kernel);
     if (!s.ok()) {
       item->kernel = nullptr;
@@ -677,6 +768,7 @@ Status ExecutorImpl::Initialize(const Graph& graph) {
     item->is_initialization_op = IsInitializationOp(n);
     item->is_recv_or_switch = IsRecv(n) || IsSwitch(n);
     item->is_next_iteration = IsNextIteration(n);
+    item->is_step_arena_escape = false;
 
     // Compute the maximum values we'll store for this node in the
     // pending counts data structure, and allocate a handle in
@@ -705,9 +797,81 @@ Status ExecutorImpl::Initialize(const Graph& graph) {
   // all nodes.
   InitializePending(&graph, cf_info);
 
+  if (params_.use_step_arena || params_.use_static_memory_plan) {
+    gview_.SetStepArenaOutputs(&graph);
+  }
+  if (params_.use_static_memory_plan) {
+    InitializeMemoryPlanner(graph, cf_info);
+  }
   return gview_.SetAllocAttrs(&graph, params_.device);
 }
 
+void ExecutorImpl::InitializeMemoryPlanner(const Graph& graph,
+                                           const ControlFlowInfo& cf_info) {
+  // The outputs that may be allocated from the step arena are also those
+  // that may be planned, except in loops, whose nodes run more than once per
+  // step, and for types that need more than their buffer.
+  std::vector<StaticMemoryPlan::Output> outputs;
+  for (const Node* n : graph.nodes()) {
+    if (!cf_info.frame_names[n->id()].empty()) {
+      continue;
+    }
+    const NodeItem* item = gview_.node(n->id());
+    for (int i = 0; i < n->num_outputs(); ++i) {
+      if (item->step_arena_outputs()[i] &&
+          DataTypeCanUseMemcpy(n->output_type(i))) {
+        outputs.push_back({n, i, item->output_start + i});
+        planned_output_ids_.push_back(item->output_start + i);
+      }
+    }
+  }
+  mutex_lock l(memory_plan_mu_);
+  memory_planner_ = StaticMemoryPlan::Planner::Create(graph, outputs);
+  if (memory_planner_ != nullptr) {
+    output_bytes_.reset(new std::atomic<int64>[total_outputs_]);
+    for (int i = 0; i < total_outputs_; ++i) {
+      output_bytes_[i].store(0, std::memory_order_relaxed);
+    }
+  }
+}
+
+StaticMemoryPlan::StepMemory* ExecutorImpl::AcquireStepMemory(
+    bool* record_output_bytes) const {
+  *record_output_bytes = false;
+  std::shared_ptr<StaticMemoryPlan> plan;
+  {
+    mutex_lock l(memory_plan_mu_);
+    if (memory_planner_ != nullptr && output_bytes_recorded_) {
+      std::vector<size_t> num_bytes;
+      for (int output_id : planned_output_ids_) {
+        num_bytes.push_back(
+            output_bytes_[output_id].load(std::memory_order_relaxed));
+      }
+      memory_plan_ = memory_planner_->Plan(
+          num_bytes, total_outputs_,
+          params_.device->GetAllocator(AllocatorAttributes()));
+      memory_planner_.reset();
+    }
+    *record_output_bytes = memory_planner_ != nullptr;
+    plan = memory_plan_;
+  }
+  return plan != nullptr ? plan->AcquireStepMemory() : nullptr;
+}
+
+void ExecutorImpl::RecordOutputBytes(int output_id, int64 num_bytes) const {
+  std::atomic<int64>& recorded = output_bytes_[output_id];
+  int64 current = recorded.load(std::memory_order_relaxed);
+  while (current < num_bytes &&
+         !recorded.compare_exchange_weak(current, num_bytes,
+                                         std::memory_order_relaxed)) {
+  }
+}
+
+void ExecutorImpl::OutputBytesRecorded() const {
+  mutex_lock l(memory_plan_mu_);
+  output_bytes_recorded_ = true;
+}
+
 // If a Node has been marked to use a ScopedAllocator x for output i, then
 // sc_attr will contain the subsequence (i, x) at an even offset.  This function
 // extracts and transfers that ScopedAllocator id to alloc_attr.  For now, we
@@ -768,6 +932,48 @@ void GraphView::SetScopedAllocatorAttrs(
   }
 }
 
+// Returns true if `dst` may keep a tensor that it consumes beyond the step,
+// or hand it out of the executor.
+bool MayRetainInput(const Node* dst) {
+  if (dst->IsRetval() || dst->IsSend() || dst->IsFunctionCall() ||
+      dst->op_def().is_stateful()) {
+    return true;
+  }
+  for (int i = 0; i < dst->num_inputs(); ++i) {
+    if (IsRefType(dst->input_type(i))) {
+      return true;
+    }
+  }
+  return false;
+}
+
+// Marks the outputs that may be allocated from the step arena allocator:
+// those of stateless nodes that are not consumed by a node that may retain
+// them, and whose values are plain memory. Strings, variants and resources
+// own memory outside of their buffer, which the analysis does not follow.
+// The outputs that are consumed by such a node are escape points: a tensor
+// that reaches one of them by aliasing an arena buffer is copied out of the
+// arena (see ExecutorState::ProcessOutputs), so that the tensors that
+// outlive the step do not hold blocks of the arena.
+void GraphView::SetStepArenaOutputs(const Graph* g) {
+  for (const Node* n : g->nodes()) {
+    NodeItem* item = node(n->id());
+    bool* step_arena_outputs = item->step_arena_output_base();
+    const bool is_stateful = n->op_def().is_stateful();
+    for (int i = 0; i < n->num_outputs(); ++i) {
+      const DataType dtype = n->output_type(i);
+      step_arena_outputs[i] =
+          !is_stateful && !IsRefType(dtype) && DataTypeCanUseMemcpy(dtype);
+    }
+    for (const Edge* e : n->out_edges()) {
+      if (!e->IsControlEdge() && MayRetainInput(e->dst())) {
+        step_arena_outputs[e->src_output()] = false;
+        item->is_step_arena_escape = true;
+      }
+    }
+  }
+}
+
 Status GraphView::SetAllocAttrs(const Graph* g, const Device* device) {
   Status s;
   DeviceNameUtils::ParsedName local_dev_name = device->parsed_name();
@@ -1279,6 +1485,85 @@ class ExecutorState {
     int front_index_;
   };
 
+  // A bounded lock-free queue of the ready nodes that the threads of a step
+  // hand off to each other, after Dmitry Vyukov's bounded MPMC queue. The
+  // sequence number of each cell tells whether it is free for the producer
+  // at a position, or holds the node for the consumer at a position.
+  class StepReadyQueue {
+   public:
+    // 'capacity' must be a power of two.
+    explicit StepReadyQueue(size_t capacity)
+        : mask_(capacity - 1), cells_(new Cell[capacity]) {
+      DCHECK_EQ(0, capacity & mask_);
+      for (size_t i = 0; i < capacity; ++i) {
+        cells_[i].sequence.store(i, std::memory_order_relaxed);
+      }
+    }
+
+    // Returns false if the queue is full.
+    bool Push(const TaggedNode& node) {
+      size_t pos = tail_.load(std::memory_order_relaxed);
+      while (true) {
+        Cell* cell = &cells_[pos & mask_];
+        const size_t seq = cell->sequence.load(std::memory_order_acquire);
+        const intptr_t diff =
+            static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos);
+        if (diff == 0) {
+          if (tail_.compare_exchange_weak(pos, pos + 1,
+                                          std::memory_order_relaxed)) {
+            cell->node = node;
+            cell->sequence.store(pos + 1, std::memory_order_release);
+            return true;
+          }
+        } else if (diff < 0) {
+          return false;
+        } else {
+          pos = tail_.load(std::memory_order_relaxed);
+        }
+      }
+    }
+
+    // Returns false if the queue is empty.
+    bool Pop(TaggedNode* node) {
+      size_t pos = head_.load(std::memory_order_relaxed);
+      while (true) {
+        Cell* cell = &cells_[pos & mask_];
+        const size_t seq = cell->sequence.load(std::memory_order_acquire);
+        const intptr_t diff =
+            static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos + 1);
+        if (diff == 0) {
+          if (head_.compare_exchange_weak(pos, pos + 1,
+                                          std::memory_order_relaxed)) {
+            *node = cell->node;
+            cell->sequence.store(pos + mask_ + 1, std::memory_order_release);
+            return true;
+          }
+        } else if (diff < 0) {
+          return false;
+        } else {
+          pos = head_.load(std::memory_order_relaxed);
+        }
+      }
+    }
+
+    // Returns true if every node pushed so far has been (or is being) popped.
+    bool empty() const {
+      return head_.load(std::memory_order_relaxed) >=
+             tail_.load(std::memory_order_relaxed);
+    }
+
+   private:
+    struct Cell {
+      std::atomic<size_t> sequence;
+      TaggedNode node{nullptr, nullptr, -1, false};
+    };
+
+    const size_t mask_;
+    std::unique_ptr<Cell[]> cells_;
+    std::atomic<size_t> head_{0};
+    std::atomic<size_t> tail_{0};
+  };
+
   struct AsyncState;
 
   const bool vlog_;  // true if VLOG_IS_ON(1). Used to check vlog cheaply.
@@ -1309,8 +1594,22 @@ class ExecutorState {
   CancellationManager* cancellation_manager_;
   // If not null, use this device to schedule intra-op operation
   std::unique_ptr<DeviceBase> user_device_;
+  // If not null, allocates the outputs that do not escape the step.
+  core::RefCountPtr<StepArenaAllocator> step_arena_allocator_;
+  // If not null, the memory of the outputs planned ahead of the step.
+  StaticMemoryPlan::StepMemory* step_memory_ = nullptr;
+  // If true, records the sizes of the outputs to plan.
+  bool record_output_bytes_ = false;
+  // If not null, the expensive ready nodes that the threads running the step
+  // did not keep for themselves, for the workers of the step to run.
+  std::unique_ptr<StepReadyQueue> ready_queue_;
+  // The number of workers scheduled to run the nodes of 'ready_queue_' that
+  // have not started yet.
+  std::atomic<int> num_pending_workers_{0};
   Executor::Args::Runner runner_;
   bool sync_on_finish_;
+  // If true, updates the cost estimates of the inexpensive kernels as well.
+  const bool resample_costs_;
 
   // Owned.
 
@@ -1363,6 +1662,10 @@ class ExecutorState {
   // Process a ready node in current thread.
   void Process(TaggedNode node, int64 scheduled_nsec);
 
+  // Process the ready nodes in 'nodes', and the inexpensive nodes that they
+  // make ready, in current thread.
+  void ProcessAll(TaggedNodeReadyQueue* nodes, int64 scheduled_nsec);
+
   // Before invoking item->kernel, fills in its "inputs".
   Status PrepareInputs(const NodeItem& item, Entry* first_input,
                        TensorValueVec* inputs,
@@ -1390,6 +1693,18 @@ class ExecutorState {
   void ScheduleReady(const TaggedNodeSeq& ready,
                      TaggedNodeReadyQueue* inline_ready);
 
+  // Runs 'tagged_node' on another thread. The calling thread must hold
+  // another node of the step, which keeps the step alive.
+  void Dispatch(const TaggedNode& tagged_node, int64 scheduled_nsec);
+
+  // Schedules a worker to run the nodes of 'ready_queue_', unless it is
+  // empty or a worker is about to start.
+  void MaybeStartWorker(int64 scheduled_nsec);
+
+  // Runs the nodes of 'ready_queue_' until it is empty. Each worker counts
+  // as an outstanding op of the step while it runs.
+  void RunWorker(int64 scheduled_nsec);
+
   // For debugging/logging only.
   inline void MaybeMarkCompleted(FrameState* frame, int64 iter,
                                  const NodeItem& item);
@@ -1408,6 +1723,13 @@ class ExecutorState {
 
   // Clean up when this executor is done.
   void Finish();
+
+  // Returns true if `ptr` points into memory that the step allocated for
+  // outputs that do not escape it.
+  bool InStepMemory(const void* ptr) const {
+    return (step_arena_allocator_ && step_arena_allocator_->Contains(ptr)) ||
+           (step_memory_ != nullptr && step_memory_->Contains(ptr));
+  }
   void ScheduleFinish();
 
   // A standalone routine for this expression so that we can express
@@ -1443,12 +1765,30 @@ ExecutorState::ExecutorState(const Executor::Args& args, ExecutorImpl* impl)
       cancellation_manager_(args.cancellation_manager),
       runner_(args.runner),
       sync_on_finish_(args.sync_on_finish),
+      resample_costs_(impl->StartStep()),
       num_outstanding_ops_(0) {
   if (args.user_intra_op_threadpool != nullptr) {
     Device* device = impl_->params_.device;
     user_device_ = RenamedDevice::NewRenamedDevice(
         device->name(), device, false, false, args.user_intra_op_threadpool);
   }
+  if (impl_->params_.use_static_memory_plan) {
+    step_memory_ = impl_->AcquireStepMemory(&record_output_bytes_);
+  }
+  if (impl_->params_.use_step_arena) {
+    step_arena_allocator_.reset(new StepArenaAllocator(
+        impl_->params_.device->GetAllocator(AllocatorAttributes()),
+        kStepArenaBlockBytes, kStepArenaMaxAllocationBytes,
+        kStepArenaMaxBytes));
+  }
+  if (impl_->params_.use_step_ready_queue) {
+    size_t capacity = 2;
+    while (capacity < impl_->gview_.num_nodes() &&
+           capacity < kMaxStepReadyQueueCapacity) {
+      capacity *= 2;
+    }
+    ready_queue_.reset(new StepReadyQueue(capacity));
+  }
 
   // We start the entire execution in iteration 0 of the root frame
   // so let us create the root frame and the state for iteration 0.
@@ -1472,6 +1812,9 @@ ExecutorState::~ExecutorState() {
   if (device_context_) {
     device_context_->Unref();
   }
+  if (step_memory_ != nullptr) {
+    step_memory_->Unref();
+  }
   delete slice_reader_cache_;
 }
 
@@ -1654,6 +1997,13 @@ bool MightTrace(const NodeItem& item,
 }
 
 void ExecutorState::Process(TaggedNode tagged_node, int64 scheduled_nsec) {
+  TaggedNodeReadyQueue inline_ready;
+  inline_ready.push_back(tagged_node);
+  ProcessAll(&inline_ready, scheduled_nsec);
+}
+
+void ExecutorState::ProcessAll(TaggedNodeReadyQueue* nodes,
+                               int64 scheduled_nsec) {
   profiler::TraceMe activity(
       [&] {
         int64 id = step_id_;
@@ -1665,7 +2015,7 @@ void ExecutorState::Process(TaggedNode tagged_node, int64 scheduled_nsec) {
       2);
   WithContext wc(context_);
   TaggedNodeSeq ready;
-  TaggedNodeReadyQueue inline_ready;
+  TaggedNodeReadyQueue& inline_ready = *nodes;
 
   // Parameters passed to OpKernel::Compute.
   TensorValueVec inputs;
@@ -1682,6 +2032,7 @@ void ExecutorState::Process(TaggedNode tagged_node, int64 scheduled_nsec) {
   }
   params.log_memory = log_memory_;
   params.record_tensor_accesses = impl_->device_record_tensor_accesses_;
+  params.record_allocated_output_bytes = record_output_bytes_;
   params.rendezvous = rendezvous_;
   params.create_rendezvous = create_rendezvous_;
   params.collective_executor = collective_executor_;
@@ -1726,7 +2077,7 @@ void ExecutorState::Process(TaggedNode tagged_node, int64 scheduled_nsec) {
 
   EntryVector outputs;
   bool completed = false;
-  inline_ready.push_back(tagged_node);
+  TaggedNode tagged_node(nullptr, nullptr, -1, false);
   while (!inline_ready.empty()) {
     tagged_node = inline_ready.front();
     inline_ready.pop_front();
@@ -1795,6 +2146,14 @@ void ExecutorState::Process(TaggedNode tagged_node, int64 scheduled_nsec) {
       params.frame_iter = FrameAndIter(input_frame->frame_id, input_iter);
       params.is_input_dead = is_input_dead;
       params.output_attr_array = item.output_attrs();
+      if (step_arena_allocator_) {
+        params.step_arena_allocator = step_arena_allocator_.get();
+        params.step_arena_outputs = item.step_arena_outputs();
+      }
+      if (step_memory_ != nullptr) {
+        params.planned_output_allocators =
+            step_memory_->output_allocators() + item.output_start;
+      }
       params.forward_from_array = item.forward_from();
 
       if (item.kernel_is_async) {
@@ -1888,7 +2247,7 @@ void ExecutorState::Process(TaggedNode tagged_node, int64 scheduled_nsec) {
           device->Compute(op_kernel, &ctx);
         } else {
           // In the common case, avoid creating any tracing objects.
-          if (op_kernel->IsExpensive()) {
+          if (op_kernel->IsExpensive() || resample_costs_) {
             KernelTimer timer;
             device->Compute(op_kernel, &ctx);
             op_kernel->UpdateCostEstimate(timer.ElapsedCycles());
@@ -2102,6 +2461,20 @@ Status ExecutorState::ProcessOutputs(const NodeItem& item, OpKernelContext* ctx,
                                           ctx->step_id(), i, to_log);
           }
         } else {
+          if (item.is_step_arena_escape &&
+              DataTypeCanUseMemcpy(val.tensor->dtype()) &&
+              InStepMemory(val.tensor->tensor_data().data())) {
+            // The kernel forwarded or aliased an input that was allocated
+            // from the memory of the step, but the output may outlive it.
+            *val.tensor = tensor::DeepCopy(*val.tensor);
+          } else if (record_output_bytes_ && item.step_arena_outputs()[i]) {
+            // Only the outputs that the kernel allocated can be planned, not
+            // the inputs that it forwarded or aliased.
+            const int64 num_bytes = ctx->allocated_output_bytes(i);
+            if (num_bytes > 0) {
+              impl_->RecordOutputBytes(item.output_start + i, num_bytes);
+            }
+          }
           // NOTE that std::move is used here, so val.tensor goes to
           // uninitialized state (val.tensor->IsInitialized return false).
           DCHECK(!out->val_field_is_set);
@@ -2313,10 +2686,44 @@ void ExecutorState::ScheduleReady(const TaggedNodeSeq& ready,
   }
 
   if (inline_ready == nullptr) {
-    // Schedule to run all the ready ops in thread pool.
+    // Schedule to run all the ready ops in thread pool. The inexpensive ops
+    // are run one after the other by closures of up to
+    // kMaxInexpensiveNodesPerClosure ops, and each expensive op by its own.
+    // The ops that are not scheduled yet keep the step alive while the others
+    // are dispatched, so the last closure is scheduled directly.
+    TaggedNodeReadyQueue inexpensive;
+    size_t num_inexpensive = 0;
+    const TaggedNode* last_expensive_node = nullptr;
     for (auto& tagged_node : ready) {
-      runner_([=]() { Process(tagged_node, scheduled_nsec); });
+      if (tagged_node.is_dead ||
+          !tagged_node.node_item->kernel->IsExpensive()) {
+        if (num_inexpensive == kMaxInexpensiveNodesPerClosure) {
+          runner_([this, inexpensive, scheduled_nsec]() mutable {
+            ProcessAll(&inexpensive, scheduled_nsec);
+          });
+          inexpensive = TaggedNodeReadyQueue();
+          num_inexpensive = 0;
+        }
+        inexpensive.push_back(tagged_node);
+        ++num_inexpensive;
+      } else {
+        if (last_expensive_node) {
+          Dispatch(*last_expensive_node, scheduled_nsec);
+        }
+        last_expensive_node = &tagged_node;
+      }
+    }
+    if (inexpensive.empty()) {
+      const TaggedNode last = *last_expensive_node;
+      runner_([=]() { Process(last, scheduled_nsec); });
+      return;
     }
+    if (last_expensive_node) {
+      Dispatch(*last_expensive_node, scheduled_nsec);
+    }
+    runner_([this, inexpensive, scheduled_nsec]() mutable {
+      ProcessAll(&inexpensive, scheduled_nsec);
+    });
     return;
   }
 
@@ -2330,8 +2737,7 @@ void ExecutorState::ScheduleReady(const TaggedNodeSeq& ready,
       if (curr_expensive_node) {
         // Dispatch to another thread since there is plenty of work to
         // do for this thread.
-        runner_(std::bind(&ExecutorState::Process, this, *curr_expensive_node,
-                          scheduled_nsec));
+        Dispatch(*curr_expensive_node, scheduled_nsec);
       }
       curr_expensive_node = &tagged_node;
     }
@@ -2342,12 +2748,51 @@ void ExecutorState::ScheduleReady(const TaggedNodeSeq& ready,
     } else {
       // There are inline nodes to run already. We dispatch this expensive
       // node to other thread.
-      runner_(std::bind(&ExecutorState::Process, this, *curr_expensive_node,
-                        scheduled_nsec));
+      Dispatch(*curr_expensive_node, scheduled_nsec);
     }
   }
 }
 
+void ExecutorState::Dispatch(const TaggedNode& tagged_node,
+                             int64 scheduled_nsec) {
+  if (ready_queue_ != nullptr && ready_queue_->Push(tagged_node)) {
+    MaybeStartWorker(scheduled_nsec);
+  } else {
+    runner_(std::bind(&ExecutorState::Process, this, tagged_node,
+                      scheduled_nsec));
+  }
+}
+
+void ExecutorState::MaybeStartWorker(int64 scheduled_nsec) {
+  // Pairs with the fence in RunWorker(): either a worker that has not
+  // started yet sees the nodes queued so far, or this thread sees that no
+  // worker is about to start.
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  if (ready_queue_->empty() ||
+      num_pending_workers_.load(std::memory_order_relaxed) > 0) {
+    return;
+  }
+  int expected = 0;
+  if (!num_pending_workers_.compare_exchange_strong(expected, 1)) {
+    return;
+  }
+  num_outstanding_ops_.fetch_add(1, std::memory_order_relaxed);
+  runner_([this, scheduled_nsec]() { RunWorker(scheduled_nsec); });
+}
+
+void ExecutorState::RunWorker(int64 scheduled_nsec) {
+  num_pending_workers_.fetch_sub(1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  TaggedNode tagged_node(nullptr, nullptr, -1, false);
+  while (ready_queue_->Pop(&tagged_node)) {
+    // Lets another thread share the rest of the queue, which keeps as many
+    // threads busy as there are nodes to run.
+    MaybeStartWorker(scheduled_nsec);
+    Process(tagged_node, scheduled_nsec);
+  }
+  if (num_outstanding_ops_.fetch_sub(1) == 1) ScheduleFinish();
+}
+
 inline void ExecutorState::MaybeMarkCompleted(FrameState* frame, int64 iter,
                                               const NodeItem& item) {
   // TODO(misard) Replace with a finer-grain enabling flag once we
@@ -2498,6 +2943,9 @@ void ExecutorState::Finish() {
   int64 step_id = step_id_;
   CHECK(done_cb != nullptr);
   Device* device = impl_->params_.device;
+  if (record_output_bytes_ && status.ok()) {
+    impl_->OutputBytesRecorded();
+  }
 
   // There are several potential race conditions below. To name a few:
   // 1. Even if the device's status is OK at the precise moment when
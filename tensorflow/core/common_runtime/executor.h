@@ -145,6 +145,22 @@ struct LocalExecutorParams {
   std::function<void(OpKernel*)> delete_kernel;
 
   Executor::RendezvousFactory rendezvous_factory;
+
+  // If true, the small outputs that do not escape a step are allocated from
+  // an arena that is released at the end of the step, rather than one by one
+  // from the device allocator.
+  bool use_step_arena = false;
+
+  // If true, the outputs that do not escape a step are assigned offsets in
+  // one block of memory per step, planned from their sizes in the first
+  // step. The blocks are reused by later steps.
+  bool use_static_memory_plan = false;
+
+  // If true, the expensive nodes that a thread does not run itself are
+  // handed to the other threads of the step through a lock-free queue,
+  // which the threads drain until it is empty, rather than scheduled on the
+  // runner one closure per node.
+  bool use_step_ready_queue = false;
 };
 ::tensorflow::Status NewLocalExecutor(const LocalExecutorParams& params,
                                       const Graph& graph, Executor** executor);
@@ -23,13 +23,18 @@ limitations under the License.
 #include "tensorflow/core/common_runtime/process_util.h"
 #include "tensorflow/core/common_runtime/step_stats_collector.h"
 #include "tensorflow/core/framework/op.h"
+#include "tensorflow/core/framework/allocator.h"
 #include "tensorflow/core/framework/rendezvous.h"
 #include "tensorflow/core/framework/step_stats.pb.h"
+#include "tensorflow/core/framework/tensor_testutil.h"
 #include "tensorflow/core/framework/versions.pb.h"
 #include "tensorflow/core/graph/graph_constructor.h"
 #include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/lib/core/threadpool.h"
 #include "tensorflow/core/lib/random/simple_philox.h"
 #include "tensorflow/core/lib/strings/strcat.h"
+#include "tensorflow/core/platform/cpu_info.h"
+#include "tensorflow/core/platform/env.h"
 #include "tensorflow/core/platform/logging.h"
 #include "tensorflow/core/platform/test.h"
 #include "tensorflow/core/platform/test_benchmark.h"
@@ -57,10 +62,15 @@ class ExecutorTest : public ::testing::Test {
   }
 
   // Resets executor_ with a new executor based on a graph 'gdef'.
-  void Create(std::unique_ptr<const Graph> graph) {
+  void Create(std::unique_ptr<const Graph> graph, bool use_step_arena = false,
+              bool use_static_memory_plan = false,
+              bool use_step_ready_queue = false) {
     const int version = graph->versions().producer();
     LocalExecutorParams params;
     params.device = device_.get();
+    params.use_step_arena = use_step_arena;
+    params.use_static_memory_plan = use_static_memory_plan;
+    params.use_step_ready_queue = use_step_ready_queue;
     params.create_kernel = [this, version](const NodeDef& ndef,
                                            OpKernel** kernel) {
       return CreateNonCachedKernel(device_.get(), nullptr, ndef, version,
@@ -69,6 +79,9 @@ class ExecutorTest : public ::testing::Test {
     params.delete_kernel = [](OpKernel* kernel) {
       DeleteNonCachedKernel(kernel);
     };
+    if (rendez_ != nullptr) {
+      rendez_->Unref();
+    }
     rendez_ = NewLocalRendezvous();
     params.rendezvous_factory = [this](const int64, const DeviceMgr*,
                                        Rendezvous** r) {
@@ -200,6 +213,192 @@ TEST_F(ExecutorTest, SelfAdd) {
   EXPECT_EQ(1024.0, V(out));  // b=v10=2*v9=4*v8=...=1024*a=1024.0
 }
 
+TEST_F(ExecutorTest, SelfAddWithStepArena) {
+  // b <- a * 1024, with the intermediate sums in the step arena.
+  const int kNumSteps = 3;
+  int64 num_allocs[2];
+  for (bool use_step_arena : {false, true}) {
+    auto g = absl::make_unique<Graph>(OpRegistry::Global());
+    auto v = test::graph::Recv(g.get(), "a", "float", ALICE, 1, BOB);
+    for (int i = 1; i <= 10; ++i) {
+      v = test::graph::Add(g.get(), v, v);
+    }
+    // The output that is sent aliases an intermediate sum.
+    v = test::graph::Identity(g.get(), v);
+    test::graph::Send(g.get(), v, "b", BOB, 1, ALICE);
+    Create(std::move(g), use_step_arena);
+    EnableCPUAllocatorStats(true);
+    cpu_allocator()->ClearStats();
+    Rendezvous::Args args;
+    for (int step = 0; step < kNumSteps; ++step) {
+      TF_ASSERT_OK(rendez_->Send(Key(ALICE, kIncarnation, BOB, "a"), args,
+                                 V(step), false));
+      TF_ASSERT_OK(Run(rendez_));
+      Tensor out = V(-1);
+      bool is_dead = false;
+      TF_ASSERT_OK(rendez_->Recv(Key(BOB, kIncarnation, ALICE, "b"), args,
+                                 &out, &is_dead));
+      EXPECT_EQ(1024.0 * step, V(out));
+    }
+    absl::optional<AllocatorStats> stats = cpu_allocator()->GetStats();
+    EnableCPUAllocatorStats(false);
+    ASSERT_TRUE(stats);
+    num_allocs[use_step_arena] = stats->num_allocs;
+  }
+  // Instead of the 10 sums, each step allocates a block of the arena and a
+  // copy of the sum that is sent.
+  EXPECT_LE(num_allocs[1] + kNumSteps * (10 - 2), num_allocs[0]);
+}
+
+TEST_F(ExecutorTest, SelfAddWithStaticMemoryPlan) {
+  // b <- a * 1024, with the intermediate sums in planned memory after the
+  // first step.
+  auto g = absl::make_unique<Graph>(OpRegistry::Global());
+  auto v = test::graph::Recv(g.get(), "a", "float", ALICE, 1, BOB);
+  for (int i = 1; i <= 10; ++i) {
+    v = test::graph::Add(g.get(), v, v);
+  }
+  v = test::graph::Identity(g.get(), v);
+  test::graph::Send(g.get(), v, "b", BOB, 1, ALICE);
+  Create(std::move(g), /*use_step_arena=*/false,
+         /*use_static_memory_plan=*/true);
+  EnableCPUAllocatorStats(true);
+  Rendezvous::Args args;
+  const int kNumSteps = 3;
+  int64 num_allocs[kNumSteps];
+  for (int step = 0; step < kNumSteps; ++step) {
+    TF_ASSERT_OK(rendez_->Send(Key(ALICE, kIncarnation, BOB, "a"), args,
+                               V(step), false));
+    cpu_allocator()->ClearStats();
+    TF_ASSERT_OK(Run(rendez_));
+    absl::optional<AllocatorStats> stats = cpu_allocator()->GetStats();
+    ASSERT_TRUE(stats);
+    num_allocs[step] = stats->num_allocs;
+    Tensor out = V(-1);
+    bool is_dead = false;
+    TF_ASSERT_OK(rendez_->Recv(Key(BOB, kIncarnation, ALICE, "b"), args, &out,
+                               &is_dead));
+    EXPECT_EQ(1024.0 * step, V(out));
+  }
+  EnableCPUAllocatorStats(false);
+  // A planned output whose slot cannot be claimed is allocated from the CPU
+  // allocator. After the first step, the 10 sums must all be allocated inside
+  // the block of the step, which costs at most one allocation for the block
+  // and one for the copy of the sum that is sent.
+  for (int step = 1; step < kNumSteps; ++step) {
+    EXPECT_LE(num_allocs[step] + 10 - 2, num_allocs[0]) << "step " << step;
+  }
+}
+
+TEST_F(ExecutorTest, WideFanOutWithStepReadyQueue) {
+  // b <- a * 128, with the 64 sums of a + a handed off between threads.
+  auto g = absl::make_unique<Graph>(OpRegistry::Global());
+  auto a = test::graph::Recv(g.get(), "a", "float", ALICE, 1, BOB);
+  std::vector<Node*> sums;
+  for (int i = 0; i < 64; ++i) {
+    sums.push_back(test::graph::Add(g.get(), a, a));
+  }
+  auto b = test::graph::Multi(g.get(), "AddN", sums);
+  test::graph::Send(g.get(), b, "b", BOB, 1, ALICE);
+  Create(std::move(g), /*use_step_arena=*/false,
+         /*use_static_memory_plan=*/false, /*use_step_ready_queue=*/true);
+  Rendezvous::Args args;
+  for (int step = 0; step < 3; ++step) {
+    TF_ASSERT_OK(rendez_->Send(Key(ALICE, kIncarnation, BOB, "a"), args,
+                               V(step), false));
+    TF_ASSERT_OK(Run(rendez_));
+    Tensor out = V(-1);
+    bool is_dead = false;
+    TF_ASSERT_OK(rendez_->Recv(Key(BOB, kIncarnation, ALICE, "b"), args, &out,
+                               &is_dead));
+    EXPECT_EQ(128.0 * step, V(out));
+  }
+}
+
+TEST_F(ExecutorTest, InexpensiveAndExpensiveRoots) {
+  // b <- 40 + a0 + a1 + a2 + a3, with the 40 constant roots run by several
+  // closures and each Recv root, an async kernel, by its own.
+  auto g = absl::make_unique<Graph>(OpRegistry::Global());
+  std::vector<Node*> terms;
+  for (int i = 0; i < 40; ++i) {
+    terms.push_back(test::graph::Constant(g.get(), V(1.0)));
+  }
+  for (int i = 0; i < 4; ++i) {
+    terms.push_back(test::graph::Recv(g.get(), strings::StrCat("a", i),
+                                      "float", ALICE, 1, BOB));
+  }
+  auto b = test::graph::Multi(g.get(), "AddN", terms);
+  test::graph::Send(g.get(), b, "b", BOB, 1, ALICE);
+  Create(std::move(g));
+  Rendezvous::Args args;
+  for (int step = 0; step < 3; ++step) {
+    for (int i = 0; i < 4; ++i) {
+      TF_ASSERT_OK(rendez_->Send(
+          Key(ALICE, kIncarnation, BOB, strings::StrCat("a", i)), args,
+          V(step), false));
+    }
+    TF_ASSERT_OK(Run(rendez_));
+    Tensor out = V(-1);
+    bool is_dead = false;
+    TF_ASSERT_OK(rendez_->Recv(Key(BOB, kIncarnation, ALICE, "b"), args, &out,
+                               &is_dead));
+    EXPECT_EQ(40.0 + 4.0 * step, V(out));
+    EXPECT_FALSE(is_dead);
+  }
+}
+
+// Builds b <- a * 40 + (a + a) * 4, where the 40 copies of a and the 4 sums
+// are made ready by the Recv of a, an async kernel.
+void BuildAsyncFanOut(Graph* g) {
+  auto a = test::graph::Recv(g, "a", "float", ALICE, 1, BOB);
+  std::vector<Node*> terms;
+  for (int i = 0; i < 40; ++i) {
+    terms.push_back(test::graph::Identity(g, a));
+  }
+  for (int i = 0; i < 4; ++i) {
+    terms.push_back(test::graph::Add(g, a, a));
+  }
+  auto b = test::graph::Multi(g, "AddN", terms);
+  test::graph::Send(g, b, "b", BOB, 1, ALICE);
+}
+
+TEST_F(ExecutorTest, AsyncKernelSuccessors) {
+  auto g = absl::make_unique<Graph>(OpRegistry::Global());
+  BuildAsyncFanOut(g.get());
+  Create(std::move(g));
+  Rendezvous::Args args;
+  for (int step = 0; step < 3; ++step) {
+    TF_ASSERT_OK(rendez_->Send(Key(ALICE, kIncarnation, BOB, "a"), args,
+                               V(step), false));
+    TF_ASSERT_OK(Run(rendez_));
+    Tensor out = V(-1);
+    bool is_dead = false;
+    TF_ASSERT_OK(rendez_->Recv(Key(BOB, kIncarnation, ALICE, "b"), args, &out,
+                               &is_dead));
+    EXPECT_EQ(48.0 * step, V(out));
+    EXPECT_FALSE(is_dead);
+  }
+}
+
+TEST_F(ExecutorTest, DeadAsyncKernelSuccessors) {
+  // The successors of a dead Recv are dead, and are run by the closures of
+  // the inexpensive nodes whatever their kernels.
+  auto g = absl::make_unique<Graph>(OpRegistry::Global());
+  BuildAsyncFanOut(g.get());
+  Create(std::move(g));
+  Rendezvous::Args args;
+  for (int step = 0; step < 3; ++step) {
+    TF_ASSERT_OK(rendez_->Send(Key(ALICE, kIncarnation, BOB, "a"), args,
+                               V(step), /*is_dead=*/true));
+    TF_ASSERT_OK(Run(rendez_));
+    Tensor out = V(-1);
+    bool is_dead = false;
+    TF_ASSERT_OK(rendez_->Recv(Key(BOB, kIncarnation, ALICE, "b"), args, &out,
+                               &is_dead));
+    EXPECT_TRUE(is_dead);
+  }
+}
+
 // Builds a graph which adds N copies of one variable "in". I.e.,
 //     a + a + a + ... + a
 // The returned graph is parenthesized ramdonly. I.e.,
@@ -494,4 +693,126 @@ static void BM_FeedInputFetchOutput(int iters) {
 }
 BENCHMARK(BM_FeedInputFetchOutput);
 
+// Runs 'width' inexpensive roots, each followed by an inexpensive node, which
+// are all made ready at the start of the step. The time per item is the cost
+// of a node, including the overhead of scheduling the roots.
+static void BM_executor_inexpensive_roots(int iters, int width) {
+  Graph* g = new Graph(OpRegistry::Global());
+  std::vector<Node*> leaves;
+  for (int i = 0; i < width; ++i) {
+    Node* root = test::graph::NoOp(g, {});
+    leaves.push_back(test::graph::NoOp(g, {root}));
+  }
+  test::graph::NoOp(g, leaves);
+#ifdef PLATFORM_GOOGLE
+  SetBenchmarkItemsProcessed(static_cast<int64>(iters) * (2 * width + 1));
+#endif  // PLATFORM_GOOGLE
+  test::Benchmark("cpu", g).Run(iters);
+}
+BENCHMARK(BM_executor_inexpensive_roots)->Arg(16)->Arg(256)->Arg(4096);
+
+// Runs 'width' independent chains of additions of 16K floats, which remain
+// expensive enough to be dispatched to other threads, with or without the
+// ready queue of the step. The time per item is the cost of a node,
+// including the overhead of scheduling it.
+static void BM_executor_dispatch(int iters, int width,
+                                 int use_step_ready_queue) {
+  testing::StopTiming();
+  constexpr int kDepth = 8;
+  Graph* g = new Graph(OpRegistry::Global());
+  Tensor t(DT_FLOAT, TensorShape({16 << 10}));
+  t.flat<float>().setZero();
+  Node* c = test::graph::Constant(g, t);
+  for (int i = 0; i < width; ++i) {
+    Node* v = c;
+    for (int j = 0; j < kDepth; ++j) {
+      v = test::graph::Add(g, v, c);
+    }
+  }
+  std::unique_ptr<Device> device(
+      DeviceFactory::NewDevice("CPU", {}, "/job:localhost/replica:0/task:0"));
+  thread::ThreadPool pool(Env::Default(), "executor_dispatch",
+                          port::MaxParallelism());
+  const int version = g->versions().producer();
+  LocalExecutorParams params;
+  params.device = device.get();
+  params.use_step_ready_queue = use_step_ready_queue;
+  params.create_kernel = [&device, version](const NodeDef& ndef,
+                                            OpKernel** kernel) {
+    return CreateNonCachedKernel(device.get(), nullptr, ndef, version,
+                                 kernel);
+  };
+  params.delete_kernel = [](OpKernel* kernel) {
+    DeleteNonCachedKernel(kernel);
+  };
+  Executor* exec = nullptr;
+  TF_CHECK_OK(NewLocalExecutor(params, *g, &exec));
+  Rendezvous* rendez = NewLocalRendezvous();
+  Executor::Args args;
+  args.rendezvous = rendez;
+  args.runner = [&pool](std::function<void()> fn) { pool.Schedule(fn); };
+  // Lets the cost estimates of the kernels settle.
+  for (int i = 0; i < 100; ++i) {
+    TF_CHECK_OK(exec->Run(args));
+  }
+#ifdef PLATFORM_GOOGLE
+  SetBenchmarkItemsProcessed(static_cast<int64>(iters) * width * kDepth);
+#endif  // PLATFORM_GOOGLE
+  testing::StartTiming();
+  for (int i = 0; i < iters; ++i) {
+    TF_CHECK_OK(exec->Run(args));
+  }
+  testing::StopTiming();
+  delete exec;
+  rendez->Unref();
+  delete g;
+}
+BENCHMARK(BM_executor_dispatch)->ArgPair(16, 0);
+BENCHMARK(BM_executor_dispatch)->ArgPair(16, 1);
+BENCHMARK(BM_executor_dispatch)->ArgPair(256, 0);
+BENCHMARK(BM_executor_dispatch)->ArgPair(256, 1);
+
+// Chains 'depth' levels of Relu, BiasAdd, Reshape, Transpose and ConcatV2 of
+// [256, 1024] floats, and reports the number of allocations per step. Every
+// level can reuse the buffer of the previous one, so the allocations do not
+// grow with the depth when the kernels forward their inputs.
+static void BM_executor_allocations(int iters, int depth) {
+  testing::StopTiming();
+  Graph* g = new Graph(OpRegistry::Global());
+  Tensor x(DT_FLOAT, TensorShape({256, 1024}));
+  x.flat<float>().setRandom();
+  Tensor bias(DT_FLOAT, TensorShape({1024}));
+  bias.flat<float>().setRandom();
+  Tensor empty(DT_FLOAT, TensorShape({0, 1024}));
+  Node* bias_node = test::graph::Constant(g, bias);
+  Node* empty_node = test::graph::Constant(g, empty);
+  Node* shape3 =
+      test::graph::Constant(g, test::AsTensor<int32>({256, 1024, 1}, {3}));
+  Node* shape2 =
+      test::graph::Constant(g, test::AsTensor<int32>({256, 1024}, {2}));
+  Node* perm = test::graph::Constant(g, test::AsTensor<int32>({0, 2, 1}, {3}));
+  Node* axis = test::graph::Constant(g, test::AsScalar<int32>(0));
+  Node* n = test::graph::Constant(g, x);
+  for (int i = 0; i < depth; ++i) {
+    n = test::graph::BiasAdd(g, test::graph::Relu(g, n), bias_node);
+    // A transpose that only moves a dimension of size 1 is a reshape.
+    n = test::graph::Binary(
+        g, "Transpose", test::graph::Binary(g, "Reshape", n, shape3), perm);
+    n = test::graph::Binary(g, "Reshape", n, shape2);
+    n = test::graph::ConcatV2(g, {n, empty_node}, axis);
+  }
+  EnableCPUAllocatorStats(true);
+  cpu_allocator()->ClearStats();
+  testing::StartTiming();
+  test::Benchmark("cpu", g).Run(iters);
+  testing::StopTiming();
+  absl::optional<AllocatorStats> stats = cpu_allocator()->GetStats();
+  EnableCPUAllocatorStats(false);
+  if (stats && iters > 0) {
+    testing::SetLabel(strings::StrCat(stats->num_allocs / iters,
+                                      " allocations per step"));
+  }
+}
+BENCHMARK(BM_executor_allocations)->Arg(1)->Arg(16);
+
 }  // namespace tensorflow
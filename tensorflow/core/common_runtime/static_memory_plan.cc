@@ -0,0 +1,300 @@
+/* Copyright 2019 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#include "tensorflow/core/common_runtime/static_memory_plan.h"
+
+#include <algorithm>
+#include <numeric>
+
+#include "tensorflow/core/graph/algorithm.h"
+#include "tensorflow/core/platform/logging.h"
+
+namespace tensorflow {
+namespace {
+
+// The largest reachability matrix (in bits) that planning computes.
+constexpr int64 kMaxReachabilityBits = int64{1} << 28;
+
+size_t AlignedBytes(size_t num_bytes) {
+  return (num_bytes + Allocator::kAllocatorAlignment - 1) &
+         ~(Allocator::kAllocatorAlignment - 1);
+}
+
+}  // namespace
+
+// Allocates a planned output of a step at its offset in the block of the
+// step, or from the allocator of the plan if that memory is in use.
+class StaticMemoryPlan::SlotAllocator : public Allocator {
+ public:
+  string Name() override { return "static_memory_plan"; }
+
+  void* AllocateRaw(size_t alignment, size_t num_bytes) override {
+    // Like the `TensorBuffer`s that it backs, each allocation keeps the
+    // memory of the step alive.
+    memory_->Ref();
+    const Slot& slot = memory_->plan_->slots_[slot_];
+    if (num_bytes <= slot.num_bytes &&
+        alignment <= Allocator::kAllocatorAlignment &&
+        memory_->Claim(slot_)) {
+      return memory_->block_ + slot.offset;
+    }
+    void* ptr = memory_->plan_->allocator_->AllocateRaw(alignment, num_bytes);
+    if (ptr == nullptr) {
+      memory_->Unref();
+    }
+    return ptr;
+  }
+
+  void DeallocateRaw(void* ptr) override {
+    const Slot& slot = memory_->plan_->slots_[slot_];
+    if (memory_->block_ != nullptr && ptr == memory_->block_ + slot.offset) {
+      memory_->live_[slot_].store(false, std::memory_order_release);
+    } else {
+      memory_->plan_->allocator_->DeallocateRaw(ptr);
+    }
+    memory_->Unref();
+  }
+
+ private:
+  friend class StaticMemoryPlan::StepMemory;
+
+  StepMemory* memory_ = nullptr;
+  int slot_ = -1;
+};
+
+StaticMemoryPlan::StepMemory::StepMemory(StaticMemoryPlan* plan)
+    : plan_(plan),
+      slot_allocators_(new SlotAllocator[plan->slots_.size()]),
+      output_allocators_(plan->num_output_ids_, nullptr),
+      live_(new std::atomic<bool>[plan->slots_.size()]) {
+  block_ = static_cast<char*>(plan->allocator_->AllocateRaw(
+      Allocator::kAllocatorAlignment, plan->block_bytes_));
+  for (int i = 0; i < plan->slots_.size(); ++i) {
+    slot_allocators_[i].memory_ = this;
+    slot_allocators_[i].slot_ = i;
+    output_allocators_[plan->slots_[i].output_id] = &slot_allocators_[i];
+    live_[i].store(false, std::memory_order_relaxed);
+  }
+}
+
+StaticMemoryPlan::StepMemory::~StepMemory() {
+  if (block_ != nullptr) {
+    plan_->allocator_->DeallocateRaw(block_);
+  }
+}
+
+bool StaticMemoryPlan::StepMemory::Claim(int i) {
+  if (block_ == nullptr) {
+    return false;
+  }
+  if (live_[i].exchange(true, std::memory_order_seq_cst)) {
+    return false;
+  }
+  // Two slots that share memory cannot both be claimed: whichever marks
+  // itself live last sees the other one.
+  for (int j : plan_->slots_[i].overlaps) {
+    if (live_[j].load(std::memory_order_seq_cst)) {
+      live_[i].store(false, std::memory_order_relaxed);
+      return false;
+    }
+  }
+  return true;
+}
+
+void StaticMemoryPlan::StepMemory::Unref() {
+  if (ref_.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+    plan_->Recycle(this);
+  }
+}
+
+StaticMemoryPlan::StaticMemoryPlan(std::vector<Slot> slots, size_t block_bytes,
+                                   int num_output_ids, Allocator* allocator)
+    : slots_(std::move(slots)),
+      block_bytes_(block_bytes),
+      num_output_ids_(num_output_ids),
+      allocator_(allocator) {}
+
+StaticMemoryPlan::~StaticMemoryPlan() {
+  for (StepMemory* memory : free_memory_) {
+    delete memory;
+  }
+}
+
+StaticMemoryPlan::StepMemory* StaticMemoryPlan::AcquireStepMemory() {
+  StepMemory* memory = nullptr;
+  {
+    mutex_lock l(mu_);
+    if (!free_memory_.empty()) {
+      memory = free_memory_.back();
+      free_memory_.pop_back();
+    }
+  }
+  if (memory == nullptr) {
+    memory = new StepMemory(this);
+  }
+  memory->plan_ref_ = shared_from_this();
+  memory->ref_.store(1, std::memory_order_relaxed);
+  return memory;
+}
+
+void StaticMemoryPlan::Recycle(StepMemory* memory) {
+  // Releasing the last reference to the plan deletes the memory with it.
+  std::shared_ptr<StaticMemoryPlan> plan = std::move(memory->plan_ref_);
+  mutex_lock l(mu_);
+  free_memory_.push_back(memory);
+}
+
+// static
+std::unique_ptr<StaticMemoryPlan::Planner> StaticMemoryPlan::Planner::Create(
+    const Graph& graph, const std::vector<Output>& outputs) {
+  std::vector<int> user_ids(graph.num_node_ids(), -1);
+  int num_users = 0;
+  auto user_id = [&user_ids, &num_users](const Node* n) {
+    if (user_ids[n->id()] == -1) {
+      user_ids[n->id()] = num_users++;
+    }
+    return user_ids[n->id()];
+  };
+  std::vector<PlannedOutput> planned_outputs(outputs.size());
+  for (int i = 0; i < outputs.size(); ++i) {
+    PlannedOutput& planned = planned_outputs[i];
+    planned.node_id = outputs[i].node->id();
+    planned.output_id = outputs[i].output_id;
+    for (const Edge* e : outputs[i].node->out_edges()) {
+      if (!e->IsControlEdge() && e->src_output() == outputs[i].index) {
+        planned.users.push_back(user_id(e->dst()));
+      }
+    }
+    if (planned.users.empty()) {
+      planned.users.push_back(user_id(outputs[i].node));
+    }
+  }
+  if (static_cast<int64>(graph.num_node_ids()) * num_users >
+      kMaxReachabilityBits) {
+    VLOG(1) << "Not planning the memory of " << outputs.size()
+            << " outputs of a graph with " << graph.num_node_ids()
+            << " nodes.";
+    return nullptr;
+  }
+  return std::unique_ptr<Planner>(
+      new Planner(std::move(planned_outputs), user_ids, num_users, graph));
+}
+
+StaticMemoryPlan::Planner::Planner(std::vector<PlannedOutput> outputs,
+                                   const std::vector<int>& user_ids,
+                                   int num_users, const Graph& graph)
+    : outputs_(std::move(outputs)),
+      num_words_((num_users + 63) / 64),
+      predecessors_(graph.num_node_ids() * num_words_, 0) {
+  // The back edges of loops are ignored, which can only omit predecessors.
+  std::vector<Node*> order;
+  GetReversePostOrder(graph, &order);
+  for (const Node* n : order) {
+    uint64* bits = &predecessors_[n->id() * num_words_];
+    for (const Edge* e : n->in_edges()) {
+      const int src = e->src()->id();
+      const uint64* src_bits = &predecessors_[src * num_words_];
+      for (size_t w = 0; w < num_words_; ++w) {
+        bits[w] |= src_bits[w];
+      }
+      if (user_ids[src] != -1) {
+        bits[user_ids[src] / 64] |= uint64{1} << (user_ids[src] % 64);
+      }
+    }
+  }
+}
+
+bool StaticMemoryPlan::Planner::DeadBefore(const PlannedOutput& a,
+                                           const PlannedOutput& b) const {
+  const uint64* bits = &predecessors_[b.node_id * num_words_];
+  for (int user : a.users) {
+    if (!((bits[user / 64] >> (user % 64)) & 1)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+std::shared_ptr<StaticMemoryPlan> StaticMemoryPlan::Planner::Plan(
+    const std::vector<size_t>& num_bytes, int num_output_ids,
+    Allocator* allocator) const {
+  DCHECK_EQ(num_bytes.size(), outputs_.size());
+  // The outputs to plan, largest first.
+  std::vector<int> order;
+  for (int i = 0; i < outputs_.size(); ++i) {
+    if (num_bytes[i] > 0) {
+      order.push_back(i);
+    }
+  }
+  if (order.empty()) {
+    return nullptr;
+  }
+  // Maps the outputs to their slots, in the order of `outputs_`.
+  std::vector<int> slot_ids(outputs_.size(), -1);
+  for (int i = 0; i < order.size(); ++i) {
+    slot_ids[order[i]] = i;
+  }
+  std::stable_sort(order.begin(), order.end(), [&num_bytes](int a, int b) {
+    return num_bytes[a] > num_bytes[b];
+  });
+
+  std::vector<Slot> slots(order.size());
+  std::vector<int> placed;
+  size_t block_bytes = 0;
+  for (int i : order) {
+    Slot& slot = slots[slot_ids[i]];
+    slot.output_id = outputs_[i].output_id;
+    slot.num_bytes = AlignedBytes(num_bytes[i]);
+
+    // Finds the lowest gap between the placed outputs that may be live at
+    // the same time as this one.
+    std::vector<const Slot*> conflicts;
+    for (int j : placed) {
+      if (!DeadBefore(outputs_[i], outputs_[j]) &&
+          !DeadBefore(outputs_[j], outputs_[i])) {
+        conflicts.push_back(&slots[slot_ids[j]]);
+      }
+    }
+    std::sort(conflicts.begin(), conflicts.end(),
+              [](const Slot* a, const Slot* b) {
+                return a->offset < b->offset;
+              });
+    size_t offset = 0;
+    for (const Slot* conflict : conflicts) {
+      if (offset + slot.num_bytes <= conflict->offset) {
+        break;
+      }
+      offset = std::max(offset, conflict->offset + conflict->num_bytes);
+    }
+    slot.offset = offset;
+    block_bytes = std::max(block_bytes, offset + slot.num_bytes);
+
+    for (int j : placed) {
+      Slot& other = slots[slot_ids[j]];
+      if (slot.offset < other.offset + other.num_bytes &&
+          other.offset < slot.offset + slot.num_bytes) {
+        slot.overlaps.push_back(slot_ids[j]);
+        other.overlaps.push_back(slot_ids[i]);
+      }
+    }
+    placed.push_back(i);
+  }
+
+  VLOG(1) << "Planned the memory of " << slots.size() << " outputs in "
+          << block_bytes << " bytes.";
+  return std::shared_ptr<StaticMemoryPlan>(new StaticMemoryPlan(
+      std::move(slots), block_bytes, num_output_ids, allocator));
+}
+
+}  // namespace tensorflow
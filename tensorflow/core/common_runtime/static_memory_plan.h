@@ -0,0 +1,188 @@
+/* Copyright 2019 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#ifndef TENSORFLOW_CORE_COMMON_RUNTIME_STATIC_MEMORY_PLAN_H_
+#define TENSORFLOW_CORE_COMMON_RUNTIME_STATIC_MEMORY_PLAN_H_
+
+#include <atomic>
+#include <memory>
+#include <vector>
+
+#include "tensorflow/core/framework/allocator.h"
+#include "tensorflow/core/graph/graph.h"
+#include "tensorflow/core/platform/macros.h"
+#include "tensorflow/core/platform/mutex.h"
+#include "tensorflow/core/platform/thread_annotations.h"
+#include "tensorflow/core/platform/types.h"
+
+namespace tensorflow {
+
+// A `StaticMemoryPlan` assigns node outputs of known sizes to offsets in a
+// single block of memory, computed once for a graph, so that a step can
+// allocate all of them from one block. Outputs that may be live at the same
+// time get disjoint ranges of the block; other outputs may share memory.
+//
+// Two outputs are known not to be live at the same time if every consumer
+// of one of them must finish before the producer of the other one starts,
+// following the data and control edges of the graph. The plan is assigned
+// greedily, the largest outputs first, like the arena planners of XLA and
+// TensorFlow Lite.
+//
+// A kernel may keep an output alive for longer than its consumers, e.g. by
+// forwarding it to one of its own outputs. The plan therefore tracks at run
+// time which buffers of a step are live, and an output whose memory is still
+// in use (or that is larger than planned) is allocated from the device
+// allocator instead.
+class StaticMemoryPlan
+    : public std::enable_shared_from_this<StaticMemoryPlan> {
+ public:
+  // An output whose memory may be planned.
+  struct Output {
+    const Node* node;
+    int index;
+    // Identifies the output in `StepMemory::output_allocators()`.
+    int output_id;
+  };
+
+  class Planner;
+
+  ~StaticMemoryPlan();
+
+  // Returns the size of the block of memory of a step.
+  size_t block_bytes() const { return block_bytes_; }
+
+  // Returns the offset in the block of the `i`th planned output (in the
+  // order of `Planner::Plan()`).
+  size_t offset(int i) const { return slots_[i].offset; }
+
+  class StepMemory;
+
+  // Returns the memory for a new step, which the step must Unref() when it
+  // ends. The memory returns to the plan (to be reused by a later step) once
+  // all tensors allocated from it are deallocated.
+  StepMemory* AcquireStepMemory() LOCKS_EXCLUDED(mu_);
+
+ private:
+  class SlotAllocator;
+  struct Slot {
+    int output_id;
+    size_t offset;
+    size_t num_bytes;
+    // The other slots whose range of the block intersects this one.
+    std::vector<int> overlaps;
+  };
+
+  StaticMemoryPlan(std::vector<Slot> slots, size_t block_bytes,
+                   int num_output_ids, Allocator* allocator);
+
+  void Recycle(StepMemory* memory) LOCKS_EXCLUDED(mu_);
+
+  const std::vector<Slot> slots_;
+  const size_t block_bytes_;
+  const int num_output_ids_;
+  Allocator* const allocator_;  // Not owned.
+
+  mutex mu_;
+  std::vector<StepMemory*> free_memory_ GUARDED_BY(mu_);
+
+  TF_DISALLOW_COPY_AND_ASSIGN(StaticMemoryPlan);
+};
+
+// Finds which outputs of a graph may be live at the same time, ahead of
+// knowing their sizes. Only holds the results of the analysis, not the graph.
+class StaticMemoryPlan::Planner {
+ public:
+  // Analyzes `outputs` of `graph`. Returns nullptr if the graph is too large
+  // to analyze.
+  static std::unique_ptr<Planner> Create(const Graph& graph,
+                                         const std::vector<Output>& outputs);
+
+  // Plans the memory of the outputs of `num_bytes[i] > 0` bytes, where `i`
+  // follows the order of the outputs in `Create()`. The blocks of memory are
+  // obtained from `allocator`, which must outlive the plan. Returns nullptr
+  // if there is nothing to plan.
+  std::shared_ptr<StaticMemoryPlan> Plan(const std::vector<size_t>& num_bytes,
+                                         int num_output_ids,
+                                         Allocator* allocator) const;
+
+ private:
+  struct PlannedOutput {
+    int node_id;
+    int output_id;
+    // The indices in the predecessor sets of the nodes that use the output:
+    // its consumers, or its producer if it has none.
+    std::vector<int> users;
+  };
+
+  // `user_ids` maps node ids to indices in the predecessor sets.
+  Planner(std::vector<PlannedOutput> outputs, const std::vector<int>& user_ids,
+          int num_users, const Graph& graph);
+
+  // Returns true if output `a` is dead before output `b` is allocated.
+  bool DeadBefore(const PlannedOutput& a, const PlannedOutput& b) const;
+
+  const std::vector<PlannedOutput> outputs_;
+  const size_t num_words_;
+  // The sets of users that must finish before each node starts, as bitmaps
+  // of `num_words_` words indexed by node id.
+  std::vector<uint64> predecessors_;
+
+  TF_DISALLOW_COPY_AND_ASSIGN(Planner);
+};
+
+// The block of memory of a step, and the allocators of its planned outputs.
+class StaticMemoryPlan::StepMemory {
+ public:
+  ~StepMemory();
+
+  // Returns an array indexed by output id, which holds the allocator of each
+  // planned output and nullptr for the other outputs.
+  Allocator* const* output_allocators() const {
+    return output_allocators_.data();
+  }
+
+  // Returns true if `ptr` points into the block.
+  bool Contains(const void* ptr) const {
+    const char* p = static_cast<const char*>(ptr);
+    return block_ != nullptr && p >= block_ && p < block_ + plan_->block_bytes_;
+  }
+
+  void Ref() { ref_.fetch_add(1, std::memory_order_relaxed); }
+  void Unref();
+
+ private:
+  friend class StaticMemoryPlan;
+  friend class StaticMemoryPlan::SlotAllocator;
+
+  explicit StepMemory(StaticMemoryPlan* plan);
+
+  // Marks slot `i` as live. Returns false, leaving it free, if a slot that
+  // shares its memory is live.
+  bool Claim(int i);
+
+  StaticMemoryPlan* const plan_;
+  // Keeps the plan alive while the memory is in use by a step.
+  std::shared_ptr<StaticMemoryPlan> plan_ref_;
+  char* block_ = nullptr;
+  std::unique_ptr<SlotAllocator[]> slot_allocators_;
+  std::vector<Allocator*> output_allocators_;
+  std::unique_ptr<std::atomic<bool>[]> live_;
+  std::atomic<int> ref_{0};
+
+  TF_DISALLOW_COPY_AND_ASSIGN(StepMemory);
+};
+
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_CORE_COMMON_RUNTIME_STATIC_MEMORY_PLAN_H_
@@ -0,0 +1,181 @@
+/* Copyright 2019 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/common_runtime/static_memory_plan.h"
+
+#include <atomic>
+#include <vector>
+
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/graph/testlib.h"
+#include "tensorflow/core/platform/test.h"
+
+namespace tensorflow {
+namespace {
+
+// Counts the allocations that reach the wrapped allocator.
+class CountingAllocator : public Allocator {
+ public:
+  string Name() override { return "counting"; }
+
+  void* AllocateRaw(size_t alignment, size_t num_bytes) override {
+    ++num_allocations_;
+    return cpu_allocator()->AllocateRaw(alignment, num_bytes);
+  }
+
+  void DeallocateRaw(void* ptr) override {
+    cpu_allocator()->DeallocateRaw(ptr);
+  }
+
+  int num_allocations() const { return num_allocations_; }
+
+ private:
+  std::atomic<int> num_allocations_{0};
+};
+
+class StaticMemoryPlanTest : public ::testing::Test {
+ protected:
+  StaticMemoryPlanTest() : graph_(OpRegistry::Global()) {}
+
+  // Builds the chain c -> n[0] -> n[1] -> ... -> n[num_nodes - 1], and plans
+  // 1000 bytes for the output of each n[i], with output id i.
+  void BuildChain(int num_nodes) {
+    Tensor c(DT_FLOAT, TensorShape({250}));
+    c.flat<float>().setZero();
+    Node* input = test::graph::Constant(&graph_, c);
+    std::vector<StaticMemoryPlan::Output> outputs;
+    for (int i = 0; i < num_nodes; ++i) {
+      input = test::graph::Unary(&graph_, "Neg", input);
+      outputs.push_back({input, 0, i});
+    }
+    auto planner = StaticMemoryPlan::Planner::Create(graph_, outputs);
+    ASSERT_NE(nullptr, planner);
+    plan_ = planner->Plan(std::vector<size_t>(num_nodes, 1000), num_nodes,
+                          &allocator_);
+    ASSERT_NE(nullptr, plan_);
+  }
+
+  Graph graph_;
+  CountingAllocator allocator_;
+  std::shared_ptr<StaticMemoryPlan> plan_;
+};
+
+TEST_F(StaticMemoryPlanTest, ReusesMemoryOfDeadOutputs) {
+  BuildChain(4);
+  // Each output is live only with its neighbors in the chain, so every other
+  // output can share memory.
+  EXPECT_EQ(2048, plan_->block_bytes());
+  EXPECT_EQ(plan_->offset(0), plan_->offset(2));
+  EXPECT_EQ(plan_->offset(1), plan_->offset(3));
+  EXPECT_NE(plan_->offset(0), plan_->offset(1));
+}
+
+TEST_F(StaticMemoryPlanTest, SkipsOutputsOfUnknownSize) {
+  Tensor c(DT_FLOAT, TensorShape({250}));
+  c.flat<float>().setZero();
+  Node* n0 =
+      test::graph::Unary(&graph_, "Neg", test::graph::Constant(&graph_, c));
+  Node* n1 = test::graph::Unary(&graph_, "Neg", n0);
+  auto planner =
+      StaticMemoryPlan::Planner::Create(graph_, {{n0, 0, 0}, {n1, 0, 1}});
+  ASSERT_NE(nullptr, planner);
+  EXPECT_EQ(nullptr, planner->Plan({0, 0}, 2, &allocator_));
+  plan_ = planner->Plan({0, 1000}, 2, &allocator_);
+  ASSERT_NE(nullptr, plan_);
+  EXPECT_EQ(1024, plan_->block_bytes());
+  StaticMemoryPlan::StepMemory* memory = plan_->AcquireStepMemory();
+  EXPECT_EQ(nullptr, memory->output_allocators()[0]);
+  EXPECT_NE(nullptr, memory->output_allocators()[1]);
+  memory->Unref();
+}
+
+TEST_F(StaticMemoryPlanTest, AllocatesFromTheBlockOfTheStep) {
+  BuildChain(4);
+  StaticMemoryPlan::StepMemory* memory = plan_->AcquireStepMemory();
+  Allocator* const* allocators = memory->output_allocators();
+  std::vector<void*> ptrs;
+  for (int i = 0; i < 4; ++i) {
+    ptrs.push_back(allocators[i]->AllocateRaw(Allocator::kAllocatorAlignment,
+                                              1000));
+    if (i > 0) {
+      // The output of the previous node is dead.
+      allocators[i - 1]->DeallocateRaw(ptrs[i - 1]);
+    }
+    EXPECT_TRUE(memory->Contains(ptrs[i]));
+  }
+  allocators[3]->DeallocateRaw(ptrs[3]);
+  // Only the block came from the wrapped allocator.
+  EXPECT_EQ(1, allocator_.num_allocations());
+  memory->Unref();
+}
+
+TEST_F(StaticMemoryPlanTest, FallsBackWhenMemoryIsInUse) {
+  BuildChain(4);
+  StaticMemoryPlan::StepMemory* memory = plan_->AcquireStepMemory();
+  Allocator* const* allocators = memory->output_allocators();
+  // The output of n[0] stays alive, e.g. because n[1] forwarded it.
+  void* ptr0 =
+      allocators[0]->AllocateRaw(Allocator::kAllocatorAlignment, 1000);
+  void* ptr2 =
+      allocators[2]->AllocateRaw(Allocator::kAllocatorAlignment, 1000);
+  EXPECT_TRUE(memory->Contains(ptr0));
+  EXPECT_FALSE(memory->Contains(ptr2));
+  allocators[2]->DeallocateRaw(ptr2);
+  allocators[0]->DeallocateRaw(ptr0);
+  // The memory is free again.
+  ptr2 = allocators[2]->AllocateRaw(Allocator::kAllocatorAlignment, 1000);
+  EXPECT_EQ(ptr0, ptr2);
+  allocators[2]->DeallocateRaw(ptr2);
+  memory->Unref();
+}
+
+TEST_F(StaticMemoryPlanTest, FallsBackForLargerOutputs) {
+  BuildChain(2);
+  StaticMemoryPlan::StepMemory* memory = plan_->AcquireStepMemory();
+  Allocator* a = memory->output_allocators()[0];
+  void* ptr = a->AllocateRaw(Allocator::kAllocatorAlignment, 4096);
+  EXPECT_FALSE(memory->Contains(ptr));
+  a->DeallocateRaw(ptr);
+  memory->Unref();
+}
+
+TEST_F(StaticMemoryPlanTest, ReusesBlocksAcrossSteps) {
+  BuildChain(2);
+  const char* first = nullptr;
+  for (int step = 0; step < 3; ++step) {
+    StaticMemoryPlan::StepMemory* memory = plan_->AcquireStepMemory();
+    Allocator* a = memory->output_allocators()[0];
+    Tensor t(a, DT_FLOAT, TensorShape({250}));
+    if (step == 0) {
+      first = t.tensor_data().data();
+    }
+    EXPECT_EQ(first, t.tensor_data().data());
+    memory->Unref();
+  }
+  EXPECT_EQ(1, allocator_.num_allocations());
+}
+
+TEST_F(StaticMemoryPlanTest, TensorsOutliveThePlan) {
+  BuildChain(2);
+  StaticMemoryPlan::StepMemory* memory = plan_->AcquireStepMemory();
+  Tensor t(memory->output_allocators()[1], DT_FLOAT, TensorShape({250}));
+  t.flat<float>().setConstant(1.0f);
+  memory->Unref();
+  plan_.reset();
+  EXPECT_EQ(1.0f, t.flat<float>()(249));
+}
+
+}  // namespace
+}  // namespace tensorflow
@@ -0,0 +1,151 @@
+/* Copyright 2019 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#include "tensorflow/core/common_runtime/step_arena_allocator.h"
+
+#include <algorithm>
+
+#include "tensorflow/core/platform/logging.h"
+
+namespace tensorflow {
+
+StepArenaAllocator::StepArenaAllocator(Allocator* wrapped, size_t block_bytes,
+                                       size_t max_allocation_bytes,
+                                       size_t max_bytes)
+    : wrapped_(wrapped),
+      block_bytes_(block_bytes),
+      max_allocation_bytes_(std::min(max_allocation_bytes, block_bytes)),
+      max_blocks_(
+          static_cast<int>(std::max<size_t>(1, max_bytes / block_bytes))),
+      blocks_(new Block[max_blocks_]) {
+  DCHECK_EQ(0, block_bytes % Allocator::kAllocatorAlignment);
+}
+
+StepArenaAllocator::~StepArenaAllocator() {
+  const int num_blocks = num_blocks_.load(std::memory_order_acquire);
+  for (int i = 0; i < num_blocks; ++i) {
+    wrapped_->DeallocateRaw(blocks_[i].data);
+  }
+}
+
+// static
+void* StepArenaAllocator::AllocateFromBlock(Block* block, size_t num_bytes) {
+  // The block is counted as live before its pointer is bumped, so that
+  // `NextBlock()` does not reuse it under an allocation in progress.
+  block->live.fetch_add(1);
+  // Overshooting the size of a full block is harmless: its `used` only grows
+  // until the block is reused.
+  const size_t offset = block->used.fetch_add(num_bytes);
+  if (offset + num_bytes > block->size) {
+    block->live.fetch_sub(1);
+    return nullptr;
+  }
+  return block->data + offset;
+}
+
+int StepArenaAllocator::NextBlock(int current) {
+  if (current >= 0) {
+    // No allocation from the block succeeds until it is reused. Only retired
+    // blocks are reused, so that an allocation that starts on a retired block
+    // either fails or is counted as live before the block is reset.
+    blocks_[current].used.store(block_bytes_ + 1);
+  }
+  const int num_blocks = num_blocks_.load(std::memory_order_acquire);
+  for (int i = 0; i < num_blocks; ++i) {
+    if (i != current && blocks_[i].live.load() == 0) {
+      blocks_[i].used.store(0);
+      return i;
+    }
+  }
+  if (num_blocks == max_blocks_) {
+    return -1;
+  }
+  Block* block = &blocks_[num_blocks];
+  block->data = static_cast<char*>(
+      wrapped_->AllocateRaw(Allocator::kAllocatorAlignment, block_bytes_));
+  if (block->data == nullptr) {
+    return -1;
+  }
+  block->size = block_bytes_;
+  num_blocks_.store(num_blocks + 1, std::memory_order_release);
+  return num_blocks;
+}
+
+void* StepArenaAllocator::AllocateRaw(size_t alignment, size_t num_bytes) {
+  // Each allocation keeps the allocator alive, because the `TensorBuffer` that
+  // owns it refers back to this object on deallocation.
+  Ref();
+  if (num_bytes > 0 && num_bytes <= max_allocation_bytes_ &&
+      alignment <= Allocator::kAllocatorAlignment) {
+    // Keeps every arena buffer aligned like the start of a block.
+    const size_t rounded_bytes =
+        (num_bytes + Allocator::kAllocatorAlignment - 1) &
+        ~(Allocator::kAllocatorAlignment - 1);
+    int current = current_.load(std::memory_order_acquire);
+    while (true) {
+      if (current >= 0) {
+        void* ptr = AllocateFromBlock(&blocks_[current], rounded_bytes);
+        if (ptr != nullptr) {
+          num_arena_allocations_.fetch_add(1, std::memory_order_relaxed);
+          return ptr;
+        }
+      }
+      mutex_lock l(mu_);
+      const int latest = current_.load(std::memory_order_acquire);
+      if (latest != current) {
+        // Another thread changed the current block.
+        current = latest;
+        continue;
+      }
+      const int next = NextBlock(current);
+      if (next < 0) {
+        break;
+      }
+      current_.store(next, std::memory_order_release);
+      current = next;
+    }
+  }
+  void* ptr = wrapped_->AllocateRaw(alignment, num_bytes);
+  if (ptr == nullptr) {
+    Unref();
+  }
+  return ptr;
+}
+
+int StepArenaAllocator::BlockIndex(const void* ptr) const {
+  const char* p = static_cast<const char*>(ptr);
+  const int num_blocks = num_blocks_.load(std::memory_order_acquire);
+  for (int i = 0; i < num_blocks; ++i) {
+    if (p >= blocks_[i].data && p < blocks_[i].data + blocks_[i].size) {
+      return i;
+    }
+  }
+  return -1;
+}
+
+void StepArenaAllocator::DeallocateRaw(void* ptr) {
+  const int block = BlockIndex(ptr);
+  if (block < 0) {
+    wrapped_->DeallocateRaw(ptr);
+  } else {
+    blocks_[block].live.fetch_sub(1);
+  }
+  Unref();
+}
+
+size_t StepArenaAllocator::block_bytes_allocated() const {
+  return num_blocks_.load(std::memory_order_acquire) * block_bytes_;
+}
+
+}  // namespace tensorflow
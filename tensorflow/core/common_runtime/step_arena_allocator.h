@@ -0,0 +1,110 @@
+/* Copyright 2019 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#ifndef TENSORFLOW_CORE_COMMON_RUNTIME_STEP_ARENA_ALLOCATOR_H_
+#define TENSORFLOW_CORE_COMMON_RUNTIME_STEP_ARENA_ALLOCATOR_H_
+
+#include <atomic>
+#include <memory>
+
+#include "tensorflow/core/framework/allocator.h"
+#include "tensorflow/core/lib/core/refcount.h"
+#include "tensorflow/core/platform/macros.h"
+#include "tensorflow/core/platform/mutex.h"
+#include "tensorflow/core/platform/thread_annotations.h"
+#include "tensorflow/core/platform/types.h"
+
+namespace tensorflow {
+
+// A `StepArenaAllocator` serves the allocations of a single step by bumping a
+// pointer through large blocks obtained from a wrapped allocator. Deallocating
+// an arena buffer does not release its memory, but a block whose buffers have
+// all been deallocated is reused once the current block is full. All blocks
+// are released together when the allocator is destroyed.
+//
+// The executor allocates from it the outputs of kernels that are consumed
+// only within the step, so that a step of many small kernels does not
+// allocate and deallocate each of their outputs individually.
+//
+// Allocations of more than `max_allocation_bytes` bytes, allocations that
+// need more than the default alignment, and allocations after `max_bytes`
+// bytes of blocks have been obtained are delegated to the wrapped allocator.
+//
+// Each allocation holds a reference on the allocator, so the blocks outlive
+// any tensor allocated from them, even if it outlives the step.
+class StepArenaAllocator : public Allocator, public core::RefCounted {
+ public:
+  StepArenaAllocator(Allocator* wrapped, size_t block_bytes,
+                     size_t max_allocation_bytes, size_t max_bytes);
+
+  string Name() override { return "step_arena"; }
+
+  void* AllocateRaw(size_t alignment, size_t num_bytes) override;
+  void DeallocateRaw(void* ptr) override;
+
+  // Returns true if `ptr` points into a block of the arena.
+  bool Contains(const void* ptr) const { return BlockIndex(ptr) >= 0; }
+
+  // Returns the number of allocations served from the arena.
+  int64 num_arena_allocations() const {
+    return num_arena_allocations_.load(std::memory_order_relaxed);
+  }
+
+  // Returns the number of bytes of the blocks of the arena.
+  size_t block_bytes_allocated() const LOCKS_EXCLUDED(mu_);
+
+ private:
+  ~StepArenaAllocator() override;
+
+  struct Block {
+    char* data = nullptr;
+    size_t size = 0;
+    std::atomic<size_t> used{0};
+    // The number of buffers of the block that are allocated, plus the number
+    // of allocations from the block that are in progress.
+    std::atomic<int64> live{0};
+  };
+
+  // Bumps the pointer of `block`. Returns nullptr if it is full.
+  static void* AllocateFromBlock(Block* block, size_t num_bytes);
+
+  // Retires the block `current` (if any) and returns the index of the block
+  // to allocate from next: a retired block without live buffers, or a new
+  // block. Returns -1 if there is none.
+  int NextBlock(int current) EXCLUSIVE_LOCKS_REQUIRED(mu_);
+
+  // Returns the index of the block that `ptr` points into, or -1.
+  int BlockIndex(const void* ptr) const;
+
+  Allocator* const wrapped_;  // Not owned.
+  const size_t block_bytes_;
+  const size_t max_allocation_bytes_;
+  const int max_blocks_;
+
+  // The blocks. The `data` and `size` of the first `num_blocks_` entries are
+  // set, and never change once set. Allocations are served from the block
+  // `current_`, or from the wrapped allocator if it is -1.
+  const std::unique_ptr<Block[]> blocks_;
+  std::atomic<int> num_blocks_{0};
+  std::atomic<int> current_{-1};
+  mutable mutex mu_;  // Serializes the changes of the current block.
+
+  std::atomic<int64> num_arena_allocations_{0};
+
+  TF_DISALLOW_COPY_AND_ASSIGN(StepArenaAllocator);
+};
+
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_CORE_COMMON_RUNTIME_STEP_ARENA_ALLOCATOR_H_
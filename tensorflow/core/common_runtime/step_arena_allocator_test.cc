@@ -0,0 +1,223 @@
+/* Copyright 2019 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/common_runtime/step_arena_allocator.h"
+
+#include <atomic>
+#include <cstring>
+#include <vector>
+
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/framework/tensor_testutil.h"
+#include "tensorflow/core/lib/core/threadpool.h"
+#include "tensorflow/core/platform/test.h"
+#include "tensorflow/core/platform/test_benchmark.h"
+
+namespace tensorflow {
+namespace {
+
+// Counts the allocations that reach the wrapped allocator.
+class CountingAllocator : public Allocator {
+ public:
+  string Name() override { return "counting"; }
+
+  void* AllocateRaw(size_t alignment, size_t num_bytes) override {
+    ++num_allocations_;
+    ++num_live_;
+    return cpu_allocator()->AllocateRaw(alignment, num_bytes);
+  }
+
+  void DeallocateRaw(void* ptr) override {
+    --num_live_;
+    cpu_allocator()->DeallocateRaw(ptr);
+  }
+
+  int num_allocations() const { return num_allocations_; }
+  int num_live() const { return num_live_; }
+
+ private:
+  std::atomic<int> num_allocations_{0};
+  std::atomic<int> num_live_{0};
+};
+
+TEST(StepArenaAllocatorTest, ServesSmallAllocationsFromBlocks) {
+  CountingAllocator wrapped;
+  StepArenaAllocator* a = new StepArenaAllocator(
+      &wrapped, /*block_bytes=*/4096, /*max_allocation_bytes=*/1024,
+      /*max_bytes=*/1 << 20);
+  std::vector<void*> ptrs;
+  for (int i = 0; i < 100; ++i) {
+    void* ptr = a->AllocateRaw(Allocator::kAllocatorAlignment, 100);
+    ASSERT_NE(nullptr, ptr);
+    EXPECT_EQ(0, reinterpret_cast<uintptr_t>(ptr) %
+                     Allocator::kAllocatorAlignment);
+    memset(ptr, i, 100);
+    ptrs.push_back(ptr);
+  }
+  for (int i = 0; i < 100; ++i) {
+    EXPECT_EQ(static_cast<char>(i), static_cast<char*>(ptrs[i])[99]);
+    a->DeallocateRaw(ptrs[i]);
+  }
+  EXPECT_EQ(100, a->num_arena_allocations());
+  // Each block of 4096 bytes holds 32 buffers of 100 bytes, rounded up to
+  // the alignment.
+  EXPECT_EQ(4, wrapped.num_allocations());
+  EXPECT_EQ(4 * 4096, a->block_bytes_allocated());
+  // The blocks are released with the allocator, not with their buffers.
+  EXPECT_EQ(4, wrapped.num_live());
+  a->Unref();
+  EXPECT_EQ(0, wrapped.num_live());
+}
+
+TEST(StepArenaAllocatorTest, DelegatesLargeAllocations) {
+  CountingAllocator wrapped;
+  StepArenaAllocator* a = new StepArenaAllocator(
+      &wrapped, /*block_bytes=*/4096, /*max_allocation_bytes=*/1024,
+      /*max_bytes=*/1 << 20);
+  void* ptr = a->AllocateRaw(Allocator::kAllocatorAlignment, 2048);
+  ASSERT_NE(nullptr, ptr);
+  EXPECT_EQ(0, a->num_arena_allocations());
+  EXPECT_EQ(1, wrapped.num_live());
+  a->DeallocateRaw(ptr);
+  EXPECT_EQ(0, wrapped.num_live());
+  a->Unref();
+}
+
+TEST(StepArenaAllocatorTest, DelegatesAllocationsBeyondMaxBytes) {
+  CountingAllocator wrapped;
+  StepArenaAllocator* a = new StepArenaAllocator(
+      &wrapped, /*block_bytes=*/1024, /*max_allocation_bytes=*/1024,
+      /*max_bytes=*/2048);
+  std::vector<void*> ptrs;
+  for (int i = 0; i < 4; ++i) {
+    ptrs.push_back(a->AllocateRaw(Allocator::kAllocatorAlignment, 1024));
+    ASSERT_NE(nullptr, ptrs.back());
+  }
+  EXPECT_EQ(2, a->num_arena_allocations());
+  EXPECT_EQ(2048, a->block_bytes_allocated());
+  for (void* ptr : ptrs) {
+    a->DeallocateRaw(ptr);
+  }
+  EXPECT_EQ(2, wrapped.num_live());
+  a->Unref();
+  EXPECT_EQ(0, wrapped.num_live());
+}
+
+TEST(StepArenaAllocatorTest, ReusesBlocksOfDeallocatedBuffers) {
+  CountingAllocator wrapped;
+  StepArenaAllocator* a = new StepArenaAllocator(
+      &wrapped, /*block_bytes=*/1024, /*max_allocation_bytes=*/1024,
+      /*max_bytes=*/1 << 20);
+  // Each buffer fills a block, and is deallocated before the next one is
+  // allocated, so the arena alternates between two blocks.
+  for (int i = 0; i < 10; ++i) {
+    void* ptr = a->AllocateRaw(Allocator::kAllocatorAlignment, 1024);
+    ASSERT_NE(nullptr, ptr);
+    EXPECT_TRUE(a->Contains(ptr));
+    a->DeallocateRaw(ptr);
+  }
+  EXPECT_EQ(10, a->num_arena_allocations());
+  EXPECT_EQ(2, wrapped.num_allocations());
+  // A block with a live buffer is not reused.
+  void* live = a->AllocateRaw(Allocator::kAllocatorAlignment, 1024);
+  for (int i = 0; i < 3; ++i) {
+    void* ptr = a->AllocateRaw(Allocator::kAllocatorAlignment, 1024);
+    ASSERT_NE(nullptr, ptr);
+    EXPECT_NE(live, ptr);
+    a->DeallocateRaw(ptr);
+  }
+  a->DeallocateRaw(live);
+  EXPECT_EQ(3, wrapped.num_allocations());
+  a->Unref();
+  EXPECT_EQ(0, wrapped.num_live());
+}
+
+TEST(StepArenaAllocatorTest, TensorsOutliveTheStep) {
+  CountingAllocator wrapped;
+  StepArenaAllocator* a = new StepArenaAllocator(
+      &wrapped, /*block_bytes=*/4096, /*max_allocation_bytes=*/1024,
+      /*max_bytes=*/1 << 20);
+  Tensor t(a, DT_FLOAT, TensorShape({16}));
+  t.flat<float>().setConstant(1.0f);
+  // The step releases its reference while `t` still refers to a block.
+  a->Unref();
+  EXPECT_EQ(1, wrapped.num_live());
+  test::ExpectTensorEqual<float>(
+      test::AsTensor<float>(std::vector<float>(16, 1.0f)), t);
+  t = Tensor();
+  EXPECT_EQ(0, wrapped.num_live());
+}
+
+TEST(StepArenaAllocatorTest, ConcurrentAllocations) {
+  CountingAllocator wrapped;
+  StepArenaAllocator* a = new StepArenaAllocator(
+      &wrapped, /*block_bytes=*/4096, /*max_allocation_bytes=*/256,
+      /*max_bytes=*/1 << 20);
+  const int kNumThreads = 8;
+  const int kNumAllocations = 500;
+  {
+    thread::ThreadPool pool(Env::Default(), "arena_test", kNumThreads);
+    for (int t = 0; t < kNumThreads; ++t) {
+      pool.Schedule([a, t]() {
+        std::vector<char*> ptrs;
+        for (int i = 0; i < kNumAllocations; ++i) {
+          char* ptr = static_cast<char*>(
+              a->AllocateRaw(Allocator::kAllocatorAlignment, 64));
+          ASSERT_NE(nullptr, ptr);
+          memset(ptr, t, 64);
+          ptrs.push_back(ptr);
+        }
+        // No other thread was handed an overlapping buffer.
+        for (char* ptr : ptrs) {
+          for (int j = 0; j < 64; ++j) {
+            ASSERT_EQ(static_cast<char>(t), ptr[j]);
+          }
+          a->DeallocateRaw(ptr);
+        }
+      });
+    }
+  }
+  EXPECT_EQ(kNumThreads * kNumAllocations, a->num_arena_allocations());
+  a->Unref();
+  EXPECT_EQ(0, wrapped.num_live());
+}
+
+static void BM_Allocation(int iters, bool use_arena) {
+  const int kAllocationsPerStep = 1000;
+  for (int i = 0; i < iters; ++i) {
+    StepArenaAllocator* arena = new StepArenaAllocator(
+        cpu_allocator(), /*block_bytes=*/1 << 20,
+        /*max_allocation_bytes=*/64 << 10, /*max_bytes=*/64 << 20);
+    Allocator* a = use_arena ? static_cast<Allocator*>(arena) : cpu_allocator();
+    for (int j = 0; j < kAllocationsPerStep; ++j) {
+      a->DeallocateRaw(a->AllocateRaw(Allocator::kAllocatorAlignment,
+                                      64 + (j % 16) * 64));
+    }
+    arena->Unref();
+  }
+}
+
+static void BM_AllocationWithoutArena(int iters) {
+  BM_Allocation(iters, /*use_arena=*/false);
+}
+BENCHMARK(BM_AllocationWithoutArena);
+
+static void BM_AllocationWithArena(int iters) {
+  BM_Allocation(iters, /*use_arena=*/true);
+}
+BENCHMARK(BM_AllocationWithArena);
+
+}  // namespace
+}  // namespace tensorflow
@@ -281,6 +281,8 @@ class IteratorContext {
           env(ctx->env()),
           flr(ctx->flr()),
           function_handle_cache(ctx->function_handle_cache()),
+          incremental_checkpoints(ctx->incremental_checkpoints()),
+          map_element_batching(ctx->map_element_batching()),
           resource_mgr(ctx->resource_mgr()),
           model(ctx->model()),
           runner(*(ctx->runner())),
@@ -337,6 +339,15 @@ class IteratorContext {
     // A FunctionHandleCache that owns all the function handles. Not owned.
     FunctionHandleCache* function_handle_cache = nullptr;
 
+    // Whether iterators that buffer the elements of their input should save
+    // checkpoints from which the buffered elements can be recomputed, instead
+    // of the elements themselves.
+    bool incremental_checkpoints = false;
+
+    // Whether parallel maps may group input elements into invocations of a
+    // batched version of their function.
+    bool map_element_batching = false;
+
     // A resource manager for storing dataset-related state, e.g. random
     // seeds or cached tensors. Not owned.
     ResourceMgr* resource_mgr = nullptr;
@@ -386,6 +397,12 @@ class IteratorContext {
     return params_.function_handle_cache;
   }
 
+  bool incremental_checkpoints() const {
+    return params_.incremental_checkpoints;
+  }
+
+  bool map_element_batching() const { return params_.map_element_batching; }
+
   ResourceMgr* resource_mgr() { return params_.resource_mgr; }
 
   const std::shared_ptr<model::Model>& model() { return params_.model; }
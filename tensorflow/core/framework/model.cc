@@ -15,6 +15,7 @@ limitations under the License.
 
 #include "tensorflow/core/framework/model.h"
 
+#include <algorithm>
 #include <memory>
 
 #include "absl/time/clock.h"
@@ -667,6 +668,47 @@ std::shared_ptr<Node> MakeUnknownNode(Node::Args args) {
   return std::make_shared<Unknown>(std::move(args));
 }
 
+string ModelStats::DebugString() const {
+  string result;
+  strings::StrAppend(&result, "bottleneck=",
+                     bottleneck.empty() ? "unknown" : bottleneck, "\n");
+  for (const auto& node : nodes) {
+    strings::StrAppend(&result, node.name, ":\n");
+    strings::StrAppend(&result, "  num_elements=", node.num_elements, "\n");
+    strings::StrAppend(&result, "  throughput=", node.throughput, "\n");
+    strings::StrAppend(&result, "  self_processing_time=",
+                       node.self_processing_time, "\n");
+    strings::StrAppend(&result, "  output_time=", node.output_time, "\n");
+    strings::StrAppend(&result, "  wait_time=", node.wait_time, "\n");
+    strings::StrAppend(&result, "  buffered_elements=", node.buffered_elements,
+                       "\n");
+    strings::StrAppend(&result, "  buffered_bytes=", node.buffered_bytes, "\n");
+    for (const auto& pair : node.parameters) {
+      strings::StrAppend(&result, "  ", pair.first, "=", pair.second, "\n");
+    }
+  }
+  return result;
+}
+
+void ComputeThroughput(const ModelStats& previous, ModelStats* stats) {
+  const int64 delta_micros =
+      stats->timestamp_micros - previous.timestamp_micros;
+  if (delta_micros <= 0) {
+    return;
+  }
+  std::map<string, int64> previous_elements;
+  for (const auto& node : previous.nodes) {
+    previous_elements[node.name] = node.num_elements;
+  }
+  for (auto& node : stats->nodes) {
+    auto* num_elements = gtl::FindOrNull(previous_elements, node.name);
+    if (num_elements && *num_elements <= node.num_elements) {
+      node.throughput = static_cast<double>(node.num_elements - *num_elements) *
+                        EnvTime::kSecondsToMicros / delta_micros;
+    }
+  }
+}
+
 std::shared_ptr<Node> Model::AddNode(Node::Factory factory, const string& name,
                                      const string& output_name) {
   // The name captures the sequence of iterators joined by `::`. We use the full
@@ -777,6 +819,62 @@ void Model::RemoveNode(const string& name) {
   lookup_table_.erase(name);
 }
 
+ModelStats Model::CollectStats() {
+  ModelStats stats;
+  stats.timestamp_micros = EnvTime::Default()->NowMicros();
+  std::shared_ptr<Node> snapshot;
+  {
+    tf_shared_lock lock(mu_);
+    if (!output_) {
+      return stats;
+    }
+    snapshot = output_->Snapshot(nullptr);
+  }
+  // The bottleneck is the node with the largest processing time per element
+  // produced by the root, which is proportional to its aggregate processing
+  // time divided by its parallelism.
+  double bottleneck_time = 0;
+  std::vector<std::shared_ptr<Node>> stack = {snapshot};
+  while (!stack.empty()) {
+    std::shared_ptr<Node> node = stack.back();
+    stack.pop_back();
+    NodeStats node_stats;
+    node_stats.name = node->long_name();
+    if (node->output()) {
+      node_stats.output = node->output()->long_name();
+    }
+    node_stats.autotune = node->autotune();
+    node_stats.num_elements = node->num_elements();
+    node_stats.processing_time = node->processing_time();
+    node_stats.self_processing_time = node->SelfProcessingTime();
+    node_stats.output_time = OutputTime(node, /*gradient=*/nullptr);
+    node_stats.buffered_elements = node->buffered_elements();
+    node_stats.buffered_bytes = node->buffered_bytes();
+    node_stats.parameters = node->ParameterValues();
+    double parallelism = 1.0;
+    auto* value = gtl::FindOrNull(node_stats.parameters, kParallelism);
+    if (value && *value > 1.0) {
+      parallelism = *value;
+    }
+    node_stats.wait_time =
+        std::max(0.0, node_stats.output_time -
+                          node_stats.self_processing_time / parallelism);
+    const double time = node_stats.processing_time / parallelism;
+    if (node_stats.autotune && node_stats.num_elements > 0 &&
+        time > bottleneck_time) {
+      bottleneck_time = time;
+      stats.bottleneck = node_stats.name;
+    }
+    stats.nodes.push_back(std::move(node_stats));
+    // Push the inputs in reverse order so that they are visited in order.
+    auto inputs = node->inputs();
+    for (auto it = inputs.rbegin(); it != inputs.rend(); ++it) {
+      stack.push_back(*it);
+    }
+  }
+  return stats;
+}
+
 std::map<string, std::shared_ptr<Parameter>> Model::CollectTunableParameters(
     std::shared_ptr<Node> node) {
   std::map<string, std::shared_ptr<Parameter>> parameters;
@@ -16,6 +16,7 @@ limitations under the License.
 #define TENSORFLOW_CORE_FRAMEWORK_MODEL_H_
 
 #include <list>
+#include <map>
 #include <memory>
 #include <string>
 // TODO(b/114492873): Move this include into core/platform.
@@ -315,6 +316,27 @@ class Node {
     return result;
   }
 
+  // Returns the current values of the parameters of this node, keyed by
+  // parameter name.
+  //
+  // This method must not be called while holding the mutex of a parameter's
+  // shared state.
+  std::map<string, double> ParameterValues() const LOCKS_EXCLUDED(mu_) {
+    std::map<string, std::shared_ptr<Parameter>> parameters;
+    {
+      tf_shared_lock l(mu_);
+      parameters = parameters_;
+    }
+    // NOTE: The shared state is read outside of `mu_`, because the iterator
+    // that owns it may update this node while holding the state mutex.
+    std::map<string, double> result;
+    for (auto& pair : parameters) {
+      mutex_lock l(*pair.second->state->mu);
+      result[pair.first] = pair.second->state->value;
+    }
+    return result;
+  }
+
   // Returns the per-element processing time spent in this node.
   double SelfProcessingTime() const LOCKS_EXCLUDED(mu_) {
     tf_shared_lock l(mu_);
@@ -548,6 +570,57 @@ std::shared_ptr<Node> MakeUnknownRatioNode(Node::Args args);
 // as pass-through between inputs and output.
 std::shared_ptr<Node> MakeUnknownNode(Node::Args args);
 
+// Runtime statistics of a single node of the model.
+struct NodeStats {
+  // The unique name of the node.
+  string name;
+  // The unique name of the output of the node, or empty for the root.
+  string output;
+  // Indicates whether the node is included in autotuning.
+  bool autotune = false;
+  // The number of elements produced by the node.
+  int64 num_elements = 0;
+  // The number of elements produced by the node per second since the previous
+  // collection of statistics (see `ComputeThroughput()`), or 0 if unknown.
+  double throughput = 0;
+  // The aggregate processing time spent in the node (in nanoseconds).
+  int64 processing_time = 0;
+  // The per-element processing time spent in the node (in nanoseconds).
+  double self_processing_time = 0;
+  // The per-element output time of the subtree rooted in the node, as
+  // predicted by the model (in nanoseconds).
+  double output_time = 0;
+  // The part of `output_time` that the node is predicted to spend waiting for
+  // its inputs, i.e. not covered by its own (parallel) processing.
+  double wait_time = 0;
+  // The number of elements and bytes currently stored in the node's buffer.
+  int64 buffered_elements = 0;
+  int64 buffered_bytes = 0;
+  // The current values of the node's parameters (e.g. parallelism or buffer
+  // size), keyed by parameter name.
+  std::map<string, double> parameters;
+};
+
+// Runtime statistics of an input pipeline.
+struct ModelStats {
+  // The time at which the statistics were collected.
+  int64 timestamp_micros = 0;
+  // The statistics of each node, in pre-order starting at the root.
+  std::vector<NodeStats> nodes;
+  // The name of the node that is predicted to limit the throughput of the
+  // input pipeline, or empty if there is not enough information. This is the
+  // node that spends the most processing time per element produced by the
+  // root, after accounting for its parallelism.
+  string bottleneck;
+
+  // Returns a human-readable representation of the statistics.
+  string DebugString() const;
+};
+
+// Sets the throughput of each node in `stats` from the number of elements it
+// produced since `previous` was collected.
+void ComputeThroughput(const ModelStats& previous, ModelStats* stats);
+
 // Abstract representation of a TensorFlow input pipeline that can be used
 // for collecting runtime information and optimizing performance. It collects
 // runtime information about execution of the input pipeline that is used to
@@ -605,6 +678,13 @@ class Model {
   // Removes the given node.
   void RemoveNode(const string& name) LOCKS_EXCLUDED(mu_);
 
+  // Returns the runtime statistics of the nodes of the model and the node
+  // that the model predicts to be the bottleneck of the input pipeline.
+  //
+  // This method must not be called while holding the mutex of a parameter's
+  // shared state.
+  ModelStats CollectStats() LOCKS_EXCLUDED(mu_);
+
  private:
   // Collects tunable parameters in the tree rooted in the given node, returning
   // a mapping from a (unique) node name to a tunable parameter.
@@ -479,6 +479,89 @@ TEST(TestManyElements, Model) {
             0);
 }
 
+TEST(CollectStatsTest, Model) {
+  Model model(/*remove_node_hook=*/[](std::shared_ptr<Node> node) {});
+  EXPECT_TRUE(model.CollectStats().nodes.empty());
+  model.AddNode(
+      [](Node::Args args) {
+        return model::MakeKnownRatioNode(std::move(args), /*ratio=*/1);
+      },
+      "Root", "");
+  model.AddNode(
+      [](Node::Args args) {
+        return model::MakeAsyncKnownRatioNode(
+            std::move(args), /*ratio=*/1,
+            {model::MakeParameter(
+                kParallelism,
+                std::make_shared<SharedState>(
+                    /*value=*/4, std::make_shared<mutex>(),
+                    std::make_shared<condition_variable>()),
+                /*min=*/1, /*max=*/16)});
+      },
+      "Root::Map", "Root");
+  model.AddNode(
+      [](Node::Args args) { return model::MakeSourceNode(std::move(args)); },
+      "Root::Map::Source", "Root::Map");
+
+  model.AddProcessingTime("Root", 100);
+  model.AddProcessingTime("Root::Map", 2000);
+  model.AddProcessingTime("Root::Map::Source", 800);
+  for (int i = 0; i < 10; ++i) {
+    model.RecordElement("Root");
+    model.RecordElement("Root::Map");
+    model.RecordElement("Root::Map::Source");
+  }
+
+  ModelStats stats = model.CollectStats();
+  ASSERT_EQ(stats.nodes.size(), 3);
+  EXPECT_EQ(stats.nodes[0].name, "Root(id:1)");
+  EXPECT_EQ(stats.nodes[0].output, "");
+  EXPECT_EQ(stats.nodes[1].name, "Map(id:2)");
+  EXPECT_EQ(stats.nodes[1].output, "Root(id:1)");
+  EXPECT_EQ(stats.nodes[2].name, "Source(id:3)");
+  EXPECT_EQ(stats.nodes[2].output, "Map(id:2)");
+
+  const NodeStats& map = stats.nodes[1];
+  EXPECT_EQ(map.num_elements, 10);
+  EXPECT_EQ(map.processing_time, 2000);
+  EXPECT_EQ(map.self_processing_time, 200);
+  EXPECT_EQ(map.parameters.at(kParallelism), 4);
+  EXPECT_GE(map.wait_time, 0);
+  EXPECT_LE(map.wait_time, map.output_time);
+  // The map node spends 2000 / 4 = 500 ns per element produced by the root,
+  // which is less than the 800 ns spent by the source node.
+  EXPECT_EQ(stats.bottleneck, "Source(id:3)");
+
+  model.AddProcessingTime("Root::Map", 2000);
+  EXPECT_EQ(model.CollectStats().bottleneck, "Map(id:2)");
+}
+
+TEST(ComputeThroughputTest, Model) {
+  ModelStats previous;
+  previous.timestamp_micros = 1000000;
+  previous.nodes.resize(2);
+  previous.nodes[0].name = "a";
+  previous.nodes[0].num_elements = 10;
+  previous.nodes[1].name = "b";
+  previous.nodes[1].num_elements = 10;
+
+  ModelStats stats;
+  stats.timestamp_micros = 3000000;
+  stats.nodes.resize(3);
+  stats.nodes[0].name = "a";
+  stats.nodes[0].num_elements = 30;
+  stats.nodes[1].name = "b";
+  stats.nodes[1].num_elements = 5;
+  stats.nodes[2].name = "c";
+  stats.nodes[2].num_elements = 100;
+
+  ComputeThroughput(previous, &stats);
+  EXPECT_EQ(stats.nodes[0].throughput, 10);
+  // Nodes whose element count was reset or that are new have no throughput.
+  EXPECT_EQ(stats.nodes[1].throughput, 0);
+  EXPECT_EQ(stats.nodes[2].throughput, 0);
+}
+
 // Precision for comparison of the gradient and a relative output time change.
 constexpr double kComparisonPrecision = 1e-1;
 
@@ -294,6 +294,10 @@ OpKernelContext::OpKernelContext(Params* params, int num_outputs)
   if (params_->record_tensor_accesses) {
     referenced_tensors_.Init();
   }
+  if (params_->record_allocated_output_bytes) {
+    allocated_output_bytes_.reset(
+        new gtl::InlinedVector<int64, 4>(num_outputs));
+  }
 }
 
 OpKernelContext::~OpKernelContext() {
@@ -707,9 +711,8 @@ Status OpKernelContext::allocate_output(StringPiece name,
 }
 
 Status OpKernelContext::allocate_tensor(
-    DataType type, const TensorShape& shape, Tensor* out_tensor,
-    AllocatorAttributes attr, const AllocationAttributes& allocation_attr) {
-  Allocator* a = get_allocator(attr);
+    Allocator* a, DataType type, const TensorShape& shape, Tensor* out_tensor,
+    const AllocationAttributes& allocation_attr) {
   MEMDEBUG_CACHE_OP(op_kernel().name().c_str());
   MEMDEBUG_CACHE_STEPID(step_id());
   Tensor new_tensor(a, type, shape,
@@ -767,14 +770,36 @@ Status OpKernelContext::allocate_output(int index, const TensorShape& shape,
     }
   }
   auto output_tensor = MakeUnique<Tensor>();
-  Status s = allocate_tensor(type, shape, output_tensor.get(), attr);
+  Status s = allocate_tensor(get_output_allocator(index, attr), type, shape,
+                             output_tensor.get(), AllocationAttributes());
   if (s.ok()) {
+    if (allocated_output_bytes_) {
+      (*allocated_output_bytes_)[index] = output_tensor->TotalBytes();
+    }
     outputs_[index] = TensorValue(output_tensor.release());
     *output = outputs_[index].tensor;
   }
   return s;
 }
 
+Allocator* OpKernelContext::get_output_allocator(int index,
+                                                 AllocatorAttributes attr) {
+  // Only outputs in the memory that the executor expects for them, and whose
+  // allocations need not be tracked, may come from the executor.
+  if (attr.value != 0 || attr.scope_id != 0 || track_allocations()) {
+    return get_allocator(attr);
+  }
+  if (params_->planned_output_allocators != nullptr &&
+      params_->planned_output_allocators[index] != nullptr) {
+    return params_->planned_output_allocators[index];
+  }
+  if (params_->step_arena_allocator != nullptr &&
+      params_->step_arena_outputs[index]) {
+    return params_->step_arena_allocator;
+  }
+  return get_allocator(attr);
+}
+
 Status OpKernelContext::allocate_temp(
     DataType type, const TensorShape& shape, Tensor* out_temp,
     AllocatorAttributes allocator_attr,
@@ -663,6 +663,21 @@ class OpKernelContext {
     // Array indexed by output number for this node
     const AllocatorAttributes* output_attr_array = nullptr;
 
+    // If not null, an allocator whose memory is released at the end of the
+    // step, and an array indexed by output number for this node, which is
+    // true for the outputs that may be allocated from it.
+    Allocator* step_arena_allocator = nullptr;
+    const bool* step_arena_outputs = nullptr;
+
+    // If not null, an array indexed by output number for this node, which
+    // holds the allocators of the outputs whose memory the executor planned
+    // ahead of the step, and nullptr for the other outputs.
+    Allocator* const* planned_output_allocators = nullptr;
+
+    // If true, `allocate_output()` records the size of the outputs that it
+    // allocates (see `allocated_output_bytes()`).
+    bool record_allocated_output_bytes = false;
+
     // Shared resources accessible by this op kernel invocation.
     ResourceMgr* resource_manager = nullptr;
 
@@ -1009,6 +1024,14 @@ class OpKernelContext {
                          Tensor** tensor,
                          AllocatorAttributes attr) TF_MUST_USE_RESULT;
 
+  // Returns the number of bytes that `allocate_output()` allocated for output
+  // `index`, or 0 if the output was not allocated by it, e.g. because it was
+  // forwarded from an input. Always 0 unless
+  // `Params::record_allocated_output_bytes`.
+  int64 allocated_output_bytes(int index) const {
+    return allocated_output_bytes_ ? (*allocated_output_bytes_)[index] : 0;
+  }
+
   // Allocates a temporary Tensor of the specified type and
   // shape. Devices such as GPUs that enqueue Ops for lazy execution
   // may retain references to the temporary tensors after the Op's
@@ -1295,8 +1318,21 @@ class OpKernelContext {
 
   Status allocate_tensor(DataType type, const TensorShape& shape,
                          Tensor* out_tensor, AllocatorAttributes allocator_attr,
+                         const AllocationAttributes& allocation_attr) {
+    return allocate_tensor(get_allocator(allocator_attr), type, shape,
+                           out_tensor, allocation_attr);
+  }
+
+  Status allocate_tensor(Allocator* a, DataType type, const TensorShape& shape,
+                         Tensor* out_tensor,
                          const AllocationAttributes& allocation_attr);
 
+  // Returns the allocator for output `index` with attributes `attr`: the
+  // allocator of its planned memory or the step arena allocator if the
+  // executor provides one for the output, and otherwise the allocator for
+  // `attr`.
+  Allocator* get_output_allocator(int index, AllocatorAttributes attr);
+
   // Initialize the allocated_scope_ids_ set the first time this method is
   // called.
   void maybe_initialize_scope_id_set();
@@ -1323,6 +1359,9 @@ class OpKernelContext {
   // Constructed only if <params->record_tensor_accesses>.
   ManualConstructor<UniqueTensorReferences> referenced_tensors_ GUARDED_BY(mu_);
 
+  // Constructed only if <params->record_allocated_output_bytes>.
+  std::unique_ptr<gtl::InlinedVector<int64, 4>> allocated_output_bytes_;
+
   // The following data members are only used when allocation tracking is
   // enabled.
   mutable mutex stats_mu_;
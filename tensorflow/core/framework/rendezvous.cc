@@ -15,6 +15,7 @@ limitations under the License.
 
 #include "tensorflow/core/framework/rendezvous.h"
 
+#include <atomic>
 #include <deque>
 #include <functional>
 #include <utility>
@@ -45,6 +46,7 @@ Rendezvous::ParsedKey& Rendezvous::ParsedKey::operator=(const ParsedKey& b) {
   dst = b.dst;
   edge_name = StringPiece(buf_.data() + (b.edge_name.data() - b_base),
                           b.edge_name.size());
+  full_key_hash_ = b.full_key_hash_;
   return *this;
 }
 
@@ -107,6 +109,7 @@ Status Rendezvous::ParseKey(StringPiece key, ParsedKey* out) {
     out->src_device = StringPiece(parts[0].data(), parts[0].size());
     out->dst_device = StringPiece(parts[2].data(), parts[2].size());
     out->edge_name = StringPiece(parts[3].data(), parts[3].size());
+    out->full_key_hash_ = Hash64(out->buf_.data(), out->buf_.size());
     return Status::OK();
   }
   return errors::InvalidArgument("Invalid  rendezvous key: ", key);
@@ -152,18 +155,18 @@ class LocalRendezvousImpl : public Rendezvous {
 
   Status Send(const ParsedKey& key, const Args& send_args, const Tensor& val,
               const bool is_dead) override {
-    uint64 key_hash = KeyHash(key.FullKey());
+    const uint64 key_hash = key.FullKeyHash();
     VLOG(2) << "Send " << this << " " << key_hash << " " << key.FullKey();
 
-    mu_.lock();
-    if (!status_.ok()) {
+    Shard* shard = GetShard(key_hash);
+    shard->mu.lock();
+    if (aborted_.load(std::memory_order_acquire)) {
       // Rendezvous has been aborted.
-      Status s = status_;
-      mu_.unlock();
-      return s;
+      shard->mu.unlock();
+      return GetStatus();
     }
 
-    ItemQueue* queue = &table_[key_hash];
+    ItemQueue* queue = &shard->table[key_hash];
     if (queue->empty() || queue->front()->IsSendValue()) {
       // There is no waiter for this message. Append the message
       // into the queue. The waiter will pick it up when arrives.
@@ -177,7 +180,7 @@ class LocalRendezvousImpl : public Rendezvous {
         item->send_args.device_context->Ref();
       }
       queue->push_back(item);
-      mu_.unlock();
+      shard->mu.unlock();
       return Status::OK();
     }
 
@@ -188,11 +191,11 @@ class LocalRendezvousImpl : public Rendezvous {
     // Delete the queue when the last element has been consumed.
     if (queue->size() == 1) {
       VLOG(2) << "Clean up Send/Recv queue (key:" << key.FullKey() << "). ";
-      table_.erase(key_hash);
+      shard->table.erase(key_hash);
     } else {
       queue->pop_front();
     }
-    mu_.unlock();
+    shard->mu.unlock();
 
     // Notify the waiter by invoking its done closure, outside the
     // lock.
@@ -204,19 +207,19 @@ class LocalRendezvousImpl : public Rendezvous {
 
   void RecvAsync(const ParsedKey& key, const Args& recv_args,
                  DoneCallback done) override {
-    uint64 key_hash = KeyHash(key.FullKey());
+    const uint64 key_hash = key.FullKeyHash();
     VLOG(2) << "Recv " << this << " " << key_hash << " " << key.FullKey();
 
-    mu_.lock();
-    if (!status_.ok()) {
+    Shard* shard = GetShard(key_hash);
+    shard->mu.lock();
+    if (aborted_.load(std::memory_order_acquire)) {
       // Rendezvous has been aborted.
-      Status s = status_;
-      mu_.unlock();
-      done(s, Args(), recv_args, Tensor(), false);
+      shard->mu.unlock();
+      done(GetStatus(), Args(), recv_args, Tensor(), false);
       return;
     }
 
-    ItemQueue* queue = &table_[key_hash];
+    ItemQueue* queue = &shard->table[key_hash];
     if (queue->empty() || !queue->front()->IsSendValue()) {
       // There is no message to pick up.
       // Only recv-related fields need to be filled.
@@ -225,18 +228,18 @@ class LocalRendezvousImpl : public Rendezvous {
       bool already_cancelled = false;
       if (cm != nullptr) {
         token = cm->get_cancellation_token();
-        already_cancelled = !cm->RegisterCallback(token, [this, token,
+        already_cancelled = !cm->RegisterCallback(token, [shard, token,
                                                           key_hash] {
           Item* item = nullptr;
           {
-            mutex_lock l(mu_);
-            ItemQueue* queue = &table_[key_hash];
+            mutex_lock l(shard->mu);
+            ItemQueue* queue = &shard->table[key_hash];
             if (!queue->empty() && !queue->front()->IsSendValue()) {
               for (auto it = queue->begin(); it != queue->end(); it++) {
                 if ((*it)->cancellation_token == token) {
                   item = *it;
                   if (queue->size() == 1) {
-                    table_.erase(key_hash);
+                    shard->table.erase(key_hash);
                   } else {
                     queue->erase(it);
                   }
@@ -255,7 +258,7 @@ class LocalRendezvousImpl : public Rendezvous {
         });
       }
       if (already_cancelled) {
-        mu_.unlock();
+        shard->mu.unlock();
         done(StatusGroup::MakeDerived(
                  errors::Cancelled("RecvAsync is cancelled.")),
              Args(), recv_args, Tensor(), /*is_dead=*/false);
@@ -285,7 +288,7 @@ class LocalRendezvousImpl : public Rendezvous {
         item->recv_args.device_context->Ref();
       }
       queue->push_back(item);
-      mu_.unlock();
+      shard->mu.unlock();
       return;
     }
 
@@ -297,11 +300,11 @@ class LocalRendezvousImpl : public Rendezvous {
     // Delete the queue when the last element has been consumed.
     if (queue->size() == 1) {
       VLOG(2) << "Clean up Send/Recv queue (key:" << key.FullKey() << "). ";
-      table_.erase(key_hash);
+      shard->table.erase(key_hash);
     } else {
       queue->pop_front();
     }
-    mu_.unlock();
+    shard->mu.unlock();
 
     // Invokes the done() by invoking its done closure, outside scope
     // of the table lock.
@@ -312,18 +315,26 @@ class LocalRendezvousImpl : public Rendezvous {
 
   void StartAbort(const Status& status) override {
     CHECK(!status.ok());
-    Table table;
     {
-      mutex_lock l(mu_);
+      mutex_lock l(status_mu_);
       status_.Update(status);
-      table_.swap(table);
     }
-    for (auto& p : table) {
-      for (Item* item : p.second) {
-        if (!item->IsSendValue()) {
-          item->waiter(status, Args(), Args(), Tensor(), false);
+    aborted_.store(true, std::memory_order_release);
+    // A Send or RecvAsync that locks a shard after it is swapped out below
+    // sees `aborted_`, so no item is left behind in the table.
+    for (Shard& shard : shards_) {
+      Table table;
+      {
+        mutex_lock l(shard.mu);
+        shard.table.swap(table);
+      }
+      for (auto& p : table) {
+        for (Item* item : p.second) {
+          if (!item->IsSendValue()) {
+            item->waiter(status, Args(), Args(), Tensor(), false);
+          }
+          delete item;
         }
-        delete item;
       }
     }
   }
@@ -352,11 +363,6 @@ class LocalRendezvousImpl : public Rendezvous {
     bool IsSendValue() const { return this->waiter == nullptr; }
   };
 
-  // We key the hash table by KeyHash of the Rendezvous::CreateKey string
-  static uint64 KeyHash(const StringPiece& k) {
-    return Hash64(k.data(), k.size());
-  }
-
   // By invariant, the item queue under each key is of the form
   //   [item.IsSendValue()]* meaning each item is a sent message.
   // or
@@ -364,16 +370,40 @@ class LocalRendezvousImpl : public Rendezvous {
   //
   // TODO(zhifengc): consider a better queue impl than std::deque.
   typedef std::deque<Item*> ItemQueue;
+  // We key the hash table by the hash of the Rendezvous::CreateKey string,
+  // which ParsedKey computes once, and shard it by the same hash so that the
+  // sends and receives of different keys rarely contend for a lock.
   typedef gtl::FlatMap<uint64, ItemQueue> Table;
 
-  // TODO(zhifengc): shard table_.
-  mutex mu_;
-  Table table_ GUARDED_BY(mu_);
-  Status status_ GUARDED_BY(mu_);
+  struct Shard {
+    mutex mu;
+    Table table GUARDED_BY(mu);
+  };
+
+  Shard* GetShard(uint64 key_hash) {
+    // The low bits of the hash select the bucket of the table.
+    return &shards_[(key_hash >> 32) % kNumShards];
+  }
+
+  Status GetStatus() {
+    mutex_lock l(status_mu_);
+    return status_;
+  }
+
+  static constexpr int kNumShards = 16;
+  Shard shards_[kNumShards];
+
+  // Set once the rendezvous is aborted, before the shards are cleared.
+  std::atomic<bool> aborted_{false};
+  mutex status_mu_;
+  Status status_ GUARDED_BY(status_mu_);
 
   ~LocalRendezvousImpl() override {
-    if (!table_.empty()) {
-      StartAbort(errors::Cancelled("LocalRendezvousImpl deleted"));
+    for (Shard& shard : shards_) {
+      if (!shard.table.empty()) {
+        StartAbort(errors::Cancelled("LocalRendezvousImpl deleted"));
+        return;
+      }
     }
   }
 
@@ -74,12 +74,15 @@ class Rendezvous : public core::RefCounted {
 
     ParsedKey& operator=(const ParsedKey& b);
     StringPiece FullKey() const { return buf_; }
+    // Returns the hash of FullKey(), computed once by ParseKey().
+    uint64 FullKeyHash() const { return full_key_hash_; }
 
    private:
     friend class Rendezvous;
     friend class SendOp;
     friend class RecvOp;
     string buf_;
+    uint64 full_key_hash_ = 0;
   };
   static Status ParseKey(StringPiece key, ParsedKey* out);
 
@@ -23,6 +23,8 @@ limitations under the License.
 #include "third_party/eigen3/unsupported/Eigen/CXX11/Tensor"
 #include "tensorflow/core/framework/run_handler_util.h"
 #include "tensorflow/core/lib/core/threadpool_interface.h"
+#include "tensorflow/core/lib/monitoring/counter.h"
+#include "tensorflow/core/lib/monitoring/sampler.h"
 #include "tensorflow/core/lib/strings/strcat.h"
 #include "tensorflow/core/platform/context.h"
 #include "tensorflow/core/platform/denormal.h"
@@ -37,6 +39,20 @@ namespace tensorflow {
 namespace {
 static constexpr int32 kMaxConcurrentHandlers = 128;
 
+auto* run_handler_latency_usecs = monitoring::Sampler<1>::New(
+    {"/tensorflow/core/run_handler/latency_usecs",
+     "The time from getting a run handler to releasing it in microseconds, "
+     "by the priority of the request.",
+     "priority"},
+    // Power of 2 with bucket count 24 (> 27 minutes)
+    {monitoring::Buckets::Exponential(100, 2, 24)});
+
+auto* run_handler_missed_deadlines = monitoring::Counter<1>::New(
+    "/tensorflow/core/run_handler/missed_deadlines",
+    "The number of run handlers released after the deadline of their request, "
+    "by the priority of the request.",
+    "priority");
+
 // TODO(azaks): Refactor with thread:ThreadPool
 class RunHandlerEnvironment {
   typedef Thread EnvThread;
@@ -106,7 +122,8 @@ class ThreadWorkSource {
         non_blocking_work_queues_(non_blocking_work_sharding_factor_),
         blocking_inflight_(0),
         non_blocking_inflight_(0),
-        traceme_id_(0) {
+        traceme_id_(0),
+        priority_(0) {
     queue_waiters_.next = &queue_waiters_;
     queue_waiters_.prev = &queue_waiters_;
     for (int i = 0; i < NonBlockingWorkShardingFactor(); ++i) {
@@ -242,6 +259,10 @@ class ThreadWorkSource {
   void SetTracemeId(int64 value) { traceme_id_ = value; }
   void SetRank(int64 value) { rank_ = value; }
 
+  int64 GetPriority() { return priority_.load(std::memory_order_relaxed); }
+
+  void SetPriority(int64 value) { priority_ = value; }
+
   int64 GetInflightTaskCount(bool is_blocking) {
     std::atomic<int64>* counter =
         is_blocking ? &blocking_inflight_ : &non_blocking_inflight_;
@@ -306,6 +327,7 @@ class ThreadWorkSource {
   Waiter queue_waiters_ GUARDED_BY(waiters_mu_);
   std::atomic<int64> traceme_id_;
   std::atomic<int64> rank_;
+  std::atomic<int64> priority_;
 };
 
 class RunHandlerThreadPool {
@@ -364,8 +386,10 @@ class RunHandlerThreadPool {
   }
 
   // Set work queues from which the thread 'tid' can steal its work.
-  // The request with start_request_idx will be attempted first. Other requests
-  // will be attempted in FIFO order based on their arrival time.
+  // The requests of a higher priority than the request with start_request_idx
+  // will be attempted first, so that they preempt it between closures, then
+  // the request with start_request_idx. Other requests will be attempted in
+  // the order of 'thread_work_sources'.
 
   // TODO(donglin) Change the task steal order to be round-robin such that if
   // an attempt to steal task from request i failed, then attempt to steal task
@@ -377,8 +401,20 @@ class RunHandlerThreadPool {
       const Eigen::MaxSizeVector<ThreadWorkSource*>& thread_work_sources) {
     mutex_lock l(thread_data_[tid].mu);
     thread_data_[tid].thread_work_sources.resize(0);
-    thread_data_[tid].thread_work_sources.emplace_back(
-        thread_work_sources[start_request_idx]);
+    ThreadWorkSource* start_source = thread_work_sources[start_request_idx];
+    thread_data_[tid].thread_work_sources.emplace_back(start_source);
+    // The requests of a higher priority follow the start request, and the
+    // thread looks at them first.
+    const int64 start_priority = start_source->GetPriority();
+    int num_preempting_sources = 0;
+    for (int j = 0; j < thread_work_sources.size(); ++j) {
+      if (thread_work_sources[j]->GetPriority() > start_priority) {
+        thread_data_[tid].thread_work_sources.emplace_back(
+            thread_work_sources[j]);
+        ++num_preempting_sources;
+      }
+    }
+    thread_data_[tid].num_preempting_sources = num_preempting_sources;
     // The number of shards for the queue. Threads in each shard will prioritize
     // different thread_work_sources. Increase the number of shards could
     // decrease the contention in the queue.
@@ -393,7 +429,8 @@ class RunHandlerThreadPool {
     int token = tid % num_shards;
     for (int i = 0; i < num_shards; ++i) {
       for (int j = token; j < thread_work_sources.size(); j += num_shards) {
-        if (j != start_request_idx) {
+        if (j != start_request_idx &&
+            thread_work_sources[j]->GetPriority() <= start_priority) {
           thread_data_[tid].thread_work_sources.emplace_back(
               thread_work_sources[j]);
         }
@@ -440,6 +477,8 @@ class RunHandlerThreadPool {
     condition_variable sources_not_empty;
     std::unique_ptr<Thread> thread;
     Eigen::MaxSizeVector<ThreadWorkSource*> thread_work_sources GUARDED_BY(mu);
+    // The number of sources after the first one that are attempted before it.
+    int num_preempting_sources GUARDED_BY(mu) = 0;
   };
 
   const int num_threads_;
@@ -469,9 +508,16 @@ void RunHandlerThreadPool::WorkerLoop(int thread_id,
       // The mutex is not hot since its per thread and can only be held
       // by some other thread when a session run starts/finishes.
       mutex_lock l(thread_data_[thread_id].mu);
+      const int num_preempting_sources =
+          thread_data_[thread_id].num_preempting_sources;
 
       for (int i = 0; i < thread_work_sources->size(); ++i) {
-        tws = (*thread_work_sources)[i];
+        // The sources of a higher priority than the "primary" one come first.
+        const int index =
+            i < num_preempting_sources
+                ? i + 1
+                : (i == num_preempting_sources ? 0 : i);
+        tws = (*thread_work_sources)[index];
         // We want a smallish numbers of inter threads since
         // otherwise there will be contention in PropagateOutputs.
         // This is best effort policy.
@@ -482,7 +528,7 @@ void RunHandlerThreadPool::WorkerLoop(int thread_id,
             break;
           }
         }
-        if (i == 0) {
+        if (index == 0) {
           // Always look for any work from the "primary" work source.
           // This way when we wake up a thread for a new closure we are
           // guaranteed it can be worked on.
@@ -588,11 +634,16 @@ class RunHandler::Impl {
   // Stores now time (in microseconds) since unix epoch when the handler is
   // requested via RunHandlerPool::Get().
   uint64 start_time_us() const { return start_time_us_; }
+  // Returns the time (in microseconds since unix epoch) by which the request
+  // should finish, or 0 if it has no deadline.
+  uint64 deadline_us() const { return deadline_us_; }
+  int64 priority() const { return priority_; }
   int64 step_id() const { return step_id_; }
   void ScheduleInterOpClosure(std::function<void()> fn);
   void ScheduleIntraOpClosure(std::function<void()> fn);
 
-  void Reset(int64 step_id);
+  void Reset(int64 step_id, int64 timeout_in_ms,
+             const RunOptions::Experimental::RunHandlerPoolOptions& options);
 
   RunHandlerPool::Impl* pool_impl() { return pool_impl_; }
 
@@ -614,6 +665,8 @@ class RunHandler::Impl {
 
   RunHandlerPool::Impl* pool_impl_;  // NOT OWNED.
   uint64 start_time_us_;
+  uint64 deadline_us_;
+  int64 priority_;
   int64 step_id_;
   std::unique_ptr<thread::ThreadPoolInterface> thread_pool_interface_;
   ThreadWorkSource tws_;
@@ -627,6 +680,8 @@ class RunHandlerPool::Impl {
   explicit Impl(int num_inter_op_threads, int num_intra_op_threads)
       : max_handlers_(static_cast<int32>(ParamFromEnvWithDefault(
             "TF_RUN_HANDLER_MAX_CONCURRENT_HANDLERS", kMaxConcurrentHandlers))),
+        num_reserved_threads_(static_cast<int>(ParamFromEnvWithDefault(
+            "TF_RUN_HANDLER_NUM_RESERVED_THREADS", 0))),
         run_handler_thread_pool_(new RunHandlerThreadPool(
             num_inter_op_threads, num_intra_op_threads, Env::Default(),
             ThreadOptions(), "tf_run_handler_pool")),
@@ -654,18 +709,23 @@ class RunHandlerPool::Impl {
     return run_handler_thread_pool_.get();
   }
 
-  std::unique_ptr<RunHandler> Get(int64 step_id) LOCKS_EXCLUDED(mu_) {
+  std::unique_ptr<RunHandler> Get(
+      int64 step_id, int64 timeout_in_ms,
+      const RunOptions::Experimental::RunHandlerPoolOptions& options)
+      LOCKS_EXCLUDED(mu_) {
     mutex_lock l(mu_);
     while (free_handlers_.empty()) {
       one_handler_free_.wait(l);
     }
-    // Remove the last entry from free_handlers_ and add to the end of
-    // sorted_active_handlers_.
+    // Remove the last entry from free_handlers_ and add it to
+    // sorted_active_handlers_, after the handlers that run before it.
     auto* handler_impl = free_handlers_.back();
-    handler_impl->Reset(step_id);
-    // Sortedness isn't violated if we simply add at the end of the list, since
-    // handlers are expected to be obtained in increasing order of time.
-    sorted_active_handlers_.push_back(handler_impl);
+    handler_impl->Reset(step_id, timeout_in_ms, options);
+    sorted_active_handlers_.insert(
+        std::upper_bound(sorted_active_handlers_.begin(),
+                         sorted_active_handlers_.end(), handler_impl,
+                         RunsBefore),
+        handler_impl);
     DCHECK_LE(sorted_active_handlers_.size(), max_handlers_);
     free_handlers_.pop_back();
 
@@ -674,6 +734,13 @@ class RunHandlerPool::Impl {
   }
 
   void ReleaseHandler(RunHandler::Impl* handler) LOCKS_EXCLUDED(mu_) {
+    const string priority = strings::StrCat(handler->priority());
+    const uint64 now = tensorflow::Env::Default()->NowMicros();
+    run_handler_latency_usecs->GetCell(priority)->Add(
+        now - handler->start_time_us());
+    if (handler->deadline_us() > 0 && now > handler->deadline_us()) {
+      run_handler_missed_deadlines->GetCell(priority)->IncrementBy(1);
+    }
     {
       mutex_lock l(mu_);
       DCHECK_GT(sorted_active_handlers_.size(), 0);
@@ -681,7 +748,6 @@ class RunHandlerPool::Impl {
       CHECK_EQ(handler->tws()->TaskQueueSize(true), 0);
       CHECK_EQ(handler->tws()->TaskQueueSize(false), 0);
 
-      uint64 now = tensorflow::Env::Default()->NowMicros();
       double elapsed = (now - handler->start_time_us()) / 1000.0;
       time_hist_.Add(elapsed);
 
@@ -707,16 +773,37 @@ class RunHandlerPool::Impl {
  private:
   void RecomputePoolStatsLocked() EXCLUSIVE_LOCKS_REQUIRED(mu_);
 
+  // Returns true if the work of handler 'a' runs before that of handler 'b':
+  // the higher priority first, then the earlier deadline, then the earlier
+  // start.
+  static bool RunsBefore(const RunHandler::Impl* a, const RunHandler::Impl* b) {
+    if (a->priority() != b->priority()) {
+      return a->priority() > b->priority();
+    }
+    // A handler without a deadline runs after those with one.
+    const uint64 a_deadline =
+        a->deadline_us() > 0 ? a->deadline_us() : kuint64max;
+    const uint64 b_deadline =
+        b->deadline_us() > 0 ? b->deadline_us() : kuint64max;
+    if (a_deadline != b_deadline) {
+      return a_deadline < b_deadline;
+    }
+    return a->start_time_us() < b->start_time_us();
+  }
+
   // Maximum number of handlers pre-created during pool construction time. The
   // number has been chosen expecting each handler might at least want 1
   // inter-op thread for execution (during compute intensive workloads like
   // inference).
   const int max_handlers_;
 
+  // The number of blocking threads that only run the work of the handlers of
+  // the highest priority, while handlers of a lower priority are active.
+  const int num_reserved_threads_;
+
   std::unique_ptr<RunHandlerThreadPool> run_handler_thread_pool_;
   // Thread compatible part used only by lock under RunHandlerPool.
-  // Handlers are sorted by start time.
-  // TODO(azaks): sort by the remaining latency budget.
+  // Handlers are sorted by RunsBefore().
   std::vector<RunHandler::Impl*> sorted_active_handlers_ GUARDED_BY(mu_);
   std::vector<RunHandler::Impl*> free_handlers_ GUARDED_BY(mu_);
   std::vector<std::unique_ptr<RunHandler::Impl>> handlers_ GUARDED_BY(mu_);
@@ -744,14 +831,46 @@ void RunHandlerPool::Impl::RecomputePoolStatsLocked() {
   int num_blocking_threads = run_handler_thread_pool()->NumBlockingThreads();
   int num_non_blocking_threads = num_threads - num_blocking_threads;
 
+  // The requests of the highest priority come first. While requests of a
+  // lower priority are active too, the last blocking threads are reserved for
+  // them.
+  int num_top_requests = 1;
+  while (num_top_requests < num_active_requests &&
+         sorted_active_handlers_[num_top_requests]->priority() ==
+             sorted_active_handlers_[0]->priority()) {
+    ++num_top_requests;
+  }
+  int num_reserved_threads = 0;
+  if (num_top_requests < num_active_requests) {
+    num_reserved_threads =
+        std::max(0, std::min(num_reserved_threads_, num_blocking_threads - 1));
+  }
+  const int num_shared_threads = num_blocking_threads - num_reserved_threads;
+
   std::vector<int> request_idx_list = ChooseRequestsWithExponentialDistribution(
-      num_active_requests, num_blocking_threads);
-  for (int i = 0; i < num_blocking_threads; ++i) {
+      num_active_requests, num_shared_threads);
+  for (int i = 0; i < num_shared_threads; ++i) {
     VLOG(2) << "Set work for tid=" << i
             << " with start_request_idx=" << request_idx_list[i];
     run_handler_thread_pool()->SetThreadWorkSources(i, request_idx_list[i],
                                                     thread_work_sources);
   }
+  if (num_reserved_threads > 0) {
+    Eigen::MaxSizeVector<ThreadWorkSource*> top_work_sources(
+        num_top_requests);
+    top_work_sources.resize(num_top_requests);
+    for (int i = 0; i < num_top_requests; ++i) {
+      top_work_sources[i] = thread_work_sources[i];
+    }
+    request_idx_list = ChooseRequestsWithExponentialDistribution(
+        num_top_requests, num_reserved_threads);
+    for (int i = 0; i < num_reserved_threads; ++i) {
+      VLOG(2) << "Set reserved work for tid=" << (i + num_shared_threads)
+              << " with start_request_idx=" << request_idx_list[i];
+      run_handler_thread_pool()->SetThreadWorkSources(
+          i + num_shared_threads, request_idx_list[i], top_work_sources);
+    }
+  }
 
   request_idx_list = ChooseRequestsWithExponentialDistribution(
       num_active_requests, num_non_blocking_threads);
@@ -803,7 +922,7 @@ void RunHandler::Impl::ThreadPoolInterfaceWrapper::Schedule(
 RunHandler::Impl::Impl(RunHandlerPool::Impl* pool_impl)
     : pool_impl_(pool_impl) {
   thread_pool_interface_.reset(new ThreadPoolInterfaceWrapper(this));
-  Reset(0);
+  Reset(0, 0, RunOptions::Experimental::RunHandlerPoolOptions());
 }
 
 void RunHandler::Impl::ScheduleInterOpClosure(std::function<void()> fn) {
@@ -818,10 +937,15 @@ void RunHandler::Impl::ScheduleIntraOpClosure(std::function<void()> fn) {
                                                         std::move(fn));
 }
 
-void RunHandler::Impl::Reset(int64 step_id) {
+void RunHandler::Impl::Reset(
+    int64 step_id, int64 timeout_in_ms,
+    const RunOptions::Experimental::RunHandlerPoolOptions& options) {
   start_time_us_ = tensorflow::Env::Default()->NowMicros();
+  deadline_us_ = timeout_in_ms > 0 ? start_time_us_ + timeout_in_ms * 1000 : 0;
+  priority_ = options.priority();
   step_id_ = step_id;
   tws_.SetTracemeId(step_id);
+  tws_.SetPriority(priority_);
 }
 
 RunHandlerPool::RunHandlerPool(int num_inter_op_threads)
@@ -833,8 +957,10 @@ RunHandlerPool::RunHandlerPool(int num_inter_op_threads,
 
 RunHandlerPool::~RunHandlerPool() {}
 
-std::unique_ptr<RunHandler> RunHandlerPool::Get(int64 step_id) {
-  return impl_->Get(step_id);
+std::unique_ptr<RunHandler> RunHandlerPool::Get(
+    int64 step_id, int64 timeout_in_ms,
+    const RunOptions::Experimental::RunHandlerPoolOptions& options) {
+  return impl_->Get(step_id, timeout_in_ms, options);
 }
 
 RunHandler::RunHandler(Impl* impl) : impl_(impl) {}
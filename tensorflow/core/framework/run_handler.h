@@ -62,7 +62,14 @@ class RunHandlerPool {
   // unique_ptr is destroyed.
   //
   // Will block unless there is an inactive handler.
-  std::unique_ptr<RunHandler> Get(int64 step_id = 0);
+  //
+  // The work of the handlers of a higher `options.priority()` is run first,
+  // and then that of the handlers with the earliest deadline, which is
+  // `timeout_in_ms` after the call if it is positive.
+  std::unique_ptr<RunHandler> Get(
+      int64 step_id = 0, int64 timeout_in_ms = 0,
+      const RunOptions::Experimental::RunHandlerPoolOptions& options =
+          RunOptions::Experimental::RunHandlerPoolOptions());
 
  private:
   class Impl;
@@ -74,7 +81,9 @@ class RunHandlerPool {
 // RunHandler can be used to schedule inter/intra-op closures to run on a global
 // pool shared across all Session::Run(s). The closures are enqueued to a
 // handler specific queue, from which the work is stolen in a priority order
-// (time of the Get() call).
+// (priority, deadline and time of the Get() call). Before each closure, a
+// thread looks for work of the handlers of a higher priority than the one it
+// serves first, so that they preempt it between ops.
 //
 // It can only be created via RunHandlerPool::Get().
 //
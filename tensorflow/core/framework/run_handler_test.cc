@@ -25,9 +25,11 @@ limitations under the License.
 #include "absl/synchronization/barrier.h"
 #include "third_party/eigen3/unsupported/Eigen/CXX11/Tensor"
 #include "tensorflow/core/lib/core/blocking_counter.h"
+#include "tensorflow/core/lib/core/notification.h"
 #include "tensorflow/core/lib/strings/strcat.h"
 #include "tensorflow/core/platform/env.h"
 #include "tensorflow/core/platform/logging.h"
+#include "tensorflow/core/platform/mutex.h"
 #include "tensorflow/core/platform/test.h"
 
 namespace tensorflow {
@@ -72,5 +74,52 @@ TEST(RunHandlerUtilTest, TestBasicScheduling) {
   counter.Wait();
 }
 
+// Gets a handler from a pool with a single inter-op thread, and keeps the
+// thread busy with a closure of the handler while the other handlers, which
+// have the given timeouts and priorities, schedule one closure each. Returns
+// the indices of the other handlers in the order in which their closures
+// run.
+std::vector<int> RunOrder(const std::vector<int64>& timeouts_in_ms,
+                          const std::vector<int64>& priorities) {
+  RunHandlerPool pool(1, 0);
+  auto busy_handler = pool.Get(0);
+  Notification started;
+  Notification release;
+  busy_handler->ScheduleInterOpClosure([&started, &release]() {
+    started.Notify();
+    release.WaitForNotification();
+  });
+  started.WaitForNotification();
+
+  mutex mu;
+  std::vector<int> order;
+  BlockingCounter counter(priorities.size());
+  std::vector<std::unique_ptr<RunHandler>> handlers;
+  for (int i = 0; i < priorities.size(); ++i) {
+    RunOptions::Experimental::RunHandlerPoolOptions options;
+    options.set_priority(priorities[i]);
+    handlers.push_back(pool.Get(i + 1, timeouts_in_ms[i], options));
+    handlers.back()->ScheduleInterOpClosure([&mu, &order, &counter, i]() {
+      {
+        mutex_lock l(mu);
+        order.push_back(i);
+      }
+      counter.DecrementCount();
+    });
+  }
+  release.Notify();
+  counter.Wait();
+  return order;
+}
+
+TEST(RunHandlerTest, RunsHigherPriorityFirst) {
+  EXPECT_EQ(std::vector<int>({2, 1, 0}), RunOrder({0, 0, 0}, {0, 1, 2}));
+}
+
+TEST(RunHandlerTest, RunsEarlierDeadlineFirst) {
+  EXPECT_EQ(std::vector<int>({1, 0, 2}),
+            RunOrder({60000, 1000, 0}, {0, 0, 0}));
+}
+
 }  // namespace
 }  // namespace tensorflow
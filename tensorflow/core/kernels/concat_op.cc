@@ -112,6 +112,9 @@ class ConcatBaseOp : public OpKernel {
       inputs_flat_dim0 *= input_shape.dim_size(d);
     }
     int64 output_concat_dim = 0;
+    // The index of the last non-empty input, and the number of them.
+    int non_empty_input = -1;
+    int num_non_empty_inputs = 0;
     const bool input_is_scalar = IsLegacyScalar(input_shape);
     for (int i = 0; i < N; ++i) {
       const auto& in = values[i];
@@ -134,6 +137,8 @@ class ConcatBaseOp : public OpKernel {
                 "] = ", in.shape().DebugString()));
       }
       if (in.NumElements() > 0) {
+        non_empty_input = i;
+        ++num_non_empty_inputs;
         int64 inputs_flat_dim1 = in.NumElements() / inputs_flat_dim0;
         inputs_flat.emplace_back(new typename TTypes<T, 2>::ConstMatrix(
             in.shaped<T, 2>({inputs_flat_dim0, inputs_flat_dim1})));
@@ -149,6 +154,22 @@ class ConcatBaseOp : public OpKernel {
     } else {
       output_shape.set_dim(axis, output_concat_dim);
     }
+    if (num_non_empty_inputs == 1) {
+      // The output has the elements of the only non-empty input, in the same
+      // order, so it takes over the buffer of that input instead of copying
+      // it. The input is copied if it is a ref or if its buffer is shared,
+      // e.g. with a variable that it was read from, whose later updates must
+      // not change the output.
+      int values_start, values_stop;
+      OP_REQUIRES_OK(c, InputRange("values", &values_start, &values_stop));
+      std::unique_ptr<Tensor> output = c->forward_input(
+          values_start + non_empty_input, 0, DataTypeToEnum<T>::v(),
+          output_shape, c->output_memory_type(0), c->output_alloc_attr(0));
+      if (output != nullptr) {
+        c->set_output(0, *output);
+        return;
+      }
+    }
     Tensor* output = nullptr;
     OP_REQUIRES_OK(c, c->allocate_output(0, output_shape, &output));
     if (output->NumElements() > 0) {
@@ -19,8 +19,11 @@ limitations under the License.
 
 #include "tensorflow/core/common_runtime/kernel_benchmark_testlib.h"
 #include "tensorflow/core/framework/allocator.h"
+#include "tensorflow/core/framework/fake_input.h"
+#include "tensorflow/core/framework/node_def_builder.h"
 #include "tensorflow/core/framework/op_kernel.h"
 #include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/framework/tensor_testutil.h"
 #include "tensorflow/core/framework/types.h"
 #include "tensorflow/core/framework/types.pb.h"
 #include "tensorflow/core/graph/node_builder.h"
@@ -35,6 +38,58 @@ limitations under the License.
 namespace tensorflow {
 namespace {
 
+class ConcatOpTest : public OpsTestBase {
+ protected:
+  void MakeOp(int num_inputs) {
+    TF_ASSERT_OK(NodeDefBuilder("concat_op", "ConcatV2")
+                     .Input(FakeInput(num_inputs, DT_FLOAT))
+                     .Input(FakeInput(DT_INT32))
+                     .Finalize(node_def()));
+    TF_ASSERT_OK(InitOp());
+  }
+};
+
+TEST_F(ConcatOpTest, ConcatsAlongAxis) {
+  MakeOp(2);
+  AddInputFromArray<float>(TensorShape({2, 2}), {1, 2, 3, 4});
+  AddInputFromArray<float>(TensorShape({2, 1}), {5, 6});
+  AddInputFromArray<int32>(TensorShape({}), {1});
+  TF_ASSERT_OK(RunOpKernel());
+  Tensor expected(allocator(), DT_FLOAT, TensorShape({2, 3}));
+  test::FillValues<float>(&expected, {1, 2, 5, 3, 4, 6});
+  test::ExpectTensorEqual<float>(expected, *GetOutput(0));
+}
+
+TEST_F(ConcatOpTest, SharesTheBufferOfTheOnlyNonEmptyInput) {
+  MakeOp(3);
+  AddInputFromArray<float>(TensorShape({0, 3}), {});
+  AddInputFromArray<float>(TensorShape({2, 3}), {1, 2, 3, 4, 5, 6});
+  AddInputFromArray<float>(TensorShape({0, 3}), {});
+  AddInputFromArray<int32>(TensorShape({}), {0});
+  TF_ASSERT_OK(RunOpKernel());
+  Tensor expected(allocator(), DT_FLOAT, TensorShape({2, 3}));
+  test::FillValues<float>(&expected, {1, 2, 3, 4, 5, 6});
+  test::ExpectTensorEqual<float>(expected, *GetOutput(0));
+  EXPECT_EQ(GetInput(1).tensor_data().data(),
+            GetOutput(0)->tensor_data().data());
+}
+
+TEST_F(ConcatOpTest, CopiesTheOnlyNonEmptyInputIfItsBufferIsShared) {
+  MakeOp(2);
+  AddInputFromArray<float>(TensorShape({2, 3}), {1, 2, 3, 4, 5, 6});
+  AddInputFromArray<float>(TensorShape({0, 3}), {});
+  AddInputFromArray<int32>(TensorShape({}), {0});
+  // Like a variable that the input was read from, 'shared' refers to the
+  // buffer of the input and may update it after the op has run.
+  Tensor shared = GetInput(0);
+  TF_ASSERT_OK(RunOpKernel());
+  EXPECT_NE(shared.tensor_data().data(), GetOutput(0)->tensor_data().data());
+  shared.flat<float>().setZero();
+  Tensor expected(allocator(), DT_FLOAT, TensorShape({2, 3}));
+  test::FillValues<float>(&expected, {1, 2, 3, 4, 5, 6});
+  test::ExpectTensorEqual<float>(expected, *GetOutput(0));
+}
+
 // For the benchmark, we set up two 2-dimensional tensors, each kDim1 x 'dim'
 // in size, and concat them together along "concat_dimension"
 template <typename T>
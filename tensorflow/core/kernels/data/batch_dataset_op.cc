@@ -17,6 +17,7 @@ limitations under the License.
 #include "tensorflow/core/framework/op_kernel.h"
 #include "tensorflow/core/framework/partial_tensor_shape.h"
 #include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/kernels/data/batch_slice_allocator.h"
 #include "tensorflow/core/kernels/data/name_utils.h"
 #include "tensorflow/core/lib/core/blocking_counter.h"
 #include "tensorflow/core/lib/gtl/cleanup.h"
@@ -129,7 +130,27 @@ class BatchDatasetOp::Dataset : public DatasetBase {
     explicit Iterator(const Params& params)
         : DatasetIterator<Dataset>(params) {}
 
+    ~Iterator() override {
+      if (slice_allocator_) {
+        slice_allocator_->Unref();
+      }
+    }
+
     Status Initialize(IteratorContext* ctx) override {
+      // If the types and shapes of the input elements are statically known,
+      // the batch can be allocated before its elements are produced, and
+      // inputs that allocate their outputs through the `IteratorContext` can
+      // write them directly into their slice of the batch.
+      bool batch_in_place = true;
+      for (DataType dtype : dataset()->input_->output_dtypes()) {
+        batch_in_place &= DataTypeCanUseMemcpy(dtype);
+      }
+      for (const auto& shape : dataset()->input_->output_shapes()) {
+        batch_in_place &= shape.IsFullyDefined();
+      }
+      if (batch_in_place) {
+        slice_allocator_ = new BatchSliceAllocator(ctx->allocator({}));
+      }
       return dataset()->input_->MakeIterator(ctx, prefix(), &input_impl_);
     }
 
@@ -146,6 +167,16 @@ class BatchDatasetOp::Dataset : public DatasetBase {
       // Each row of `batch_elements` is a tuple of tensors from the
       // input iterator.
       std::vector<std::vector<Tensor>> batch_elements;
+      // If non-empty, holds one preallocated tensor per tuple component that
+      // was offered to the input through `slice_allocator_`.
+      std::vector<Tensor> preallocated_batch;
+      // `in_place[i][j]` is true if component `j` of the `i`-th element was
+      // produced directly in its slice of `preallocated_batch`.
+      std::vector<std::vector<bool>> in_place;
+      // `can_use_preallocated[j]` is false if a slice of component `j` of
+      // `preallocated_batch` was claimed by a tensor that was not returned as
+      // part of the corresponding element, and must therefore not be written.
+      std::vector<bool> can_use_preallocated;
       {
         mutex_lock l(mu_);
         if (!input_impl_) {
@@ -154,16 +185,60 @@ class BatchDatasetOp::Dataset : public DatasetBase {
         }
         batch_elements.reserve(dataset()->batch_size_);
         *end_of_sequence = false;
+        // Stops offering slices for good once the input has kept a slice
+        // beyond its batch (e.g. in a shuffle buffer or a cache), which keeps
+        // the whole batch alive, or has made a batch fall back to a fresh
+        // buffer, which allocates the batch twice.
+        if (slice_allocator_ && (slice_fallback_ ||
+                                 slice_allocator_->HasOutstandingSlices())) {
+          slice_allocator_->Unref();
+          slice_allocator_ = nullptr;
+        }
+        std::unique_ptr<IteratorContext> slice_ctx;
+        if (slice_allocator_) {
+          TF_RETURN_IF_ERROR(StartSliceBatch(ctx, &slice_ctx));
+        }
+        IteratorContext* input_ctx = slice_ctx ? slice_ctx.get() : ctx;
+        auto finish_batch = gtl::MakeCleanup([this, &preallocated_batch]() {
+          if (slice_allocator_) {
+            preallocated_batch = slice_allocator_->FinishBatch();
+          }
+        });
         for (int i = 0; i < dataset()->batch_size_ && !*end_of_sequence; ++i) {
           std::vector<Tensor> batch_element_tuple;
-          TF_RETURN_IF_ERROR(
-              input_impl_->GetNext(ctx, &batch_element_tuple, end_of_sequence));
+          if (slice_allocator_) {
+            slice_allocator_->StartElement(i);
+          }
+          Status s = input_impl_->GetNext(input_ctx, &batch_element_tuple,
+                                          end_of_sequence);
+          if (slice_allocator_) {
+            slice_allocator_->EndElement();
+          }
+          TF_RETURN_IF_ERROR(s);
           if (!*end_of_sequence) {
             batch_elements.emplace_back(std::move(batch_element_tuple));
           } else {
             input_impl_.reset();
           }
         }
+        if (slice_allocator_) {
+          const size_t num_components =
+              dataset()->input_->output_dtypes().size();
+          can_use_preallocated.assign(num_components, true);
+          in_place.reserve(batch_elements.size());
+          for (size_t i = 0; i < batch_elements.size(); ++i) {
+            in_place.emplace_back(num_components, false);
+            for (size_t j = 0; j < num_components; ++j) {
+              if (j < batch_elements[i].size() &&
+                  slice_allocator_->IsSliceOf(batch_elements[i][j], j, i)) {
+                in_place[i][j] = true;
+              } else if (slice_allocator_->IsClaimed(j, i)) {
+                can_use_preallocated[j] = false;
+                slice_fallback_ = true;
+              }
+            }
+          }
+        }
       }
 
       if (batch_elements.empty()) {
@@ -178,13 +253,8 @@ class BatchDatasetOp::Dataset : public DatasetBase {
       }
 
       // Copy the retrieved batch elements into one output tensor per tuple
-      // component.
-      //
-      // NOTE(mrry): If the input or output sizes are statically known, we
-      // could potentially read the input values in-place into their
-      // respective slice locations. This would require a different GetNext()
-      // overload that supports zero-copy, and might make sense in an
-      // optimization pass.
+      // component. Elements that the input produced in place in
+      // `preallocated_batch` are not copied.
       const size_t num_tuple_components = batch_elements[0].size();
       const int64 num_batch_elements = batch_elements.size();
       for (size_t component_index = 0; component_index < num_tuple_components;
@@ -196,8 +266,24 @@ class BatchDatasetOp::Dataset : public DatasetBase {
         // element is moved into the output batch.
         TensorShape first_element_shape(first_element.shape());
         batch_component_shape.AppendShape(first_element_shape);
-        out_tensors->emplace_back(ctx->allocator({}), first_element.dtype(),
-                                  batch_component_shape);
+        // NOTE: A partial batch is copied out of the preallocated batch, so
+        // that it does not keep the full batch alive.
+        const bool use_preallocated =
+            component_index < preallocated_batch.size() &&
+            can_use_preallocated[component_index] &&
+            num_batch_elements ==
+                preallocated_batch[component_index].dim_size(0) &&
+            preallocated_batch[component_index].dtype() ==
+                first_element.dtype() &&
+            SliceShapeMatches(preallocated_batch[component_index],
+                              first_element_shape);
+        if (use_preallocated) {
+          out_tensors->push_back(
+              std::move(preallocated_batch[component_index]));
+        } else {
+          out_tensors->emplace_back(ctx->allocator({}), first_element.dtype(),
+                                    batch_component_shape);
+        }
         if (!out_tensors->back().IsInitialized()) {
           return errors::ResourceExhausted(
               "Failed to allocate memory for the batch of component ",
@@ -206,8 +292,13 @@ class BatchDatasetOp::Dataset : public DatasetBase {
         Tensor& batch_component = out_tensors->back();
         // Build the output tuple component by copying one slice
         // from each input element in the batch.
-        auto copy_element_fn = [component_index, &batch_elements,
-                                &batch_component](int index) {
+        auto copy_element_fn = [component_index, use_preallocated,
+                                &batch_elements, &batch_component,
+                                &in_place](int index) {
+          if (use_preallocated && in_place[index][component_index]) {
+            batch_elements[index][component_index] = Tensor();
+            return Status::OK();
+          }
           TF_RETURN_IF_ERROR(batch_util::CopyElementToSlice(
               std::move(batch_elements[index][component_index]),
               &batch_component, index));
@@ -277,8 +368,69 @@ class BatchDatasetOp::Dataset : public DatasetBase {
     }
 
    private:
+    // Allocates a batch with the statically known element shapes, offers it
+    // to `slice_allocator_`, and returns in `*slice_ctx` a context for the
+    // input that allocates through `slice_allocator_`.
+    Status StartSliceBatch(IteratorContext* ctx,
+                           std::unique_ptr<IteratorContext>* slice_ctx)
+        EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+      std::vector<Tensor> batch;
+      const auto& output_dtypes = dataset()->input_->output_dtypes();
+      const auto& output_shapes = dataset()->input_->output_shapes();
+      batch.reserve(output_dtypes.size());
+      for (size_t i = 0; i < output_dtypes.size(); ++i) {
+        TensorShape batch_component_shape({dataset()->batch_size_});
+        TensorShape element_shape;
+        if (!output_shapes[i].AsTensorShape(&element_shape)) {
+          return errors::Internal("Expected a fully defined shape but got ",
+                                  output_shapes[i].DebugString());
+        }
+        batch_component_shape.AppendShape(element_shape);
+        batch.emplace_back(ctx->allocator({}), output_dtypes[i],
+                           batch_component_shape);
+        if (!batch.back().IsInitialized()) {
+          return errors::ResourceExhausted(
+              "Failed to allocate memory for the batch of component ", i);
+        }
+      }
+      slice_allocator_->StartBatch(std::move(batch));
+
+      IteratorContext::Params params(ctx);
+      // The getter may outlive this iterator (e.g. in a context copied by an
+      // asynchronous input), so it holds its own reference.
+      slice_allocator_->Ref();
+      std::shared_ptr<BatchSliceAllocator> allocator(
+          slice_allocator_, [](BatchSliceAllocator* a) { a->Unref(); });
+      auto allocator_getter = params.allocator_getter;
+      params.allocator_getter =
+          [allocator, allocator_getter](AllocatorAttributes attrs) {
+            return attrs.value == 0 ? allocator.get()
+                                    : allocator_getter(attrs);
+          };
+      *slice_ctx = absl::make_unique<IteratorContext>(std::move(params));
+      return Status::OK();
+    }
+
+    // Returns true if the slices of `batch` have shape `element_shape`.
+    static bool SliceShapeMatches(const Tensor& batch,
+                                  const TensorShape& element_shape) {
+      if (batch.dims() != element_shape.dims() + 1) {
+        return false;
+      }
+      for (int i = 0; i < element_shape.dims(); ++i) {
+        if (batch.dim_size(i + 1) != element_shape.dim_size(i)) {
+          return false;
+        }
+      }
+      return true;
+    }
+
     mutex mu_;
     std::unique_ptr<IteratorBase> input_impl_ GUARDED_BY(mu_);
+    // Non-null if the batch can be preallocated. Owns a reference.
+    BatchSliceAllocator* slice_allocator_ = nullptr;
+    // True if a batch could not use its preallocated buffer.
+    bool slice_fallback_ GUARDED_BY(mu_) = false;
   };
 
   const int64 batch_size_;
@@ -0,0 +1,143 @@
+/* Copyright 2019 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#include "tensorflow/core/kernels/data/batch_slice_allocator.h"
+
+#include "tensorflow/core/framework/types.h"
+#include "tensorflow/core/platform/logging.h"
+
+namespace tensorflow {
+namespace data {
+
+BatchSliceAllocator::BatchSliceAllocator(Allocator* wrapped)
+    : wrapped_(wrapped) {}
+
+void* BatchSliceAllocator::AllocateRaw(size_t alignment, size_t num_bytes) {
+  // Each allocation keeps the allocator alive, because the `TensorBuffer` that
+  // owns it refers back to this object on deallocation.
+  Ref();
+  if (num_bytes > 0) {
+    mutex_lock l(mu_);
+    if (element_index_ >= 0 &&
+        element_thread_ == std::this_thread::get_id()) {
+      for (size_t i = 0; i < batch_.size(); ++i) {
+        if (slice_bytes_[i] != num_bytes || claimed_[i][element_index_]) {
+          continue;
+        }
+        char* data = SliceData(i, element_index_);
+        if (reinterpret_cast<uintptr_t>(data) % alignment != 0) {
+          continue;
+        }
+        claimed_[i][element_index_] = true;
+        outstanding_slices_.emplace(data, batch_[i]);
+        return data;
+      }
+    }
+  }
+  void* ptr = wrapped_->AllocateRaw(alignment, num_bytes);
+  if (ptr == nullptr) {
+    Unref();
+  }
+  return ptr;
+}
+
+void BatchSliceAllocator::DeallocateRaw(void* ptr) {
+  // NOTE: The batch component is released outside of `mu_`, because
+  // destroying it may deallocate the batch buffer.
+  Tensor batch_component;
+  bool is_slice = false;
+  {
+    mutex_lock l(mu_);
+    auto it = outstanding_slices_.find(ptr);
+    if (it != outstanding_slices_.end()) {
+      batch_component = std::move(it->second);
+      outstanding_slices_.erase(it);
+      is_slice = true;
+    }
+  }
+  if (!is_slice) {
+    wrapped_->DeallocateRaw(ptr);
+  }
+  batch_component = Tensor();
+  Unref();
+}
+
+void BatchSliceAllocator::StartBatch(std::vector<Tensor> batch) {
+  mutex_lock l(mu_);
+  batch_ = std::move(batch);
+  slice_bytes_.clear();
+  claimed_.clear();
+  for (const Tensor& component : batch_) {
+    DCHECK(component.IsInitialized());
+    DCHECK(DataTypeCanUseMemcpy(component.dtype()));
+    DCHECK_GT(component.dims(), 0);
+    const int64 batch_size = component.dim_size(0);
+    slice_bytes_.push_back(batch_size > 0 ? component.TotalBytes() / batch_size
+                                          : 0);
+    claimed_.emplace_back(batch_size, false);
+  }
+  element_index_ = -1;
+}
+
+void BatchSliceAllocator::StartElement(int64 index) {
+  mutex_lock l(mu_);
+  element_index_ = index;
+  element_thread_ = std::this_thread::get_id();
+}
+
+void BatchSliceAllocator::EndElement() {
+  mutex_lock l(mu_);
+  element_index_ = -1;
+}
+
+bool BatchSliceAllocator::IsClaimed(size_t component, int64 index) const {
+  mutex_lock l(mu_);
+  return component < claimed_.size() && index < claimed_[component].size() &&
+         claimed_[component][index];
+}
+
+bool BatchSliceAllocator::IsSliceOf(const Tensor& element, size_t component,
+                                    int64 index) const {
+  mutex_lock l(mu_);
+  if (component >= batch_.size() || index >= claimed_[component].size() ||
+      slice_bytes_[component] == 0) {
+    return false;
+  }
+  return element.dtype() == batch_[component].dtype() &&
+         element.TotalBytes() == slice_bytes_[component] &&
+         element.tensor_data().data() == SliceData(component, index);
+}
+
+std::vector<Tensor> BatchSliceAllocator::FinishBatch() {
+  mutex_lock l(mu_);
+  std::vector<Tensor> batch = std::move(batch_);
+  batch_.clear();
+  slice_bytes_.clear();
+  claimed_.clear();
+  element_index_ = -1;
+  return batch;
+}
+
+bool BatchSliceAllocator::HasOutstandingSlices() const {
+  mutex_lock l(mu_);
+  return !outstanding_slices_.empty();
+}
+
+char* BatchSliceAllocator::SliceData(size_t component, int64 index) const {
+  return const_cast<char*>(batch_[component].tensor_data().data()) +
+         index * slice_bytes_[component];
+}
+
+}  // namespace data
+}  // namespace tensorflow
@@ -0,0 +1,113 @@
+/* Copyright 2019 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#ifndef TENSORFLOW_CORE_KERNELS_DATA_BATCH_SLICE_ALLOCATOR_H_
+#define TENSORFLOW_CORE_KERNELS_DATA_BATCH_SLICE_ALLOCATOR_H_
+
+#include <thread>  // NOLINT
+#include <unordered_map>
+#include <vector>
+
+#include "tensorflow/core/framework/allocator.h"
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/lib/core/refcount.h"
+#include "tensorflow/core/platform/mutex.h"
+#include "tensorflow/core/platform/thread_annotations.h"
+
+namespace tensorflow {
+namespace data {
+
+// A `BatchSliceAllocator` lets the producers of batch elements allocate their
+// outputs directly in the slices of a preallocated batch, so that batching
+// those elements does not need to copy them.
+//
+// The batching iterator offers a batch with `StartBatch()`, and brackets each
+// call to its input's `GetNext()` with `StartElement(index)` and
+// `EndElement()`. While an element is in progress, an allocation made *by the
+// thread that called `StartElement()`* whose size matches the size of a slice
+// of one of the batch components is served from the `index`-th slice of that
+// component. All other allocations are delegated to the wrapped allocator.
+//
+// A slice that has been handed out keeps a reference to the batch buffer until
+// it is deallocated, so producers that retain their outputs (e.g. caches) stay
+// safe. Since such a slice keeps its whole batch alive, the batching iterator
+// should stop offering batches once `HasOutstandingSlices()` reports slices
+// that outlived their batch. Because a producer may also return a different
+// tensor than the one that it allocated in the slice (e.g. a shuffle buffer),
+// the batching iterator must check `IsSliceOf()` and `IsClaimed()` before
+// writing to a slice itself.
+//
+// Each allocation holds a reference on the allocator, which is therefore
+// destroyed only once all tensors that it allocated have been deallocated.
+class BatchSliceAllocator : public Allocator, public core::RefCounted {
+ public:
+  explicit BatchSliceAllocator(Allocator* wrapped);
+
+  string Name() override { return "batch_slice"; }
+
+  void* AllocateRaw(size_t alignment, size_t num_bytes) override;
+  void DeallocateRaw(void* ptr) override;
+
+  // Offers the slices (in the 0th dimension) of the tensors in `batch` to
+  // subsequent elements. The tensors must be initialized and of a type that
+  // can be copied with memcpy.
+  void StartBatch(std::vector<Tensor> batch) LOCKS_EXCLUDED(mu_);
+
+  // Routes matching allocations made by the calling thread to the `index`-th
+  // slices of the current batch until `EndElement()` is called.
+  void StartElement(int64 index) LOCKS_EXCLUDED(mu_);
+  void EndElement() LOCKS_EXCLUDED(mu_);
+
+  // Returns true if the `index`-th slice of component `component` has been
+  // handed out to a producer.
+  bool IsClaimed(size_t component, int64 index) const LOCKS_EXCLUDED(mu_);
+
+  // Returns true if `element` occupies exactly the `index`-th slice of
+  // component `component` of the current batch.
+  bool IsSliceOf(const Tensor& element, size_t component, int64 index) const
+      LOCKS_EXCLUDED(mu_);
+
+  // Stops offering slices of the current batch and returns its tensors.
+  std::vector<Tensor> FinishBatch() LOCKS_EXCLUDED(mu_);
+
+  // Returns true if a slice that has been handed out is still allocated.
+  bool HasOutstandingSlices() const LOCKS_EXCLUDED(mu_);
+
+ private:
+  ~BatchSliceAllocator() override {}
+
+  // Returns the address of the `index`-th slice of component `component`.
+  char* SliceData(size_t component, int64 index) const
+      EXCLUSIVE_LOCKS_REQUIRED(mu_);
+
+  Allocator* const wrapped_;  // Not owned.
+  mutable mutex mu_;
+  std::vector<Tensor> batch_ GUARDED_BY(mu_);
+  std::vector<size_t> slice_bytes_ GUARDED_BY(mu_);
+  // `claimed_[component][index]` is true if the corresponding slice has been
+  // handed out.
+  std::vector<std::vector<bool>> claimed_ GUARDED_BY(mu_);
+  int64 element_index_ GUARDED_BY(mu_) = -1;
+  std::thread::id element_thread_ GUARDED_BY(mu_);
+  // Maps each outstanding slice allocation to the batch component that it
+  // belongs to, keeping the underlying buffer alive.
+  std::unordered_map<void*, Tensor> outstanding_slices_ GUARDED_BY(mu_);
+
+  TF_DISALLOW_COPY_AND_ASSIGN(BatchSliceAllocator);
+};
+
+}  // namespace data
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_CORE_KERNELS_DATA_BATCH_SLICE_ALLOCATOR_H_
@@ -0,0 +1,156 @@
+/* Copyright 2019 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#include "tensorflow/core/kernels/data/batch_slice_allocator.h"
+
+#include <thread>  // NOLINT
+
+#include "tensorflow/core/framework/tensor_testutil.h"
+#include "tensorflow/core/lib/core/refcount.h"
+#include "tensorflow/core/platform/test.h"
+
+namespace tensorflow {
+namespace data {
+namespace {
+
+constexpr int64 kBatchSize = 4;
+constexpr int64 kElementSize = 16;
+
+std::vector<Tensor> MakeBatch() {
+  return {Tensor(cpu_allocator(), DT_FLOAT,
+                 TensorShape({kBatchSize, kElementSize}))};
+}
+
+TEST(BatchSliceAllocatorTest, AllocatesInPlaceDuringElement) {
+  BatchSliceAllocator* allocator = new BatchSliceAllocator(cpu_allocator());
+  core::ScopedUnref unref(allocator);
+  allocator->StartBatch(MakeBatch());
+
+  allocator->StartElement(1);
+  Tensor element(allocator, DT_FLOAT, TensorShape({kElementSize}));
+  allocator->EndElement();
+
+  EXPECT_TRUE(allocator->IsClaimed(0, 1));
+  EXPECT_FALSE(allocator->IsClaimed(0, 0));
+  EXPECT_TRUE(allocator->IsSliceOf(element, 0, 1));
+  EXPECT_FALSE(allocator->IsSliceOf(element, 0, 0));
+
+  for (int i = 0; i < kElementSize; ++i) {
+    element.vec<float>()(i) = static_cast<float>(i);
+  }
+  std::vector<Tensor> batch = allocator->FinishBatch();
+  ASSERT_EQ(batch.size(), 1);
+  test::ExpectTensorEqual<float>(batch[0].SubSlice(1), element);
+}
+
+TEST(BatchSliceAllocatorTest, DelegatesMismatchedSizes) {
+  BatchSliceAllocator* allocator = new BatchSliceAllocator(cpu_allocator());
+  core::ScopedUnref unref(allocator);
+  allocator->StartBatch(MakeBatch());
+
+  allocator->StartElement(0);
+  Tensor element(allocator, DT_FLOAT, TensorShape({kElementSize / 2}));
+  allocator->EndElement();
+
+  EXPECT_FALSE(allocator->IsClaimed(0, 0));
+  EXPECT_FALSE(allocator->IsSliceOf(element, 0, 0));
+  allocator->FinishBatch();
+}
+
+TEST(BatchSliceAllocatorTest, DelegatesOutsideOfElement) {
+  BatchSliceAllocator* allocator = new BatchSliceAllocator(cpu_allocator());
+  core::ScopedUnref unref(allocator);
+  allocator->StartBatch(MakeBatch());
+
+  Tensor element(allocator, DT_FLOAT, TensorShape({kElementSize}));
+
+  EXPECT_FALSE(allocator->IsClaimed(0, 0));
+  EXPECT_FALSE(allocator->IsSliceOf(element, 0, 0));
+  allocator->FinishBatch();
+}
+
+TEST(BatchSliceAllocatorTest, DelegatesOtherThreads) {
+  BatchSliceAllocator* allocator = new BatchSliceAllocator(cpu_allocator());
+  core::ScopedUnref unref(allocator);
+  allocator->StartBatch(MakeBatch());
+
+  allocator->StartElement(0);
+  Tensor element;
+  std::thread thread([allocator, &element]() {
+    element = Tensor(allocator, DT_FLOAT, TensorShape({kElementSize}));
+  });
+  thread.join();
+  allocator->EndElement();
+
+  EXPECT_FALSE(allocator->IsClaimed(0, 0));
+  EXPECT_FALSE(allocator->IsSliceOf(element, 0, 0));
+  allocator->FinishBatch();
+}
+
+TEST(BatchSliceAllocatorTest, ClaimsEachSliceOnce) {
+  BatchSliceAllocator* allocator = new BatchSliceAllocator(cpu_allocator());
+  core::ScopedUnref unref(allocator);
+  allocator->StartBatch(MakeBatch());
+
+  allocator->StartElement(2);
+  Tensor first(allocator, DT_FLOAT, TensorShape({kElementSize}));
+  Tensor second(allocator, DT_FLOAT, TensorShape({kElementSize}));
+  allocator->EndElement();
+
+  EXPECT_TRUE(allocator->IsSliceOf(first, 0, 2));
+  EXPECT_FALSE(allocator->IsSliceOf(second, 0, 2));
+  allocator->FinishBatch();
+}
+
+TEST(BatchSliceAllocatorTest, TracksOutstandingSlices) {
+  BatchSliceAllocator* allocator = new BatchSliceAllocator(cpu_allocator());
+  core::ScopedUnref unref(allocator);
+  allocator->StartBatch(MakeBatch());
+  EXPECT_FALSE(allocator->HasOutstandingSlices());
+
+  allocator->StartElement(0);
+  Tensor element(allocator, DT_FLOAT, TensorShape({kElementSize}));
+  Tensor other(allocator, DT_FLOAT, TensorShape({kElementSize / 2}));
+  allocator->EndElement();
+  allocator->FinishBatch();
+  EXPECT_TRUE(allocator->HasOutstandingSlices());
+
+  // Allocations that were not served from a slice do not count.
+  element = Tensor();
+  EXPECT_FALSE(allocator->HasOutstandingSlices());
+}
+
+TEST(BatchSliceAllocatorTest, SliceOutlivesBatchAndAllocator) {
+  Tensor element;
+  {
+    BatchSliceAllocator* allocator = new BatchSliceAllocator(cpu_allocator());
+    core::ScopedUnref unref(allocator);
+    allocator->StartBatch(MakeBatch());
+    allocator->StartElement(3);
+    element = Tensor(allocator, DT_FLOAT, TensorShape({kElementSize}));
+    allocator->EndElement();
+    EXPECT_TRUE(allocator->IsSliceOf(element, 0, 3));
+    allocator->FinishBatch();
+  }
+  // The slice keeps both the batch buffer and the allocator alive.
+  for (int i = 0; i < kElementSize; ++i) {
+    element.vec<float>()(i) = 1.0f;
+  }
+  test::ExpectTensorEqual<float>(
+      element, test::AsTensor<float>(std::vector<float>(kElementSize, 1.0f)));
+}
+
+}  // namespace
+}  // namespace data
+}  // namespace tensorflow
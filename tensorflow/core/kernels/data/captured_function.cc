@@ -449,6 +449,19 @@ Status FunctionMetadata::Create(
   return Status::OK();
 }
 
+Status FunctionMetadata::Create(
+    NameAttrList&& func, std::unique_ptr<FunctionLibraryDefinition> lib_def,
+    Params params, std::shared_ptr<FunctionMetadata>* out_metadata) {
+  if (lib_def->Find(func.name()) == nullptr) {
+    return errors::FailedPrecondition(
+        "Could not find required function definition ", func.name());
+  }
+  out_metadata->reset(new FunctionMetadata(std::move(func), params));
+  (*out_metadata)->lib_def_ = std::move(lib_def);
+  (*out_metadata)->ValidateMultiDevice();
+  return Status::OK();
+}
+
 void FunctionMetadata::ValidateMultiDevice() {
   const FunctionDef* fdef = lib_def_->Find(func_.name());
   if (is_multi_device_function_) {
@@ -142,6 +142,14 @@ class FunctionMetadata {
                        NameAttrList&& func, Params params,
                        std::shared_ptr<FunctionMetadata>* out_metadata);
 
+  // Creates a new instance of the `FunctionMetadata` class for a function
+  // defined in `lib_def`, which need not be known to the function library of
+  // the op kernel. Such functions are never short-circuited.
+  static Status Create(NameAttrList&& func,
+                       std::unique_ptr<FunctionLibraryDefinition> lib_def,
+                       Params params,
+                       std::shared_ptr<FunctionMetadata>* out_metadata);
+
   // Returns the named list of function arguments.
   const NameAttrList& func() const { return func_; }
 
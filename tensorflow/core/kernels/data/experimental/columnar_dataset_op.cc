@@ -0,0 +1,403 @@
+/* Copyright 2019 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#include <cmath>
+
+#include "tensorflow/core/framework/dataset.h"
+#include "tensorflow/core/framework/partial_tensor_shape.h"
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/kernels/data/experimental/columnar_file.h"
+#include "tensorflow/core/lib/core/errors.h"
+
+namespace tensorflow {
+namespace data {
+namespace experimental {
+namespace {
+
+// Copies the values of `input` at `rows` into a new vector.
+template <typename T>
+Tensor GatherRows(Allocator* allocator, const Tensor& input,
+                  const std::vector<int64>& rows) {
+  Tensor output(allocator, input.dtype(),
+                TensorShape({static_cast<int64>(rows.size())}));
+  const auto input_values = input.flat<T>();
+  auto output_values = output.flat<T>();
+  for (size_t i = 0; i < rows.size(); ++i) {
+    output_values(i) = input_values(rows[i]);
+  }
+  return output;
+}
+
+Tensor GatherRows(Allocator* allocator, const Tensor& input,
+                  const std::vector<int64>& rows) {
+  switch (input.dtype()) {
+    case DT_INT32:
+      return GatherRows<int32>(allocator, input, rows);
+    case DT_INT64:
+      return GatherRows<int64>(allocator, input, rows);
+    case DT_FLOAT:
+      return GatherRows<float>(allocator, input, rows);
+    case DT_DOUBLE:
+      return GatherRows<double>(allocator, input, rows);
+    default:
+      return GatherRows<tstring>(allocator, input, rows);
+  }
+}
+
+// Appends to `rows` the indices of the values of `column` in [`min`, `max`].
+template <typename T>
+void SelectRows(const Tensor& column, double min, double max,
+                std::vector<int64>* rows) {
+  const auto values = column.flat<T>();
+  for (int64 i = 0; i < values.size(); ++i) {
+    const double value = static_cast<double>(values(i));
+    if (value >= min && value <= max) {
+      rows->push_back(i);
+    }
+  }
+}
+
+void SelectRows(const Tensor& column, double min, double max,
+                std::vector<int64>* rows) {
+  switch (column.dtype()) {
+    case DT_INT32:
+      return SelectRows<int32>(column, min, max, rows);
+    case DT_INT64:
+      return SelectRows<int64>(column, min, max, rows);
+    case DT_FLOAT:
+      return SelectRows<float>(column, min, max, rows);
+    default:
+      return SelectRows<double>(column, min, max, rows);
+  }
+}
+
+class ColumnarDatasetOp : public DatasetOpKernel {
+ public:
+  explicit ColumnarDatasetOp(OpKernelConstruction* ctx) : DatasetOpKernel(ctx) {
+    OP_REQUIRES_OK(ctx, ctx->GetAttr("output_types", &output_types_));
+    OP_REQUIRES_OK(ctx, ctx->GetAttr("output_shapes", &output_shapes_));
+  }
+
+  void MakeDataset(OpKernelContext* ctx, DatasetBase** output) override {
+    const Tensor* filenames_tensor;
+    OP_REQUIRES_OK(ctx, ctx->input("filenames", &filenames_tensor));
+    OP_REQUIRES(
+        ctx, filenames_tensor->dims() <= 1,
+        errors::InvalidArgument("`filenames` must be a scalar or a vector."));
+    std::vector<string> filenames;
+    filenames.reserve(filenames_tensor->NumElements());
+    for (int i = 0; i < filenames_tensor->NumElements(); ++i) {
+      filenames.push_back(filenames_tensor->flat<tstring>()(i));
+    }
+
+    const Tensor* columns_tensor;
+    OP_REQUIRES_OK(ctx, ctx->input("columns", &columns_tensor));
+    OP_REQUIRES(ctx, columns_tensor->dims() == 1,
+                errors::InvalidArgument("`columns` must be a vector."));
+    OP_REQUIRES(
+        ctx, columns_tensor->NumElements() == output_types_.size(),
+        errors::InvalidArgument("`columns` must have ", output_types_.size(),
+                                " elements to match `output_types`, but has ",
+                                columns_tensor->NumElements()));
+    std::vector<string> columns;
+    columns.reserve(columns_tensor->NumElements());
+    for (int i = 0; i < columns_tensor->NumElements(); ++i) {
+      columns.push_back(columns_tensor->flat<tstring>()(i));
+    }
+
+    tstring predicate_column;
+    OP_REQUIRES_OK(ctx, ParseScalarArgument<tstring>(ctx, "predicate_column",
+                                                     &predicate_column));
+    double predicate_min;
+    OP_REQUIRES_OK(ctx, ParseScalarArgument<double>(ctx, "predicate_min",
+                                                    &predicate_min));
+    double predicate_max;
+    OP_REQUIRES_OK(ctx, ParseScalarArgument<double>(ctx, "predicate_max",
+                                                    &predicate_max));
+
+    *output = new Dataset(ctx, std::move(filenames), std::move(columns),
+                          std::move(predicate_column), predicate_min,
+                          predicate_max, output_types_, output_shapes_);
+  }
+
+ private:
+  class Dataset : public DatasetBase {
+   public:
+    Dataset(OpKernelContext* ctx, std::vector<string> filenames,
+            std::vector<string> columns, string predicate_column,
+            double predicate_min, double predicate_max,
+            const DataTypeVector& output_types,
+            const std::vector<PartialTensorShape>& output_shapes)
+        : DatasetBase(DatasetContext(ctx)),
+          filenames_(std::move(filenames)),
+          columns_(std::move(columns)),
+          predicate_column_(std::move(predicate_column)),
+          predicate_min_(predicate_min),
+          predicate_max_(predicate_max),
+          output_types_(output_types),
+          output_shapes_(output_shapes) {}
+
+    std::unique_ptr<IteratorBase> MakeIteratorInternal(
+        const string& prefix) const override {
+      return absl::make_unique<Iterator>(
+          Iterator::Params{this, strings::StrCat(prefix, "::Columnar")});
+    }
+
+    const DataTypeVector& output_dtypes() const override {
+      return output_types_;
+    }
+
+    const std::vector<PartialTensorShape>& output_shapes() const override {
+      return output_shapes_;
+    }
+
+    string DebugString() const override {
+      return "ColumnarDatasetOp::Dataset";
+    }
+
+    Status CheckExternalState() const override { return Status::OK(); }
+
+   protected:
+    Status AsGraphDefInternal(SerializationContext* ctx,
+                              DatasetGraphDefBuilder* b,
+                              Node** output) const override {
+      Node* filenames = nullptr;
+      TF_RETURN_IF_ERROR(b->AddVector(filenames_, &filenames));
+      Node* columns = nullptr;
+      TF_RETURN_IF_ERROR(b->AddVector(columns_, &columns));
+      Node* predicate_column = nullptr;
+      TF_RETURN_IF_ERROR(b->AddScalar(predicate_column_, &predicate_column));
+      Node* predicate_min = nullptr;
+      TF_RETURN_IF_ERROR(b->AddScalar(predicate_min_, &predicate_min));
+      Node* predicate_max = nullptr;
+      TF_RETURN_IF_ERROR(b->AddScalar(predicate_max_, &predicate_max));
+      TF_RETURN_IF_ERROR(b->AddDataset(
+          this,
+          {filenames, columns, predicate_column, predicate_min, predicate_max},
+          output));
+      return Status::OK();
+    }
+
+   private:
+    class Iterator : public DatasetIterator<Dataset> {
+     public:
+      explicit Iterator(const Params& params)
+          : DatasetIterator<Dataset>(params) {}
+
+      Status GetNextInternal(IteratorContext* ctx,
+                             std::vector<Tensor>* out_tensors,
+                             bool* end_of_sequence) override {
+        mutex_lock l(mu_);
+        do {
+          if (reader_) {
+            while (next_row_group_ < reader_->num_row_groups()) {
+              const int64 row_group = next_row_group_++;
+              bool produced = false;
+              TF_RETURN_IF_ERROR(
+                  ReadRowGroup(ctx, row_group, out_tensors, &produced));
+              if (produced) {
+                *end_of_sequence = false;
+                return Status::OK();
+              }
+            }
+            ResetReaderLocked();
+            ++current_file_index_;
+          }
+          if (current_file_index_ == dataset()->filenames_.size()) {
+            *end_of_sequence = true;
+            return Status::OK();
+          }
+          TF_RETURN_IF_ERROR(SetupReaderLocked(ctx->env()));
+        } while (true);
+      }
+
+     protected:
+      std::shared_ptr<model::Node> CreateNode(
+          IteratorContext* ctx, model::Node::Args args) const override {
+        return model::MakeSourceNode(std::move(args));
+      }
+
+      Status SaveInternal(IteratorStateWriter* writer) override {
+        mutex_lock l(mu_);
+        TF_RETURN_IF_ERROR(writer->WriteScalar(full_name("current_file_index"),
+                                               current_file_index_));
+        if (reader_) {
+          TF_RETURN_IF_ERROR(writer->WriteScalar(full_name("next_row_group"),
+                                                 next_row_group_));
+        }
+        return Status::OK();
+      }
+
+      Status RestoreInternal(IteratorContext* ctx,
+                             IteratorStateReader* reader) override {
+        mutex_lock l(mu_);
+        ResetReaderLocked();
+        int64 current_file_index;
+        TF_RETURN_IF_ERROR(reader->ReadScalar(full_name("current_file_index"),
+                                              &current_file_index));
+        current_file_index_ = size_t(current_file_index);
+        if (reader->Contains(full_name("next_row_group"))) {
+          TF_RETURN_IF_ERROR(SetupReaderLocked(ctx->env()));
+          TF_RETURN_IF_ERROR(reader->ReadScalar(full_name("next_row_group"),
+                                                &next_row_group_));
+        }
+        return Status::OK();
+      }
+
+     private:
+      // Reads the projected columns of `row_group` into `*out_tensors`, keeping
+      // the rows that satisfy the predicate. Sets `*produced` to false if no
+      // row does, in which case `*out_tensors` is left unchanged.
+      Status ReadRowGroup(IteratorContext* ctx, int64 row_group,
+                          std::vector<Tensor>* out_tensors, bool* produced)
+          EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+        *produced = false;
+        Allocator* allocator = ctx->allocator({});
+        bool filter_rows = false;
+        if (predicate_index_ >= 0) {
+          const ColumnarChunkStats& stats =
+              reader_->stats(row_group, predicate_index_);
+          // The stats of the chunk bound its values, so the row group is
+          // skipped without being read if they miss the predicate range, and
+          // its rows are not filtered if they are within the range.
+          if (stats.has_stats && (stats.max < dataset()->predicate_min_ ||
+                                  stats.min > dataset()->predicate_max_)) {
+            return Status::OK();
+          }
+          filter_rows = !stats.has_stats ||
+                        stats.min < dataset()->predicate_min_ ||
+                        stats.max > dataset()->predicate_max_;
+        }
+        if (reader_->num_rows(row_group) == 0) {
+          return Status::OK();
+        }
+        std::vector<int64> rows;
+        Tensor predicate_values;
+        if (filter_rows) {
+          TF_RETURN_IF_ERROR(reader_->ReadColumnChunk(
+              row_group, predicate_index_, allocator, &predicate_values));
+          SelectRows(predicate_values, dataset()->predicate_min_,
+                     dataset()->predicate_max_, &rows);
+          if (rows.empty()) {
+            return Status::OK();
+          }
+        }
+        std::vector<Tensor> values;
+        values.reserve(column_indices_.size());
+        for (int column : column_indices_) {
+          Tensor column_values;
+          if (filter_rows && column == predicate_index_) {
+            column_values = predicate_values;
+          } else {
+            TF_RETURN_IF_ERROR(reader_->ReadColumnChunk(
+                row_group, column, allocator, &column_values));
+          }
+          if (filter_rows) {
+            column_values = GatherRows(allocator, column_values, rows);
+          }
+          values.push_back(std::move(column_values));
+        }
+        *out_tensors = std::move(values);
+        *produced = true;
+        return Status::OK();
+      }
+
+      // Opens the file at `current_file_index_` and resolves the projected
+      // and predicate columns.
+      Status SetupReaderLocked(Env* env) EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+        if (current_file_index_ >= dataset()->filenames_.size()) {
+          return errors::InvalidArgument(
+              "current_file_index_:", current_file_index_,
+              " >= filenames_.size():", dataset()->filenames_.size());
+        }
+        const string& filename = dataset()->filenames_[current_file_index_];
+        TF_RETURN_IF_ERROR(env->NewRandomAccessFile(filename, &file_));
+        uint64 file_size;
+        TF_RETURN_IF_ERROR(env->GetFileSize(filename, &file_size));
+        TF_RETURN_IF_ERROR(
+            ColumnarFileReader::Open(file_.get(), file_size, &reader_));
+        column_indices_.clear();
+        for (size_t i = 0; i < dataset()->columns_.size(); ++i) {
+          const string& name = dataset()->columns_[i];
+          const int column = reader_->FindColumn(name);
+          if (column < 0) {
+            return errors::InvalidArgument("Column ", name, " not found in ",
+                                           filename);
+          }
+          const DataType dtype = reader_->columns()[column].dtype;
+          if (dtype != dataset()->output_types_[i]) {
+            return errors::InvalidArgument(
+                "Column ", name, " of ", filename, " has type ",
+                DataTypeString(dtype), " but the dataset expects ",
+                DataTypeString(dataset()->output_types_[i]));
+          }
+          column_indices_.push_back(column);
+        }
+        predicate_index_ = -1;
+        if (!dataset()->predicate_column_.empty()) {
+          predicate_index_ = reader_->FindColumn(dataset()->predicate_column_);
+          if (predicate_index_ < 0) {
+            return errors::InvalidArgument("Predicate column ",
+                                           dataset()->predicate_column_,
+                                           " not found in ", filename);
+          }
+          if (reader_->columns()[predicate_index_].dtype == DT_STRING) {
+            return errors::InvalidArgument("Predicate column ",
+                                           dataset()->predicate_column_,
+                                           " of ", filename,
+                                           " must be numeric");
+          }
+        }
+        next_row_group_ = 0;
+        return Status::OK();
+      }
+
+      void ResetReaderLocked() EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+        reader_.reset();
+        file_.reset();
+      }
+
+      mutex mu_;
+      size_t current_file_index_ GUARDED_BY(mu_) = 0;
+      int64 next_row_group_ GUARDED_BY(mu_) = 0;
+      std::unique_ptr<RandomAccessFile> file_ GUARDED_BY(mu_);
+      // Reads `file_`.
+      std::unique_ptr<ColumnarFileReader> reader_ GUARDED_BY(mu_);
+      // The indices of the projected columns in the file.
+      std::vector<int> column_indices_ GUARDED_BY(mu_);
+      // The index of the predicate column in the file, or -1 if there is no
+      // predicate.
+      int predicate_index_ GUARDED_BY(mu_) = -1;
+    };  // class Iterator
+
+    const std::vector<string> filenames_;
+    const std::vector<string> columns_;
+    const tstring predicate_column_;
+    const double predicate_min_;
+    const double predicate_max_;
+    const DataTypeVector output_types_;
+    const std::vector<PartialTensorShape> output_shapes_;
+  };  // class Dataset
+
+  DataTypeVector output_types_;
+  std::vector<PartialTensorShape> output_shapes_;
+};  // class ColumnarDatasetOp
+
+REGISTER_KERNEL_BUILDER(Name("ColumnarDataset").Device(DEVICE_CPU),
+                        ColumnarDatasetOp);
+
+}  // namespace
+}  // namespace experimental
+}  // namespace data
+}  // namespace tensorflow
@@ -0,0 +1,455 @@
+/* Copyright 2019 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#include "tensorflow/core/kernels/data/experimental/columnar_file.h"
+
+#include <string.h>
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#include "tensorflow/core/lib/core/coding.h"
+#include "tensorflow/core/lib/core/errors.h"
+#include "tensorflow/core/lib/io/random_inputstream.h"
+#include "tensorflow/core/lib/io/zlib_compression_options.h"
+#include "tensorflow/core/lib/io/zlib_inputstream.h"
+#include "tensorflow/core/lib/io/zlib_outputbuffer.h"
+#include "tensorflow/core/platform/byte_order.h"
+
+namespace tensorflow {
+namespace data {
+namespace experimental {
+namespace {
+
+constexpr char kMagic[] = "TFCOLv1";
+// The magic includes its terminating '\0'.
+constexpr size_t kMagicSize = sizeof(kMagic);
+constexpr size_t kTrailerSize = sizeof(uint64) + kMagicSize;
+constexpr size_t kZlibBufferSize = 256 << 10;
+// The maximum compression ratio of deflate, which bounds the uncompressed size
+// of a compressed column chunk.
+constexpr uint64 kMaxZlibCompressionRatio = 1032;
+
+bool IsNumeric(DataType dtype) {
+  return dtype == DT_INT32 || dtype == DT_INT64 || dtype == DT_FLOAT ||
+         dtype == DT_DOUBLE;
+}
+
+Status CheckDtype(DataType dtype) {
+  if (!IsNumeric(dtype) && dtype != DT_STRING) {
+    return errors::InvalidArgument("Unsupported dtype for a columnar file: ",
+                                   DataTypeString(dtype));
+  }
+  if (!port::kLittleEndian) {
+    return errors::Unimplemented(
+        "Columnar files are only supported on little-endian hosts.");
+  }
+  return Status::OK();
+}
+
+io::ZlibCompressionOptions ZlibOptions(ColumnarCompression compression) {
+  return compression == ColumnarCompression::kGzip
+             ? io::ZlibCompressionOptions::GZIP()
+             : io::ZlibCompressionOptions::DEFAULT();
+}
+
+// A WritableFile that appends to a string, which `ZlibOutputBuffer`
+// compresses column chunks into.
+class StringWritableFile : public WritableFile {
+ public:
+  explicit StringWritableFile(string* dst) : dst_(dst) {}
+
+  Status Append(StringPiece data) override {
+    dst_->append(data.data(), data.size());
+    return Status::OK();
+  }
+  Status Close() override { return Status::OK(); }
+  Status Flush() override { return Status::OK(); }
+  Status Sync() override { return Status::OK(); }
+
+ private:
+  string* const dst_;  // Not owned.
+};
+
+template <typename T>
+ColumnarChunkStats ComputeStats(const Tensor& column) {
+  ColumnarChunkStats stats;
+  stats.has_stats = true;
+  stats.min = std::numeric_limits<double>::infinity();
+  stats.max = -std::numeric_limits<double>::infinity();
+  const auto values = column.flat<T>();
+  for (int64 i = 0; i < values.size(); ++i) {
+    const double v = static_cast<double>(values(i));
+    if (std::isnan(v)) return ColumnarChunkStats();
+    stats.min = std::min(stats.min, v);
+    stats.max = std::max(stats.max, v);
+  }
+  return stats;
+}
+
+ColumnarChunkStats ComputeStats(const Tensor& column) {
+  switch (column.dtype()) {
+    case DT_INT32:
+      return ComputeStats<int32>(column);
+    case DT_INT64:
+      return ComputeStats<int64>(column);
+    case DT_FLOAT:
+      return ComputeStats<float>(column);
+    case DT_DOUBLE:
+      return ComputeStats<double>(column);
+    default:
+      return ColumnarChunkStats();
+  }
+}
+
+void PutDouble(string* dst, double value) {
+  uint64 bits;
+  memcpy(&bits, &value, sizeof(bits));
+  core::PutFixed64(dst, bits);
+}
+
+bool GetDouble(StringPiece* input, double* value) {
+  if (input->size() < sizeof(uint64)) return false;
+  const uint64 bits = core::DecodeFixed64(input->data());
+  memcpy(value, &bits, sizeof(bits));
+  input->remove_prefix(sizeof(uint64));
+  return true;
+}
+
+bool GetString(StringPiece* input, string* value) {
+  uint64 size;
+  if (!core::GetVarint64(input, &size) || input->size() < size) return false;
+  value->assign(input->data(), size);
+  input->remove_prefix(size);
+  return true;
+}
+
+}  // namespace
+
+ColumnarFileWriter::ColumnarFileWriter(WritableFile* file,
+                                       std::vector<ColumnarColumn> columns,
+                                       ColumnarCompression compression)
+    : file_(file), columns_(std::move(columns)), compression_(compression) {}
+
+Status ColumnarFileWriter::Append(StringPiece data) {
+  if (offset_ == 0) {
+    TF_RETURN_IF_ERROR(file_->Append(StringPiece(kMagic, kMagicSize)));
+    offset_ = kMagicSize;
+  }
+  TF_RETURN_IF_ERROR(file_->Append(data));
+  offset_ += data.size();
+  return Status::OK();
+}
+
+Status ColumnarFileWriter::WriteRowGroup(const std::vector<Tensor>& columns) {
+  if (closed_) {
+    return errors::FailedPrecondition("The columnar file is closed.");
+  }
+  if (columns.size() != columns_.size()) {
+    return errors::InvalidArgument("Expected ", columns_.size(),
+                                   " columns but got ", columns.size());
+  }
+  ColumnarRowGroupMetadata row_group;
+  row_group.num_rows = columns.empty() ? 0 : columns[0].NumElements();
+  for (size_t i = 0; i < columns.size(); ++i) {
+    const Tensor& column = columns[i];
+    TF_RETURN_IF_ERROR(CheckDtype(columns_[i].dtype));
+    if (column.dtype() != columns_[i].dtype || column.dims() != 1 ||
+        column.NumElements() != row_group.num_rows) {
+      return errors::InvalidArgument(
+          "Expected a vector of ", row_group.num_rows, " ",
+          DataTypeString(columns_[i].dtype), " values for column ",
+          columns_[i].name, " but got ", column.DebugString());
+    }
+  }
+  if (offset_ == 0) {
+    TF_RETURN_IF_ERROR(Append(StringPiece()));
+  }
+  string encoded;
+  string compressed;
+  for (const Tensor& column : columns) {
+    StringPiece values;
+    if (column.dtype() == DT_STRING) {
+      encoded.clear();
+      const auto strings = column.flat<tstring>();
+      for (int64 j = 0; j < strings.size(); ++j) {
+        core::PutVarint64(&encoded, strings(j).size());
+        encoded.append(strings(j).data(), strings(j).size());
+      }
+      values = encoded;
+    } else {
+      values = column.tensor_data();
+    }
+    ColumnarChunkMetadata chunk;
+    chunk.offset = offset_;
+    chunk.uncompressed_size = values.size();
+    chunk.stats = ComputeStats(column);
+    if (compression_ != ColumnarCompression::kNone) {
+      compressed.clear();
+      StringWritableFile compressed_file(&compressed);
+      io::ZlibOutputBuffer zlib(&compressed_file, kZlibBufferSize,
+                                kZlibBufferSize, ZlibOptions(compression_));
+      TF_RETURN_IF_ERROR(zlib.Init());
+      TF_RETURN_IF_ERROR(zlib.Append(values));
+      TF_RETURN_IF_ERROR(zlib.Close());
+      values = compressed;
+    }
+    chunk.size = values.size();
+    TF_RETURN_IF_ERROR(Append(values));
+    row_group.chunks.push_back(chunk);
+  }
+  row_groups_.push_back(std::move(row_group));
+  return Status::OK();
+}
+
+Status ColumnarFileWriter::Close() {
+  if (closed_) {
+    return errors::FailedPrecondition("The columnar file is closed.");
+  }
+  closed_ = true;
+  string footer;
+  core::PutVarint64(&footer, static_cast<uint64>(compression_));
+  core::PutVarint64(&footer, columns_.size());
+  for (const ColumnarColumn& column : columns_) {
+    core::PutVarint64(&footer, column.name.size());
+    footer.append(column.name);
+    core::PutVarint64(&footer, column.dtype);
+  }
+  core::PutVarint64(&footer, row_groups_.size());
+  for (const ColumnarRowGroupMetadata& row_group : row_groups_) {
+    core::PutVarint64(&footer, row_group.num_rows);
+    for (const ColumnarChunkMetadata& chunk : row_group.chunks) {
+      core::PutVarint64(&footer, chunk.offset);
+      core::PutVarint64(&footer, chunk.size);
+      core::PutVarint64(&footer, chunk.uncompressed_size);
+      core::PutVarint64(&footer, chunk.stats.has_stats);
+      if (chunk.stats.has_stats) {
+        PutDouble(&footer, chunk.stats.min);
+        PutDouble(&footer, chunk.stats.max);
+      }
+    }
+  }
+  core::PutFixed64(&footer, footer.size());
+  footer.append(kMagic, kMagicSize);
+  return Append(footer);
+}
+
+/* static */
+Status ColumnarFileReader::Open(RandomAccessFile* file, uint64 file_size,
+                                std::unique_ptr<ColumnarFileReader>* reader) {
+  if (!port::kLittleEndian) {
+    return errors::Unimplemented(
+        "Columnar files are only supported on little-endian hosts.");
+  }
+  if (file_size < kMagicSize + kTrailerSize) {
+    return errors::DataLoss("Columnar file is too short: ", file_size,
+                            " bytes");
+  }
+  char trailer_scratch[kTrailerSize];
+  StringPiece trailer;
+  TF_RETURN_IF_ERROR(file->Read(file_size - kTrailerSize, kTrailerSize,
+                                &trailer, trailer_scratch));
+  char magic_scratch[kMagicSize];
+  StringPiece magic;
+  TF_RETURN_IF_ERROR(file->Read(0, kMagicSize, &magic, magic_scratch));
+  if (trailer.size() != kTrailerSize ||
+      trailer.substr(sizeof(uint64)) != StringPiece(kMagic, kMagicSize) ||
+      magic != StringPiece(kMagic, kMagicSize)) {
+    return errors::DataLoss("Not a columnar file.");
+  }
+  const uint64 footer_size = core::DecodeFixed64(trailer.data());
+  if (footer_size > file_size - kMagicSize - kTrailerSize) {
+    return errors::DataLoss("Corrupted columnar file footer size: ",
+                            footer_size);
+  }
+  const uint64 footer_offset = file_size - kTrailerSize - footer_size;
+  string footer_scratch(footer_size, '\0');
+  StringPiece footer;
+  TF_RETURN_IF_ERROR(
+      file->Read(footer_offset, footer_size, &footer, &footer_scratch[0]));
+  if (footer.size() != footer_size) {
+    return errors::DataLoss("Truncated columnar file footer.");
+  }
+  std::unique_ptr<ColumnarFileReader> result(new ColumnarFileReader(file));
+  TF_RETURN_IF_ERROR(result->ParseFooter(footer, footer_offset));
+  *reader = std::move(result);
+  return Status::OK();
+}
+
+Status ColumnarFileReader::ParseFooter(StringPiece footer,
+                                       uint64 footer_offset) {
+  const Status corrupted = errors::DataLoss("Corrupted columnar file footer.");
+  uint64 compression;
+  uint64 num_columns;
+  if (!core::GetVarint64(&footer, &compression) ||
+      compression > static_cast<uint64>(ColumnarCompression::kGzip) ||
+      !core::GetVarint64(&footer, &num_columns) ||
+      num_columns > footer.size()) {
+    return corrupted;
+  }
+  compression_ = static_cast<ColumnarCompression>(compression);
+  columns_.resize(num_columns);
+  for (ColumnarColumn& column : columns_) {
+    uint64 dtype;
+    if (!GetString(&footer, &column.name) ||
+        !core::GetVarint64(&footer, &dtype) ||
+        !DataType_IsValid(static_cast<int>(dtype))) {
+      return corrupted;
+    }
+    column.dtype = static_cast<DataType>(dtype);
+    TF_RETURN_IF_ERROR(CheckDtype(column.dtype));
+  }
+  uint64 num_row_groups;
+  if (!core::GetVarint64(&footer, &num_row_groups) ||
+      num_row_groups > footer.size()) {
+    return corrupted;
+  }
+  row_groups_.resize(num_row_groups);
+  for (ColumnarRowGroupMetadata& row_group : row_groups_) {
+    uint64 num_rows;
+    if (!core::GetVarint64(&footer, &num_rows) ||
+        num_rows > std::numeric_limits<int64>::max()) {
+      return corrupted;
+    }
+    // Each row takes at least one byte in each column chunk.
+    if (num_columns == 0 && num_rows != 0) {
+      return corrupted;
+    }
+    row_group.num_rows = num_rows;
+    row_group.chunks.resize(num_columns);
+    for (size_t i = 0; i < num_columns; ++i) {
+      ColumnarChunkMetadata& chunk = row_group.chunks[i];
+      uint64 has_stats;
+      if (!core::GetVarint64(&footer, &chunk.offset) ||
+          !core::GetVarint64(&footer, &chunk.size) ||
+          !core::GetVarint64(&footer, &chunk.uncompressed_size) ||
+          !core::GetVarint64(&footer, &has_stats) ||
+          chunk.offset < kMagicSize || chunk.offset > footer_offset ||
+          chunk.size > footer_offset - chunk.offset) {
+        return corrupted;
+      }
+      chunk.stats.has_stats = has_stats != 0;
+      if (chunk.stats.has_stats && (!GetDouble(&footer, &chunk.stats.min) ||
+                                    !GetDouble(&footer, &chunk.stats.max))) {
+        return corrupted;
+      }
+      if (compression_ == ColumnarCompression::kNone
+              ? chunk.uncompressed_size != chunk.size
+              : chunk.uncompressed_size / kMaxZlibCompressionRatio >
+                    chunk.size) {
+        return corrupted;
+      }
+      if (num_rows > chunk.uncompressed_size) {
+        return corrupted;
+      }
+      // Compares sizes by division, because `num_rows * DataTypeSize(dtype)`
+      // can overflow.
+      const DataType dtype = columns_[i].dtype;
+      if (IsNumeric(dtype) &&
+          (chunk.uncompressed_size % DataTypeSize(dtype) != 0 ||
+           chunk.uncompressed_size / DataTypeSize(dtype) != num_rows)) {
+        return corrupted;
+      }
+    }
+  }
+  if (!footer.empty()) {
+    return corrupted;
+  }
+  return Status::OK();
+}
+
+int ColumnarFileReader::FindColumn(StringPiece name) const {
+  for (size_t i = 0; i < columns_.size(); ++i) {
+    if (columns_[i].name == name) return i;
+  }
+  return -1;
+}
+
+Status ColumnarFileReader::ReadChunkBytes(const ColumnarChunkMetadata& chunk,
+                                          char* data) const {
+  if (chunk.uncompressed_size == 0) {
+    return Status::OK();
+  }
+  if (compression_ == ColumnarCompression::kNone) {
+    StringPiece result;
+    Status s = file_->Read(chunk.offset, chunk.size, &result, data);
+    if (!s.ok() && !errors::IsOutOfRange(s)) {
+      return s;
+    }
+    if (result.size() != chunk.size) {
+      return errors::DataLoss("Truncated columnar file chunk at offset ",
+                              chunk.offset);
+    }
+    if (result.data() != data) {
+      memcpy(data, result.data(), result.size());
+    }
+    return Status::OK();
+  }
+  io::RandomAccessInputStream input_stream(file_);
+  TF_RETURN_IF_ERROR(input_stream.Seek(chunk.offset));
+  const size_t buffer_size =
+      std::max<size_t>(1, std::min<uint64>(chunk.size, kZlibBufferSize));
+  io::ZlibInputStream zlib(&input_stream, buffer_size, kZlibBufferSize,
+                           ZlibOptions(compression_));
+  tstring uncompressed;
+  Status s = zlib.ReadNBytes(chunk.uncompressed_size, &uncompressed);
+  if (!s.ok() && !errors::IsOutOfRange(s)) {
+    return s;
+  }
+  if (uncompressed.size() != chunk.uncompressed_size) {
+    return errors::DataLoss("Truncated columnar file chunk at offset ",
+                            chunk.offset);
+  }
+  memcpy(data, uncompressed.data(), uncompressed.size());
+  return Status::OK();
+}
+
+Status ColumnarFileReader::ReadColumnChunk(int64 row_group, int column,
+                                           Allocator* allocator,
+                                           Tensor* out) const {
+  const ColumnarRowGroupMetadata& group = row_groups_[row_group];
+  const ColumnarChunkMetadata& chunk = group.chunks[column];
+  const DataType dtype = columns_[column].dtype;
+  Tensor values(allocator, dtype, TensorShape({group.num_rows}));
+  if (IsNumeric(dtype)) {
+    // Reads the chunk into the buffer of the tensor without a copy.
+    TF_RETURN_IF_ERROR(ReadChunkBytes(
+        chunk, const_cast<char*>(values.tensor_data().data())));
+  } else {
+    string scratch(chunk.uncompressed_size, '\0');
+    TF_RETURN_IF_ERROR(ReadChunkBytes(chunk, &scratch[0]));
+    StringPiece input(scratch);
+    auto strings = values.flat<tstring>();
+    for (int64 i = 0; i < strings.size(); ++i) {
+      uint64 size;
+      if (!core::GetVarint64(&input, &size) || input.size() < size) {
+        return errors::DataLoss("Corrupted columnar file chunk at offset ",
+                                chunk.offset);
+      }
+      strings(i).assign(input.data(), size);
+      input.remove_prefix(size);
+    }
+    if (!input.empty()) {
+      return errors::DataLoss("Corrupted columnar file chunk at offset ",
+                              chunk.offset);
+    }
+  }
+  *out = std::move(values);
+  return Status::OK();
+}
+
+}  // namespace experimental
+}  // namespace data
+}  // namespace tensorflow
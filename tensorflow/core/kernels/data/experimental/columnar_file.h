@@ -0,0 +1,180 @@
+/* Copyright 2019 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#ifndef TENSORFLOW_CORE_KERNELS_DATA_EXPERIMENTAL_COLUMNAR_FILE_H_
+#define TENSORFLOW_CORE_KERNELS_DATA_EXPERIMENTAL_COLUMNAR_FILE_H_
+
+#include <memory>
+#include <vector>
+
+#include "tensorflow/core/framework/allocator.h"
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/framework/types.h"
+#include "tensorflow/core/lib/core/status.h"
+#include "tensorflow/core/platform/file_system.h"
+#include "tensorflow/core/platform/macros.h"
+#include "tensorflow/core/platform/types.h"
+
+namespace tensorflow {
+namespace data {
+namespace experimental {
+
+// Columnar files
+// --------------
+//
+// A columnar file stores a table whose rows are split into row groups. Each
+// row group stores the values of each column contiguously in a column chunk,
+// so that a reader only reads the columns it needs, and records the minimum
+// and maximum value of each numeric column chunk, so that a reader skips the
+// row groups whose values cannot satisfy a predicate.
+//
+// The file is laid out as follows:
+//
+//   magic: "TFCOLv1\0"
+//   column chunks, by row group and then by column
+//   footer
+//   footer_size: fixed64
+//   magic: "TFCOLv1\0"
+//
+// The footer consists of varints, as encoded by `core::PutVarint64()`:
+//
+//   compression (see `ColumnarCompression`)
+//   num_columns, then for each column: name_size, name bytes, dtype
+//   num_row_groups, then for each row group: num_rows, then for each column:
+//     offset, size, uncompressed_size, has_stats, and if has_stats the min
+//     and max as the fixed64 bits of doubles
+//
+// The values of DT_INT32, DT_INT64, DT_FLOAT and DT_DOUBLE columns are stored
+// as a little-endian array, which a reader of an uncompressed file reads
+// directly into the buffer of a tensor. The values of DT_STRING columns are
+// stored as a varint size followed by the bytes of each value, and have no
+// statistics. Each column chunk is compressed on its own.
+
+enum class ColumnarCompression {
+  kNone = 0,
+  kZlib = 1,
+  kGzip = 2,
+};
+
+struct ColumnarColumn {
+  string name;
+  DataType dtype = DT_INVALID;
+};
+
+// The statistics of a column chunk. The values of integer columns are
+// compared as doubles. Chunks that contain NaN values have no statistics.
+struct ColumnarChunkStats {
+  bool has_stats = false;
+  double min = 0.0;
+  double max = 0.0;
+};
+
+// The location and statistics of a column chunk.
+struct ColumnarChunkMetadata {
+  uint64 offset = 0;
+  uint64 size = 0;
+  uint64 uncompressed_size = 0;
+  ColumnarChunkStats stats;
+};
+
+struct ColumnarRowGroupMetadata {
+  int64 num_rows = 0;
+  std::vector<ColumnarChunkMetadata> chunks;
+};
+
+// Writes a columnar file.
+//
+// A given instance of ColumnarFileWriter is NOT safe for concurrent use by
+// multiple threads.
+class ColumnarFileWriter {
+ public:
+  // `file` must outlive *this and is not closed by `Close()`.
+  ColumnarFileWriter(WritableFile* file, std::vector<ColumnarColumn> columns,
+                     ColumnarCompression compression);
+
+  // Appends a row group. `columns` holds a vector per column of the file, of
+  // the dtype of the column and of the same number of elements.
+  Status WriteRowGroup(const std::vector<Tensor>& columns);
+
+  // Writes the footer. No row group can be written after `Close()`.
+  Status Close();
+
+ private:
+  // Writes `data` at the end of the file.
+  Status Append(StringPiece data);
+
+  WritableFile* const file_;  // Not owned.
+  const std::vector<ColumnarColumn> columns_;
+  const ColumnarCompression compression_;
+  uint64 offset_ = 0;
+  bool closed_ = false;
+  std::vector<ColumnarRowGroupMetadata> row_groups_;
+
+  TF_DISALLOW_COPY_AND_ASSIGN(ColumnarFileWriter);
+};
+
+// Reads a columnar file.
+//
+// ColumnarFileReader is safe for concurrent use by multiple threads.
+class ColumnarFileReader {
+ public:
+  // Reads the footer of the file, of `file_size` bytes. `file` must outlive
+  // *reader.
+  static Status Open(RandomAccessFile* file, uint64 file_size,
+                     std::unique_ptr<ColumnarFileReader>* reader);
+
+  const std::vector<ColumnarColumn>& columns() const { return columns_; }
+
+  // Returns the index of the column called `name`, or -1 if there is none.
+  int FindColumn(StringPiece name) const;
+
+  int64 num_row_groups() const { return row_groups_.size(); }
+
+  int64 num_rows(int64 row_group) const {
+    return row_groups_[row_group].num_rows;
+  }
+
+  const ColumnarChunkStats& stats(int64 row_group, int column) const {
+    return row_groups_[row_group].chunks[column].stats;
+  }
+
+  // Reads the chunk of `column` in `row_group` into a vector allocated with
+  // `allocator`. The numeric chunks of uncompressed files are read directly
+  // into the buffer of the vector.
+  Status ReadColumnChunk(int64 row_group, int column, Allocator* allocator,
+                         Tensor* out) const;
+
+ private:
+  explicit ColumnarFileReader(RandomAccessFile* file) : file_(file) {}
+
+  // Parses `footer`, which starts at `footer_offset` in the file.
+  Status ParseFooter(StringPiece footer, uint64 footer_offset);
+
+  // Reads the `chunk.uncompressed_size` bytes of the values of `chunk` into
+  // `data`, uncompressing them if needed.
+  Status ReadChunkBytes(const ColumnarChunkMetadata& chunk, char* data) const;
+
+  RandomAccessFile* const file_;  // Not owned.
+  ColumnarCompression compression_ = ColumnarCompression::kNone;
+  std::vector<ColumnarColumn> columns_;
+  std::vector<ColumnarRowGroupMetadata> row_groups_;
+
+  TF_DISALLOW_COPY_AND_ASSIGN(ColumnarFileReader);
+};
+
+}  // namespace experimental
+}  // namespace data
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_CORE_KERNELS_DATA_EXPERIMENTAL_COLUMNAR_FILE_H_
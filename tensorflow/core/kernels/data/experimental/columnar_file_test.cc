@@ -0,0 +1,244 @@
+/* Copyright 2019 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#include "tensorflow/core/kernels/data/experimental/columnar_file.h"
+
+#include <cmath>
+
+#include "tensorflow/core/framework/tensor_testutil.h"
+#include "tensorflow/core/lib/core/coding.h"
+#include "tensorflow/core/lib/core/errors.h"
+#include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/platform/env.h"
+#include "tensorflow/core/platform/test.h"
+
+namespace tensorflow {
+namespace data {
+namespace experimental {
+namespace {
+
+std::vector<ColumnarColumn> TestColumns() {
+  return {{"id", DT_INT64}, {"score", DT_FLOAT}, {"name", DT_STRING}};
+}
+
+std::vector<Tensor> RowGroup(std::vector<int64> ids, std::vector<float> scores,
+                             std::vector<tstring> names) {
+  const int64 n = ids.size();
+  return {test::AsTensor<int64>(ids, {n}),
+          test::AsTensor<float>(scores, {n}),
+          test::AsTensor<tstring>(names, {n})};
+}
+
+class ColumnarFileTest
+    : public ::testing::TestWithParam<ColumnarCompression> {
+ protected:
+  void WriteFile(const std::vector<std::vector<Tensor>>& row_groups) {
+    fname_ = strings::StrCat(testing::TmpDir(), "/columnar_file_test_",
+                             static_cast<int>(GetParam()));
+    std::unique_ptr<WritableFile> file;
+    TF_ASSERT_OK(Env::Default()->NewWritableFile(fname_, &file));
+    ColumnarFileWriter writer(file.get(), TestColumns(), GetParam());
+    for (const auto& row_group : row_groups) {
+      TF_ASSERT_OK(writer.WriteRowGroup(row_group));
+    }
+    TF_ASSERT_OK(writer.Close());
+    TF_ASSERT_OK(file->Close());
+  }
+
+  Status OpenFile(std::unique_ptr<ColumnarFileReader>* reader) {
+    TF_RETURN_IF_ERROR(Env::Default()->NewRandomAccessFile(fname_, &file_));
+    uint64 file_size;
+    TF_RETURN_IF_ERROR(Env::Default()->GetFileSize(fname_, &file_size));
+    return ColumnarFileReader::Open(file_.get(), file_size, reader);
+  }
+
+  string fname_;
+  std::unique_ptr<RandomAccessFile> file_;
+};
+
+TEST_P(ColumnarFileTest, RoundTrip) {
+  const std::vector<std::vector<Tensor>> row_groups = {
+      RowGroup({1, 2, 3}, {0.5, -1.5, 2.0}, {"a", "", "ccc"}),
+      RowGroup({}, {}, {}),
+      RowGroup({-7}, {1e30}, {"d"})};
+  WriteFile(row_groups);
+  std::unique_ptr<ColumnarFileReader> reader;
+  TF_ASSERT_OK(OpenFile(&reader));
+  ASSERT_EQ(reader->columns().size(), 3);
+  EXPECT_EQ(reader->columns()[1].name, "score");
+  EXPECT_EQ(reader->columns()[1].dtype, DT_FLOAT);
+  EXPECT_EQ(reader->FindColumn("name"), 2);
+  EXPECT_EQ(reader->FindColumn("missing"), -1);
+  ASSERT_EQ(reader->num_row_groups(), row_groups.size());
+  for (int64 g = 0; g < reader->num_row_groups(); ++g) {
+    EXPECT_EQ(reader->num_rows(g), row_groups[g][0].NumElements());
+    // Reads the columns out of order.
+    for (int c : {2, 0, 1}) {
+      Tensor column;
+      TF_ASSERT_OK(reader->ReadColumnChunk(g, c, cpu_allocator(), &column));
+      if (c == 0) {
+        test::ExpectTensorEqual<int64>(column, row_groups[g][c]);
+      } else if (c == 1) {
+        test::ExpectTensorEqual<float>(column, row_groups[g][c]);
+      } else {
+        test::ExpectTensorEqual<tstring>(column, row_groups[g][c]);
+      }
+    }
+  }
+}
+
+TEST_P(ColumnarFileTest, Stats) {
+  WriteFile({RowGroup({4, -2, 9}, {1.5, 0.25, -3.0}, {"a", "b", "c"}),
+             RowGroup({5}, {NAN}, {"d"})});
+  std::unique_ptr<ColumnarFileReader> reader;
+  TF_ASSERT_OK(OpenFile(&reader));
+  const ColumnarChunkStats& ids = reader->stats(0, 0);
+  EXPECT_TRUE(ids.has_stats);
+  EXPECT_EQ(ids.min, -2.0);
+  EXPECT_EQ(ids.max, 9.0);
+  const ColumnarChunkStats& scores = reader->stats(0, 1);
+  EXPECT_TRUE(scores.has_stats);
+  EXPECT_EQ(scores.min, -3.0);
+  EXPECT_EQ(scores.max, 1.5);
+  EXPECT_FALSE(reader->stats(0, 2).has_stats);
+  EXPECT_TRUE(reader->stats(1, 0).has_stats);
+  EXPECT_FALSE(reader->stats(1, 1).has_stats);
+}
+
+INSTANTIATE_TEST_SUITE_P(Compression, ColumnarFileTest,
+                         ::testing::Values(ColumnarCompression::kNone,
+                                           ColumnarCompression::kZlib,
+                                           ColumnarCompression::kGzip));
+
+TEST(ColumnarFileWriterTest, InvalidRowGroups) {
+  const string fname = testing::TmpDir() + "/columnar_file_invalid";
+  std::unique_ptr<WritableFile> file;
+  TF_ASSERT_OK(Env::Default()->NewWritableFile(fname, &file));
+  ColumnarFileWriter writer(file.get(), TestColumns(),
+                            ColumnarCompression::kNone);
+  std::vector<Tensor> row_group = RowGroup({1, 2}, {1.0, 2.0}, {"a", "b"});
+  row_group.pop_back();
+  EXPECT_TRUE(errors::IsInvalidArgument(writer.WriteRowGroup(row_group)));
+  row_group.push_back(test::AsTensor<tstring>({"a"}, {1}));
+  EXPECT_TRUE(errors::IsInvalidArgument(writer.WriteRowGroup(row_group)));
+  row_group.back() = test::AsTensor<int64>({1, 2}, {2});
+  EXPECT_TRUE(errors::IsInvalidArgument(writer.WriteRowGroup(row_group)));
+  TF_ASSERT_OK(writer.Close());
+  EXPECT_TRUE(errors::IsFailedPrecondition(
+      writer.WriteRowGroup(RowGroup({1}, {1.0}, {"a"}))));
+}
+
+TEST(ColumnarFileReaderTest, NotAColumnarFile) {
+  const string fname = testing::TmpDir() + "/columnar_file_not_columnar";
+  TF_ASSERT_OK(WriteStringToFile(Env::Default(), fname,
+                                 "this is not a columnar file at all"));
+  std::unique_ptr<RandomAccessFile> file;
+  TF_ASSERT_OK(Env::Default()->NewRandomAccessFile(fname, &file));
+  uint64 file_size;
+  TF_ASSERT_OK(Env::Default()->GetFileSize(fname, &file_size));
+  std::unique_ptr<ColumnarFileReader> reader;
+  EXPECT_TRUE(errors::IsDataLoss(
+      ColumnarFileReader::Open(file.get(), file_size, &reader)));
+  EXPECT_TRUE(
+      errors::IsDataLoss(ColumnarFileReader::Open(file.get(), 4, &reader)));
+}
+
+// Returns the footer of a file with a single chunk of a single column.
+string SingleChunkFooter(ColumnarCompression compression, DataType dtype,
+                         uint64 num_rows, uint64 size,
+                         uint64 uncompressed_size) {
+  string footer;
+  core::PutVarint64(&footer, static_cast<uint64>(compression));
+  core::PutVarint64(&footer, 1);
+  core::PutVarint64(&footer, 1);
+  footer.append("c");
+  core::PutVarint64(&footer, dtype);
+  core::PutVarint64(&footer, 1);
+  core::PutVarint64(&footer, num_rows);
+  // The chunk starts after the magic.
+  core::PutVarint64(&footer, 8);
+  core::PutVarint64(&footer, size);
+  core::PutVarint64(&footer, uncompressed_size);
+  core::PutVarint64(&footer, 0);
+  return footer;
+}
+
+// Opens a file with 16 bytes of column chunks and `footer`.
+Status OpenWithFooter(const string& name, const string& footer,
+                      std::unique_ptr<ColumnarFileReader>* reader,
+                      std::unique_ptr<RandomAccessFile>* file) {
+  const string magic("TFCOLv1\0", 8);
+  string contents = magic;
+  contents.append(16, '\0');
+  contents.append(footer);
+  core::PutFixed64(&contents, footer.size());
+  contents.append(magic);
+  const string fname = strings::StrCat(testing::TmpDir(), "/", name);
+  TF_RETURN_IF_ERROR(WriteStringToFile(Env::Default(), fname, contents));
+  TF_RETURN_IF_ERROR(Env::Default()->NewRandomAccessFile(fname, file));
+  return ColumnarFileReader::Open(file->get(), contents.size(), reader);
+}
+
+TEST(ColumnarFileReaderTest, ValidFooter) {
+  std::unique_ptr<RandomAccessFile> file;
+  std::unique_ptr<ColumnarFileReader> reader;
+  TF_ASSERT_OK(OpenWithFooter(
+      "columnar_file_valid_footer",
+      SingleChunkFooter(ColumnarCompression::kNone, DT_INT64, 2, 16, 16),
+      &reader, &file));
+  Tensor column;
+  TF_ASSERT_OK(reader->ReadColumnChunk(0, 0, cpu_allocator(), &column));
+  test::ExpectTensorEqual<int64>(column, test::AsTensor<int64>({0, 0}, {2}));
+}
+
+TEST(ColumnarFileReaderTest, CorruptedFooter) {
+  // `num_rows * 8` wraps around to a size that is larger than `num_rows`.
+  const uint64 wrapping_num_rows = 3000000000000000000ULL;
+  const struct {
+    const char* name;
+    string footer;
+  } test_cases[] = {
+      {"numeric_size_overflow",
+       SingleChunkFooter(ColumnarCompression::kZlib, DT_INT64,
+                         wrapping_num_rows, 16, wrapping_num_rows * 8)},
+      {"numeric_size_mismatch",
+       SingleChunkFooter(ColumnarCompression::kNone, DT_INT64, 3, 16, 16)},
+      {"string_too_many_rows",
+       SingleChunkFooter(ColumnarCompression::kNone, DT_STRING, 1ULL << 40, 16,
+                         16)},
+      {"compressed_string_too_many_rows",
+       SingleChunkFooter(ColumnarCompression::kGzip, DT_STRING, 1ULL << 40, 16,
+                         16)},
+      {"compressed_too_large",
+       SingleChunkFooter(ColumnarCompression::kZlib, DT_STRING, 1, 16,
+                         1ULL << 50)},
+      {"uncompressed_size_mismatch",
+       SingleChunkFooter(ColumnarCompression::kNone, DT_STRING, 1, 16, 17)},
+      {"chunk_past_footer",
+       SingleChunkFooter(ColumnarCompression::kNone, DT_STRING, 1, 17, 17)},
+  };
+  for (const auto& test_case : test_cases) {
+    std::unique_ptr<RandomAccessFile> file;
+    std::unique_ptr<ColumnarFileReader> reader;
+    EXPECT_TRUE(errors::IsDataLoss(
+        OpenWithFooter(strings::StrCat("columnar_file_", test_case.name),
+                       test_case.footer, &reader, &file)))
+        << test_case.name;
+  }
+}
+
+}  // namespace
+}  // namespace experimental
+}  // namespace data
+}  // namespace tensorflow
@@ -12,6 +12,12 @@ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
 See the License for the specific language governing permissions and
 limitations under the License.
 ==============================================================================*/
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#include <string.h>
+
 #include "tensorflow/core/framework/common_shape_fns.h"
 #include "tensorflow/core/framework/dataset.h"
 #include "tensorflow/core/framework/op.h"
@@ -26,6 +32,43 @@ namespace data {
 namespace experimental {
 namespace {
 
+// Returns the position of the first character of `buffer` at or after `pos`
+// that ends an unquoted field, i.e. `delim`, '\n' or '\r', or that is a quote
+// if `use_quote_delim` is true. Returns `buffer.size()` if there is none.
+// Compares 16 characters at a time where SSE2 is available.
+size_t FindUnquotedFieldEnd(StringPiece buffer, size_t pos, char delim,
+                            bool use_quote_delim) {
+  const char* data = buffer.data();
+  const size_t size = buffer.size();
+#ifdef __SSE2__
+  const __m128i delims = _mm_set1_epi8(delim);
+  const __m128i newlines = _mm_set1_epi8('\n');
+  const __m128i carriage_returns = _mm_set1_epi8('\r');
+  // Without quote delimiters, quotes are ordinary characters: look for
+  // newlines twice instead.
+  const __m128i quotes = _mm_set1_epi8(use_quote_delim ? '"' : '\n');
+  for (; pos + 16 <= size; pos += 16) {
+    const __m128i chars =
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + pos));
+    const __m128i matches =
+        _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(chars, delims),
+                                  _mm_cmpeq_epi8(chars, newlines)),
+                     _mm_or_si128(_mm_cmpeq_epi8(chars, carriage_returns),
+                                  _mm_cmpeq_epi8(chars, quotes)));
+    const int mask = _mm_movemask_epi8(matches);
+    if (mask != 0) return pos + __builtin_ctz(mask);
+  }
+#endif
+  for (; pos < size; ++pos) {
+    const char ch = data[pos];
+    if (ch == delim || ch == '\n' || ch == '\r' ||
+        (use_quote_delim && ch == '"')) {
+      return pos;
+    }
+  }
+  return size;
+}
+
 class CSVDatasetOp : public DatasetOpKernel {
  public:
   explicit CSVDatasetOp(OpKernelConstruction* ctx) : DatasetOpKernel(ctx) {
@@ -444,7 +487,9 @@ class CSVDatasetOp : public DatasetOpKernel {
         pos_++;  // Starting quotation mark
 
         Status parse_result;
-        while (true) {  // Each iter reads 1 char, filling buffer if necessary
+        // Each iter handles the character at `pos_`, skipping to the next
+        // quote if it is not one, and fills the buffer if necessary.
+        while (true) {
           if (pos_ >= buffer_.size()) {
             Status s = SaveAndFillBuffer(&earlier_pieces, &start, include);
             if (errors::IsOutOfRange(s)) {
@@ -498,7 +543,13 @@ class CSVDatasetOp : public DatasetOpKernel {
             }
 
           } else {
-            pos_++;
+            // Skip to the next quote, the only special character inside a
+            // quoted field.
+            const void* quote =
+                memchr(&buffer_[pos_], '"', buffer_.size() - pos_);
+            pos_ = quote == nullptr
+                       ? buffer_.size()
+                       : static_cast<const char*>(quote) - buffer_.data();
           }
         }
       }
@@ -576,7 +627,9 @@ class CSVDatasetOp : public DatasetOpKernel {
         size_t start = pos_;
         Status parse_result;
 
-        while (true) {  // Each iter reads 1 char, filling buffer if necessary
+        // Each iter scans to the next special character, filling buffer if
+        // necessary.
+        while (true) {
           if (pos_ >= buffer_.size()) {
             Status s = SaveAndFillBuffer(&earlier_pieces, &start, include);
             // Handle errors
@@ -592,6 +645,10 @@ class CSVDatasetOp : public DatasetOpKernel {
             }
           }
 
+          pos_ = FindUnquotedFieldEnd(buffer_, pos_, dataset()->delim_,
+                                      dataset()->use_quote_delim_);
+          if (pos_ >= buffer_.size()) continue;
+
           char ch = buffer_[pos_];
 
           if (ch == dataset()->delim_) {
@@ -617,7 +674,7 @@ class CSVDatasetOp : public DatasetOpKernel {
             parse_result.Update(errors::InvalidArgument(
                 "Unquoted fields cannot have quotes inside"));
           }
-          // Otherwise, go to next character
+          // Otherwise, go past the quote
           pos_++;
         }
       }
@@ -724,7 +781,7 @@ class CSVDatasetOp : public DatasetOpKernel {
               component.scalar<tstring>()() =
                   dataset()->record_defaults_[output_idx].flat<tstring>()(0);
             } else {
-              component.scalar<tstring>()() = string(field);
+              component.scalar<tstring>()().assign(field.data(), field.size());
             }
             break;
           }
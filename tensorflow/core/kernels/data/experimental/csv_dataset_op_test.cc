@@ -0,0 +1,189 @@
+/* Copyright 2019 The TensorFlow Authors. All Rights Reserved.
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+    http://www.apache.org/licenses/LICENSE-2.0
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#include "tensorflow/core/kernels/data/dataset_test_base.h"
+
+namespace tensorflow {
+namespace data {
+namespace experimental {
+namespace {
+
+constexpr char kNodeName[] = "csv_dataset";
+
+// Reads records of string fields from a single uncompressed file.
+class CSVDatasetParams : public DatasetParams {
+ public:
+  CSVDatasetParams(string filename, int num_fields, int64 buffer_size,
+                   bool use_quote_delim, string node_name)
+      : DatasetParams(DataTypeVector(num_fields, DT_STRING),
+                      std::vector<PartialTensorShape>(num_fields,
+                                                      PartialTensorShape({})),
+                      std::move(node_name)),
+        filename_(std::move(filename)),
+        num_fields_(num_fields),
+        buffer_size_(buffer_size),
+        use_quote_delim_(use_quote_delim) {}
+
+  std::vector<Tensor> GetInputTensors() const override {
+    std::vector<Tensor> input_tensors = {
+        CreateTensor<tstring>(TensorShape({1}), {filename_}),
+        CreateTensor<tstring>(TensorShape({}), {""}),
+        CreateTensor<int64>(TensorShape({}), {buffer_size_}),
+        CreateTensor<bool>(TensorShape({}), {false}),
+        CreateTensor<tstring>(TensorShape({}), {","}),
+        CreateTensor<bool>(TensorShape({}), {use_quote_delim_}),
+        CreateTensor<tstring>(TensorShape({}), {""}),
+        CreateTensor<int64>(TensorShape({0}), {})};
+    for (int i = 0; i < num_fields_; ++i) {
+      input_tensors.push_back(CreateTensor<tstring>(TensorShape({1}), {""}));
+    }
+    return input_tensors;
+  }
+
+  Status GetInputNames(std::vector<string>* input_names) const override {
+    *input_names = {"filenames", "compression_type", "buffer_size",
+                    "header",    "field_delim",      "use_quote_delim",
+                    "na_value",  "select_cols"};
+    for (int i = 0; i < num_fields_; ++i) {
+      input_names->push_back(absl::StrCat("record_defaults_", i));
+    }
+    return Status::OK();
+  }
+
+  Status GetAttributes(AttributeVector* attr_vector) const override {
+    *attr_vector = {{"output_types", output_dtypes_},
+                    {"output_shapes", output_shapes_}};
+    return Status::OK();
+  }
+
+  string dataset_type() const override { return "CSV"; }
+
+ private:
+  tstring filename_;
+  int num_fields_;
+  int64 buffer_size_;
+  bool use_quote_delim_;
+};
+
+class CSVDatasetOpTest : public DatasetOpsTestBaseV2 {};
+
+string WriteTestFile(const string& name, const string& contents) {
+  const string filename = absl::StrCat(testing::TmpDir(), "/", name);
+  CompressionParams params;
+  params.output_buffer_size = 10;
+  params.compression_type = CompressionType::UNCOMPRESSED;
+  Status s = WriteDataToFile(filename, contents.c_str(), params);
+  if (!s.ok()) {
+    VLOG(WARNING) << "Failed to create the test file " << filename << ": "
+                  << s;
+  }
+  return filename;
+}
+
+// The unquoted fields and records are longer than the 16 characters that are
+// scanned at a time, and the delimiters and line breaks are at the end or the
+// start of a block of 16 characters.
+string UnquotedContents() {
+  return absl::StrCat(string(15, 'a'), ",", string(16, 'b'), "\n",
+                      string(17, 'c'), ",", string(31, 'd'), "\r\n",
+                      string(32, 'e'), ",", string(33, 'f'));
+}
+
+std::vector<Tensor> UnquotedOutputs() {
+  return CreateTensors<tstring>(
+      TensorShape({}), {{string(15, 'a')}, {string(16, 'b')},
+                        {string(17, 'c')}, {string(31, 'd')},
+                        {string(32, 'e')}, {string(33, 'f')}});
+}
+
+// Test case 1: long unquoted fields read from a large buffer.
+CSVDatasetParams CSVDatasetParams1() {
+  return CSVDatasetParams(WriteTestFile("csv_unquoted_1", UnquotedContents()),
+                          /*num_fields=*/2, /*buffer_size=*/1024,
+                          /*use_quote_delim=*/true,
+                          /*node_name=*/kNodeName);
+}
+
+// Test case 2: long unquoted fields that span several buffer refills.
+CSVDatasetParams CSVDatasetParams2() {
+  return CSVDatasetParams(WriteTestFile("csv_unquoted_2", UnquotedContents()),
+                          /*num_fields=*/2, /*buffer_size=*/7,
+                          /*use_quote_delim=*/true,
+                          /*node_name=*/kNodeName);
+}
+
+// Test case 3: long quoted fields with escaped quotes, delimiters and line
+// breaks at the boundaries of blocks of 16 characters.
+CSVDatasetParams CSVDatasetParams3() {
+  return CSVDatasetParams(
+      WriteTestFile(
+          "csv_quoted",
+          absl::StrCat("\"", string(15, 'a'), "\"\"", string(16, 'b'), "\",\"",
+                       string(16, 'c'), "\"\n\"", string(14, 'd'), ",\n\r\",",
+                       string(40, 'e'), "\n")),
+      /*num_fields=*/2, /*buffer_size=*/1024, /*use_quote_delim=*/true,
+      /*node_name=*/kNodeName);
+}
+
+// Test case 4: quotes are ordinary characters without quote delimiters.
+CSVDatasetParams CSVDatasetParams4() {
+  return CSVDatasetParams(
+      WriteTestFile("csv_no_quote_delim",
+                    absl::StrCat(string(16, 'a'), "\"", string(15, 'b'), ",",
+                                 string(20, '"'), "\n")),
+      /*num_fields=*/2, /*buffer_size=*/1024, /*use_quote_delim=*/false,
+      /*node_name=*/kNodeName);
+}
+
+std::vector<GetNextTestCase<CSVDatasetParams>> GetNextTestCases() {
+  return {
+      {/*dataset_params=*/CSVDatasetParams1(),
+       /*expected_outputs=*/UnquotedOutputs()},
+      {/*dataset_params=*/CSVDatasetParams2(),
+       /*expected_outputs=*/UnquotedOutputs()},
+      {/*dataset_params=*/CSVDatasetParams3(),
+       /*expected_outputs=*/
+       CreateTensors<tstring>(
+           TensorShape({}),
+           {{absl::StrCat(string(15, 'a'), "\"", string(16, 'b'))},
+            {string(16, 'c')},
+            {absl::StrCat(string(14, 'd'), ",\n\r")},
+            {string(40, 'e')}})},
+      {/*dataset_params=*/CSVDatasetParams4(),
+       /*expected_outputs=*/
+       CreateTensors<tstring>(
+           TensorShape({}),
+           {{absl::StrCat(string(16, 'a'), "\"", string(15, 'b'))},
+            {string(20, '"')}})}};
+}
+
+ITERATOR_GET_NEXT_TEST_P(CSVDatasetOpTest, CSVDatasetParams,
+                         GetNextTestCases())
+
+TEST_F(CSVDatasetOpTest, QuoteInUnquotedField) {
+  auto dataset_params = CSVDatasetParams(
+      WriteTestFile("csv_quote_in_unquoted_field",
+                    absl::StrCat(string(16, 'a'), "\"b,c\n")),
+      /*num_fields=*/2, /*buffer_size=*/1024, /*use_quote_delim=*/true,
+      /*node_name=*/kNodeName);
+  TF_ASSERT_OK(Initialize(dataset_params));
+  bool end_of_sequence = false;
+  std::vector<Tensor> out_tensors;
+  EXPECT_EQ(
+      iterator_->GetNext(iterator_ctx_.get(), &out_tensors, &end_of_sequence)
+          .code(),
+      tensorflow::error::INVALID_ARGUMENT);
+}
+
+}  // namespace
+}  // namespace experimental
+}  // namespace data
+}  // namespace tensorflow
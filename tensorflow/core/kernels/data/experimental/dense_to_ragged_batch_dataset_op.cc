@@ -0,0 +1,355 @@
+/* Copyright 2019 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#include <algorithm>
+
+#include "tensorflow/core/framework/dataset.h"
+#include "tensorflow/core/framework/partial_tensor_shape.h"
+#include "tensorflow/core/framework/register_types.h"
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/framework/variant.h"
+#include "tensorflow/core/util/batch_util.h"
+
+namespace tensorflow {
+namespace data {
+namespace experimental {
+namespace {
+
+// Returns true if the elements of a component of dtype `dtype` and shape
+// `shape` are batched into a ragged tensor. The other components (scalars,
+// and the variant encodings of ragged and sparse tensors) are stacked.
+bool IsRaggedComponent(DataType dtype, const PartialTensorShape& shape) {
+  return dtype != DT_VARIANT && shape.dims() != 0;
+}
+
+// Copies the values of `element` to `values`, starting at its `offset`-th
+// value.
+Status CopyValues(const Tensor& element, int64 offset, Tensor* values) {
+#define HANDLE_TYPE(T)                                                 \
+  case DataTypeToEnum<T>::value: {                                     \
+    const T* src = element.flat<T>().data();                           \
+    std::copy(src, src + element.NumElements(),                        \
+              values->flat<T>().data() + offset);                      \
+    return Status::OK();                                               \
+  }
+
+  switch (element.dtype()) {
+    TF_CALL_DATASET_TYPES(HANDLE_TYPE);
+#undef HANDLE_TYPE
+    default:
+      return errors::Unimplemented(
+          "DenseToRaggedBatchDataset unhandled data type: ", element.dtype());
+  }
+}
+
+class DenseToRaggedBatchDatasetOp : public UnaryDatasetOpKernel {
+ public:
+  explicit DenseToRaggedBatchDatasetOp(OpKernelConstruction* ctx)
+      : UnaryDatasetOpKernel(ctx) {
+    OP_REQUIRES_OK(ctx, ctx->GetAttr("row_splits_dtype", &row_splits_dtype_));
+    OP_REQUIRES_OK(ctx, ctx->GetAttr("output_types", &output_types_));
+    OP_REQUIRES_OK(ctx, ctx->GetAttr("output_shapes", &output_shapes_));
+  }
+
+  void MakeDataset(OpKernelContext* ctx, DatasetBase* input,
+                   DatasetBase** output) override {
+    int64 batch_size;
+    OP_REQUIRES_OK(ctx,
+                   ParseScalarArgument<int64>(ctx, "batch_size", &batch_size));
+    OP_REQUIRES(
+        ctx, batch_size > 0,
+        errors::InvalidArgument("Batch size must be greater than zero."));
+    bool drop_remainder;
+    OP_REQUIRES_OK(
+        ctx, ParseScalarArgument<bool>(ctx, "drop_remainder", &drop_remainder));
+
+    const DataTypeVector& input_types = input->output_dtypes();
+    OP_REQUIRES(ctx, output_types_.size() == input_types.size(),
+                errors::InvalidArgument(
+                    "DenseToRaggedBatchDataset expects ", input_types.size(),
+                    " output types, got ", output_types_.size(), "."));
+    std::vector<bool> ragged(input_types.size());
+    for (size_t i = 0; i < input_types.size(); ++i) {
+      ragged[i] =
+          IsRaggedComponent(input_types[i], input->output_shapes()[i]);
+      const DataType expected = ragged[i] ? DT_VARIANT : input_types[i];
+      OP_REQUIRES(ctx, output_types_[i] == expected,
+                  errors::InvalidArgument(
+                      "Component ", i, " of DenseToRaggedBatchDataset has "
+                      "type ", DataTypeString(output_types_[i]),
+                      ", expected ", DataTypeString(expected), "."));
+    }
+
+    *output = new Dataset(ctx, batch_size, drop_remainder, row_splits_dtype_,
+                          std::move(ragged), output_types_, output_shapes_,
+                          input);
+  }
+
+ private:
+  class Dataset : public DatasetBase {
+   public:
+    Dataset(OpKernelContext* ctx, int64 batch_size, bool drop_remainder,
+            DataType row_splits_dtype, std::vector<bool> ragged,
+            const DataTypeVector& output_types,
+            const std::vector<PartialTensorShape>& output_shapes,
+            const DatasetBase* input)
+        : DatasetBase(DatasetContext(ctx)),
+          batch_size_(batch_size),
+          drop_remainder_(drop_remainder),
+          row_splits_dtype_(row_splits_dtype),
+          ragged_(std::move(ragged)),
+          output_types_(output_types),
+          output_shapes_(output_shapes),
+          input_(input) {
+      input_->Ref();
+    }
+
+    ~Dataset() override { input_->Unref(); }
+
+    std::unique_ptr<IteratorBase> MakeIteratorInternal(
+        const string& prefix) const override {
+      return absl::make_unique<Iterator>(Iterator::Params{
+          this, strings::StrCat(prefix, "::DenseToRaggedBatch")});
+    }
+
+    const DataTypeVector& output_dtypes() const override {
+      return output_types_;
+    }
+
+    const std::vector<PartialTensorShape>& output_shapes() const override {
+      return output_shapes_;
+    }
+
+    string DebugString() const override {
+      return strings::StrCat("DenseToRaggedBatchDatasetOp(", batch_size_,
+                             ")::Dataset");
+    }
+
+    int64 Cardinality() const override {
+      int64 n = input_->Cardinality();
+      if (n == kInfiniteCardinality || n == kUnknownCardinality) {
+        return n;
+      }
+      return n / batch_size_ +
+             (n % batch_size_ == 0 || drop_remainder_ ? 0 : 1);
+    }
+
+    Status CheckExternalState() const override {
+      return input_->CheckExternalState();
+    }
+
+   protected:
+    Status AsGraphDefInternal(SerializationContext* ctx,
+                              DatasetGraphDefBuilder* b,
+                              Node** output) const override {
+      Node* input_node;
+      TF_RETURN_IF_ERROR(b->AddInputDataset(ctx, input_, &input_node));
+      Node* batch_size_node;
+      TF_RETURN_IF_ERROR(b->AddScalar(batch_size_, &batch_size_node));
+      Node* drop_remainder_node;
+      TF_RETURN_IF_ERROR(b->AddScalar(drop_remainder_, &drop_remainder_node));
+      AttrValue row_splits_dtype;
+      b->BuildAttrValue(row_splits_dtype_, &row_splits_dtype);
+      TF_RETURN_IF_ERROR(b->AddDataset(
+          this, {input_node, batch_size_node, drop_remainder_node},
+          {{"row_splits_dtype", row_splits_dtype}}, output));
+      return Status::OK();
+    }
+
+   private:
+    class Iterator : public DatasetIterator<Dataset> {
+     public:
+      explicit Iterator(const Params& params)
+          : DatasetIterator<Dataset>(params) {}
+
+      Status Initialize(IteratorContext* ctx) override {
+        return dataset()->input_->MakeIterator(ctx, prefix(), &input_impl_);
+      }
+
+      Status GetNextInternal(IteratorContext* ctx,
+                             std::vector<Tensor>* out_tensors,
+                             bool* end_of_sequence) override {
+        std::vector<std::vector<Tensor>> batch_elements;
+        batch_elements.reserve(dataset()->batch_size_);
+        {
+          mutex_lock l(mu_);
+          *end_of_sequence = false;
+          for (int64 i = 0; i < dataset()->batch_size_ && !*end_of_sequence;
+               ++i) {
+            std::vector<Tensor> batch_element_tuple;
+            TF_RETURN_IF_ERROR(input_impl_->GetNext(ctx, &batch_element_tuple,
+                                                    end_of_sequence));
+            if (!*end_of_sequence) {
+              batch_elements.push_back(std::move(batch_element_tuple));
+            }
+          }
+        }
+
+        if (batch_elements.empty() ||
+            (dataset()->drop_remainder_ &&
+             batch_elements.size() < dataset()->batch_size_)) {
+          *end_of_sequence = true;
+          return Status::OK();
+        }
+
+        out_tensors->reserve(dataset()->ragged_.size());
+        for (size_t component = 0; component < dataset()->ragged_.size();
+             ++component) {
+          out_tensors->emplace_back();
+          if (dataset()->ragged_[component]) {
+            TF_RETURN_IF_ERROR(BatchRagged(ctx, &batch_elements, component,
+                                           &out_tensors->back()));
+          } else {
+            TF_RETURN_IF_ERROR(BatchStacked(ctx, &batch_elements, component,
+                                            &out_tensors->back()));
+          }
+        }
+        *end_of_sequence = false;
+        return Status::OK();
+      }
+
+     protected:
+      std::shared_ptr<model::Node> CreateNode(
+          IteratorContext* ctx, model::Node::Args args) const override {
+        return model::MakeKnownRatioNode(std::move(args),
+                                         dataset()->batch_size_);
+      }
+
+      Status SaveInternal(IteratorStateWriter* writer) override {
+        mutex_lock l(mu_);
+        TF_RETURN_IF_ERROR(SaveInput(writer, input_impl_));
+        return Status::OK();
+      }
+
+      Status RestoreInternal(IteratorContext* ctx,
+                             IteratorStateReader* reader) override {
+        mutex_lock l(mu_);
+        TF_RETURN_IF_ERROR(RestoreInput(ctx, reader, input_impl_));
+        return Status::OK();
+      }
+
+     private:
+      // Concatenates the `component`-th tensors of `batch_elements` in their
+      // 0th dimension and encodes them, with the row splits that delimit
+      // them, like a ragged tensor of ragged rank 1 that
+      // `RaggedTensorToVariant` encodes.
+      Status BatchRagged(IteratorContext* ctx,
+                         std::vector<std::vector<Tensor>>* batch_elements,
+                         size_t component, Tensor* out) {
+        const Tensor& first = (*batch_elements)[0][component];
+        if (first.dims() == 0) {
+          return errors::InvalidArgument(
+              "Cannot batch scalars in component ", component,
+              " into a ragged tensor.");
+        }
+        TensorShape values_shape = first.shape();
+        int64 num_rows = 0;
+        for (const auto& batch_element : *batch_elements) {
+          const Tensor& element = batch_element[component];
+          values_shape.set_dim(0, element.dim_size(0));
+          if (element.shape() != values_shape) {
+            return errors::InvalidArgument(
+                "Cannot batch tensors of shapes ", first.shape().DebugString(),
+                " and ", element.shape().DebugString(), " in component ",
+                component, " into a ragged tensor: their inner dimensions "
+                "differ.");
+          }
+          num_rows += element.dim_size(0);
+        }
+        values_shape.set_dim(0, num_rows);
+
+        Tensor values(ctx->allocator({}), first.dtype(), values_shape);
+        Tensor row_splits(ctx->allocator({}), dataset()->row_splits_dtype_,
+                          {static_cast<int64>(batch_elements->size()) + 1});
+        const int64 row_size = num_rows > 0 ? values.NumElements() / num_rows
+                                            : 0;
+        int64 row = 0;
+        for (size_t i = 0; i < batch_elements->size(); ++i) {
+          if (dataset()->row_splits_dtype_ == DT_INT32) {
+            row_splits.vec<int32>()(i) = static_cast<int32>(row);
+          } else {
+            row_splits.vec<int64>()(i) = row;
+          }
+          Tensor element = std::move((*batch_elements)[i][component]);
+          TF_RETURN_IF_ERROR(CopyValues(element, row * row_size, &values));
+          row += element.dim_size(0);
+        }
+        if (dataset()->row_splits_dtype_ == DT_INT32) {
+          row_splits.vec<int32>()(batch_elements->size()) =
+              static_cast<int32>(row);
+        } else {
+          row_splits.vec<int64>()(batch_elements->size()) = row;
+        }
+
+        Tensor encoded(DT_VARIANT, TensorShape({2}));
+        encoded.vec<Variant>()(0) = std::move(row_splits);
+        encoded.vec<Variant>()(1) = std::move(values);
+        *out = Tensor(DT_VARIANT, TensorShape({}));
+        out->scalar<Variant>()() = std::move(encoded);
+        return Status::OK();
+      }
+
+      // Stacks the `component`-th tensors of `batch_elements`, which must
+      // have the same shape.
+      Status BatchStacked(IteratorContext* ctx,
+                          std::vector<std::vector<Tensor>>* batch_elements,
+                          size_t component, Tensor* out) {
+        const TensorShape element_shape =
+            (*batch_elements)[0][component].shape();
+        TensorShape batch_shape(
+            {static_cast<int64>(batch_elements->size())});
+        batch_shape.AppendShape(element_shape);
+        *out = Tensor(ctx->allocator({}),
+                      (*batch_elements)[0][component].dtype(), batch_shape);
+        for (size_t i = 0; i < batch_elements->size(); ++i) {
+          Tensor& element = (*batch_elements)[i][component];
+          if (element.shape() != element_shape) {
+            return errors::InvalidArgument(
+                "Cannot batch tensors with different shapes in component ",
+                component, ". First element had shape ",
+                element_shape.DebugString(), " and element ", i,
+                " had shape ", element.shape().DebugString(), ".");
+          }
+          TF_RETURN_IF_ERROR(
+              batch_util::CopyElementToSlice(std::move(element), out, i));
+        }
+        return Status::OK();
+      }
+
+      mutex mu_;
+      std::unique_ptr<IteratorBase> input_impl_ GUARDED_BY(mu_);
+    };
+
+    const int64 batch_size_;
+    const bool drop_remainder_;
+    const DataType row_splits_dtype_;
+    // Whether each component is batched into a ragged tensor.
+    const std::vector<bool> ragged_;
+    const DataTypeVector output_types_;
+    const std::vector<PartialTensorShape> output_shapes_;
+    const DatasetBase* const input_;
+  };
+
+  DataType row_splits_dtype_;
+  DataTypeVector output_types_;
+  std::vector<PartialTensorShape> output_shapes_;
+};
+
+REGISTER_KERNEL_BUILDER(Name("DenseToRaggedBatchDataset").Device(DEVICE_CPU),
+                        DenseToRaggedBatchDatasetOp);
+
+}  // namespace
+}  // namespace experimental
+}  // namespace data
+}  // namespace tensorflow
@@ -12,6 +12,8 @@ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
 See the License for the specific language governing permissions and
 limitations under the License.
 ==============================================================================*/
+#include <algorithm>
+
 #include "tensorflow/core/framework/dataset.h"
 #include "tensorflow/core/framework/partial_tensor_shape.h"
 #include "tensorflow/core/framework/tensor.h"
@@ -192,7 +194,6 @@ class DenseToSparseBatchDatasetOp : public UnaryDatasetOpKernel {
                                                     end_of_sequence));
             if (!*end_of_sequence) {
               DCHECK_EQ(1, batch_element_tuple.size());
-              batch_elements.push_back(std::move(batch_element_tuple[0]));
               total_elements += batch_element_tuple[0].NumElements();
 
               // TODO(mrry): Investigate how to hoist this check when we
@@ -219,6 +220,7 @@ class DenseToSparseBatchDatasetOp : public UnaryDatasetOpKernel {
                       row_shape.DebugString(), ").");
                 }
               }
+              batch_elements.push_back(std::move(batch_element_tuple[0]));
             }
           }
         }
@@ -239,30 +241,27 @@ class DenseToSparseBatchDatasetOp : public UnaryDatasetOpKernel {
         auto indices_matrix = indices.matrix<int64>();
         auto values_flat = values.flat<T>();
 
+        T* values_data = values_flat.data();
         int64 current_position_in_values = 0;
+        gtl::InlinedVector<int64, 4> index(row_ndims);
         for (int64 i = 0; i < batch_elements.size(); ++i) {
           const Tensor& t = batch_elements[i];
-          const auto& t_flat = t.flat<T>();
-          // TODO(mrry): Replace with a memcpy or something more
-          // efficient. (Maybe an Eigen assign op?)
-          gtl::InlinedVector<int64, 4> strides(row_ndims);
-          if (!strides.empty()) {
-            strides[row_ndims - 1] = 1;
-            for (int64_t row_dim = strides.size() - 2; row_dim >= 0;
-                 --row_dim) {
-              strides[row_dim] =
-                  strides[row_dim + 1] * t.shape().dim_size(row_dim + 1);
-            }
-          }
-
-          for (int64 j = 0; j < t.NumElements(); ++j) {
-            values_flat(current_position_in_values) = t_flat(j);
-            indices_matrix(current_position_in_values, 0) = i;
-            int64 index = j;
-            for (size_t k = 0; k < strides.size(); ++k) {
-              indices_matrix(current_position_in_values, k + 1) =
-                  index / strides[k];
-              index %= strides[k];
+          const int64 num_elements = t.NumElements();
+          const T* t_data = t.flat<T>().data();
+          std::copy(t_data, t_data + num_elements,
+                    values_data + current_position_in_values);
+
+          // Enumerates the indices of `t` in row-major order, like an
+          // odometer, instead of dividing the flat position by the strides.
+          std::fill(index.begin(), index.end(), 0);
+          for (int64 j = 0; j < num_elements; ++j) {
+            int64* indices_row =
+                &indices_matrix(current_position_in_values, 0);
+            indices_row[0] = i;
+            std::copy(index.begin(), index.end(), indices_row + 1);
+            for (int k = row_ndims - 1; k >= 0; --k) {
+              if (++index[k] < t.dim_size(k)) break;
+              index[k] = 0;
             }
             ++current_position_in_values;
           }
@@ -0,0 +1,170 @@
+/* Copyright 2019 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#include <memory>
+#include <vector>
+
+#include "absl/memory/memory.h"
+#include "tensorflow/core/framework/dataset.h"
+#include "tensorflow/core/framework/op_kernel.h"
+#include "tensorflow/core/lib/strings/strcat.h"
+
+namespace tensorflow {
+namespace data {
+namespace experimental {
+namespace {
+
+constexpr char kIncrementalCheckpoints[] = "incremental_checkpoints";
+constexpr char kMapElementBatching[] = "map_element_batching";
+
+// Sets options of the `IteratorContext` of the iterators of its input, which
+// control how those iterators work without changing the elements that they
+// produce.
+class IteratorOptionsDatasetOp : public UnaryDatasetOpKernel {
+ public:
+  explicit IteratorOptionsDatasetOp(OpKernelConstruction* ctx)
+      : UnaryDatasetOpKernel(ctx) {
+    OP_REQUIRES_OK(
+        ctx, ctx->GetAttr(kIncrementalCheckpoints, &incremental_checkpoints_));
+    OP_REQUIRES_OK(ctx,
+                   ctx->GetAttr(kMapElementBatching, &map_element_batching_));
+  }
+
+  void MakeDataset(OpKernelContext* ctx, DatasetBase* input,
+                   DatasetBase** output) override {
+    *output = new Dataset(ctx, input, incremental_checkpoints_,
+                          map_element_batching_);
+  }
+
+ private:
+  class Dataset : public DatasetBase {
+   public:
+    Dataset(OpKernelContext* ctx, const DatasetBase* input,
+            bool incremental_checkpoints, bool map_element_batching)
+        : DatasetBase(DatasetContext(ctx)),
+          input_(input),
+          incremental_checkpoints_(incremental_checkpoints),
+          map_element_batching_(map_element_batching) {
+      input_->Ref();
+    }
+
+    ~Dataset() override { input_->Unref(); }
+
+    std::unique_ptr<IteratorBase> MakeIteratorInternal(
+        const string& prefix) const override {
+      return absl::make_unique<Iterator>(
+          Iterator::Params{this, strings::StrCat(prefix, "::IteratorOptions")});
+    }
+
+    const DataTypeVector& output_dtypes() const override {
+      return input_->output_dtypes();
+    }
+    const std::vector<PartialTensorShape>& output_shapes() const override {
+      return input_->output_shapes();
+    }
+
+    string DebugString() const override {
+      return "IteratorOptionsDatasetOp::Dataset";
+    }
+
+    int64 Cardinality() const override { return input_->Cardinality(); }
+
+    Status CheckExternalState() const override {
+      return input_->CheckExternalState();
+    }
+
+   protected:
+    Status AsGraphDefInternal(SerializationContext* ctx,
+                              DatasetGraphDefBuilder* b,
+                              Node** output) const override {
+      Node* input_graph_node = nullptr;
+      TF_RETURN_IF_ERROR(b->AddInputDataset(ctx, input_, &input_graph_node));
+      AttrValue incremental_checkpoints_attr;
+      b->BuildAttrValue(incremental_checkpoints_,
+                        &incremental_checkpoints_attr);
+      AttrValue map_element_batching_attr;
+      b->BuildAttrValue(map_element_batching_, &map_element_batching_attr);
+      TF_RETURN_IF_ERROR(b->AddDataset(
+          this, {input_graph_node},
+          {std::make_pair(kIncrementalCheckpoints,
+                          incremental_checkpoints_attr),
+           std::make_pair(kMapElementBatching, map_element_batching_attr)},
+          output));
+      return Status::OK();
+    }
+
+   private:
+    class Iterator : public DatasetIterator<Dataset> {
+     public:
+      explicit Iterator(const Params& params)
+          : DatasetIterator<Dataset>(params) {}
+
+      Status Initialize(IteratorContext* ctx) override {
+        IteratorContext input_ctx(InputParams(ctx));
+        return dataset()->input_->MakeIterator(&input_ctx, prefix(),
+                                               &input_impl_);
+      }
+
+      Status GetNextInternal(IteratorContext* ctx,
+                             std::vector<Tensor>* out_tensors,
+                             bool* end_of_sequence) override {
+        return input_impl_->GetNext(IteratorContext(InputParams(ctx)),
+                                    out_tensors, end_of_sequence);
+      }
+
+     protected:
+      std::shared_ptr<model::Node> CreateNode(
+          IteratorContext* ctx, model::Node::Args args) const override {
+        return model::MakeKnownRatioNode(std::move(args),
+                                         /*ratio=*/1);
+      }
+
+      Status SaveInternal(IteratorStateWriter* writer) override {
+        return SaveInput(writer, input_impl_);
+      }
+
+      Status RestoreInternal(IteratorContext* ctx,
+                             IteratorStateReader* reader) override {
+        IteratorContext input_ctx(InputParams(ctx));
+        return RestoreInput(&input_ctx, reader, input_impl_);
+      }
+
+     private:
+      // Returns the parameters of `ctx` with the options of the dataset.
+      IteratorContext::Params InputParams(IteratorContext* ctx) const {
+        IteratorContext::Params params(ctx);
+        params.incremental_checkpoints = dataset()->incremental_checkpoints_;
+        params.map_element_batching = dataset()->map_element_batching_;
+        return params;
+      }
+
+      std::unique_ptr<IteratorBase> input_impl_;
+    };
+
+    const DatasetBase* const input_;
+    const bool incremental_checkpoints_;
+    const bool map_element_batching_;
+  };
+
+  bool incremental_checkpoints_;
+  bool map_element_batching_;
+};
+
+REGISTER_KERNEL_BUILDER(Name("IteratorOptionsDataset").Device(DEVICE_CPU),
+                        IteratorOptionsDatasetOp);
+
+}  // namespace
+}  // namespace experimental
+}  // namespace data
+}  // namespace tensorflow
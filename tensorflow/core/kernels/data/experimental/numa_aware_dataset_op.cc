@@ -0,0 +1,278 @@
+/* Copyright 2019 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <vector>
+
+#include "absl/memory/memory.h"
+#include "tensorflow/core/common_runtime/pool_allocator.h"
+#include "tensorflow/core/framework/dataset.h"
+#include "tensorflow/core/framework/op_kernel.h"
+#include "tensorflow/core/framework/thread_factory.h"
+#include "tensorflow/core/kernels/data/dataset_utils.h"
+#include "tensorflow/core/lib/core/threadpool.h"
+#include "tensorflow/core/lib/strings/strcat.h"
+#include "tensorflow/core/platform/cpu_info.h"
+#include "tensorflow/core/platform/mutex.h"
+#include "tensorflow/core/platform/numa.h"
+
+namespace tensorflow {
+namespace data {
+namespace experimental {
+namespace {
+
+// Returns an allocator of memory that is local to NUMA node `node`. The
+// allocators live as long as the process, because the tensors that they
+// allocate can outlive any dataset.
+Allocator* NumaLocalAllocator(int node) {
+  static mutex* mu = new mutex;
+  static std::vector<Allocator*>* allocators = new std::vector<Allocator*>;
+  mutex_lock l(*mu);
+  if (allocators->size() <= static_cast<size_t>(node)) {
+    allocators->resize(node + 1, nullptr);
+  }
+  Allocator*& allocator = (*allocators)[node];
+  if (allocator == nullptr) {
+    // Like the NUMA-aware allocators of `ProcessState`, pools the buffers of
+    // `port::NUMAMalloc()`, which is too slow to call for every allocation.
+    allocator = new PoolAllocator(
+        /*pool_size_limit=*/100, /*auto_resize=*/true,
+        new BasicCPUAllocator(node, {}, {}), new NoopRounder,
+        strings::StrCat("data_numa_pool_", node));
+  }
+  return allocator;
+}
+
+// Starts the threads of another `ThreadFactory` (or of the default `Env`)
+// with affinity to a NUMA node. The affinity is removed when the thread
+// function returns, because the physical thread may be reused.
+class NumaThreadFactory : public ThreadFactory {
+ public:
+  NumaThreadFactory(std::shared_ptr<ThreadFactory> wrapped, int node)
+      : wrapped_(std::move(wrapped)), node_(node) {}
+
+  std::unique_ptr<Thread> StartThread(const string& name,
+                                      std::function<void()> fn) override {
+    const int node = node_;
+    std::function<void()> pinned_fn = [node, fn = std::move(fn)]() {
+      port::NUMASetThreadNodeAffinity(node);
+      fn();
+      port::NUMASetThreadNodeAffinity(port::kNUMANoAffinity);
+    };
+    if (wrapped_) {
+      return wrapped_->StartThread(name, std::move(pinned_fn));
+    }
+    return absl::WrapUnique(
+        Env::Default()->StartThread({}, name, std::move(pinned_fn)));
+  }
+
+ private:
+  const std::shared_ptr<ThreadFactory> wrapped_;
+  const int node_;
+};
+
+class NumaAwareDatasetOp : public UnaryDatasetOpKernel {
+ public:
+  explicit NumaAwareDatasetOp(OpKernelConstruction* ctx)
+      : UnaryDatasetOpKernel(ctx) {}
+
+  void MakeDataset(OpKernelContext* ctx, DatasetBase* input,
+                   DatasetBase** output) override {
+    int64 num_threads_per_node = 0;
+    OP_REQUIRES_OK(ctx, ParseScalarArgument<int64>(ctx, "num_threads_per_node",
+                                                   &num_threads_per_node));
+    OP_REQUIRES(
+        ctx, num_threads_per_node >= 0,
+        errors::InvalidArgument("`num_threads_per_node` must be >= 0"));
+    *output = new Dataset(ctx, input, num_threads_per_node);
+  }
+
+ private:
+  class Dataset : public DatasetBase {
+   public:
+    Dataset(OpKernelContext* ctx, const DatasetBase* input,
+            int64 num_threads_per_node)
+        : DatasetBase(DatasetContext(ctx)),
+          input_(input),
+          num_threads_per_node_(num_threads_per_node),
+          num_nodes_(port::NUMAEnabled() ? port::NUMANumNodes() : 1) {
+      input_->Ref();
+      if (num_nodes_ > 1) {
+        for (int node = 0; node < num_nodes_; ++node) {
+          const int num_threads =
+              num_threads_per_node_ > 0
+                  ? num_threads_per_node_
+                  : std::max(1, port::MaxParallelism(node));
+          ThreadOptions thread_options;
+          thread_options.numa_node = node;
+          thread_pools_.push_back(absl::make_unique<thread::ThreadPool>(
+              ctx->env(), thread_options,
+              strings::StrCat("data_numa_threadpool_", node), num_threads,
+              /*low_latency_hint=*/false));
+        }
+      }
+    }
+
+    ~Dataset() override { input_->Unref(); }
+
+    std::unique_ptr<IteratorBase> MakeIteratorInternal(
+        const string& prefix) const override {
+      return absl::make_unique<Iterator>(
+          Iterator::Params{this, strings::StrCat(prefix, "::NumaAware")});
+    }
+
+    const DataTypeVector& output_dtypes() const override {
+      return input_->output_dtypes();
+    }
+    const std::vector<PartialTensorShape>& output_shapes() const override {
+      return input_->output_shapes();
+    }
+
+    string DebugString() const override {
+      return "NumaAwareDatasetOp::Dataset";
+    }
+
+    int64 Cardinality() const override { return input_->Cardinality(); }
+
+    Status CheckExternalState() const override {
+      return input_->CheckExternalState();
+    }
+
+   protected:
+    Status AsGraphDefInternal(SerializationContext* ctx,
+                              DatasetGraphDefBuilder* b,
+                              Node** output) const override {
+      Node* input_graph_node = nullptr;
+      TF_RETURN_IF_ERROR(b->AddInputDataset(ctx, input_, &input_graph_node));
+      Node* num_threads_per_node = nullptr;
+      TF_RETURN_IF_ERROR(
+          b->AddScalar(num_threads_per_node_, &num_threads_per_node));
+      TF_RETURN_IF_ERROR(b->AddDataset(
+          this, {input_graph_node, num_threads_per_node}, output));
+      return Status::OK();
+    }
+
+   private:
+    class Iterator : public DatasetIterator<Dataset> {
+     public:
+      explicit Iterator(const Params& params)
+          : DatasetIterator<Dataset>(params) {}
+
+      Status Initialize(IteratorContext* ctx) override {
+        if (dataset()->num_nodes_ > 1) {
+          // Keeps the iterators of a thread that has affinity to a node on
+          // that node, and spreads the other iterators over the nodes.
+          node_ = port::NUMAGetThreadNodeAffinity();
+          if (node_ < 0 || node_ >= dataset()->num_nodes_) {
+            node_ = dataset()->next_node_.fetch_add(1) % dataset()->num_nodes_;
+          }
+          thread_factory_ =
+              std::make_shared<NumaThreadFactory>(ctx->thread_factory(), node_);
+          pool_ = dataset()->thread_pools_[node_].get();
+          thread::ThreadPool* pool = pool_;
+          runner_ = [pool](std::function<void()> c) {
+            pool->Schedule(std::move(c));
+          };
+          // Only the allocations that any host memory satisfies are moved to
+          // the node, e.g. not the ones that must be GPU-compatible.
+          Allocator* allocator = NumaLocalAllocator(node_);
+          allocator_getter_ = [allocator, getter = ctx->allocator_getter()](
+                                  AllocatorAttributes attrs) {
+            AllocatorAttributes host_attrs;
+            host_attrs.set_on_host(true);
+            if (getter != nullptr &&
+                (attrs.scope_id != 0 ||
+                 !attrs.IsEqualOrLessRestrictiveThan(host_attrs))) {
+              return getter(attrs);
+            }
+            return allocator;
+          };
+          VLOG(2) << "Pinning " << prefix() << " to NUMA node " << node_;
+        }
+        IteratorContext pinned_ctx(PinnedParams(ctx));
+        return dataset()->input_->MakeIterator(&pinned_ctx, prefix(),
+                                               &input_impl_);
+      }
+
+      Status GetNextInternal(IteratorContext* ctx,
+                             std::vector<Tensor>* out_tensors,
+                             bool* end_of_sequence) override {
+        return input_impl_->GetNext(IteratorContext(PinnedParams(ctx)),
+                                    out_tensors, end_of_sequence);
+      }
+
+     protected:
+      std::shared_ptr<model::Node> CreateNode(
+          IteratorContext* ctx, model::Node::Args args) const override {
+        return model::MakeKnownRatioNode(std::move(args),
+                                         /*ratio=*/1);
+      }
+
+      Status SaveInternal(IteratorStateWriter* writer) override {
+        return SaveInput(writer, input_impl_);
+      }
+
+      Status RestoreInternal(IteratorContext* ctx,
+                             IteratorStateReader* reader) override {
+        IteratorContext pinned_ctx(PinnedParams(ctx));
+        return RestoreInput(&pinned_ctx, reader, input_impl_);
+      }
+
+     private:
+      // Returns the parameters of `ctx` with the runner, threads and
+      // allocations of the input moved to the node of this iterator.
+      IteratorContext::Params PinnedParams(IteratorContext* ctx) const {
+        IteratorContext::Params params(ctx);
+        if (node_ == port::kNUMANoAffinity) {
+          return params;
+        }
+        params.runner = runner_;
+        params.runner_threadpool_size = pool_->NumThreads();
+        params.thread_factory = thread_factory_;
+        params.allocator_getter = allocator_getter_;
+        return params;
+      }
+
+      int node_ = port::kNUMANoAffinity;
+      // The runner and allocator getter of the input on `node_`, built once
+      // in `Initialize()` rather than on every call to `GetNext()`.
+      thread::ThreadPool* pool_ = nullptr;  // Owned by the dataset.
+      std::function<void(std::function<void()>)> runner_;
+      std::function<Allocator*(AllocatorAttributes)> allocator_getter_;
+      // Declared before `input_impl_`, so that it outlives the threads that
+      // the input starts.
+      std::shared_ptr<ThreadFactory> thread_factory_;
+      std::unique_ptr<IteratorBase> input_impl_;
+    };
+
+    const DatasetBase* const input_;
+    const int64 num_threads_per_node_;
+    const int num_nodes_;
+    // The thread pools whose threads have affinity to each node. Empty if
+    // the host has a single node (or NUMA is not supported), in which case
+    // the dataset forwards its input unchanged.
+    std::vector<std::unique_ptr<thread::ThreadPool>> thread_pools_;
+    mutable std::atomic<int64> next_node_{0};
+  };
+};
+
+REGISTER_KERNEL_BUILDER(Name("NumaAwareDataset").Device(DEVICE_CPU),
+                        NumaAwareDatasetOp);
+
+}  // namespace
+}  // namespace experimental
+}  // namespace data
+}  // namespace tensorflow
@@ -161,9 +161,12 @@ class ParseExampleDatasetOp : public UnaryDatasetOpKernel {
          it++) {
       it->second = i++;
     }
+    std::unique_ptr<example::CompiledExampleParser> parser;
+    OP_REQUIRES_OK(ctx, example::CompiledExampleParser::Create(
+                            std::move(config), &parser));
 
     *output = new Dataset(ctx, input, dense_defaults, sparse_keys_, dense_keys_,
-                          std::move(key_to_output_index), std::move(config),
+                          std::move(key_to_output_index), std::move(parser),
                           num_parallel_calls, sparse_types_, dense_types_,
                           dense_shapes_, output_types_, output_shapes_, sloppy_,
                           has_ragged_keys_, ragged_keys_, ragged_value_types_,
@@ -177,7 +180,8 @@ class ParseExampleDatasetOp : public UnaryDatasetOpKernel {
             std::vector<Tensor> dense_defaults, std::vector<string> sparse_keys,
             std::vector<string> dense_keys,
             std::map<string, int> key_to_output_index,
-            example::FastParseExampleConfig config, int32 num_parallel_calls,
+            std::unique_ptr<const example::CompiledExampleParser> parser,
+            int32 num_parallel_calls,
             const DataTypeVector& sparse_types,
             const DataTypeVector& dense_types,
             const std::vector<PartialTensorShape>& dense_shapes,
@@ -193,7 +197,7 @@ class ParseExampleDatasetOp : public UnaryDatasetOpKernel {
           dense_keys_(std::move(dense_keys)),
           ragged_keys_(std::move(ragged_keys)),
           key_to_output_index_(std::move(key_to_output_index)),
-          config_(std::move(config)),
+          parser_(std::move(parser)),
           num_parallel_calls_(num_parallel_calls),
           sparse_types_(sparse_types),
           dense_types_(dense_types),
@@ -334,15 +338,12 @@ class ParseExampleDatasetOp : public UnaryDatasetOpKernel {
             for (auto it = slice.begin(); it != slice.end(); it++)
               slice_vec.push_back(*it);
           }
-          example::FastParseExampleConfig config = dataset_->config_;
-          // local copy of config_ for modification.
           auto stats_aggregator = ctx->stats_aggregator();
-          if (stats_aggregator) {
-            config.collect_feature_stats = true;
-          }
           example::Result example_result;
-          Status s = FastParseExample(config, slice_vec, {}, device_threadpool,
-                                      &example_result);
+          Status s = dataset_->parser_->Parse(
+              slice_vec, {},
+              /*collect_feature_stats=*/stats_aggregator != nullptr,
+              device_threadpool, &example_result);
           if (s.ok()) {
             (*output).resize(dataset_->key_to_output_index_.size());
             for (int d = 0; d < dataset_->dense_keys_.size(); ++d) {
@@ -434,7 +435,8 @@ class ParseExampleDatasetOp : public UnaryDatasetOpKernel {
     const std::vector<string> dense_keys_;
     const std::vector<string> ragged_keys_;
     const std::map<string, int> key_to_output_index_;
-    const example::FastParseExampleConfig config_;
+    // Built once from the config of the dataset and shared by its iterators.
+    const std::unique_ptr<const example::CompiledExampleParser> parser_;
     const int64 num_parallel_calls_;
     const DataTypeVector sparse_types_;
     const DataTypeVector dense_types_;
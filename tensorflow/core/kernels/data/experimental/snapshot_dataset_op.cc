@@ -12,6 +12,7 @@ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
 See the License for the specific language governing permissions and
 limitations under the License.
 ==============================================================================*/
+#include <algorithm>
 #include <random>
 
 #include "absl/time/clock.h"
@@ -22,6 +23,8 @@ limitations under the License.
 #include "tensorflow/core/framework/tensor.pb.h"  // NOLINT
 #include "tensorflow/core/grappler/graph_view.h"
 #include "tensorflow/core/kernels/data/dataset_utils.h"
+#include "tensorflow/core/kernels/data/experimental/snapshot_util.h"
+#include "tensorflow/core/kernels/data/rewrite_utils.h"
 #include "tensorflow/core/lib/core/coding.h"
 #include "tensorflow/core/lib/core/errors.h"
 #include "tensorflow/core/lib/core/raw_coding.h"
@@ -259,6 +262,76 @@ Status ReadMetadataFile(const string& hash_dir,
   return Status::OK();
 }
 
+// Records that the snapshot in `hash_dir` was read from, so that it is evicted
+// after the snapshots that were not read from since.
+Status RecordSnapshotAccess(const string& hash_dir,
+                            experimental::SnapshotMetadataRecord metadata) {
+  metadata.set_last_access_timestamp(Env::Default()->NowMicros());
+  return WriteMetadataFile(hash_dir, metadata);
+}
+
+// Computes the total size of the files of a snapshot run.
+Status SnapshotRunSize(const string& run_dir, int64* num_bytes) {
+  std::vector<string> filenames;
+  TF_RETURN_IF_ERROR(Env::Default()->GetMatchingPaths(
+      absl::StrCat(run_dir, "/*"), &filenames));
+  *num_bytes = 0;
+  for (const auto& filename : filenames) {
+    uint64 file_size;
+    TF_RETURN_IF_ERROR(Env::Default()->GetFileSize(filename, &file_size));
+    *num_bytes += file_size;
+  }
+  return Status::OK();
+}
+
+// Deletes the least recently used snapshots in `dir` until the total size of
+// the snapshots is at most `max_store_size_bytes`. Snapshots that are being
+// written, the snapshot in `current_hash_dir` and the snapshots that they read
+// a prefix of their input from are never deleted.
+Status EvictSnapshots(const string& dir, const string& writer_path_prefix,
+                      const string& current_hash_dir,
+                      int64 max_store_size_bytes) {
+  std::vector<string> children;
+  TF_RETURN_IF_ERROR(Env::Default()->GetChildren(dir, &children));
+  std::vector<SnapshotStoreEntry> entries;
+  for (const auto& child : children) {
+    const string hash_dir = absl::StrCat(dir, "/", child);
+    experimental::SnapshotMetadataRecord metadata;
+    if (!ReadMetadataFile(hash_dir, &metadata).ok()) {
+      continue;
+    }
+    SnapshotStoreEntry entry;
+    entry.hash_dir = hash_dir;
+    entry.num_bytes = metadata.num_bytes();
+    entry.last_access_micros = std::max(metadata.last_access_timestamp(),
+                                        metadata.creation_timestamp());
+    entry.pinned = !metadata.finalized() || hash_dir == current_hash_dir;
+    for (const auto& input_hash : metadata.input_snapshot_hashes()) {
+      entry.input_hash_dirs.push_back(absl::StrCat(dir, "/", input_hash));
+    }
+    entries.push_back(std::move(entry));
+  }
+
+  for (const auto& hash_dir :
+       SelectSnapshotsToEvict(std::move(entries), max_store_size_bytes)) {
+    LOG(INFO) << "Evicting snapshot " << hash_dir
+              << " to limit the size of the snapshots in " << dir << " to "
+              << max_store_size_bytes << " bytes.";
+    // Deleting the metadata file first prevents new readers of the snapshot.
+    TF_RETURN_IF_ERROR(Env::Default()->DeleteFile(
+        absl::StrCat(hash_dir, "/", kSnapshotFilename)));
+    int64 undeleted_files, undeleted_dirs;
+    TF_RETURN_IF_ERROR(Env::Default()->DeleteRecursively(
+        hash_dir, &undeleted_files, &undeleted_dirs));
+    if (!writer_path_prefix.empty()) {
+      TF_RETURN_IF_ERROR(Env::Default()->DeleteRecursively(
+          absl::StrCat(writer_path_prefix, hash_dir), &undeleted_files,
+          &undeleted_dirs));
+    }
+  }
+  return Status::OK();
+}
+
 Status DetermineOpState(const Status& file_status,
                         const experimental::SnapshotMetadataRecord& metadata,
                         const uint64 pending_snapshot_expiry_seconds,
@@ -319,6 +392,8 @@ class SnapshotDatasetOp : public UnaryDatasetOpKernel {
     OP_REQUIRES_OK(ctx, ctx->GetAttr("shuffle_on_read", &shuffle_on_read_));
     OP_REQUIRES_OK(ctx, ctx->GetAttr("seed", &seed_));
     OP_REQUIRES_OK(ctx, ctx->GetAttr("seed2", &seed2_));
+    OP_REQUIRES_OK(
+        ctx, ctx->GetAttr("max_store_size_bytes", &max_store_size_bytes_));
 
     if (shard_size_bytes_ == -1) shard_size_bytes_ = kDefaultShardSizeBytes;
 
@@ -331,6 +406,7 @@ class SnapshotDatasetOp : public UnaryDatasetOpKernel {
     if (reader_buffer_size_ == -1) reader_buffer_size_ = 1;
     if (num_writer_threads_ == -1) num_writer_threads_ = 1;
     if (writer_buffer_size_ == -1) writer_buffer_size_ = 1;
+    if (max_store_size_bytes_ == -1) max_store_size_bytes_ = 0;
 
     OP_REQUIRES(
         ctx,
@@ -344,6 +420,10 @@ class SnapshotDatasetOp : public UnaryDatasetOpKernel {
         ctx, pending_snapshot_expiry_seconds_ >= 1,
         errors::InvalidArgument(
             "pending_snapshot_expiry_seconds must be at least 1 second."));
+
+    OP_REQUIRES(ctx, max_store_size_bytes_ >= 0,
+                errors::InvalidArgument(
+                    "max_store_size_bytes must be non-negative."));
   }
 
  protected:
@@ -364,29 +444,106 @@ class SnapshotDatasetOp : public UnaryDatasetOpKernel {
 
     uint64 hash;
     OP_REQUIRES_OK(ctx, HashGraph(graph_def, &hash));
+    const string graph_hash =
+        strings::StrCat(strings::Hex(hash, strings::kZeroPad16));
+
+    DatasetBase* prefix_input = nullptr;
+    string prefix_hash;
+    Status s = ReadPrefixFromSnapshot(ctx, path, graph_hash,
+                                      std::move(graph_def), input_list,
+                                      &prefix_input, &prefix_hash);
+    if (!s.ok()) {
+      LOG(WARNING) << "Failed to read a prefix of the input of snapshot "
+                   << graph_hash << " from an existing snapshot: " << s;
+    }
 
     *output = new Dataset(
-        ctx, input, path,
-        strings::StrCat(strings::Hex(hash, strings::kZeroPad16)),
-        reader_path_prefix_, writer_path_prefix_, compression_,
+        ctx, input, prefix_input != nullptr ? prefix_input : input, path,
+        graph_hash, reader_path_prefix_, writer_path_prefix_, compression_,
         shard_size_bytes_, pending_snapshot_expiry_seconds_,
         num_reader_threads_, reader_buffer_size_, num_writer_threads_,
-        writer_buffer_size_, shuffle_on_read_, seed_, seed2_);
+        writer_buffer_size_, shuffle_on_read_, seed_, seed2_,
+        max_store_size_bytes_, prefix_hash);
+    if (prefix_input != nullptr) {
+      prefix_input->Unref();
+    }
   }
 
  private:
+  // If the input has not been materialized in a finalized snapshot, looks for
+  // a finalized snapshot in `path` of the longest prefix of the input (see
+  // `ComputeDatasetPrefixes()`). If there is one, `*prefix_input` is set to a
+  // dataset that is equivalent to the input but reads the prefix from its
+  // snapshot, the caller owns a reference to it, and `*prefix_hash` is set to
+  // the graph hash of the prefix.
+  Status ReadPrefixFromSnapshot(
+      OpKernelContext* ctx, const string& path, const string& graph_hash,
+      GraphDef graph_def,
+      const std::vector<std::pair<string, Tensor>>& input_list,
+      DatasetBase** prefix_input, string* prefix_hash) {
+    *prefix_input = nullptr;
+    prefix_hash->clear();
+    experimental::SnapshotMetadataRecord metadata;
+    if (ReadMetadataFile(absl::StrCat(path, "/", graph_hash), &metadata)
+            .ok() &&
+        metadata.finalized()) {
+      return Status::OK();
+    }
+
+    std::vector<DatasetPrefix> prefixes;
+    TF_RETURN_IF_ERROR(ComputeDatasetPrefixes(graph_def, &prefixes));
+    // The first prefix is the whole input.
+    for (size_t i = 1; i < prefixes.size(); ++i) {
+      const string hash =
+          strings::StrCat(strings::Hex(prefixes[i].hash, strings::kZeroPad16));
+      const string hash_dir = absl::StrCat(path, "/", hash);
+      // The files of the snapshot are only found under `reader_path_prefix_`
+      // if they were written under `writer_path_prefix_`.
+      if (!ReadMetadataFile(hash_dir, &metadata).ok() ||
+          !metadata.finalized() ||
+          metadata.writer_path_prefix() != writer_path_prefix_) {
+        continue;
+      }
+      // A copy of this op reads the prefix from its snapshot, because it
+      // computes the same fingerprint for the prefix. It reads the files the
+      // way they were written, in order.
+      NodeDef reader_def = def();
+      (*reader_def.mutable_attr())["compression"].set_s(metadata.compression());
+      (*reader_def.mutable_attr())["shuffle_on_read"].set_b(false);
+      TF_RETURN_IF_ERROR(InsertSnapshot(prefixes[i].node_name,
+                                        prefixes[i - 1].node_name, path,
+                                        reader_def, &graph_def));
+      TF_RETURN_IF_ERROR(MakeDatasetFromGraph(
+          ctx, graph_def, input_list, prefixes[0].node_name, prefix_input));
+      Status s = RecordSnapshotAccess(hash_dir, metadata);
+      if (!s.ok()) {
+        LOG(WARNING) << "Failed to record an access to snapshot " << hash_dir
+                     << ": " << s;
+      }
+      *prefix_hash = hash;
+      LOG(INFO) << "Snapshot " << graph_hash << " reads "
+                << prefixes.size() - i << " of the " << prefixes.size()
+                << " datasets of its input from snapshot " << hash << ".";
+      return Status::OK();
+    }
+    return Status::OK();
+  }
+
   class Dataset : public DatasetBase {
    public:
-    Dataset(OpKernelContext* ctx, const DatasetBase* input, const string& path,
+    Dataset(OpKernelContext* ctx, const DatasetBase* input,
+            const DatasetBase* iterated_input, const string& path,
             const string& graph_hash, const string& reader_path_prefix,
             const string& writer_path_prefix, const string& compression,
             const uint64 shard_size_bytes,
             const uint64 pending_snapshot_expiry_seconds,
             const uint64 num_reader_threads, const uint64 reader_buffer_size,
             const uint64 num_writer_threads, const uint64 writer_buffer_size,
-            const bool shuffle_on_read, const uint64 seed, const uint64 seed2)
+            const bool shuffle_on_read, const uint64 seed, const uint64 seed2,
+            const int64 max_store_size_bytes, const string& input_snapshot_hash)
         : DatasetBase(DatasetContext(ctx)),
           input_(input),
+          iterated_input_(iterated_input),
           dir_(path),
           graph_hash_(graph_hash),
           reader_path_prefix_(reader_path_prefix),
@@ -400,11 +557,17 @@ class SnapshotDatasetOp : public UnaryDatasetOpKernel {
           writer_buffer_size_(writer_buffer_size),
           shuffle_on_read_(shuffle_on_read),
           seed_(seed),
-          seed2_(seed2) {
+          seed2_(seed2),
+          max_store_size_bytes_(max_store_size_bytes),
+          input_snapshot_hash_(input_snapshot_hash) {
       input_->Ref();
+      iterated_input_->Ref();
     }
 
-    ~Dataset() override { input_->Unref(); }
+    ~Dataset() override {
+      input_->Unref();
+      iterated_input_->Unref();
+    }
 
     std::unique_ptr<IteratorBase> MakeIteratorInternal(
         const string& prefix) const override {
@@ -475,6 +638,10 @@ class SnapshotDatasetOp : public UnaryDatasetOpKernel {
       AttrValue seed2_attr;
       b->BuildAttrValue<int64>(seed2_, &seed2_attr);
 
+      AttrValue max_store_size_bytes_attr;
+      b->BuildAttrValue<int64>(max_store_size_bytes_,
+                               &max_store_size_bytes_attr);
+
       TF_RETURN_IF_ERROR(b->AddDataset(
           this,
           /*inputs=*/
@@ -494,7 +661,8 @@ class SnapshotDatasetOp : public UnaryDatasetOpKernel {
            {"writer_buffer_size", writer_buffer_size_attr},
            {"shuffle_on_read", shuffle_on_read_attr},
            {"seed", seed_attr},
-           {"seed2", seed2_attr}},
+           {"seed2", seed2_attr},
+           {"max_store_size_bytes", max_store_size_bytes_attr}},
           output));
       return Status::OK();
     }
@@ -532,6 +700,11 @@ class SnapshotDatasetOp : public UnaryDatasetOpKernel {
                   hash_dir_);
               break;
             case READER:
+              s = RecordSnapshotAccess(hash_dir_, metadata);
+              if (!s.ok()) {
+                LOG(WARNING) << "Failed to record an access to snapshot "
+                             << hash_dir_ << ": " << s;
+              }
               iterator_ = absl::make_unique<SnapshotReaderIterator>(
                   SnapshotReaderIterator::Params{
                       dataset(), strings::StrCat(prefix(), "ReaderImpl")},
@@ -844,9 +1017,15 @@ class SnapshotDatasetOp : public UnaryDatasetOpKernel {
           metadata.set_graph_hash(dataset()->graph_hash_);
           metadata.set_run_id(run_id_);
           metadata.set_finalized(false);
+          metadata.set_compression(dataset()->compression_);
+          metadata.set_writer_path_prefix(dataset()->writer_path_prefix_);
+          if (!dataset()->input_snapshot_hash_.empty()) {
+            metadata.add_input_snapshot_hashes(dataset()->input_snapshot_hash_);
+          }
           TF_RETURN_IF_ERROR(WriteMetadataFile(hash_dir_, metadata));
 
-          return dataset()->input_->MakeIterator(ctx, prefix(), &input_impl_);
+          return dataset()->iterated_input_->MakeIterator(ctx, prefix(),
+                                                          &input_impl_);
         }
 
         Status GetNextInternal(IteratorContext* ctx,
@@ -1049,19 +1228,38 @@ class SnapshotDatasetOp : public UnaryDatasetOpKernel {
             TF_RETURN_IF_ERROR((*writer)->Close());
             TF_RETURN_IF_ERROR((*file)->Sync());
             TF_RETURN_IF_ERROR((*file)->Close());
-            mutex_lock l(mu_);
-            if (!written_final_metadata_file_) {
-              experimental::SnapshotMetadataRecord metadata;
-              TF_RETURN_IF_ERROR(ReadMetadataFile(hash_dir_, &metadata));
-
-              if (metadata.run_id() == run_id_) {
-                metadata.set_finalized(true);
-                TF_RETURN_IF_ERROR(WriteMetadataFile(hash_dir_, metadata));
-              } else {
-                // TODO(frankchn): We lost the race, remove all snapshots.
+            bool finalized = false;
+            {
+              mutex_lock l(mu_);
+              if (!written_final_metadata_file_) {
+                experimental::SnapshotMetadataRecord metadata;
+                TF_RETURN_IF_ERROR(ReadMetadataFile(hash_dir_, &metadata));
+
+                if (metadata.run_id() == run_id_) {
+                  int64 num_bytes;
+                  TF_RETURN_IF_ERROR(SnapshotRunSize(run_dir_, &num_bytes));
+                  metadata.set_num_bytes(num_bytes);
+                  metadata.set_last_access_timestamp(
+                      Env::Default()->NowMicros());
+                  metadata.set_finalized(true);
+                  metadata.clear_input_snapshot_hashes();
+                  TF_RETURN_IF_ERROR(WriteMetadataFile(hash_dir_, metadata));
+                  finalized = true;
+                } else {
+                  // TODO(frankchn): We lost the race, remove all snapshots.
+                }
+                written_final_metadata_file_ = true;
+                cond_var_.notify_all();
+              }
+            }
+            if (finalized && dataset()->max_store_size_bytes_ > 0) {
+              Status s = EvictSnapshots(
+                  dataset()->dir_, dataset()->writer_path_prefix_, hash_dir_,
+                  dataset()->max_store_size_bytes_);
+              if (!s.ok()) {
+                LOG(WARNING) << "Failed to evict snapshots from "
+                             << dataset()->dir_ << ": " << s;
               }
-              written_final_metadata_file_ = true;
-              cond_var_.notify_all();
             }
           }
           return Status::OK();
@@ -1146,7 +1344,8 @@ class SnapshotDatasetOp : public UnaryDatasetOpKernel {
             : DatasetIterator<Dataset>(params) {}
 
         Status Initialize(IteratorContext* ctx) override {
-          return dataset()->input_->MakeIterator(ctx, prefix(), &input_impl_);
+          return dataset()->iterated_input_->MakeIterator(ctx, prefix(),
+                                                          &input_impl_);
         }
 
         Status GetNextInternal(IteratorContext* ctx,
@@ -1167,6 +1366,10 @@ class SnapshotDatasetOp : public UnaryDatasetOpKernel {
     };
 
     const DatasetBase* const input_;
+    // The dataset that the writer and passthrough iterators read from. It is
+    // either `input_` or an equivalent dataset that reads a prefix of `input_`
+    // from an existing snapshot.
+    const DatasetBase* const iterated_input_;
     const tstring dir_;
     const string graph_hash_;
 
@@ -1184,6 +1387,11 @@ class SnapshotDatasetOp : public UnaryDatasetOpKernel {
 
     const uint64 seed_;
     const uint64 seed2_;
+
+    const int64 max_store_size_bytes_;
+    // The graph hash of the snapshot that `iterated_input_` reads a prefix of
+    // `input_` from, or empty if it is `input_`.
+    const string input_snapshot_hash_;
   };
 
   const int graph_def_version_;
@@ -1204,6 +1412,8 @@ class SnapshotDatasetOp : public UnaryDatasetOpKernel {
 
   int64 seed_;
   int64 seed2_;
+
+  int64 max_store_size_bytes_;
 };
 
 REGISTER_KERNEL_BUILDER(Name("SnapshotDataset").Device(DEVICE_CPU),
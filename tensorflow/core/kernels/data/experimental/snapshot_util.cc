@@ -0,0 +1,204 @@
+/* Copyright 2019 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#include "tensorflow/core/kernels/data/experimental/snapshot_util.h"
+
+#include <algorithm>
+
+#include "absl/container/flat_hash_map.h"
+#include "absl/container/flat_hash_set.h"
+#include "tensorflow/core/framework/attr_value.pb.h"
+#include "tensorflow/core/framework/op.h"
+#include "tensorflow/core/framework/op_def.pb.h"
+#include "tensorflow/core/framework/tensor.pb.h"
+#include "tensorflow/core/kernels/data/dataset_utils.h"
+#include "tensorflow/core/lib/core/errors.h"
+#include "tensorflow/core/lib/strings/strcat.h"
+
+namespace tensorflow {
+namespace data {
+namespace experimental {
+namespace {
+
+constexpr char kRetvalOp[] = "_Retval";
+constexpr char kOutputTypes[] = "output_types";
+constexpr char kOutputShapes[] = "output_shapes";
+
+// Returns the name of the node that produces the given (non-control) input.
+string InputNodeName(const string& input) {
+  return input.substr(0, input.find(':'));
+}
+
+// Returns the name of the node that produces the single input dataset of
+// `node`, or an empty string if `node` does not have a single input dataset.
+string InputDatasetName(const NodeDef& node) {
+  const OpDef* op_def = nullptr;
+  if (node.input_size() == 0 || node.input(0)[0] == '^' ||
+      !OpRegistry::Global()->LookUpOpDef(node.op(), &op_def).ok() ||
+      op_def->input_arg_size() == 0) {
+    return "";
+  }
+  const OpDef::ArgDef& arg = op_def->input_arg(0);
+  if (arg.type() != DT_VARIANT || !arg.number_attr().empty() ||
+      !arg.type_list_attr().empty()) {
+    return "";
+  }
+  return InputNodeName(node.input(0));
+}
+
+string UniqueNodeName(const GraphDef& graph, const string& prefix) {
+  string name = prefix;
+  for (int i = 1;; ++i) {
+    bool found = false;
+    for (const auto& node : graph.node()) {
+      if (node.name() == name) {
+        found = true;
+        break;
+      }
+    }
+    if (!found) {
+      return name;
+    }
+    name = strings::StrCat(prefix, "_", i);
+  }
+}
+
+}  // namespace
+
+Status ComputeDatasetPrefixes(const GraphDef& graph,
+                              std::vector<DatasetPrefix>* prefixes) {
+  prefixes->clear();
+  // The prefixes are hashed by pointing the `_Retval` node of a copy of the
+  // graph at each of them in turn, which reproduces the graph that
+  // `AsGraphDef()` creates for the prefix on its own.
+  GraphDef copy = graph;
+  NodeDef* sink = nullptr;
+  absl::flat_hash_map<string, const NodeDef*> nodes;
+  for (auto& node : *copy.mutable_node()) {
+    nodes[node.name()] = &node;
+    if (node.op() == kRetvalOp) {
+      sink = &node;
+    }
+  }
+  if (sink == nullptr || sink->input_size() != 1) {
+    return errors::InvalidArgument("Cannot find sink node for dataset graph.");
+  }
+
+  string node_name = InputNodeName(sink->input(0));
+  while (!node_name.empty()) {
+    auto it = nodes.find(node_name);
+    if (it == nodes.end()) {
+      return errors::InvalidArgument("Could not find node ", node_name);
+    }
+    for (const auto& prefix : *prefixes) {
+      if (prefix.node_name == node_name) {
+        return errors::InvalidArgument("Dataset graph has a cycle at node ",
+                                       node_name);
+      }
+    }
+    DatasetPrefix prefix;
+    prefix.node_name = node_name;
+    sink->set_input(0, node_name);
+    TF_RETURN_IF_ERROR(HashNode(copy, *sink, &prefix.hash));
+    prefixes->push_back(std::move(prefix));
+    node_name = InputDatasetName(*it->second);
+  }
+  return Status::OK();
+}
+
+Status InsertSnapshot(const string& node_name, const string& consumer_name,
+                      const string& path, const NodeDef& snapshot_def,
+                      GraphDef* graph) {
+  const NodeDef* node = nullptr;
+  NodeDef* consumer = nullptr;
+  for (auto& n : *graph->mutable_node()) {
+    if (n.name() == node_name) {
+      node = &n;
+    } else if (n.name() == consumer_name) {
+      consumer = &n;
+    }
+  }
+  if (node == nullptr || consumer == nullptr) {
+    return errors::InvalidArgument("Could not find node ", node_name,
+                                   " consumed by ", consumer_name);
+  }
+  if (consumer->input_size() == 0 ||
+      InputNodeName(consumer->input(0)) != node_name) {
+    return errors::InvalidArgument("Node ", consumer_name,
+                                   " does not read its input from ", node_name);
+  }
+  if (!node->attr().count(kOutputTypes) ||
+      !node->attr().count(kOutputShapes)) {
+    return errors::Unimplemented("Node ", node_name,
+                                 " does not declare its output types and "
+                                 "shapes.");
+  }
+
+  NodeDef path_node;
+  path_node.set_name(UniqueNodeName(*graph, node_name + "/snapshot_path"));
+  path_node.set_op("Const");
+  (*path_node.mutable_attr())["dtype"].set_type(DT_STRING);
+  TensorProto* value = (*path_node.mutable_attr())["value"].mutable_tensor();
+  value->set_dtype(DT_STRING);
+  value->mutable_tensor_shape();
+  value->add_string_val(path);
+
+  NodeDef snapshot_node = snapshot_def;
+  snapshot_node.set_name(UniqueNodeName(*graph, node_name + "/snapshot"));
+  snapshot_node.clear_input();
+  snapshot_node.add_input(node_name);
+  snapshot_node.add_input(path_node.name());
+  snapshot_node.clear_device();
+  (*snapshot_node.mutable_attr())[kOutputTypes] = node->attr().at(kOutputTypes);
+  (*snapshot_node.mutable_attr())[kOutputShapes] =
+      node->attr().at(kOutputShapes);
+
+  consumer->set_input(0, snapshot_node.name());
+  *graph->add_node() = std::move(path_node);
+  *graph->add_node() = std::move(snapshot_node);
+  return Status::OK();
+}
+
+std::vector<string> SelectSnapshotsToEvict(
+    std::vector<SnapshotStoreEntry> entries, int64 max_bytes) {
+  int64 total_bytes = 0;
+  absl::flat_hash_set<string> pinned_inputs;
+  for (const auto& entry : entries) {
+    total_bytes += entry.num_bytes;
+    if (entry.pinned) {
+      pinned_inputs.insert(entry.input_hash_dirs.begin(),
+                           entry.input_hash_dirs.end());
+    }
+  }
+  std::sort(entries.begin(), entries.end(),
+            [](const SnapshotStoreEntry& a, const SnapshotStoreEntry& b) {
+              return a.last_access_micros < b.last_access_micros;
+            });
+  std::vector<string> evicted;
+  for (const auto& entry : entries) {
+    if (total_bytes <= max_bytes) {
+      break;
+    }
+    if (entry.pinned || pinned_inputs.contains(entry.hash_dir)) {
+      continue;
+    }
+    evicted.push_back(entry.hash_dir);
+    total_bytes -= entry.num_bytes;
+  }
+  return evicted;
+}
+
+}  // namespace experimental
+}  // namespace data
+}  // namespace tensorflow
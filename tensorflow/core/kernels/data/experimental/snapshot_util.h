@@ -0,0 +1,89 @@
+/* Copyright 2019 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#ifndef TENSORFLOW_CORE_KERNELS_DATA_EXPERIMENTAL_SNAPSHOT_UTIL_H_
+#define TENSORFLOW_CORE_KERNELS_DATA_EXPERIMENTAL_SNAPSHOT_UTIL_H_
+
+#include <vector>
+
+#include "tensorflow/core/framework/graph.pb.h"
+#include "tensorflow/core/framework/node_def.pb.h"
+#include "tensorflow/core/lib/core/status.h"
+#include "tensorflow/core/platform/types.h"
+
+namespace tensorflow {
+namespace data {
+namespace experimental {
+
+// Prefix reuse
+// ------------
+//
+// A snapshot is keyed by the fingerprint of the graph of its input dataset,
+// so changing any transformation of the input invalidates the snapshot. The
+// input is typically a chain of transformations applied to a source dataset,
+// and a variant of a pipeline often shares a prefix of this chain with an
+// earlier variant. When the snapshot of the whole input is not available,
+// the snapshot op looks for a finalized snapshot of the longest prefix of the
+// chain, reads the prefix from it, and only recomputes the transformations
+// that follow the prefix.
+
+// A dataset in the chain of transformations that produces the output of a
+// dataset graph.
+struct DatasetPrefix {
+  // The name of the node that produces the dataset.
+  string node_name;
+  // The fingerprint of the subgraph that produces the dataset. It matches the
+  // `HashGraph()` fingerprint of the dataset serialized on its own.
+  uint64 hash = 0;
+};
+
+// Computes the prefixes of the chain of transformations that produces the
+// output of `graph`, which must be a dataset graph with a `_Retval` node. The
+// chain follows the first input of each transformation that has a single
+// input dataset. The prefixes are ordered from the longest (the whole graph)
+// to the shortest (the source dataset).
+Status ComputeDatasetPrefixes(const GraphDef& graph,
+                              std::vector<DatasetPrefix>* prefixes);
+
+// Rewrites `graph` so that `consumer_name` reads the output of `node_name`
+// from the snapshot at `path`. The snapshot node is a copy of `snapshot_def`
+// whose inputs and output types and shapes are replaced.
+Status InsertSnapshot(const string& node_name, const string& consumer_name,
+                      const string& path, const NodeDef& snapshot_def,
+                      GraphDef* graph);
+
+// A snapshot in a snapshot directory.
+struct SnapshotStoreEntry {
+  string hash_dir;
+  int64 num_bytes = 0;
+  int64 last_access_micros = 0;
+  // Pinned snapshots (e.g. the ones that are being written) are never evicted
+  // but count toward the size of the store.
+  bool pinned = false;
+  // The directories of the snapshots that this snapshot reads a prefix of its
+  // input from. They are pinned if this snapshot is.
+  std::vector<string> input_hash_dirs;
+};
+
+// Returns the directories of the snapshots to delete so that the total size
+// of `entries` does not exceed `max_bytes`, least recently accessed first.
+// Pinned snapshots and the snapshots that they read from are never selected.
+std::vector<string> SelectSnapshotsToEvict(
+    std::vector<SnapshotStoreEntry> entries, int64 max_bytes);
+
+}  // namespace experimental
+}  // namespace data
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_CORE_KERNELS_DATA_EXPERIMENTAL_SNAPSHOT_UTIL_H_
@@ -0,0 +1,202 @@
+/* Copyright 2019 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#include "tensorflow/core/kernels/data/experimental/snapshot_util.h"
+
+#include "tensorflow/core/framework/function_testlib.h"
+#include "tensorflow/core/framework/tensor_testutil.h"
+#include "tensorflow/core/kernels/data/dataset_utils.h"
+#include "tensorflow/core/lib/core/errors.h"
+#include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/platform/test.h"
+
+namespace tensorflow {
+namespace data {
+namespace experimental {
+namespace {
+
+using test::function::NDef;
+
+NodeDef ConstNode(const string& name, int64 value) {
+  return NDef(name, "Const", {},
+              {{"dtype", DT_INT64}, {"value", test::AsScalar<int64>(value)}});
+}
+
+NodeDef DatasetNode(const string& name, const string& op,
+                    const std::vector<string>& inputs) {
+  return NDef(name, op, inputs,
+              {{"output_types", DataTypeVector({DT_INT64})},
+               {"output_shapes", std::vector<PartialTensorShape>({{}})}});
+}
+
+NodeDef RetvalNode(const string& input) {
+  return NDef("dataset", "_Retval", {input}, {{"T", DT_VARIANT}, {"index", 0}});
+}
+
+// Returns the graph of `range(0, 10).take(take_count)`, followed by
+// `skip(skip_count)` if `skip_count` is non-negative. Node names are prefixed
+// with `prefix`, which does not affect the fingerprints.
+GraphDef MakeGraph(const string& prefix, int64 take_count, int64 skip_count) {
+  std::vector<NodeDef> nodes = {
+      ConstNode(prefix + "start", 0),
+      ConstNode(prefix + "stop", 10),
+      ConstNode(prefix + "step", 1),
+      DatasetNode(prefix + "range", "RangeDataset",
+                  {prefix + "start", prefix + "stop", prefix + "step"}),
+      ConstNode(prefix + "take_count", take_count),
+      DatasetNode(prefix + "take", "TakeDataset",
+                  {prefix + "range", prefix + "take_count"})};
+  string output = prefix + "take";
+  if (skip_count >= 0) {
+    nodes.push_back(ConstNode(prefix + "skip_count", skip_count));
+    nodes.push_back(DatasetNode(prefix + "skip", "SkipDataset",
+                                {output, prefix + "skip_count"}));
+    output = prefix + "skip";
+  }
+  nodes.push_back(RetvalNode(output));
+  return test::function::GDef(nodes);
+}
+
+TEST(ComputeDatasetPrefixesTest, Chain) {
+  GraphDef graph = MakeGraph("a/", /*take_count=*/5, /*skip_count=*/2);
+  std::vector<DatasetPrefix> prefixes;
+  TF_ASSERT_OK(ComputeDatasetPrefixes(graph, &prefixes));
+  ASSERT_EQ(prefixes.size(), 3);
+  EXPECT_EQ(prefixes[0].node_name, "a/skip");
+  EXPECT_EQ(prefixes[1].node_name, "a/take");
+  EXPECT_EQ(prefixes[2].node_name, "a/range");
+
+  // The longest prefix is the whole graph.
+  uint64 hash = 0;
+  TF_ASSERT_OK(HashGraph(graph, &hash));
+  EXPECT_EQ(prefixes[0].hash, hash);
+
+  // A prefix has the fingerprint of the graph of the prefix on its own, even
+  // if its nodes are named differently.
+  TF_ASSERT_OK(
+      HashGraph(MakeGraph("b/", /*take_count=*/5, /*skip_count=*/-1), &hash));
+  EXPECT_EQ(prefixes[1].hash, hash);
+  TF_ASSERT_OK(
+      HashGraph(MakeGraph("b/", /*take_count=*/6, /*skip_count=*/-1), &hash));
+  EXPECT_NE(prefixes[1].hash, hash);
+}
+
+TEST(ComputeDatasetPrefixesTest, SharedPrefix) {
+  std::vector<DatasetPrefix> prefixes;
+  TF_ASSERT_OK(ComputeDatasetPrefixes(
+      MakeGraph("a/", /*take_count=*/5, /*skip_count=*/2), &prefixes));
+  std::vector<DatasetPrefix> other_prefixes;
+  TF_ASSERT_OK(ComputeDatasetPrefixes(
+      MakeGraph("a/", /*take_count=*/5, /*skip_count=*/3), &other_prefixes));
+  ASSERT_EQ(other_prefixes.size(), 3);
+  EXPECT_NE(prefixes[0].hash, other_prefixes[0].hash);
+  EXPECT_EQ(prefixes[1].hash, other_prefixes[1].hash);
+  EXPECT_EQ(prefixes[2].hash, other_prefixes[2].hash);
+}
+
+TEST(ComputeDatasetPrefixesTest, MissingSink) {
+  std::vector<DatasetPrefix> prefixes;
+  GraphDef graph = test::function::GDef({ConstNode("start", 0)});
+  EXPECT_TRUE(
+      errors::IsInvalidArgument(ComputeDatasetPrefixes(graph, &prefixes)));
+}
+
+TEST(InsertSnapshotTest, ReadsPrefixFromSnapshot) {
+  GraphDef graph = MakeGraph("", /*take_count=*/5, /*skip_count=*/2);
+  NodeDef snapshot_def =
+      NDef("snapshot", "SnapshotDataset", {"skip", "path"},
+           {{"output_types", DataTypeVector({DT_INT64})},
+            {"output_shapes", std::vector<PartialTensorShape>({{}})},
+            {"compression", "GZIP"}});
+  TF_ASSERT_OK(InsertSnapshot("take", "skip", "/tmp/snapshot", snapshot_def,
+                              &graph));
+
+  const NodeDef* snapshot = nullptr;
+  const NodeDef* skip = nullptr;
+  for (const auto& node : graph.node()) {
+    if (node.op() == "SnapshotDataset") {
+      snapshot = &node;
+    } else if (node.name() == "skip") {
+      skip = &node;
+    }
+  }
+  ASSERT_NE(snapshot, nullptr);
+  ASSERT_NE(skip, nullptr);
+  EXPECT_EQ(skip->input(0), snapshot->name());
+  ASSERT_EQ(snapshot->input_size(), 2);
+  EXPECT_EQ(snapshot->input(0), "take");
+  EXPECT_EQ(snapshot->attr().at("compression").s(), "GZIP");
+
+  // The input of the snapshot keeps the fingerprint of the prefix, so the
+  // snapshot finds the materialized prefix.
+  std::vector<DatasetPrefix> prefixes;
+  TF_ASSERT_OK(ComputeDatasetPrefixes(graph, &prefixes));
+  ASSERT_EQ(prefixes.size(), 4);
+  EXPECT_EQ(prefixes[1].node_name, snapshot->name());
+  EXPECT_EQ(prefixes[2].node_name, "take");
+  std::vector<DatasetPrefix> original_prefixes;
+  TF_ASSERT_OK(ComputeDatasetPrefixes(
+      MakeGraph("", /*take_count=*/5, /*skip_count=*/2), &original_prefixes));
+  EXPECT_EQ(prefixes[2].hash, original_prefixes[1].hash);
+}
+
+TEST(InsertSnapshotTest, InvalidConsumer) {
+  GraphDef graph = MakeGraph("", /*take_count=*/5, /*skip_count=*/2);
+  NodeDef snapshot_def = NDef("snapshot", "SnapshotDataset", {});
+  EXPECT_TRUE(errors::IsInvalidArgument(
+      InsertSnapshot("range", "skip", "/tmp/snapshot", snapshot_def, &graph)));
+}
+
+SnapshotStoreEntry MakeEntry(const string& hash_dir, int64 num_bytes,
+                             int64 last_access_micros, bool pinned = false) {
+  SnapshotStoreEntry entry;
+  entry.hash_dir = hash_dir;
+  entry.num_bytes = num_bytes;
+  entry.last_access_micros = last_access_micros;
+  entry.pinned = pinned;
+  return entry;
+}
+
+TEST(SelectSnapshotsToEvictTest, LeastRecentlyAccessedFirst) {
+  std::vector<SnapshotStoreEntry> entries = {
+      MakeEntry("a", 100, 3), MakeEntry("b", 100, 1), MakeEntry("c", 100, 2)};
+  EXPECT_TRUE(SelectSnapshotsToEvict(entries, 300).empty());
+  EXPECT_EQ(SelectSnapshotsToEvict(entries, 250), std::vector<string>({"b"}));
+  EXPECT_EQ(SelectSnapshotsToEvict(entries, 100),
+            std::vector<string>({"b", "c"}));
+}
+
+TEST(SelectSnapshotsToEvictTest, SkipsPinnedSnapshots) {
+  std::vector<SnapshotStoreEntry> entries = {
+      MakeEntry("a", 100, 3), MakeEntry("b", 100, 1, /*pinned=*/true),
+      MakeEntry("c", 100, 2)};
+  EXPECT_EQ(SelectSnapshotsToEvict(entries, 150),
+            std::vector<string>({"c", "a"}));
+}
+
+TEST(SelectSnapshotsToEvictTest, SkipsInputsOfPinnedSnapshots) {
+  std::vector<SnapshotStoreEntry> entries = {
+      MakeEntry("a", 100, 3, /*pinned=*/true), MakeEntry("b", 100, 1),
+      MakeEntry("c", 100, 2), MakeEntry("d", 100, 4)};
+  entries[0].input_hash_dirs = {"b"};
+  // Inputs of snapshots that are not pinned can be evicted.
+  entries[3].input_hash_dirs = {"c"};
+  EXPECT_EQ(SelectSnapshotsToEvict(entries, 150),
+            std::vector<string>({"c", "d"}));
+}
+
+}  // namespace
+}  // namespace experimental
+}  // namespace data
+}  // namespace tensorflow
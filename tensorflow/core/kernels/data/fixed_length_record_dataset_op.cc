@@ -46,6 +46,9 @@ constexpr char kCurrentFileIndex[] = "current_file_index";
 constexpr char kCurrentPos[] = "current_pos";
 constexpr char kZLIB[] = "ZLIB";
 constexpr char kGZIP[] = "GZIP";
+// Number of buffers of the next records of an uncompressed file that are read
+// ahead of the iterator.
+constexpr int kNumReadAheadBuffers = 4;
 
 class FixedLengthRecordDatasetOp::Dataset : public DatasetBase {
  public:
@@ -184,7 +187,7 @@ class FixedLengthRecordDatasetOp::Dataset : public DatasetBase {
         TF_RETURN_IF_ERROR(ctx->env()->NewRandomAccessFile(
             dataset()->filenames_[current_file_index_], &file_));
         input_buffer_ = absl::make_unique<io::InputBuffer>(
-            file_.get(), dataset()->buffer_size_);
+            file_.get(), dataset()->buffer_size_, kNumReadAheadBuffers);
         TF_RETURN_IF_ERROR(input_buffer_->SkipNBytes(dataset()->header_bytes_));
       } while (true);
     }
@@ -226,7 +229,7 @@ class FixedLengthRecordDatasetOp::Dataset : public DatasetBase {
         TF_RETURN_IF_ERROR(ctx->env()->NewRandomAccessFile(
             dataset()->filenames_[current_file_index_], &file_));
         input_buffer_ = absl::make_unique<io::InputBuffer>(
-            file_.get(), dataset()->buffer_size_);
+            file_.get(), dataset()->buffer_size_, kNumReadAheadBuffers);
         TF_RETURN_IF_ERROR(input_buffer_->Seek(current_pos));
       }
 
@@ -0,0 +1,107 @@
+/* Copyright 2019 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#include "tensorflow/core/kernels/data/input_snapshot.h"
+
+#include "tensorflow/core/framework/variant_tensor_data.h"
+#include "tensorflow/core/kernels/data/dataset_utils.h"
+#include "tensorflow/core/lib/core/errors.h"
+#include "tensorflow/core/lib/strings/strcat.h"
+
+namespace tensorflow {
+namespace data {
+namespace {
+
+constexpr char kEpochSuffix[] = "_epoch";
+constexpr char kIndexSuffix[] = "_index";
+constexpr char kStateSuffix[] = "_state";
+
+}  // namespace
+
+Status SerializeInputState(
+    const std::function<Status(IteratorStateWriter*)>& save_fn,
+    string* state) {
+  VariantTensorData data;
+  VariantTensorDataWriter writer(&data);
+  TF_RETURN_IF_ERROR(save_fn(&writer));
+  TF_RETURN_IF_ERROR(writer.Flush());
+  if (!data.SerializeToString(state)) {
+    return errors::Internal("Failed to serialize the input iterator state.");
+  }
+  return Status::OK();
+}
+
+Status DeserializeInputState(
+    const string& state,
+    const std::function<Status(IteratorStateReader*)>& restore_fn) {
+  VariantTensorData data;
+  if (!data.ParseFromString(state)) {
+    return errors::DataLoss("Failed to parse the input iterator state.");
+  }
+  VariantTensorDataReader reader(&data);
+  return restore_fn(&reader);
+}
+
+void InputSnapshotLog::Add(InputSnapshot snapshot) {
+  if (!snapshots_.empty() && snapshot.position <= snapshots_.back().position) {
+    DCHECK(snapshots_.back().position == snapshot.position);
+    return;
+  }
+  snapshots_.push_back(std::move(snapshot));
+  if (snapshots_.size() > max_snapshots_) {
+    snapshots_.pop_front();
+  }
+}
+
+void InputSnapshotLog::Prune(const InputPosition& oldest) {
+  while (snapshots_.size() > 1 && snapshots_[1].position <= oldest) {
+    snapshots_.pop_front();
+  }
+}
+
+const InputSnapshot* InputSnapshotLog::Find(
+    const InputPosition& position) const {
+  for (auto it = snapshots_.rbegin(); it != snapshots_.rend(); ++it) {
+    if (it->position <= position) {
+      return &*it;
+    }
+  }
+  return nullptr;
+}
+
+Status WriteInputSnapshot(IteratorStateWriter* writer, const string& key,
+                          const InputSnapshot& snapshot) {
+  TF_RETURN_IF_ERROR(writer->WriteScalar(strings::StrCat(key, kEpochSuffix),
+                                         snapshot.position.epoch));
+  TF_RETURN_IF_ERROR(writer->WriteScalar(strings::StrCat(key, kIndexSuffix),
+                                         snapshot.position.index));
+  return writer->WriteScalar(strings::StrCat(key, kStateSuffix),
+                             snapshot.state);
+}
+
+Status ReadInputSnapshot(IteratorStateReader* reader, const string& key,
+                         InputSnapshot* snapshot) {
+  TF_RETURN_IF_ERROR(reader->ReadScalar(strings::StrCat(key, kEpochSuffix),
+                                        &snapshot->position.epoch));
+  TF_RETURN_IF_ERROR(reader->ReadScalar(strings::StrCat(key, kIndexSuffix),
+                                        &snapshot->position.index));
+  tstring state;
+  TF_RETURN_IF_ERROR(
+      reader->ReadScalar(strings::StrCat(key, kStateSuffix), &state));
+  snapshot->state = string(state);
+  return Status::OK();
+}
+
+}  // namespace data
+}  // namespace tensorflow
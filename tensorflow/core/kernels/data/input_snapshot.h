@@ -0,0 +1,126 @@
+/* Copyright 2019 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#ifndef TENSORFLOW_CORE_KERNELS_DATA_INPUT_SNAPSHOT_H_
+#define TENSORFLOW_CORE_KERNELS_DATA_INPUT_SNAPSHOT_H_
+
+#include <deque>
+#include <functional>
+
+#include "tensorflow/core/framework/dataset.h"
+#include "tensorflow/core/lib/core/status.h"
+
+namespace tensorflow {
+namespace data {
+
+// Incremental checkpointing
+// -------------------------
+//
+// Iterators that buffer elements of their input (e.g. shuffle and prefetch)
+// normally save the buffered elements in every checkpoint. When incremental
+// checkpointing is enabled, such iterators instead save the position in their
+// input of each buffered element, together with a snapshot of the input's
+// state taken at or before the oldest of those positions. On restore, the
+// input is restored from the snapshot and replayed up to the current position,
+// recomputing the buffered elements. This requires the input to be
+// deterministic, and trades checkpoint size and latency for restore time.
+//
+// The snapshots are taken only when the input starts (which is free) and when
+// a checkpoint is saved, so iterating does not pay for them. A checkpoint can
+// be incremental if all the buffered elements were read after the start of the
+// input or after a recent checkpoint; otherwise it falls back to saving the
+// buffered elements.
+//
+// Incremental checkpointing is enabled by
+// `tf.data.Options.experimental_incremental_checkpoints`, which sets
+// `IteratorContext::incremental_checkpoints()`. The checkpoint records which
+// mode was used, so it can be restored regardless of the setting.
+
+// The position of an element in the sequence produced by the input of an
+// iterator. `epoch` counts how many times the input iterator was re-created
+// (e.g. by a fused repeat), and `index` counts the elements produced by the
+// current input iterator.
+struct InputPosition {
+  int64 epoch = 0;
+  int64 index = 0;
+
+  bool operator==(const InputPosition& other) const {
+    return epoch == other.epoch && index == other.index;
+  }
+  bool operator<(const InputPosition& other) const {
+    return epoch < other.epoch || (epoch == other.epoch && index < other.index);
+  }
+  bool operator<=(const InputPosition& other) const {
+    return !(other < *this);
+  }
+};
+
+// A snapshot of the state of an input iterator at `position`. An empty `state`
+// denotes a newly created iterator.
+struct InputSnapshot {
+  InputPosition position;
+  string state;
+};
+
+// Serializes the state saved by `save_fn` into `*state`.
+Status SerializeInputState(
+    const std::function<Status(IteratorStateWriter*)>& save_fn,
+    string* state);
+
+// Deserializes `state` and passes it to `restore_fn`.
+Status DeserializeInputState(
+    const string& state,
+    const std::function<Status(IteratorStateReader*)>& restore_fn);
+
+// Keeps the snapshots of an input iterator that may be needed to recompute
+// the elements buffered by its consumer, at most `max_snapshots` of them.
+class InputSnapshotLog {
+ public:
+  explicit InputSnapshotLog(size_t max_snapshots)
+      : max_snapshots_(max_snapshots) {}
+
+  // Adds a snapshot, discarding the oldest one if the log is full. Snapshots
+  // must be added in increasing position order; a snapshot at the position of
+  // the latest one is ignored.
+  void Add(InputSnapshot snapshot);
+
+  // Discards the snapshots that are not needed to replay the input from
+  // `oldest`.
+  void Prune(const InputPosition& oldest);
+
+  // Returns the latest snapshot at or before `position`, or nullptr if there
+  // is none.
+  const InputSnapshot* Find(const InputPosition& position) const;
+
+  void Clear() { snapshots_.clear(); }
+
+  size_t size() const { return snapshots_.size(); }
+
+ private:
+  const size_t max_snapshots_;
+  std::deque<InputSnapshot> snapshots_;
+};
+
+// Writes `snapshot` to `writer` under keys derived from `key`.
+Status WriteInputSnapshot(IteratorStateWriter* writer, const string& key,
+                          const InputSnapshot& snapshot);
+
+// Reads a snapshot written by `WriteInputSnapshot()` from `reader`.
+Status ReadInputSnapshot(IteratorStateReader* reader, const string& key,
+                         InputSnapshot* snapshot);
+
+}  // namespace data
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_CORE_KERNELS_DATA_INPUT_SNAPSHOT_H_
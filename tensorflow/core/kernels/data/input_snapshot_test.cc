@@ -0,0 +1,98 @@
+/* Copyright 2019 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#include "tensorflow/core/kernels/data/input_snapshot.h"
+
+#include "tensorflow/core/framework/variant_tensor_data.h"
+#include "tensorflow/core/kernels/data/dataset_utils.h"
+#include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/lib/strings/strcat.h"
+#include "tensorflow/core/platform/test.h"
+
+namespace tensorflow {
+namespace data {
+namespace {
+
+InputSnapshot MakeSnapshot(int64 epoch, int64 index) {
+  InputSnapshot snapshot;
+  snapshot.position = {epoch, index};
+  snapshot.state = strings::StrCat("state_", epoch, "_", index);
+  return snapshot;
+}
+
+TEST(InputSnapshotLogTest, AddIsBounded) {
+  InputSnapshotLog log(/*max_snapshots=*/2);
+  log.Add(MakeSnapshot(0, 0));
+  log.Add(MakeSnapshot(0, 4));
+  // A snapshot at the position of the latest one is ignored.
+  log.Add(MakeSnapshot(0, 4));
+  EXPECT_EQ(log.size(), 2);
+  log.Add(MakeSnapshot(1, 0));
+  EXPECT_EQ(log.size(), 2);
+  EXPECT_EQ(log.Find({0, 3}), nullptr);
+  EXPECT_EQ(log.Find({0, 5})->position, (InputPosition{0, 4}));
+}
+
+TEST(InputSnapshotLogTest, FindAndPrune) {
+  InputSnapshotLog log(/*max_snapshots=*/8);
+  log.Add(MakeSnapshot(0, 0));
+  log.Add(MakeSnapshot(0, 4));
+  log.Add(MakeSnapshot(1, 0));
+  log.Add(MakeSnapshot(1, 4));
+
+  EXPECT_EQ(log.Find({0, 3})->position, (InputPosition{0, 0}));
+  EXPECT_EQ(log.Find({0, 9})->position, (InputPosition{0, 4}));
+  EXPECT_EQ(log.Find({1, 4})->position, (InputPosition{1, 4}));
+
+  log.Prune({0, 5});
+  EXPECT_EQ(log.size(), 3);
+  EXPECT_EQ(log.Find({0, 3}), nullptr);
+  EXPECT_EQ(log.Find({0, 5})->position, (InputPosition{0, 4}));
+
+  log.Prune({1, 4});
+  EXPECT_EQ(log.size(), 1);
+  EXPECT_EQ(log.Find({1, 6})->state, "state_1_4");
+}
+
+TEST(InputSnapshotTest, SerializeInputState) {
+  string state;
+  TF_ASSERT_OK(SerializeInputState(
+      [](IteratorStateWriter* writer) {
+        return writer->WriteScalar("position", 42);
+      },
+      &state));
+  int64 position = 0;
+  TF_ASSERT_OK(DeserializeInputState(
+      state, [&position](IteratorStateReader* reader) {
+        return reader->ReadScalar("position", &position);
+      }));
+  EXPECT_EQ(position, 42);
+}
+
+TEST(InputSnapshotTest, WriteAndReadSnapshot) {
+  VariantTensorData data;
+  VariantTensorDataWriter writer(&data);
+  TF_ASSERT_OK(WriteInputSnapshot(&writer, "snapshot", MakeSnapshot(2, 7)));
+  TF_ASSERT_OK(writer.Flush());
+
+  VariantTensorDataReader reader(&data);
+  InputSnapshot snapshot;
+  TF_ASSERT_OK(ReadInputSnapshot(&reader, "snapshot", &snapshot));
+  EXPECT_EQ(snapshot.position, (InputPosition{2, 7}));
+  EXPECT_EQ(snapshot.state, "state_2_7");
+}
+
+}  // namespace
+}  // namespace data
+}  // namespace tensorflow
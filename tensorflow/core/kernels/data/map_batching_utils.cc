@@ -0,0 +1,265 @@
+/* Copyright 2019 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#include "tensorflow/core/kernels/data/map_batching_utils.h"
+
+#include <algorithm>
+
+#include "absl/memory/memory.h"
+#include "tensorflow/core/framework/function.pb.h"
+#include "tensorflow/core/framework/node_def_util.h"
+#include "tensorflow/core/framework/op.h"
+#include "tensorflow/core/grappler/optimizers/data/function_utils.h"
+#include "tensorflow/core/grappler/optimizers/data/graph_utils.h"
+#include "tensorflow/core/grappler/optimizers/data/vectorization_utils.h"
+#include "tensorflow/core/lib/core/errors.h"
+#include "tensorflow/core/lib/strings/strcat.h"
+#include "tensorflow/core/util/batch_util.h"
+
+namespace tensorflow {
+namespace data {
+namespace {
+
+constexpr char kMapDefunOp[] = "MapDefun";
+
+// Number of invocations used to measure the per-element time of a group size.
+constexpr int64 kCallsPerMeasurement = 8;
+
+// Number of invocations after which the tuner searches for the best group size
+// again.
+constexpr int64 kCallsBetweenSearches = 1000;
+
+// The search stops once the per-element time of a group size is this much
+// larger than the best per-element time found so far.
+constexpr double kSearchStopRatio = 1.1;
+
+// Number of failed invocations after which the tuner stops grouping elements.
+constexpr int64 kMaxFailures = 3;
+
+}  // namespace
+
+Status CreateBatchedFunction(
+    const FunctionLibraryDefinition& lib_def, const NameAttrList& func,
+    int64 num_captured_inputs, const DataTypeVector& output_types,
+    const std::vector<PartialTensorShape>& output_shapes,
+    NameAttrList* batched_func,
+    std::unique_ptr<FunctionLibraryDefinition>* batched_lib_def) {
+  const FunctionDef* fdef = lib_def.Find(func.name());
+  if (fdef == nullptr) {
+    return errors::NotFound("Could not find function ", func.name());
+  }
+  if (grappler::function_utils::IsFunctionStateful(lib_def, *fdef)) {
+    return errors::FailedPrecondition("Function ", func.name(),
+                                      " is stateful and cannot be batched.");
+  }
+  if (output_types.size() != fdef->signature().output_arg_size() ||
+      output_shapes.size() != output_types.size()) {
+    return errors::InvalidArgument(
+        "Output types and shapes do not match the outputs of function ",
+        func.name());
+  }
+
+  FunctionDefLibrary library = lib_def.ToProto();
+  FunctionDef* wrapper = library.add_function();
+  *wrapper->mutable_signature() = fdef->signature();
+  grappler::graph_utils::SetUniqueGraphFunctionName("batched_fn", &library,
+                                                    wrapper);
+
+  NodeDef* map_defun_node = wrapper->add_node_def();
+  map_defun_node->set_op(kMapDefunOp);
+  grappler::function_utils::SetUniqueFunctionNodeName(
+      map_defun_node->op(), wrapper, map_defun_node);
+  DataTypeVector arg_types;
+  for (const auto& input : wrapper->signature().input_arg()) {
+    if (input.type() == DT_INVALID) {
+      return errors::Unimplemented("Function ", func.name(),
+                                   " has polymorphic arguments.");
+    }
+    arg_types.push_back(input.type());
+    map_defun_node->add_input(input.name());
+  }
+  if (num_captured_inputs < 0 ||
+      num_captured_inputs >= static_cast<int64>(arg_types.size())) {
+    return errors::InvalidArgument("Function ", func.name(), " has ",
+                                   arg_types.size(), " arguments, of which ",
+                                   num_captured_inputs, " are captured.");
+  }
+  DataTypeVector captured_types(arg_types.end() - num_captured_inputs,
+                                arg_types.end());
+  arg_types.resize(arg_types.size() - num_captured_inputs);
+  AddNodeAttr("Targuments", arg_types, map_defun_node);
+  AddNodeAttr("Tcaptured", captured_types, map_defun_node);
+  AddNodeAttr("output_types", output_types, map_defun_node);
+  AddNodeAttr("output_shapes", output_shapes, map_defun_node);
+  AddNodeAttr("f", func, map_defun_node);
+  const string output_prefix =
+      strings::StrCat(map_defun_node->name(), ":output:");
+  for (size_t i = 0; i < wrapper->signature().output_arg_size(); ++i) {
+    (*wrapper->mutable_ret())[wrapper->signature().output_arg(i).name()] =
+        strings::StrCat(output_prefix, i);
+  }
+
+  // Vectorization requires the output shapes to be fully defined. If some ops
+  // cannot be vectorized, the result keeps a `MapDefun` node for them.
+  const FunctionDef* result = wrapper;
+  bool fully_defined = true;
+  for (const auto& shape : output_shapes) {
+    fully_defined = fully_defined && shape.IsFullyDefined();
+  }
+  if (fully_defined) {
+    FunctionDef* vectorized = nullptr;
+    Status s = grappler::vectorization_utils::VectorizeMapDefun(
+        *wrapper, wrapper->node_def(0), &library, &vectorized);
+    if (s.ok()) {
+      result = vectorized;
+    } else {
+      VLOG(1) << "Failed to vectorize function " << func.name()
+              << "; it will be applied to each element of a batch: " << s;
+    }
+  }
+
+  batched_func->set_name(result->signature().name());
+  *batched_lib_def = absl::make_unique<FunctionLibraryDefinition>(
+      OpRegistry::Global(), library);
+  return Status::OK();
+}
+
+bool CanStackElements(const std::vector<std::vector<Tensor>>& elements) {
+  if (elements.empty()) {
+    return false;
+  }
+  const std::vector<Tensor>& first = elements[0];
+  for (const auto& element : elements) {
+    if (element.size() != first.size()) {
+      return false;
+    }
+    for (size_t i = 0; i < element.size(); ++i) {
+      if (element[i].dtype() != first[i].dtype() ||
+          element[i].shape() != first[i].shape()) {
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+Status StackElements(Allocator* allocator,
+                     const std::vector<std::vector<Tensor>>& elements,
+                     std::vector<Tensor>* batch) {
+  if (!CanStackElements(elements)) {
+    return errors::InvalidArgument(
+        "Elements must have components of the same types and shapes.");
+  }
+  const int64 num_elements = elements.size();
+  batch->clear();
+  batch->reserve(elements[0].size());
+  for (size_t i = 0; i < elements[0].size(); ++i) {
+    TensorShape shape = elements[0][i].shape();
+    shape.InsertDim(0, num_elements);
+    batch->emplace_back(allocator, elements[0][i].dtype(), shape);
+    for (int64 j = 0; j < num_elements; ++j) {
+      TF_RETURN_IF_ERROR(
+          batch_util::CopyElementToSlice(elements[j][i], &batch->back(), j));
+    }
+  }
+  return Status::OK();
+}
+
+Status UnstackElement(Allocator* allocator, const std::vector<Tensor>& batch,
+                      int64 index, std::vector<Tensor>* element) {
+  element->clear();
+  element->reserve(batch.size());
+  for (const Tensor& component : batch) {
+    if (component.dims() == 0 || index >= component.dim_size(0)) {
+      return errors::InvalidArgument("Cannot extract element ", index,
+                                     " from a batch component of shape ",
+                                     component.shape().DebugString());
+    }
+    TensorShape shape = component.shape();
+    shape.RemoveDim(0);
+    element->emplace_back(allocator, component.dtype(), shape);
+    TF_RETURN_IF_ERROR(
+        batch_util::CopySliceToElement(component, &element->back(), index));
+  }
+  return Status::OK();
+}
+
+GroupSizeTuner::GroupSizeTuner(int64 max_group_size)
+    : max_group_size_(std::max(max_group_size, int64{1})) {}
+
+void GroupSizeTuner::RecordCall(int64 group_size, int64 num_elements,
+                                int64 time_nanos) {
+  // Invocations that started before the group size changed are ignored.
+  if (disabled_ || group_size != group_size_ || num_elements <= 0) {
+    return;
+  }
+  num_calls_++;
+  num_elements_ += num_elements;
+  time_nanos_ += time_nanos;
+  if (!searching_) {
+    if (num_calls_ >= kCallsBetweenSearches) {
+      searching_ = true;
+      Measure(1);
+    }
+    return;
+  }
+  if (num_calls_ < kCallsPerMeasurement) {
+    return;
+  }
+  const double time = static_cast<double>(time_nanos_) / num_elements_;
+  if (group_size_ == 1 || time < best_time_) {
+    best_time_ = time;
+    best_group_size_ = group_size_;
+  }
+  if (time > best_time_ * kSearchStopRatio ||
+      group_size_ >= max_group_size_) {
+    searching_ = false;
+    Measure(best_group_size_);
+    VLOG(2) << "Using a group size of " << best_group_size_;
+    return;
+  }
+  Measure(std::min(group_size_ * 2, max_group_size_));
+}
+
+void GroupSizeTuner::RecordFailure(int64 group_size) {
+  if (disabled_ || group_size <= 1) {
+    return;
+  }
+  if (++num_failures_ >= kMaxFailures) {
+    disabled_ = true;
+    searching_ = false;
+    Measure(1);
+    VLOG(2) << "Grouping is disabled after " << num_failures_ << " failures";
+    return;
+  }
+  if (group_size == group_size_) {
+    // Settles on the best group size found so far, unless it is the failed
+    // one. A later search may try larger group sizes again.
+    searching_ = false;
+    if (best_group_size_ >= group_size) {
+      best_group_size_ = 1;
+    }
+    Measure(best_group_size_);
+  }
+}
+
+void GroupSizeTuner::Measure(int64 group_size) {
+  group_size_ = group_size;
+  num_calls_ = 0;
+  num_elements_ = 0;
+  time_nanos_ = 0;
+}
+
+}  // namespace data
+}  // namespace tensorflow
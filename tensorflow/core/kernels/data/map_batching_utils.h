@@ -0,0 +1,124 @@
+/* Copyright 2019 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#ifndef TENSORFLOW_CORE_KERNELS_DATA_MAP_BATCHING_UTILS_H_
+#define TENSORFLOW_CORE_KERNELS_DATA_MAP_BATCHING_UTILS_H_
+
+#include <memory>
+#include <vector>
+
+#include "tensorflow/core/framework/allocator.h"
+#include "tensorflow/core/framework/attr_value.pb.h"
+#include "tensorflow/core/framework/function.h"
+#include "tensorflow/core/framework/partial_tensor_shape.h"
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/lib/core/status.h"
+
+namespace tensorflow {
+namespace data {
+
+// Element batching
+// ----------------
+//
+// A parallel map can group several input elements into a single invocation of
+// a batched version of its function, amortizing the per-invocation overhead
+// of the function runtime. The batched function takes the input elements
+// stacked along a new 0th dimension (and the captured inputs unchanged) and
+// returns the output elements stacked the same way. It applies the original
+// function using `MapDefun`, and is vectorized where the ops of the original
+// function have registered vectorizers.
+//
+// Element batching is enabled by
+// `tf.data.experimental.OptimizationOptions.map_element_batching`, which sets
+// `IteratorContext::map_element_batching()`. It only applies to stateless
+// functions, because elements of a failed batch are recomputed one by one.
+
+// Creates a function that applies `func` to each slice along the 0th dimension
+// of its non-captured arguments. `num_captured_inputs` is the number of
+// trailing arguments of `func` that are captured inputs, and `output_types`
+// and `output_shapes` describe the (unbatched) outputs of `func`. On success,
+// `*batched_func` refers to the new function, defined in `*batched_lib_def`
+// together with the definitions from `lib_def`.
+Status CreateBatchedFunction(
+    const FunctionLibraryDefinition& lib_def, const NameAttrList& func,
+    int64 num_captured_inputs, const DataTypeVector& output_types,
+    const std::vector<PartialTensorShape>& output_shapes,
+    NameAttrList* batched_func,
+    std::unique_ptr<FunctionLibraryDefinition>* batched_lib_def);
+
+// Returns true if `elements` can be stacked along a new 0th dimension, i.e.
+// there is at least one element and all elements have components of the same
+// number, types and shapes.
+bool CanStackElements(const std::vector<std::vector<Tensor>>& elements);
+
+// Stacks the components of `elements` along a new 0th dimension.
+Status StackElements(Allocator* allocator,
+                     const std::vector<std::vector<Tensor>>& elements,
+                     std::vector<Tensor>* batch);
+
+// Copies the `index`-th slice along the 0th dimension of each component of
+// `batch` into `element`.
+Status UnstackElement(Allocator* allocator, const std::vector<Tensor>& batch,
+                      int64 index, std::vector<Tensor>* element);
+
+// Chooses the number of input elements that a parallel map groups into a
+// single invocation of its batched function.
+//
+// The tuner measures the per-element time of the invocations that use the
+// current group size. It starts with a group size of 1 and doubles it while
+// this improves the per-element time, then settles on the best group size
+// and periodically repeats the search to adapt to changes in the input. A
+// group size whose invocations fail is treated as slower than the others, and
+// after repeated failures the tuner settles on a group size of 1 for good.
+//
+// This class is not thread-safe.
+class GroupSizeTuner {
+ public:
+  explicit GroupSizeTuner(int64 max_group_size);
+
+  // Returns the group size to use for the next invocation.
+  int64 group_size() const { return group_size_; }
+
+  // Records that an invocation using `group_size` transformed `num_elements`
+  // elements in `time_nanos` nanoseconds.
+  void RecordCall(int64 group_size, int64 num_elements, int64 time_nanos);
+
+  // Records that an invocation using `group_size` failed, so that its
+  // elements were transformed one by one.
+  void RecordFailure(int64 group_size);
+
+  // Returns true if repeated failures disabled grouping.
+  bool disabled() const { return disabled_; }
+
+ private:
+  // Starts measuring the per-element time of `group_size`.
+  void Measure(int64 group_size);
+
+  const int64 max_group_size_;
+  int64 group_size_ = 1;
+  bool searching_ = true;
+  int64 best_group_size_ = 1;
+  double best_time_ = 0;
+  int64 num_failures_ = 0;
+  bool disabled_ = false;
+  // Statistics of the invocations recorded since the last call to `Measure()`.
+  int64 num_calls_ = 0;
+  int64 num_elements_ = 0;
+  int64 time_nanos_ = 0;
+};
+
+}  // namespace data
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_CORE_KERNELS_DATA_MAP_BATCHING_UTILS_H_
@@ -0,0 +1,199 @@
+/* Copyright 2019 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#include "tensorflow/core/kernels/data/map_batching_utils.h"
+
+#include "absl/memory/memory.h"
+#include "tensorflow/core/framework/function_testlib.h"
+#include "tensorflow/core/framework/op.h"
+#include "tensorflow/core/framework/tensor_testutil.h"
+#include "tensorflow/core/lib/core/errors.h"
+#include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/platform/test.h"
+
+namespace tensorflow {
+namespace data {
+namespace {
+
+std::unique_ptr<FunctionLibraryDefinition> MakeLibrary(
+    const std::vector<FunctionDef>& functions) {
+  FunctionDefLibrary proto;
+  for (const auto& fdef : functions) {
+    *proto.add_function() = fdef;
+  }
+  return absl::make_unique<FunctionLibraryDefinition>(OpRegistry::Global(),
+                                                      proto);
+}
+
+NameAttrList MakeFunc(const string& name) {
+  NameAttrList func;
+  func.set_name(name);
+  return func;
+}
+
+TEST(CreateBatchedFunctionTest, Stateless) {
+  auto lib_def = MakeLibrary({test::function::XTimesTwoInt32()});
+  NameAttrList batched_func;
+  std::unique_ptr<FunctionLibraryDefinition> batched_lib_def;
+  TF_ASSERT_OK(CreateBatchedFunction(
+      *lib_def, MakeFunc("XTimesTwoInt32"), /*num_captured_inputs=*/0,
+      {DT_INT32}, {PartialTensorShape({})}, &batched_func, &batched_lib_def));
+
+  const FunctionDef* fdef = batched_lib_def->Find(batched_func.name());
+  ASSERT_NE(fdef, nullptr);
+  ASSERT_EQ(fdef->signature().input_arg_size(), 1);
+  EXPECT_EQ(fdef->signature().input_arg(0).type(), DT_INT32);
+  ASSERT_EQ(fdef->signature().output_arg_size(), 1);
+  EXPECT_EQ(fdef->signature().output_arg(0).type(), DT_INT32);
+  // The original function remains available to a `MapDefun` fallback.
+  EXPECT_NE(batched_lib_def->Find("XTimesTwoInt32"), nullptr);
+}
+
+TEST(CreateBatchedFunctionTest, Stateful) {
+  auto lib_def = MakeLibrary({test::function::RandomUniform()});
+  NameAttrList batched_func;
+  std::unique_ptr<FunctionLibraryDefinition> batched_lib_def;
+  EXPECT_TRUE(errors::IsFailedPrecondition(CreateBatchedFunction(
+      *lib_def, MakeFunc("RandomUniform"), /*num_captured_inputs=*/0,
+      {DT_FLOAT}, {PartialTensorShape()}, &batched_func, &batched_lib_def)));
+}
+
+TEST(CreateBatchedFunctionTest, InvalidCapturedInputs) {
+  auto lib_def = MakeLibrary({test::function::XTimesTwoInt32()});
+  NameAttrList batched_func;
+  std::unique_ptr<FunctionLibraryDefinition> batched_lib_def;
+  EXPECT_TRUE(errors::IsInvalidArgument(CreateBatchedFunction(
+      *lib_def, MakeFunc("XTimesTwoInt32"), /*num_captured_inputs=*/1,
+      {DT_INT32}, {PartialTensorShape({})}, &batched_func, &batched_lib_def)));
+}
+
+TEST(StackElementsTest, StackAndUnstack) {
+  std::vector<std::vector<Tensor>> elements = {
+      {test::AsTensor<int64>({1, 2}), test::AsScalar<float>(1.0f)},
+      {test::AsTensor<int64>({3, 4}), test::AsScalar<float>(2.0f)},
+      {test::AsTensor<int64>({5, 6}), test::AsScalar<float>(3.0f)}};
+  ASSERT_TRUE(CanStackElements(elements));
+
+  std::vector<Tensor> batch;
+  TF_ASSERT_OK(StackElements(cpu_allocator(), elements, &batch));
+  ASSERT_EQ(batch.size(), 2);
+  test::ExpectTensorEqual<int64>(
+      batch[0], test::AsTensor<int64>({1, 2, 3, 4, 5, 6}, {3, 2}));
+  test::ExpectTensorEqual<float>(batch[1],
+                                 test::AsTensor<float>({1.0f, 2.0f, 3.0f}));
+
+  for (size_t i = 0; i < elements.size(); ++i) {
+    std::vector<Tensor> element;
+    TF_ASSERT_OK(UnstackElement(cpu_allocator(), batch, i, &element));
+    ASSERT_EQ(element.size(), 2);
+    test::ExpectTensorEqual<int64>(element[0], elements[i][0]);
+    test::ExpectTensorEqual<float>(element[1], elements[i][1]);
+  }
+  std::vector<Tensor> element;
+  EXPECT_TRUE(errors::IsInvalidArgument(
+      UnstackElement(cpu_allocator(), batch, 3, &element)));
+}
+
+TEST(StackElementsTest, MismatchedElements) {
+  EXPECT_FALSE(CanStackElements({}));
+  EXPECT_FALSE(CanStackElements(
+      {{test::AsTensor<int64>({1, 2})}, {test::AsTensor<int64>({3})}}));
+  EXPECT_FALSE(CanStackElements(
+      {{test::AsTensor<int64>({1})}, {test::AsTensor<int32>({1})}}));
+  EXPECT_FALSE(CanStackElements(
+      {{test::AsTensor<int64>({1})},
+       {test::AsTensor<int64>({1}), test::AsTensor<int64>({1})}}));
+
+  std::vector<Tensor> batch;
+  EXPECT_TRUE(errors::IsInvalidArgument(StackElements(
+      cpu_allocator(),
+      {{test::AsTensor<int64>({1, 2})}, {test::AsTensor<int64>({3})}},
+      &batch)));
+}
+
+// Records `num_calls` invocations of the current group size, each of which
+// takes `time_fn(group_size)` nanoseconds per element.
+void RecordCalls(GroupSizeTuner* tuner, int num_calls,
+                 const std::function<int64(int64)>& time_fn) {
+  for (int i = 0; i < num_calls; ++i) {
+    const int64 group_size = tuner->group_size();
+    tuner->RecordCall(group_size, group_size,
+                      group_size * time_fn(group_size));
+  }
+}
+
+TEST(GroupSizeTunerTest, FindsBestGroupSize) {
+  GroupSizeTuner tuner(/*max_group_size=*/64);
+  EXPECT_EQ(tuner.group_size(), 1);
+  // The per-element time is lowest for a group size of 4.
+  auto time_fn = [](int64 group_size) {
+    return 100 / group_size + 10 * group_size;
+  };
+  RecordCalls(&tuner, 100, time_fn);
+  EXPECT_EQ(tuner.group_size(), 4);
+}
+
+TEST(GroupSizeTunerTest, RespectsMaximum) {
+  GroupSizeTuner tuner(/*max_group_size=*/4);
+  RecordCalls(&tuner, 100, [](int64 group_size) { return 100 / group_size; });
+  EXPECT_EQ(tuner.group_size(), 4);
+}
+
+TEST(GroupSizeTunerTest, IgnoresStaleCalls) {
+  GroupSizeTuner tuner(/*max_group_size=*/64);
+  for (int i = 0; i < 100; ++i) {
+    tuner.RecordCall(/*group_size=*/2, /*num_elements=*/2, /*time_nanos=*/1);
+  }
+  EXPECT_EQ(tuner.group_size(), 1);
+}
+
+TEST(GroupSizeTunerTest, SearchesAgain) {
+  GroupSizeTuner tuner(/*max_group_size=*/64);
+  RecordCalls(&tuner, 100, [](int64 group_size) { return 100 / group_size; });
+  EXPECT_EQ(tuner.group_size(), 64);
+  // After enough invocations, the tuner adapts to a change in the costs.
+  RecordCalls(&tuner, 2000, [](int64 group_size) { return group_size; });
+  EXPECT_EQ(tuner.group_size(), 1);
+}
+
+TEST(GroupSizeTunerTest, FailureStopsSearch) {
+  GroupSizeTuner tuner(/*max_group_size=*/64);
+  RecordCalls(&tuner, 8, [](int64 group_size) { return 100 / group_size; });
+  EXPECT_EQ(tuner.group_size(), 2);
+  tuner.RecordFailure(/*group_size=*/2);
+  EXPECT_EQ(tuner.group_size(), 1);
+  EXPECT_FALSE(tuner.disabled());
+  // The tuner settled on a group size of 1 instead of searching further.
+  RecordCalls(&tuner, 100, [](int64 group_size) { return 100 / group_size; });
+  EXPECT_EQ(tuner.group_size(), 1);
+}
+
+TEST(GroupSizeTunerTest, RepeatedFailuresDisableGrouping) {
+  GroupSizeTuner tuner(/*max_group_size=*/64);
+  for (int i = 0; i < 10; ++i) {
+    RecordCalls(&tuner, 2000,
+                [](int64 group_size) { return 100 / group_size; });
+    if (tuner.group_size() > 1) {
+      tuner.RecordFailure(tuner.group_size());
+    }
+  }
+  EXPECT_TRUE(tuner.disabled());
+  EXPECT_EQ(tuner.group_size(), 1);
+  RecordCalls(&tuner, 2000, [](int64 group_size) { return 100 / group_size; });
+  EXPECT_EQ(tuner.group_size(), 1);
+}
+
+}  // namespace
+}  // namespace data
+}  // namespace tensorflow
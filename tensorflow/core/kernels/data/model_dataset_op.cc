@@ -19,6 +19,7 @@ limitations under the License.
 #include "tensorflow/core/framework/model.h"
 #include "tensorflow/core/framework/partial_tensor_shape.h"
 #include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/kernels/data/stats_utils.h"
 #include "tensorflow/core/lib/random/random.h"
 #include "tensorflow/core/platform/cpu_info.h"
 #include "tensorflow/core/util/ptr_util.h"
@@ -29,6 +30,10 @@ namespace {
 
 constexpr int64 kOptimizationPeriodThresholdMs = 60 * EnvTime::kSecondsToMillis;
 
+// Minimum period between logging the statistics of the input pipeline, which
+// happens only if verbose logging is enabled.
+constexpr int64 kStatsLogPeriodMs = 60 * EnvTime::kSecondsToMillis;
+
 // Default share of available RAM that can be used by model's internal buffers.
 constexpr double kRamBudgetShare = 0.5;
 
@@ -206,7 +211,45 @@ class ModelDatasetOp : public UnaryDatasetOpKernel {
           }
           current_time_ms = ctx->env()->NowMicros() / EnvTime::kMillisToMicros;
           last_optimization_ms = current_time_ms;
+          ReportStats(ctx.get(), current_time_ms);
+        }
+      }
+
+      // Exports the statistics of the input pipeline, including the node that
+      // the model predicts to be its bottleneck, to the stats aggregator (if
+      // any) and periodically logs them if verbose logging is enabled.
+      void ReportStats(IteratorContext* ctx, int64 current_time_ms) {
+        const auto& stats_aggregator = ctx->stats_aggregator();
+        const bool log =
+            VLOG_IS_ON(1) &&
+            current_time_ms >= last_stats_log_ms_ + kStatsLogPeriodMs;
+        if (!stats_aggregator && !log) {
+          return;
         }
+        model::ModelStats stats = model_->CollectStats();
+        model::ComputeThroughput(last_stats_, &stats);
+        if (stats_aggregator && !stats.nodes.empty()) {
+          const int64 step = stats.nodes.front().num_elements;
+          for (const auto& node : stats.nodes) {
+            stats_aggregator->AddScalar(
+                stats_utils::ThroughputScalarName(node.name),
+                static_cast<float>(node.throughput), step);
+            stats_aggregator->AddScalar(
+                stats_utils::WaitTimeScalarName(node.name),
+                static_cast<float>(node.wait_time), step);
+            stats_aggregator->AddScalar(
+                stats_utils::BufferSizeScalarName(node.name),
+                static_cast<float>(node.buffered_elements), step);
+            stats_aggregator->AddScalar(
+                stats_utils::BottleneckScalarName(node.name),
+                node.name == stats.bottleneck ? 1.0f : 0.0f, step);
+          }
+        }
+        if (log) {
+          VLOG(1) << "Input pipeline statistics:\n" << stats.DebugString();
+          last_stats_log_ms_ = current_time_ms;
+        }
+        last_stats_ = std::move(stats);
       }
 
       mutex mu_;
@@ -215,6 +258,10 @@ class ModelDatasetOp : public UnaryDatasetOpKernel {
       std::unique_ptr<Thread> optimize_thread_ GUARDED_BY(mu_);
       bool cancelled_ GUARDED_BY(mu_) = false;
       std::unique_ptr<IteratorBase> input_impl_;
+
+      // The following fields are only accessed by the optimize thread.
+      model::ModelStats last_stats_;
+      int64 last_stats_log_ms_ = 0;
     };
 
     const DatasetBase* input_;
@@ -14,6 +14,8 @@ limitations under the License.
 ==============================================================================*/
 #include "tensorflow/core/kernels/data/parallel_map_dataset_op.h"
 
+#include <algorithm>
+#include <atomic>
 #include <deque>
 
 #include "tensorflow/core/common_runtime/function.h"
@@ -24,6 +26,7 @@ limitations under the License.
 #include "tensorflow/core/framework/stats_aggregator.h"
 #include "tensorflow/core/framework/tensor.h"
 #include "tensorflow/core/kernels/data/dataset_utils.h"
+#include "tensorflow/core/kernels/data/map_batching_utils.h"
 #include "tensorflow/core/kernels/data/name_utils.h"
 #include "tensorflow/core/kernels/data/stats_utils.h"
 #include "tensorflow/core/lib/core/errors.h"
@@ -159,34 +162,111 @@ class ParallelMapDatasetOp::Dataset : public DatasetBase {
         : dataset_(dataset) {}
 
     Status InitFunc(IteratorContext* ctx) override {
-      return dataset_->captured_func_->Instantiate(
-          ctx, &instantiated_captured_func_);
+      TF_RETURN_IF_ERROR(dataset_->captured_func_->Instantiate(
+          ctx, &instantiated_captured_func_));
+      if (ctx->map_element_batching()) {
+        CapturedFunction* batched_captured_func =
+            dataset_->BatchedCapturedFunc();
+        Status s =
+            batched_captured_func == nullptr
+                ? errors::Unimplemented("The function cannot be batched.")
+                : batched_captured_func->Instantiate(
+                      ctx, &instantiated_batched_captured_func_);
+        if (!s.ok()) {
+          VLOG(1) << "Element batching is disabled: " << s;
+          instantiated_batched_captured_func_.reset();
+        }
+      }
+      return Status::OK();
     }
 
     void MapFunc(IteratorContext* ctx, const string& prefix,
                  std::vector<Tensor> input_element, std::vector<Tensor>* result,
                  StatusCallback done) override {
-      auto map_func = [this](IteratorContext* ctx, const string& prefix,
-                             std::vector<Tensor> input_element,
+      Run(ctx, prefix, instantiated_captured_func_.get(),
+          std::move(input_element), result, std::move(done));
+    }
+
+    bool CanBatch() const override {
+      return instantiated_batched_captured_func_ != nullptr;
+    }
+
+    void BatchedMapFunc(IteratorContext* ctx, const string& prefix,
+                        std::vector<Tensor> input, std::vector<Tensor>* output,
+                        StatusCallback done) override {
+      Run(ctx, prefix, instantiated_batched_captured_func_.get(),
+          std::move(input), output, std::move(done));
+    }
+
+   private:
+    void Run(IteratorContext* ctx, const string& prefix,
+             const InstantiatedCapturedFunction* func,
+             std::vector<Tensor> input, std::vector<Tensor>* result,
+             StatusCallback done) {
+      auto map_func = [func](IteratorContext* ctx, const string& prefix,
+                             std::vector<Tensor> input,
                              std::vector<Tensor>* result, StatusCallback done) {
-        instantiated_captured_func_->RunAsync(ctx, std::move(input_element),
-                                              result, std::move(done), prefix);
+        func->RunAsync(ctx, std::move(input), result, std::move(done), prefix);
       };
       if (!dataset_->captured_func_->use_inter_op_parallelism()) {
-        (*ctx->runner())(std::bind(map_func, ctx, prefix,
-                                   std::move(input_element), result,
-                                   std::move(done)));
+        (*ctx->runner())(std::bind(map_func, ctx, prefix, std::move(input),
+                                   result, std::move(done)));
       } else {
-        map_func(ctx, prefix, std::move(input_element), result,
-                 std::move(done));
+        map_func(ctx, prefix, std::move(input), result, std::move(done));
       }
     }
 
-   private:
     const Dataset* const dataset_;
     std::unique_ptr<InstantiatedCapturedFunction> instantiated_captured_func_;
+    std::unique_ptr<InstantiatedCapturedFunction>
+        instantiated_batched_captured_func_;
   };
 
+  // Returns the batched version of `captured_func_`, or nullptr if the
+  // function cannot be batched. It is only created when an iterator enables
+  // element batching, so that other iterators do not pay for it.
+  CapturedFunction* BatchedCapturedFunc() const
+      LOCKS_EXCLUDED(batched_mu_) {
+    mutex_lock l(batched_mu_);
+    if (!batched_func_created_) {
+      batched_func_created_ = true;
+      Status s = CreateBatchedCapturedFunc(&batched_captured_func_);
+      if (!s.ok()) {
+        VLOG(1) << "Element batching is disabled: " << s;
+        batched_captured_func_.reset();
+      }
+    }
+    return batched_captured_func_.get();
+  }
+
+  Status CreateBatchedCapturedFunc(
+      std::unique_ptr<CapturedFunction>* batched_captured_func) const {
+    if (!captured_func_->short_circuit_info().indices.empty()) {
+      return errors::Unimplemented(
+          "Functions that forward their arguments are not batched.");
+    }
+    NameAttrList batched_func;
+    std::unique_ptr<FunctionLibraryDefinition> batched_lib_def;
+    TF_RETURN_IF_ERROR(CreateBatchedFunction(
+        *captured_func_->lib_def(), captured_func_->func(),
+        captured_func_->captured_inputs().size(), output_types_,
+        output_shapes_, &batched_func, &batched_lib_def));
+    FunctionMetadata::Params params;
+    params.is_multi_device_function =
+        captured_func_->is_multi_device_function();
+    params.use_inter_op_parallelism =
+        captured_func_->use_inter_op_parallelism();
+    std::shared_ptr<FunctionMetadata> batched_func_metadata;
+    TF_RETURN_IF_ERROR(
+        FunctionMetadata::Create(std::move(batched_func),
+                                 std::move(batched_lib_def), params,
+                                 &batched_func_metadata));
+    std::vector<Tensor> captured_inputs = captured_func_->captured_inputs();
+    return CapturedFunction::Create(/*ctx=*/nullptr, batched_func_metadata,
+                                    std::move(captured_inputs),
+                                    batched_captured_func);
+  }
+
   const DatasetBase* const input_;
   const int32 num_parallel_calls_;
   const DataTypeVector output_types_;
@@ -194,6 +274,12 @@ class ParallelMapDatasetOp::Dataset : public DatasetBase {
   const bool sloppy_;
   const bool preserve_cardinality_;
   const std::unique_ptr<CapturedFunction> captured_func_;
+  mutable mutex batched_mu_;
+  mutable bool batched_func_created_ GUARDED_BY(batched_mu_) = false;
+  // The batched version of `captured_func_`, or nullptr if it has not been
+  // created or the function cannot be batched.
+  mutable std::unique_ptr<CapturedFunction> batched_captured_func_
+      GUARDED_BY(batched_mu_);
 };
 
 ParallelMapDatasetOp::ParallelMapDatasetOp(OpKernelConstruction* ctx)
@@ -229,9 +315,9 @@ void ParallelMapDatasetOp::MakeDataset(OpKernelContext* ctx, DatasetBase* input,
     metrics::RecordTFDataAutotune(kDatasetType);
   }
 
-  *output =
-      new Dataset(ctx, input, num_parallel_calls, output_types_, output_shapes_,
-                  sloppy_, std::move(captured_func), preserve_cardinality_);
+  *output = new Dataset(ctx, input, num_parallel_calls, output_types_,
+                        output_shapes_, sloppy_, std::move(captured_func),
+                        preserve_cardinality_);
 }
 
 namespace {
@@ -242,6 +328,10 @@ constexpr char kEndOfInputSuffix[] = ".end_of_input";
 constexpr char kCodeSuffix[] = ".code";
 constexpr char kErrorMessage[] = ".error_message";
 
+// Maximum number of input elements grouped into a single invocation of a
+// batched map function.
+constexpr int64 kMaxGroupSize = 64;
+
 class ParallelMapIterator : public DatasetBaseIterator {
  public:
   struct Params {
@@ -288,9 +378,13 @@ class ParallelMapIterator : public DatasetBaseIterator {
     // NOTE: We do not synchronize the following access to num_parallel_calls_
     // to minimize the tracing overhead.
     int64 parallelism = num_parallel_calls_->value;
+    int64 group_size =
+        batching_ ? thread_safety_analysis::ts_unchecked_read(group_size_tuner_)
+                        ->group_size()
+                  : 1;
     return strings::StrCat(this->prefix(), "#parallelism=", parallelism,
                            ",autotune=", autotune_, ",deterministic=", !sloppy_,
-                           "#");
+                           ",group_size=", group_size, "#");
   }
 
   Status Initialize(IteratorContext* ctx) override {
@@ -300,7 +394,16 @@ class ParallelMapIterator : public DatasetBaseIterator {
     }
     TF_RETURN_IF_ERROR(
         input_dataset_->MakeIterator(ctx, prefix(), &input_impl_));
-    return parallel_map_functor_->InitFunc(ctx);
+    TF_RETURN_IF_ERROR(parallel_map_functor_->InitFunc(ctx));
+    batching_ = parallel_map_functor_->CanBatch();
+    if (batching_) {
+      // A call never produces more than `num_parallel_calls` results, which
+      // (with autotuning) is at most the size of the runner threadpool.
+      group_size_tuner_ = absl::make_unique<GroupSizeTuner>(
+          std::min(kMaxGroupSize,
+                   static_cast<int64>(num_parallel_calls_->value)));
+    }
+    return Status::OK();
   }
 
   Status GetNextInternal(IteratorContext* ctx, std::vector<Tensor>* out_tensors,
@@ -429,8 +532,10 @@ class ParallelMapIterator : public DatasetBaseIterator {
     }
   }
 
-  void CallCompleted(const std::shared_ptr<IteratorContext>& ctx,
-                     const std::shared_ptr<InvocationResult>& result)
+  // Marks the invocation that produces `results` as completed.
+  void CallCompleted(
+      const std::shared_ptr<IteratorContext>& ctx,
+      const std::vector<std::shared_ptr<InvocationResult>>& results)
       LOCKS_EXCLUDED(*mu_) {
     mutex_lock l(*mu_);
     num_calls_--;
@@ -442,26 +547,42 @@ class ParallelMapIterator : public DatasetBaseIterator {
               static_cast<float>(num_parallel_calls_->value),
           num_elements());
     }
-    RecordBufferEnqueue(ctx.get(), result->return_values);
-    result->notification.Notify();
+    for (const auto& result : results) {
+      RecordBufferEnqueue(ctx.get(), result->return_values);
+      result->notification.Notify();
+    }
     cond_var_->notify_all();
   }
 
-  void CallFunction(const std::shared_ptr<IteratorContext>& ctx,
-                    const std::shared_ptr<InvocationResult>& result)
-      LOCKS_EXCLUDED(*mu_) {
+  // Produces `results` by applying the map function to the next
+  // `results.size()` input elements. `group_size` is the group size of the
+  // tuner when the call was scheduled, which `results.size()` may be less
+  // than if the degree of parallelism is lower.
+  void CallFunction(
+      const std::shared_ptr<IteratorContext>& ctx,
+      const std::vector<std::shared_ptr<InvocationResult>>& results,
+      int64 group_size) LOCKS_EXCLUDED(*mu_) {
+    if (results.size() > 1) {
+      CallBatchedFunction(ctx, results, group_size);
+      return;
+    }
+    const std::shared_ptr<InvocationResult>& result = results.front();
     // Get the next input element.
     std::vector<Tensor> input_element;
     result->status =
         input_impl_->GetNext(ctx.get(), &input_element, &result->end_of_input);
     if (result->end_of_input || !result->status.ok()) {
-      CallCompleted(ctx, result);
+      CallCompleted(ctx, results);
       return;
     }
 
-    auto done = [this, ctx, result](Status status) {
-      result->status.Update(status);
-      CallCompleted(ctx, result);
+    const int64 start_nanos = batching_ ? EnvTime::Default()->NowNanos() : 0;
+    auto done = [this, ctx, results, group_size, start_nanos](Status status) {
+      results.front()->status.Update(status);
+      if (batching_ && status.ok()) {
+        RecordGroupCall(group_size, /*num_elements=*/1, start_nanos);
+      }
+      CallCompleted(ctx, results);
     };
 
     // Apply the map function on `input_element`, storing the result in
@@ -471,6 +592,118 @@ class ParallelMapIterator : public DatasetBaseIterator {
                                    &result->return_values, std::move(done));
   }
 
+  // Produces `results` by stacking the next `results.size()` input elements
+  // and applying the batched map function to them.
+  void CallBatchedFunction(
+      const std::shared_ptr<IteratorContext>& ctx,
+      const std::vector<std::shared_ptr<InvocationResult>>& results,
+      int64 group_size) LOCKS_EXCLUDED(*mu_) {
+    // Get the next input elements. Elements whose retrieval failed are not
+    // part of the batch, and once the end of the input is reached, all
+    // remaining results are marked accordingly.
+    auto inputs = std::make_shared<std::vector<std::vector<Tensor>>>();
+    std::vector<std::shared_ptr<InvocationResult>> batch_results;
+    bool end_of_input = false;
+    for (const auto& result : results) {
+      if (end_of_input) {
+        result->end_of_input = true;
+        continue;
+      }
+      std::vector<Tensor> input_element;
+      result->status = input_impl_->GetNext(ctx.get(), &input_element,
+                                            &result->end_of_input);
+      end_of_input = result->end_of_input;
+      if (end_of_input || !result->status.ok()) {
+        continue;
+      }
+      inputs->push_back(std::move(input_element));
+      batch_results.push_back(result);
+    }
+    if (batch_results.empty()) {
+      CallCompleted(ctx, results);
+      return;
+    }
+
+    Allocator* allocator = ctx->allocator({});
+    std::vector<Tensor> batch;
+    if (batch_results.size() == 1) {
+      CallFunctionPerElement(ctx, results, batch_results, inputs);
+      return;
+    }
+    Status s = StackElements(allocator, *inputs, &batch);
+    if (!s.ok()) {
+      VLOG(2) << "Failed to stack input elements: " << s;
+      RecordGroupFailure(group_size);
+      CallFunctionPerElement(ctx, results, batch_results, inputs);
+      return;
+    }
+
+    const int64 start_nanos = EnvTime::Default()->NowNanos();
+    auto batch_output = std::make_shared<std::vector<Tensor>>();
+    auto done = [this, ctx, results, batch_results, inputs, batch_output,
+                 allocator, group_size, start_nanos](Status status) {
+      for (size_t i = 0; i < batch_results.size() && status.ok(); ++i) {
+        status = UnstackElement(allocator, *batch_output, i,
+                                &batch_results[i]->return_values);
+      }
+      if (!status.ok()) {
+        // The function is stateless, so it can be applied to each element to
+        // attribute the error to the elements that caused it.
+        VLOG(2) << "Batched invocation failed: " << status;
+        for (const auto& result : batch_results) {
+          result->return_values.clear();
+        }
+        RecordGroupFailure(group_size);
+        CallFunctionPerElement(ctx, results, batch_results, inputs);
+        return;
+      }
+      RecordGroupCall(group_size, batch_results.size(), start_nanos);
+      CallCompleted(ctx, results);
+    };
+    parallel_map_functor_->BatchedMapFunc(ctx.get(), prefix(), std::move(batch),
+                                          batch_output.get(), std::move(done));
+  }
+
+  // Produces `batch_results`, a subset of `results`, by applying the map
+  // function to each of `inputs` separately.
+  void CallFunctionPerElement(
+      const std::shared_ptr<IteratorContext>& ctx,
+      const std::vector<std::shared_ptr<InvocationResult>>& results,
+      const std::vector<std::shared_ptr<InvocationResult>>& batch_results,
+      const std::shared_ptr<std::vector<std::vector<Tensor>>>& inputs)
+      LOCKS_EXCLUDED(*mu_) {
+    auto pending = std::make_shared<std::atomic<int64>>(batch_results.size());
+    for (size_t i = 0; i < batch_results.size(); ++i) {
+      const std::shared_ptr<InvocationResult>& result = batch_results[i];
+      auto done = [this, ctx, results, result, pending](Status status) {
+        result->status.Update(status);
+        if (--*pending == 0) {
+          CallCompleted(ctx, results);
+        }
+      };
+      parallel_map_functor_->MapFunc(ctx.get(), prefix(),
+                                     std::move((*inputs)[i]),
+                                     &result->return_values, std::move(done));
+    }
+  }
+
+  // Reports the duration of an invocation that transformed `num_elements`
+  // elements to the group size tuner.
+  void RecordGroupCall(int64 group_size, int64 num_elements, int64 start_nanos)
+      LOCKS_EXCLUDED(*mu_) {
+    const int64 time_nanos = EnvTime::Default()->NowNanos() - start_nanos;
+    mutex_lock l(*mu_);
+    group_size_tuner_->RecordCall(group_size, num_elements, time_nanos);
+  }
+
+  // Reports an invocation of the batched map function that failed, after
+  // which its elements are transformed one by one, to the group size tuner.
+  // Repeated failures stop the grouping of elements.
+  void RecordGroupFailure(int64 group_size) LOCKS_EXCLUDED(*mu_) {
+    mutex_lock l(*mu_);
+    group_size_tuner_->RecordFailure(group_size);
+  }
+
   Status ProcessResult(IteratorContext* ctx,
                        const std::shared_ptr<InvocationResult>& result,
                        std::vector<Tensor>* out_tensors, bool* end_of_sequence)
@@ -504,15 +737,31 @@ class ParallelMapIterator : public DatasetBaseIterator {
       LOCKS_EXCLUDED(*mu_) {
     RecordStart(ctx.get());
     auto cleanup = gtl::MakeCleanup([this, ctx] { RecordStop(ctx.get()); });
-    std::vector<std::shared_ptr<InvocationResult>> new_calls;
+    // Each new call is paired with the group size it was scheduled with.
+    std::vector<
+        std::pair<std::vector<std::shared_ptr<InvocationResult>>, int64>>
+        new_calls;
     {
       tf_shared_lock l(*mu_);  // mu_ == num_parallel_calls_->mu
       new_calls.reserve(num_parallel_calls_->value);
     }
-    auto busy = [this]() EXCLUSIVE_LOCKS_REQUIRED(*mu_) -> bool {
+    auto group_size = [this]() EXCLUSIVE_LOCKS_REQUIRED(*mu_) -> int64 {
+      return batching_ ? group_size_tuner_->group_size() : 1;
+    };
+    // The number of results of the next call.
+    auto call_size = [this, &group_size]() EXCLUSIVE_LOCKS_REQUIRED(
+                         *mu_) -> int64 {
+      return std::min(group_size(),
+                      static_cast<int64>(num_parallel_calls_->value));
+    };
+    // Like without batching, the buffer holds at most `num_parallel_calls`
+    // results, and a call is scheduled once there is room for all of its
+    // results.
+    auto busy = [this, &call_size]() EXCLUSIVE_LOCKS_REQUIRED(*mu_) -> bool {
       int64 num_parallel_calls = num_parallel_calls_->value;
       return num_calls_ >= num_parallel_calls ||
-             invocation_results_.size() >= num_parallel_calls;
+             static_cast<int64>(invocation_results_.size()) + call_size() >
+                 num_parallel_calls;
     };
     while (true) {
       {
@@ -526,8 +775,12 @@ class ParallelMapIterator : public DatasetBaseIterator {
           return;
         }
         while (!busy()) {
-          invocation_results_.push_back(std::make_shared<InvocationResult>());
-          new_calls.push_back(invocation_results_.back());
+          std::vector<std::shared_ptr<InvocationResult>> call(call_size());
+          for (auto& result : call) {
+            result = std::make_shared<InvocationResult>();
+            invocation_results_.push_back(result);
+          }
+          new_calls.emplace_back(std::move(call), group_size());
           num_calls_++;
         }
         const auto& stats_aggregator = ctx->stats_aggregator();
@@ -541,7 +794,7 @@ class ParallelMapIterator : public DatasetBaseIterator {
         cond_var_->notify_all();
       }
       for (const auto& call : new_calls) {
-        CallFunction(ctx, call);
+        CallFunction(ctx, call.first, call.second);
       }
       new_calls.clear();
     }
@@ -626,6 +879,11 @@ class ParallelMapIterator : public DatasetBaseIterator {
   const bool sloppy_;
   const bool preserve_cardinality_;
   const bool autotune_;
+  // Indicates whether input elements are grouped into invocations of the
+  // batched map function.
+  bool batching_ = false;
+  // Chooses the number of input elements per invocation if `batching_` is set.
+  std::unique_ptr<GroupSizeTuner> group_size_tuner_ GUARDED_BY(*mu_);
   // Counts the number of outstanding calls.
   int64 num_calls_ GUARDED_BY(*mu_) = 0;
   std::unique_ptr<IteratorBase> input_impl_;
@@ -17,6 +17,7 @@ limitations under the License.
 
 #include "tensorflow/core/framework/dataset.h"
 #include "tensorflow/core/kernels/data/captured_function.h"
+#include "tensorflow/core/lib/core/errors.h"
 
 namespace tensorflow {
 namespace data {
@@ -70,6 +71,20 @@ class ParallelMapFunctor {
   virtual void MapFunc(IteratorContext* ctx, const string& prefix,
                        std::vector<Tensor> input, std::vector<Tensor>* output,
                        StatusCallback callback) = 0;
+
+  // Indicates whether `BatchedMapFunc` can be used to transform several input
+  // elements with a single invocation. Only valid after `InitFunc` succeeded.
+  virtual bool CanBatch() const { return false; }
+
+  // A function that transforms a batch of elements asynchronously. The
+  // arguments are the same as for `MapFunc`, except that the components of
+  // the input and output elements are stacked along a new 0th dimension.
+  virtual void BatchedMapFunc(IteratorContext* ctx, const string& prefix,
+                              std::vector<Tensor> input,
+                              std::vector<Tensor>* output,
+                              StatusCallback callback) {
+    callback(errors::Unimplemented("Batching is not supported."));
+  }
 };
 
 // Returns a new iterator that uses `parallel_map_functor` to apply `MapFunc`
@@ -14,14 +14,15 @@ limitations under the License.
 ==============================================================================*/
 #include "tensorflow/core/kernels/data/prefetch_dataset_op.h"
 
-#include <deque>
-
 #include "tensorflow/core/common_runtime/metrics.h"
 #include "tensorflow/core/framework/partial_tensor_shape.h"
 #include "tensorflow/core/framework/stats_aggregator.h"
 #include "tensorflow/core/framework/tensor.h"
 #include "tensorflow/core/kernels/data/dataset_utils.h"
+#include "tensorflow/core/kernels/data/input_snapshot.h"
 #include "tensorflow/core/kernels/data/name_utils.h"
+#include "tensorflow/core/kernels/data/recycling_allocator.h"
+#include "tensorflow/core/kernels/data/spsc_queue.h"
 #include "tensorflow/core/kernels/data/stats_utils.h"
 #include "tensorflow/core/lib/gtl/cleanup.h"
 #include "tensorflow/core/lib/strings/str_util.h"
@@ -49,6 +50,17 @@ constexpr char kStatus[] = "status";
 constexpr char kSizeSuffix[] = ".size";
 constexpr char kCodeSuffix[] = ".code";
 constexpr char kErrorMessageSuffix[] = ".error_message";
+constexpr char kIncremental[] = "incremental";
+constexpr char kInputIndex[] = "input_index";
+constexpr char kInputSnapshot[] = "input_snapshot";
+// The number of snapshots of the input state kept for incremental
+// checkpoints. A snapshot is taken when the input starts and at each
+// checkpoint.
+constexpr size_t kMaxInputSnapshots = 4;
+// The largest buffer that the prefetch thread's allocator recycles, and the
+// total size of the deallocated buffers that it keeps for reuse.
+constexpr size_t kMaxRecycledBufferBytes = 64 << 10;
+constexpr size_t kMaxRecycledBytes = 16 << 20;
 
 class PrefetchDatasetOp::Dataset : public DatasetBase {
  public:
@@ -116,7 +128,8 @@ class PrefetchDatasetOp::Dataset : public DatasetBase {
           legacy_autotune_(params.dataset->legacy_autotune_),
           buffer_size_(std::make_shared<model::SharedState>(
               legacy_autotune_ ? 0 : params.dataset->buffer_size_, mu_,
-              cond_var_)) {
+              cond_var_)),
+          input_snapshots_(kMaxInputSnapshots) {
       slack_us_ = 0;
     }
 
@@ -144,6 +157,7 @@ class PrefetchDatasetOp::Dataset : public DatasetBase {
     }
 
     Status Initialize(IteratorContext* ctx) override {
+      mutex_lock parent_l(*parent_mu_);
       mutex_lock l(*mu_);
       if (buffer_size_->value == model::kAutotune) {
         buffer_size_->value = 0;
@@ -151,7 +165,14 @@ class PrefetchDatasetOp::Dataset : public DatasetBase {
       TF_RETURN_IF_ERROR(
           ConnectCancellationManagers(ctx->cancellation_manager(),
                                       &cancellation_manager_, &deregister_fn_));
-      return dataset()->input_->MakeIterator(ctx, prefix(), &input_impl_);
+      TF_RETURN_IF_ERROR(
+          dataset()->input_->MakeIterator(ctx, prefix(), &input_impl_));
+      incremental_checkpointing_ = ctx->incremental_checkpoints();
+      if (incremental_checkpointing_) {
+        // The state of a new input is empty, so it needs no serialization.
+        input_snapshots_.Add({/*position=*/{/*epoch=*/0, /*index=*/0}, ""});
+      }
+      return Status::OK();
     }
 
     Status GetNextInternal(IteratorContext* ctx,
@@ -163,6 +184,11 @@ class PrefetchDatasetOp::Dataset : public DatasetBase {
         TF_RETURN_IF_ERROR(EnsurePrefetchThreadStarted(ctx));
         // Wait until the next element in the buffer has been
         // produced, or we are shutting down.
+        //
+        // NOTE: The prefetch thread pushes to `buffer_` without holding
+        // `mu_`, and only notifies `cond_var_` if a consumer is waiting, so
+        // the consumer must announce itself before checking the buffer.
+        num_waiting_consumers_.fetch_add(1);
         if (legacy_autotune_) {
           while (!cancellation_manager_.IsCancelled() && buffer_.empty() &&
                  !prefetch_thread_finished_ &&
@@ -181,6 +207,7 @@ class PrefetchDatasetOp::Dataset : public DatasetBase {
             RecordStart(ctx);
           }
         }
+        num_waiting_consumers_.fetch_sub(1);
 
         if (cancellation_manager_.IsCancelled()) {
           return errors::Cancelled(
@@ -209,7 +236,7 @@ class PrefetchDatasetOp::Dataset : public DatasetBase {
             stats_utils::BufferCapacityScalarName(dataset()->node_name()),
             static_cast<float>(buffer_limit()), num_elements());
       }
-      return input_impl_->GetNext(ctx, out_tensors, end_of_sequence);
+      return GetNextFromInput(ctx, out_tensors, end_of_sequence);
     }
 
    protected:
@@ -227,31 +254,99 @@ class PrefetchDatasetOp::Dataset : public DatasetBase {
       // all GetNext threads are blocked.
       mutex_lock parent_l(*parent_mu_);
       mutex_lock l(*mu_);
+      if (!incremental_checkpointing_ || !input_positions_valid_) {
+        return SaveFullState(writer);
+      }
+      // An incremental checkpoint replaces the buffered elements and the input
+      // state with a snapshot from which the input can be replayed. This is
+      // possible if all the buffered elements were read after a snapshot.
+      const InputPosition oldest_buffered = {
+          /*epoch=*/0, input_index_ - static_cast<int64>(buffer_.size())};
+      input_snapshots_.Prune(oldest_buffered);
+      const InputSnapshot* snapshot = input_snapshots_.Find(oldest_buffered);
+      if (snapshot) {
+        TF_RETURN_IF_ERROR(writer->WriteScalar(full_name(kIncremental), ""));
+        TF_RETURN_IF_ERROR(
+            writer->WriteScalar(full_name(kInputIndex), input_index_));
+        TF_RETURN_IF_ERROR(
+            WriteInputSnapshot(writer, full_name(kInputSnapshot), *snapshot));
+        TF_RETURN_IF_ERROR(
+            writer->WriteScalar(full_name(kBufferSize), buffer_.size()));
+      } else {
+        TF_RETURN_IF_ERROR(SaveFullState(writer));
+      }
+      // The elements read from now on can be recomputed from the current input
+      // state in the next checkpoint.
+      return SnapshotInput();
+    }
+
+    Status RestoreInternal(IteratorContext* ctx,
+                           IteratorStateReader* reader) override {
+      mutex_lock parent_l(*parent_mu_);
+      mutex_lock l(*mu_);
+      buffer_.Clear();
+      input_snapshots_.Clear();
+      input_positions_valid_ = true;
+      if (reader->Contains(full_name(kIncremental))) {
+        TF_RETURN_IF_ERROR(RestoreIncrementalState(ctx, reader));
+      } else {
+        TF_RETURN_IF_ERROR(RestoreFullState(ctx, reader));
+        // The input positions of the restored elements are unknown. They are
+        // counted from the restored input, so that incremental checkpoints
+        // are possible once the restored elements have been consumed.
+        input_index_ = 0;
+      }
+      if (incremental_checkpointing_) {
+        TF_RETURN_IF_ERROR(SnapshotInput());
+      }
+      return Status::OK();
+    }
+
+   private:
+    // A buffer element comprises a status and (if that status is
+    // OK) a vector of tensors, representing an element of the input dataset.
+    struct BufferElement {
+      // The producer sets `status` if getting the input element fails.
+      Status status;
+      // The buffered data element.
+      std::vector<Tensor> value;
+      int64 created_us;
+    };
+
+    Status SaveFullState(IteratorStateWriter* writer)
+        EXCLUSIVE_LOCKS_REQUIRED(*parent_mu_, *mu_) {
       TF_RETURN_IF_ERROR(SaveInput(writer, input_impl_));
       TF_RETURN_IF_ERROR(
           writer->WriteScalar(full_name(kBufferSize), buffer_.size()));
-      for (size_t i = 0; i < buffer_.size(); i++) {
-        auto& buffer_element = buffer_[i];
-        TF_RETURN_IF_ERROR(WriteStatus(writer, i, buffer_element.status));
-        if (buffer_element.status.ok()) {
-          TF_RETURN_IF_ERROR(writer->WriteScalar(
-              full_name(strings::StrCat(kBuffer, "[", i, "]", kSizeSuffix)),
-              buffer_element.value.size()));
-          for (size_t j = 0; j < buffer_element.value.size(); j++) {
-            TF_RETURN_IF_ERROR(writer->WriteTensor(
-                full_name(strings::StrCat(kBuffer, "[", i, "][", j, "]")),
-                buffer_element.value[j]));
-          }
+      // Both roles of `buffer_` are blocked while holding both locks.
+      Status s;
+      buffer_.ForEach(
+          [this, writer, &s](int64 i, const BufferElement& buffer_element) {
+            if (s.ok()) {
+              s = WriteBufferElement(writer, i, buffer_element);
+            }
+          });
+      return s;
+    }
+
+    Status WriteBufferElement(IteratorStateWriter* writer, size_t index,
+                              const BufferElement& buffer_element) {
+      TF_RETURN_IF_ERROR(WriteStatus(writer, index, buffer_element.status));
+      if (buffer_element.status.ok()) {
+        TF_RETURN_IF_ERROR(writer->WriteScalar(
+            full_name(strings::StrCat(kBuffer, "[", index, "]", kSizeSuffix)),
+            buffer_element.value.size()));
+        for (size_t j = 0; j < buffer_element.value.size(); j++) {
+          TF_RETURN_IF_ERROR(writer->WriteTensor(
+              full_name(strings::StrCat(kBuffer, "[", index, "][", j, "]")),
+              buffer_element.value[j]));
         }
       }
       return Status::OK();
     }
 
-    Status RestoreInternal(IteratorContext* ctx,
-                           IteratorStateReader* reader) override {
-      mutex_lock parent_l(*parent_mu_);
-      mutex_lock l(*mu_);
-      buffer_.clear();
+    Status RestoreFullState(IteratorContext* ctx, IteratorStateReader* reader)
+        EXCLUSIVE_LOCKS_REQUIRED(*parent_mu_, *mu_) {
       TF_RETURN_IF_ERROR(RestoreInput(ctx, reader, input_impl_));
       size_t buffer_size;
       {
@@ -260,8 +355,7 @@ class PrefetchDatasetOp::Dataset : public DatasetBase {
         buffer_size = static_cast<size_t>(temp);
       }
       for (size_t i = 0; i < buffer_size; i++) {
-        buffer_.emplace_back();
-        auto& buffer_element = buffer_.back();
+        BufferElement buffer_element;
         TF_RETURN_IF_ERROR(ReadStatus(reader, i, &buffer_element.status));
         if (buffer_element.status.ok()) {
           size_t value_size;
@@ -280,20 +374,91 @@ class PrefetchDatasetOp::Dataset : public DatasetBase {
                 &buffer_element.value.back()));
           }
         }
+        buffer_.Push(std::move(buffer_element));
       }
       return Status::OK();
     }
 
-   private:
-    // A buffer element comprises a status and (if that status is
-    // OK) a vector of tensors, representing an element of the input dataset.
-    struct BufferElement {
-      // The producer sets `status` if getting the input element fails.
-      Status status;
-      // The buffered data element.
-      std::vector<Tensor> value;
-      int64 created_us;
-    };
+    // Recomputes the buffered elements of an incremental checkpoint by
+    // replaying the input from the saved snapshot.
+    Status RestoreIncrementalState(IteratorContext* ctx,
+                                   IteratorStateReader* reader)
+        EXCLUSIVE_LOCKS_REQUIRED(*parent_mu_, *mu_) {
+      TF_RETURN_IF_ERROR(
+          reader->ReadScalar(full_name(kInputIndex), &input_index_));
+      InputSnapshot snapshot;
+      TF_RETURN_IF_ERROR(
+          ReadInputSnapshot(reader, full_name(kInputSnapshot), &snapshot));
+      int64 buffer_size;
+      TF_RETURN_IF_ERROR(
+          reader->ReadScalar(full_name(kBufferSize), &buffer_size));
+      if (snapshot.state.empty()) {
+        TF_RETURN_IF_ERROR(
+            dataset()->input_->MakeIterator(ctx, prefix(), &input_impl_));
+      } else {
+        TF_RETURN_IF_ERROR(DeserializeInputState(
+            snapshot.state, [this, ctx](IteratorStateReader* reader) {
+              return RestoreInput(ctx, reader, input_impl_);
+            }));
+      }
+      const int64 first_buffered = input_index_ - buffer_size;
+      for (int64 i = snapshot.position.index; i < input_index_; ++i) {
+        BufferElement buffer_element;
+        bool end_of_sequence = false;
+        TF_RETURN_IF_ERROR(
+            input_impl_->GetNext(ctx, &buffer_element.value, &end_of_sequence));
+        if (end_of_sequence) {
+          return errors::DataLoss(
+              "Failed to recompute the prefetch buffer from an incremental "
+              "checkpoint. This can happen if the input is not "
+              "deterministic.");
+        }
+        if (i >= first_buffered) {
+          buffer_element.created_us = ctx->env()->NowMicros();
+          buffer_.Push(std::move(buffer_element));
+        }
+      }
+      input_snapshots_.Add(std::move(snapshot));
+      return Status::OK();
+    }
+
+    // Adds a snapshot of the current input state to `input_snapshots_`.
+    Status SnapshotInput() EXCLUSIVE_LOCKS_REQUIRED(*parent_mu_) {
+      const InputPosition position = {/*epoch=*/0, input_index_};
+      const InputSnapshot* last = input_snapshots_.Find(position);
+      if (last && last->position == position) {
+        return Status::OK();
+      }
+      InputSnapshot snapshot;
+      snapshot.position = position;
+      TF_RETURN_IF_ERROR(SerializeInputState(
+          [this](IteratorStateWriter* writer) {
+            return SaveInput(writer, input_impl_);
+          },
+          &snapshot.state));
+      input_snapshots_.Add(std::move(snapshot));
+      return Status::OK();
+    }
+
+    // Reads the next element from the input, counting its position for
+    // incremental checkpoints.
+    Status GetNextFromInput(IteratorContext* ctx,
+                            std::vector<Tensor>* out_tensors,
+                            bool* end_of_sequence)
+        EXCLUSIVE_LOCKS_REQUIRED(*parent_mu_) {
+      if (!incremental_checkpointing_ || !input_positions_valid_) {
+        return input_impl_->GetNext(ctx, out_tensors, end_of_sequence);
+      }
+      Status s = input_impl_->GetNext(ctx, out_tensors, end_of_sequence);
+      if (!s.ok()) {
+        // It is unknown whether the input advanced past a failed element, so
+        // the positions of the following elements are unknown.
+        input_positions_valid_ = false;
+      } else if (!*end_of_sequence) {
+        ++input_index_;
+      }
+      return s;
+    }
 
     inline int64 buffer_limit() EXCLUSIVE_LOCKS_REQUIRED(*mu_) {
       return legacy_autotune_ ? auto_tuner_.buffer_limit()
@@ -319,14 +484,18 @@ class PrefetchDatasetOp::Dataset : public DatasetBase {
       }
       // A new element is available. Forward the status from computing it, and
       // (if we successfully got an element) the output values.
-      Status s = buffer_.front().status;
+      const int64 num_buffered = buffer_.size();
+      BufferElement buffer_element;
+      const bool popped = buffer_.Pop(&buffer_element);
+      DCHECK(popped);
+      Status s = buffer_element.status;
       if (s.ok()) {
         if (dataset()->slack_period_ > 0 &&
             (num_elements() + 1) % dataset()->slack_period_ == 0) {
           // TODO(rachelim): Consider doing something more sophisticated
           // to decide how long to sleep for; e.g. using a kalman filter.
           int64 slack_us =
-              Env::Default()->NowMicros() - buffer_.front().created_us;
+              Env::Default()->NowMicros() - buffer_element.created_us;
           // Every slack_period_-th element, update the most recent slack time,
           // measured by the duration between when the element is prefetched
           // and when it is consumed. We add kSleepFactor * slack_us_ to the
@@ -335,30 +504,39 @@ class PrefetchDatasetOp::Dataset : public DatasetBase {
           slack_us_ = kSleepFactor * slack_us_ + slack_us;
           VLOG(2) << "Setting slack_us_: " << slack_us_;
         }
-        *out_tensors = std::move(buffer_.front().value);
+        *out_tensors = std::move(buffer_element.value);
         RecordBufferDequeue(ctx, *out_tensors);
       }
       if (legacy_autotune_) {
-        auto_tuner_.RecordConsumption(buffer_.size());
+        auto_tuner_.RecordConsumption(num_buffered);
         buffer_size_->value = auto_tuner_.buffer_limit();
       }
-      buffer_.pop_front();
       *end_of_sequence = false;
 
       // Wake the prefetch thread, in case it has been waiting for space
-      // in the buffer. Also wake up threads from other calls to GetNext.
-      //
-      // TODO(mrry): Consider using different condition variables for
-      // GetNext and Prefetch.
-      cond_var_->notify_all();
+      // in the buffer.
+      if (prefetch_thread_waiting_) {
+        cond_var_->notify_all();
+      }
       return s;
     }
 
     Status EnsurePrefetchThreadStarted(IteratorContext* ctx)
         EXCLUSIVE_LOCKS_REQUIRED(*mu_) {
       if (!prefetch_thread_) {
+        IteratorContext::Params params(ctx);
+        if (params.allocator_getter) {
+          allocator_.reset(new RecyclingAllocator(ctx->allocator({}),
+                                                  kMaxRecycledBufferBytes,
+                                                  kMaxRecycledBytes));
+          params.allocator_getter =
+              [allocator = allocator_.get(),
+               getter = params.allocator_getter](AllocatorAttributes attrs) {
+                return attrs.value == 0 ? allocator : getter(attrs);
+              };
+        }
         std::shared_ptr<IteratorContext> new_ctx =
-            std::make_shared<IteratorContext>(*ctx);
+            std::make_shared<IteratorContext>(std::move(params));
         prefetch_thread_ = ctx->StartThread(
             "tf_data_prefetch", [this, new_ctx]() { PrefetchThread(new_ctx); });
       }
@@ -373,22 +551,28 @@ class PrefetchDatasetOp::Dataset : public DatasetBase {
       auto cleanup = gtl::MakeCleanup([this, ctx] { RecordStop(ctx.get()); });
       // Keep track of where we are in an iteration "burst"
       int num_produced = 0;
+      // The buffer limit as of the last time that the thread acquired `mu_`.
+      // The thread only acquires `mu_` when the buffer reaches that limit, so
+      // that handing an element to a consumer does not contend with it.
+      int64 limit = 0;
       while (true) {
         // 1. Wait for a slot in the buffer.
-        {
+        if (buffer_.size() >= limit) {
           mutex_lock l(*mu_);
+          prefetch_thread_waiting_ = true;
           while (!cancellation_manager_.IsCancelled() &&
                  buffer_.size() >= buffer_limit()) {
             RecordStop(ctx.get());
             cond_var_->wait(l);
             RecordStart(ctx.get());
           }
-
-          if (cancellation_manager_.IsCancelled()) {
-            return;
-          }
+          prefetch_thread_waiting_ = false;
+          limit = buffer_limit();
         }
 
+        if (cancellation_manager_.IsCancelled()) {
+          return;
+        }
         if (dataset()->slack_period_ > 0 &&
             num_produced % dataset()->slack_period_ == 0) {
           // For the first element in the "burst", sleep for a bit if there is
@@ -406,8 +590,9 @@ class PrefetchDatasetOp::Dataset : public DatasetBase {
         mutex_lock parent_l(*parent_mu_);
         bool end_of_sequence;
         BufferElement buffer_element;
-        buffer_element.status = input_impl_->GetNext(
-            ctx.get(), &buffer_element.value, &end_of_sequence);
+        buffer_element.status =
+            GetNextFromInput(ctx.get(), &buffer_element.value,
+                             &end_of_sequence);
         if (buffer_element.status.ok() && end_of_sequence) {
           mutex_lock l(*mu_);
           prefetch_thread_finished_ = true;
@@ -415,12 +600,14 @@ class PrefetchDatasetOp::Dataset : public DatasetBase {
           return;
         }
 
-        // 3. Signal that the element has been produced.
-        {
+        // 3. Signal that the element has been produced. Consumers that found
+        // the buffer empty are waiting on `cond_var_`, and are woken under
+        // `mu_` so that they cannot miss the element.
+        RecordBufferEnqueue(ctx.get(), buffer_element.value);
+        buffer_element.created_us = ctx->env()->NowMicros();
+        buffer_.Push(std::move(buffer_element));
+        if (num_waiting_consumers_.load() > 0) {
           mutex_lock l(*mu_);
-          RecordBufferEnqueue(ctx.get(), buffer_element.value);
-          buffer_element.created_us = ctx->env()->NowMicros();
-          buffer_.push_back(std::move(buffer_element));
           cond_var_->notify_all();
         }
         ++num_produced;
@@ -428,7 +615,7 @@ class PrefetchDatasetOp::Dataset : public DatasetBase {
     }
 
     Status WriteStatus(IteratorStateWriter* writer, size_t index,
-                       const Status& status) EXCLUSIVE_LOCKS_REQUIRED(*mu_) {
+                       const Status& status) {
       TF_RETURN_IF_ERROR(writer->WriteScalar(
           CodeKey(index), static_cast<int64>(status.code())));
       if (!status.ok()) {
@@ -474,7 +661,17 @@ class PrefetchDatasetOp::Dataset : public DatasetBase {
     std::unique_ptr<IteratorBase> input_impl_ GUARDED_BY(*parent_mu_);
     const std::shared_ptr<condition_variable> cond_var_;
     PrefetchAutotuner auto_tuner_ GUARDED_BY(*mu_);
-    std::deque<BufferElement> buffer_ GUARDED_BY(*mu_);
+    // The prefetch thread pushes elements while holding `parent_mu_`, and
+    // consumers pop elements while holding `mu_`.
+    SpscQueue<BufferElement> buffer_;
+    // The number of `GetNext()` calls that wait for `buffer_` to be non-empty.
+    std::atomic<int> num_waiting_consumers_{0};
+    // True while the prefetch thread waits for space in `buffer_`.
+    bool prefetch_thread_waiting_ GUARDED_BY(*mu_) = false;
+    // Serves the allocations of the prefetch thread, so that the buffers of
+    // small elements are reused once consumers drop them. It is declared
+    // before `prefetch_thread_`, so that it outlives the thread.
+    core::RefCountPtr<RecyclingAllocator> allocator_ GUARDED_BY(*mu_);
     std::unique_ptr<Thread> prefetch_thread_ GUARDED_BY(*mu_);
     bool cancelled_ GUARDED_BY(*mu_) = false;
     bool prefetch_thread_finished_ GUARDED_BY(*mu_) = false;
@@ -487,6 +684,14 @@ class PrefetchDatasetOp::Dataset : public DatasetBase {
 
     CancellationManager cancellation_manager_;
     std::function<void()> deregister_fn_;
+
+    // Set from `IteratorContext::incremental_checkpoints()` on initialization.
+    bool incremental_checkpointing_ = false;
+    // The number of elements produced by `input_impl_`.
+    int64 input_index_ GUARDED_BY(*parent_mu_) = 0;
+    // False if the input positions of the buffered elements are unknown.
+    bool input_positions_valid_ GUARDED_BY(*parent_mu_) = true;
+    InputSnapshotLog input_snapshots_ GUARDED_BY(*parent_mu_);
   };
   const DatasetBase* const input_;
   const int64 buffer_size_;
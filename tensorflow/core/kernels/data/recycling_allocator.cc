@@ -0,0 +1,104 @@
+/* Copyright 2019 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#include "tensorflow/core/kernels/data/recycling_allocator.h"
+
+namespace tensorflow {
+namespace data {
+
+RecyclingAllocator::RecyclingAllocator(Allocator* wrapped,
+                                       size_t max_buffer_bytes,
+                                       size_t max_cached_bytes)
+    : wrapped_(wrapped),
+      max_buffer_bytes_(max_buffer_bytes),
+      max_cached_bytes_(max_cached_bytes) {}
+
+RecyclingAllocator::~RecyclingAllocator() {
+  for (auto& entry : free_buffers_) {
+    for (void* ptr : entry.second) {
+      wrapped_->DeallocateRaw(ptr);
+    }
+  }
+}
+
+void* RecyclingAllocator::AllocateRaw(size_t alignment, size_t num_bytes) {
+  // Each allocation keeps the allocator alive, because the `TensorBuffer` that
+  // owns it refers back to this object on deallocation.
+  Ref();
+  if (num_bytes == 0 || num_bytes > max_buffer_bytes_ ||
+      alignment > Allocator::kAllocatorAlignment) {
+    void* ptr = wrapped_->AllocateRaw(alignment, num_bytes);
+    if (ptr == nullptr) {
+      Unref();
+    }
+    return ptr;
+  }
+  {
+    mutex_lock l(mu_);
+    auto it = free_buffers_.find(num_bytes);
+    if (it != free_buffers_.end() && !it->second.empty()) {
+      void* ptr = it->second.back();
+      it->second.pop_back();
+      cached_bytes_ -= num_bytes;
+      outstanding_.emplace(ptr, num_bytes);
+      ++num_recycled_;
+      return ptr;
+    }
+  }
+  // Every recycled buffer has the default alignment, so that it can serve any
+  // later allocation of the same size.
+  void* ptr =
+      wrapped_->AllocateRaw(Allocator::kAllocatorAlignment, num_bytes);
+  if (ptr == nullptr) {
+    Unref();
+    return nullptr;
+  }
+  mutex_lock l(mu_);
+  outstanding_.emplace(ptr, num_bytes);
+  return ptr;
+}
+
+void RecyclingAllocator::DeallocateRaw(void* ptr) {
+  bool cached = false;
+  {
+    mutex_lock l(mu_);
+    auto it = outstanding_.find(ptr);
+    if (it != outstanding_.end()) {
+      const size_t num_bytes = it->second;
+      outstanding_.erase(it);
+      if (cached_bytes_ + num_bytes <= max_cached_bytes_) {
+        free_buffers_[num_bytes].push_back(ptr);
+        cached_bytes_ += num_bytes;
+        cached = true;
+      }
+    }
+  }
+  if (!cached) {
+    wrapped_->DeallocateRaw(ptr);
+  }
+  Unref();
+}
+
+int64 RecyclingAllocator::num_recycled() const {
+  mutex_lock l(mu_);
+  return num_recycled_;
+}
+
+size_t RecyclingAllocator::cached_bytes() const {
+  mutex_lock l(mu_);
+  return cached_bytes_;
+}
+
+}  // namespace data
+}  // namespace tensorflow
@@ -0,0 +1,82 @@
+/* Copyright 2019 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#ifndef TENSORFLOW_CORE_KERNELS_DATA_RECYCLING_ALLOCATOR_H_
+#define TENSORFLOW_CORE_KERNELS_DATA_RECYCLING_ALLOCATOR_H_
+
+#include <unordered_map>
+#include <vector>
+
+#include "tensorflow/core/framework/allocator.h"
+#include "tensorflow/core/lib/core/refcount.h"
+#include "tensorflow/core/platform/mutex.h"
+#include "tensorflow/core/platform/thread_annotations.h"
+
+namespace tensorflow {
+namespace data {
+
+// A `RecyclingAllocator` keeps the small buffers that are deallocated through
+// it, and serves later allocations of the same size from them instead of the
+// wrapped allocator.
+//
+// Input pipelines that produce many small elements of a fixed size allocate
+// and deallocate a buffer of the same size per element, typically in
+// different threads. Recycling those buffers avoids the cost of the wrapped
+// allocator (and of its cross-thread frees) in the steady state.
+//
+// Buffers of up to `max_buffer_bytes` bytes are recycled, and at most
+// `max_cached_bytes` bytes of deallocated buffers are kept. Larger buffers,
+// and buffers that need more than the default alignment, are delegated to the
+// wrapped allocator.
+//
+// Each allocation holds a reference on the allocator, which is therefore
+// destroyed (releasing the cached buffers) only once all tensors that it
+// allocated have been deallocated.
+class RecyclingAllocator : public Allocator, public core::RefCounted {
+ public:
+  RecyclingAllocator(Allocator* wrapped, size_t max_buffer_bytes,
+                     size_t max_cached_bytes);
+
+  string Name() override { return "recycling"; }
+
+  void* AllocateRaw(size_t alignment, size_t num_bytes) override;
+  void DeallocateRaw(void* ptr) override;
+
+  // Returns the number of allocations that were served from a cached buffer.
+  int64 num_recycled() const LOCKS_EXCLUDED(mu_);
+
+  // Returns the total size of the cached buffers.
+  size_t cached_bytes() const LOCKS_EXCLUDED(mu_);
+
+ private:
+  ~RecyclingAllocator() override;
+
+  Allocator* const wrapped_;  // Not owned.
+  const size_t max_buffer_bytes_;
+  const size_t max_cached_bytes_;
+  mutable mutex mu_;
+  // The deallocated buffers, by size.
+  std::unordered_map<size_t, std::vector<void*>> free_buffers_ GUARDED_BY(mu_);
+  size_t cached_bytes_ GUARDED_BY(mu_) = 0;
+  // The sizes of the outstanding allocations that may be recycled.
+  std::unordered_map<void*, size_t> outstanding_ GUARDED_BY(mu_);
+  int64 num_recycled_ GUARDED_BY(mu_) = 0;
+
+  TF_DISALLOW_COPY_AND_ASSIGN(RecyclingAllocator);
+};
+
+}  // namespace data
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_CORE_KERNELS_DATA_RECYCLING_ALLOCATOR_H_
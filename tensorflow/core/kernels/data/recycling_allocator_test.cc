@@ -0,0 +1,82 @@
+/* Copyright 2019 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#include "tensorflow/core/kernels/data/recycling_allocator.h"
+
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/lib/core/refcount.h"
+#include "tensorflow/core/platform/test.h"
+
+namespace tensorflow {
+namespace data {
+namespace {
+
+constexpr size_t kMaxBufferBytes = 1024;
+constexpr size_t kMaxCachedBytes = 4096;
+
+TEST(RecyclingAllocatorTest, RecyclesBuffersOfTheSameSize) {
+  RecyclingAllocator* allocator = new RecyclingAllocator(
+      cpu_allocator(), kMaxBufferBytes, kMaxCachedBytes);
+  core::ScopedUnref unref(allocator);
+  const void* data;
+  {
+    Tensor t(allocator, DT_FLOAT, TensorShape({16}));
+    data = t.tensor_data().data();
+  }
+  EXPECT_EQ(allocator->cached_bytes(), 16 * sizeof(float));
+
+  Tensor other_size(allocator, DT_FLOAT, TensorShape({8}));
+  EXPECT_EQ(allocator->num_recycled(), 0);
+  Tensor same_size(allocator, DT_INT32, TensorShape({4, 4}));
+  EXPECT_EQ(allocator->num_recycled(), 1);
+  EXPECT_EQ(same_size.tensor_data().data(), data);
+  EXPECT_EQ(allocator->cached_bytes(), 0);
+}
+
+TEST(RecyclingAllocatorTest, DelegatesLargeBuffers) {
+  RecyclingAllocator* allocator = new RecyclingAllocator(
+      cpu_allocator(), kMaxBufferBytes, kMaxCachedBytes);
+  core::ScopedUnref unref(allocator);
+  { Tensor t(allocator, DT_INT8, TensorShape({kMaxBufferBytes + 1})); }
+  EXPECT_EQ(allocator->cached_bytes(), 0);
+  { Tensor t(allocator, DT_INT8, TensorShape({kMaxBufferBytes + 1})); }
+  EXPECT_EQ(allocator->num_recycled(), 0);
+}
+
+TEST(RecyclingAllocatorTest, LimitsCachedBytes) {
+  RecyclingAllocator* allocator = new RecyclingAllocator(
+      cpu_allocator(), kMaxBufferBytes, kMaxCachedBytes);
+  core::ScopedUnref unref(allocator);
+  {
+    std::vector<Tensor> tensors;
+    for (int i = 0; i < 8; ++i) {
+      tensors.emplace_back(allocator, DT_INT8, TensorShape({kMaxBufferBytes}));
+    }
+  }
+  EXPECT_EQ(allocator->cached_bytes(), kMaxCachedBytes);
+}
+
+TEST(RecyclingAllocatorTest, OutlivesItsOwner) {
+  RecyclingAllocator* allocator = new RecyclingAllocator(
+      cpu_allocator(), kMaxBufferBytes, kMaxCachedBytes);
+  Tensor t(allocator, DT_FLOAT, TensorShape({4}));
+  allocator->Unref();
+  // The tensor still refers to the allocator, which it releases when it is
+  // destroyed.
+  t.flat<float>().setZero();
+}
+
+}  // namespace
+}  // namespace data
+}  // namespace tensorflow
@@ -140,6 +140,32 @@ Status ApplyRewrites(OpKernelContext* ctx,
 
 }  // anonymous namespace
 
+Status MakeDatasetFromGraph(
+    OpKernelContext* ctx, const GraphDef& graph_def,
+    const std::vector<std::pair<string, Tensor>>& input_list,
+    const string& output_node, DatasetBase** dataset) {
+  FunctionLibraryRuntime* flr = nullptr;
+  std::unique_ptr<ProcessFunctionLibraryRuntime> pflr = nullptr;
+  std::unique_ptr<FunctionLibraryDefinition> lib_def = nullptr;
+  TF_RETURN_IF_ERROR(
+      ctx->function_library()->Clone(&lib_def, &pflr, &flr, true));
+
+  // Some functions may have been modified without having their names changed
+  // (for example, nested dataset graphs from FlatMap or Interleave).
+  TF_RETURN_IF_ERROR(AddToFunctionLibrary(lib_def.get(), graph_def.library()));
+
+  Graph graph(OpRegistry::Global());
+  TF_RETURN_IF_ERROR(ImportGraphDef({}, graph_def, &graph, nullptr));
+  std::vector<Tensor> outputs;
+  GraphRunner graph_runner(flr->device());
+
+  TF_RETURN_IF_ERROR(
+      graph_runner.Run(&graph, flr, input_list, {output_node}, &outputs));
+  TF_RETURN_IF_ERROR(GetDatasetFromVariantTensor(outputs[0], dataset));
+  (*dataset)->Ref();
+  return Status::OK();
+}
+
 Status RewriteDataset(OpKernelContext* ctx, const DatasetBase* input,
                       std::function<RewriterConfig(void)> config_factory,
                       bool optimize_function_library, bool record_fingerprint,
@@ -170,25 +196,8 @@ Status RewriteDataset(OpKernelContext* ctx, const DatasetBase* input,
 
   // Instantiate the optimized input pipeline by running the optimized graph
   // using the optimized function library.
-  FunctionLibraryRuntime* flr = nullptr;
-  std::unique_ptr<ProcessFunctionLibraryRuntime> pflr = nullptr;
-  std::unique_ptr<FunctionLibraryDefinition> lib_def = nullptr;
-  TF_RETURN_IF_ERROR(
-      ctx->function_library()->Clone(&lib_def, &pflr, &flr, true));
-
-  // Some functions may have been modified without having their names changed
-  // (for example, nested dataset graphs from FlatMap or Interleave).
-  TF_RETURN_IF_ERROR(AddToFunctionLibrary(lib_def.get(), graph_def.library()));
-
-  Graph graph(OpRegistry::Global());
-  TF_RETURN_IF_ERROR(ImportGraphDef({}, graph_def, &graph, nullptr));
-  std::vector<Tensor> outputs;
-  GraphRunner graph_runner(flr->device());
-
-  TF_RETURN_IF_ERROR(
-      graph_runner.Run(&graph, flr, input_list, {output_node}, &outputs));
-  TF_RETURN_IF_ERROR(GetDatasetFromVariantTensor(outputs[0], rewritten_input));
-  (*rewritten_input)->Ref();
+  TF_RETURN_IF_ERROR(MakeDatasetFromGraph(ctx, graph_def, input_list,
+                                          output_node, rewritten_input));
 
   if (record_fingerprint) {
     (*ctx->runner())([graph_def = std::move(graph_def),
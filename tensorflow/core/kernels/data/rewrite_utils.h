@@ -24,6 +24,14 @@ limitations under the License.
 namespace tensorflow {
 namespace data {
 
+// Instantiates the dataset produced by `output_node` of `graph_def`, feeding
+// the tensors in `input_list` to the graph. On success, the caller owns a
+// reference to `*dataset`.
+Status MakeDatasetFromGraph(
+    OpKernelContext* ctx, const GraphDef& graph_def,
+    const std::vector<std::pair<string, Tensor>>& input_list,
+    const string& output_node, DatasetBase** dataset);
+
 // Rewrites the input dataset using the given config.
 Status RewriteDataset(OpKernelContext* ctx, const DatasetBase* input,
                       std::function<RewriterConfig(void)> config_factory,
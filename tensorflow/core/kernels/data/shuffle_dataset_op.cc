@@ -15,6 +15,7 @@ limitations under the License.
 #include "tensorflow/core/kernels/data/shuffle_dataset_op.h"
 
 #include <deque>
+#include <map>
 #include <tuple>
 #include <vector>
 
@@ -22,6 +23,7 @@ limitations under the License.
 #include "tensorflow/core/framework/resource_mgr.h"
 #include "tensorflow/core/framework/tensor.h"
 #include "tensorflow/core/kernels/data/dataset_utils.h"
+#include "tensorflow/core/kernels/data/input_snapshot.h"
 #include "tensorflow/core/kernels/data/name_utils.h"
 #include "tensorflow/core/kernels/data/random_seed_ops.h"
 #include "tensorflow/core/lib/core/errors.h"
@@ -52,6 +54,10 @@ namespace data {
 
 const int64 kLogIntervalMicros = 10 * 1000000;  // 10 seconds.
 const int64 kMaxEpochsInBuffer = 3;
+// The number of snapshots of the input state kept for incremental
+// checkpoints. A snapshot is taken when each epoch of the input starts and at
+// each checkpoint.
+const size_t kMaxInputSnapshots = kMaxEpochsInBuffer + 4;
 
 constexpr char kNumRandomSamples[] = "num_random_samples";
 constexpr char kEndOfInputSequence[] = "end_of_input_sequence";
@@ -62,6 +68,10 @@ constexpr char kSlicesStart[] = "slices_start";
 constexpr char kSlicesEnd[] = "slices_end";
 constexpr char kBuffer[] = "buffer";
 constexpr char kSize[] = "size";
+constexpr char kIncremental[] = "incremental";
+constexpr char kInputIndex[] = "input_index";
+constexpr char kBufferPositions[] = "buffer_positions";
+constexpr char kInputSnapshot[] = "input_snapshot";
 constexpr char kRandomSeedGenerator[] = "RandomSeedGenerator";
 constexpr char kTFData[] = "tf_data";
 constexpr char kDSNumRandomSamples[] = "ds_num_random_samples";
@@ -121,9 +131,12 @@ class ShuffleDatasetOpBase::ShuffleDatasetBase : public DatasetBase {
           epoch_(0),
           num_elements_(0),
           parent_generator_(seed, seed2),
-          generator_(&parent_generator_) {
+          generator_(&parent_generator_),
+          input_snapshots_(kMaxInputSnapshots) {
       buffer_ = absl::make_unique<std::vector<Tensor>[]>(
           params.dataset->buffer_size_);
+      buffer_positions_ =
+          absl::make_unique<InputPosition[]>(params.dataset->buffer_size_);
       slices_.push_back(absl::make_unique<Slice>(0, 0));
     }
 
@@ -141,8 +154,10 @@ class ShuffleDatasetOpBase::ShuffleDatasetBase : public DatasetBase {
       bool first_call = false;
       if (!input_impl_ && epoch_ == 0) {
         first_call = true;
+        incremental_checkpointing_ = ctx->incremental_checkpoints();
         TF_RETURN_IF_ERROR(this->dataset()->input_->MakeIterator(
             ctx, this->prefix(), &input_impl_));
+        AddEmptyInputSnapshot();
       }
       while (input_impl_ && num_elements_ < this->dataset()->buffer_size_) {
         if (ctx->env()->NowMicros() >
@@ -170,10 +185,12 @@ class ShuffleDatasetOpBase::ShuffleDatasetBase : public DatasetBase {
             return Status::OK();
           }
           epoch_++;
+          input_index_ = 0;
           int64 n = slices_.back()->end;
           slices_.push_back(absl::make_unique<Slice>(n, n));
           TF_RETURN_IF_ERROR(this->dataset()->input_->MakeIterator(
               ctx, this->prefix(), &input_impl_));
+          AddEmptyInputSnapshot();
         }
         if (!end_of_input_sequence) {
           if (num_elements_ == 0) {
@@ -181,8 +198,11 @@ class ShuffleDatasetOpBase::ShuffleDatasetBase : public DatasetBase {
                     << this->dataset()->buffer_size_;
           }
           this->RecordBufferEnqueue(ctx, input_element);
-          buffer_[slices_.back()->end % this->dataset()->buffer_size_] =
-              std::move(input_element);
+          const int64 index =
+              slices_.back()->end % this->dataset()->buffer_size_;
+          buffer_[index] = std::move(input_element);
+          buffer_positions_[index] = {epoch_, input_index_};
+          input_index_++;
           num_elements_++;
           slices_.back()->end++;
         } else {
@@ -217,9 +237,10 @@ class ShuffleDatasetOpBase::ShuffleDatasetBase : public DatasetBase {
             (slices_.front()->start + offset) % this->dataset()->buffer_size_;
         *out_tensors = std::move(buffer_[index]);
         this->RecordBufferDequeue(ctx, *out_tensors);
-        std::swap(
-            buffer_[index],
-            buffer_[slices_.front()->start % this->dataset()->buffer_size_]);
+        const int64 start_index =
+            slices_.front()->start % this->dataset()->buffer_size_;
+        std::swap(buffer_[index], buffer_[start_index]);
+        std::swap(buffer_positions_[index], buffer_positions_[start_index]);
         slices_.front()->start++;
         num_elements_--;
       } else {
@@ -252,12 +273,21 @@ class ShuffleDatasetOpBase::ShuffleDatasetBase : public DatasetBase {
       TF_RETURN_IF_ERROR(writer->WriteScalar(this->full_name(kSeed), seed_));
       TF_RETURN_IF_ERROR(writer->WriteScalar(this->full_name(kSeed2), seed2_));
 
+      // An incremental checkpoint is possible if every buffered element can
+      // be recomputed by replaying the input from a snapshot.
+      const InputSnapshot* snapshot = nullptr;
+      if (incremental_checkpointing_) {
+        const InputPosition oldest = OldestBufferedPosition();
+        input_snapshots_.Prune(oldest);
+        snapshot = input_snapshots_.Find(oldest);
+      }
+
       // Save input iterator if it hasn't been exhausted else write
       // "end_of_input_sequence".
       if (!input_impl_) {
         TF_RETURN_IF_ERROR(
             writer->WriteScalar(this->full_name(kEndOfInputSequence), ""));
-      } else {
+      } else if (!snapshot) {
         TF_RETURN_IF_ERROR(this->SaveInput(writer, input_impl_));
       }
 
@@ -275,6 +305,9 @@ class ShuffleDatasetOpBase::ShuffleDatasetBase : public DatasetBase {
         TF_RETURN_IF_ERROR(writer->WriteScalar(
             this->full_name(absl::StrJoin(std::make_tuple(kSlicesEnd, i), "_")),
             slices_[i]->end));
+        if (snapshot) {
+          continue;
+        }
         for (size_t j = slices_[i]->start; j < slices_[i]->end; ++j) {
           size_t index = j % this->dataset()->buffer_size_;
           TF_RETURN_IF_ERROR(writer->WriteScalar(
@@ -289,6 +322,14 @@ class ShuffleDatasetOpBase::ShuffleDatasetBase : public DatasetBase {
           }
         }
       }
+      if (snapshot) {
+        TF_RETURN_IF_ERROR(SaveIncrementalState(writer, *snapshot));
+      }
+      if (incremental_checkpointing_ && input_impl_) {
+        // The elements read from now on can be recomputed from the current
+        // input state in the next checkpoint.
+        TF_RETURN_IF_ERROR(SnapshotInput());
+      }
 
       return Status::OK();
     }
@@ -296,6 +337,7 @@ class ShuffleDatasetOpBase::ShuffleDatasetBase : public DatasetBase {
     Status RestoreInternal(IteratorContext* ctx,
                            IteratorStateReader* reader) override {
       mutex_lock l(mu_);
+      incremental_checkpointing_ = ctx->incremental_checkpoints();
       // Restore the random number generators.
       TF_RETURN_IF_ERROR(reader->ReadScalar(this->full_name(kNumRandomSamples),
                                             &num_random_samples_));
@@ -303,11 +345,16 @@ class ShuffleDatasetOpBase::ShuffleDatasetBase : public DatasetBase {
       TF_RETURN_IF_ERROR(reader->ReadScalar(this->full_name(kSeed2), &seed2_));
       ResetRngs();
 
-      // Restore the input iterator if it wasn't already exhausted.
+      // Restore the input iterator if it wasn't already exhausted. The input
+      // of an incremental checkpoint is restored by `RestoreIncrementalState`.
+      const bool incremental =
+          reader->Contains(this->full_name(kIncremental));
       if (!reader->Contains(this->full_name(kEndOfInputSequence))) {
         TF_RETURN_IF_ERROR(this->dataset()->input_->MakeIterator(
             ctx, this->prefix(), &input_impl_));
-        TF_RETURN_IF_ERROR(this->RestoreInput(ctx, reader, input_impl_));
+        if (!incremental) {
+          TF_RETURN_IF_ERROR(this->RestoreInput(ctx, reader, input_impl_));
+        }
       } else {
         input_impl_.reset();
       }
@@ -325,6 +372,8 @@ class ShuffleDatasetOpBase::ShuffleDatasetBase : public DatasetBase {
       }
       buffer_ = absl::make_unique<std::vector<Tensor>[]>(
           this->dataset()->buffer_size_);
+      buffer_positions_ =
+          absl::make_unique<InputPosition[]>(this->dataset()->buffer_size_);
       for (size_t i = 0; i < slices_size; ++i) {
         int64 start;
         TF_RETURN_IF_ERROR(
@@ -336,8 +385,15 @@ class ShuffleDatasetOpBase::ShuffleDatasetBase : public DatasetBase {
             this->full_name(absl::StrJoin(std::make_tuple(kSlicesEnd, i), "_")),
             &end));
         slices_.push_back(absl::make_unique<Slice>(start, end));
+        if (incremental) {
+          continue;
+        }
         for (size_t j = start; j < end; ++j) {
           size_t index = j % this->dataset()->buffer_size_;
+          // The input positions of elements restored from a full checkpoint
+          // are unknown, which prevents incremental checkpoints until they
+          // have been produced.
+          buffer_positions_[index] = {-1, -1};
           int64 list_size;
           TF_RETURN_IF_ERROR(reader->ReadScalar(
               this->full_name(
@@ -353,6 +409,17 @@ class ShuffleDatasetOpBase::ShuffleDatasetBase : public DatasetBase {
         }
       }
 
+      input_snapshots_.Clear();
+      input_index_ = 0;
+      if (incremental) {
+        TF_RETURN_IF_ERROR(RestoreIncrementalState(ctx, reader));
+      }
+      if (incremental_checkpointing_ && input_impl_) {
+        // Snapshot the restored input, so that elements read from now on can
+        // be checkpointed incrementally.
+        TF_RETURN_IF_ERROR(SnapshotInput());
+      }
+
       return Status::OK();
     }
 
@@ -361,6 +428,138 @@ class ShuffleDatasetOpBase::ShuffleDatasetBase : public DatasetBase {
     int64 seed2_ GUARDED_BY(mu_);
 
    private:
+    // Returns the input position of the oldest element in `buffer_`, or the
+    // position of the next input element if the buffer is empty.
+    InputPosition OldestBufferedPosition() EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+      InputPosition oldest = {epoch_, input_index_};
+      for (const auto& slice : slices_) {
+        for (int64 j = slice->start; j < slice->end; ++j) {
+          const InputPosition& position =
+              buffer_positions_[j % this->dataset()->buffer_size_];
+          if (position < oldest) {
+            oldest = position;
+          }
+        }
+      }
+      return oldest;
+    }
+
+    // Records that a new input iterator starts the current epoch. Its state
+    // is empty, so the snapshot needs no serialization.
+    void AddEmptyInputSnapshot() EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+      if (incremental_checkpointing_) {
+        input_snapshots_.Add({/*position=*/{epoch_, /*index=*/0}, ""});
+      }
+    }
+
+    // Adds a snapshot of the current input state to `input_snapshots_`.
+    Status SnapshotInput() EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+      const InputPosition position = {epoch_, input_index_};
+      const InputSnapshot* last = input_snapshots_.Find(position);
+      if (last && last->position == position) {
+        return Status::OK();
+      }
+      InputSnapshot snapshot;
+      snapshot.position = position;
+      TF_RETURN_IF_ERROR(SerializeInputState(
+          [this](IteratorStateWriter* writer) {
+            return this->SaveInput(writer, input_impl_);
+          },
+          &snapshot.state));
+      input_snapshots_.Add(std::move(snapshot));
+      return Status::OK();
+    }
+
+    // Writes the input positions of the buffered elements and the snapshot
+    // from which they can be recomputed.
+    Status SaveIncrementalState(IteratorStateWriter* writer,
+                                const InputSnapshot& snapshot)
+        EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+      TF_RETURN_IF_ERROR(
+          writer->WriteScalar(this->full_name(kIncremental), ""));
+      TF_RETURN_IF_ERROR(
+          writer->WriteScalar(this->full_name(kInputIndex), input_index_));
+      TF_RETURN_IF_ERROR(WriteInputSnapshot(
+          writer, this->full_name(kInputSnapshot), snapshot));
+      // Each row holds the buffer index, epoch and input index of an element.
+      Tensor positions(DT_INT64, TensorShape({num_elements_, 3}));
+      auto positions_t = positions.matrix<int64>();
+      int64 row = 0;
+      for (const auto& slice : slices_) {
+        for (int64 j = slice->start; j < slice->end; ++j) {
+          const int64 index = j % this->dataset()->buffer_size_;
+          positions_t(row, 0) = index;
+          positions_t(row, 1) = buffer_positions_[index].epoch;
+          positions_t(row, 2) = buffer_positions_[index].index;
+          ++row;
+        }
+      }
+      return writer->WriteTensor(this->full_name(kBufferPositions), positions);
+    }
+
+    // Recomputes the buffered elements of an incremental checkpoint by
+    // replaying the input from the saved snapshot up to the saved position.
+    Status RestoreIncrementalState(IteratorContext* ctx,
+                                   IteratorStateReader* reader)
+        EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+      TF_RETURN_IF_ERROR(
+          reader->ReadScalar(this->full_name(kInputIndex), &input_index_));
+      InputSnapshot snapshot;
+      TF_RETURN_IF_ERROR(ReadInputSnapshot(
+          reader, this->full_name(kInputSnapshot), &snapshot));
+      Tensor positions;
+      TF_RETURN_IF_ERROR(
+          reader->ReadTensor(this->full_name(kBufferPositions), &positions));
+      auto positions_t = positions.matrix<int64>();
+      std::map<InputPosition, int64> indices;
+      for (int64 row = 0; row < positions.dim_size(0); ++row) {
+        indices[{positions_t(row, 1), positions_t(row, 2)}] =
+            positions_t(row, 0);
+      }
+
+      const bool end_of_input = input_impl_ == nullptr;
+      const InputPosition target = {epoch_, input_index_};
+      InputPosition position = snapshot.position;
+      TF_RETURN_IF_ERROR(this->dataset()->input_->MakeIterator(
+          ctx, this->prefix(), &input_impl_));
+      if (!snapshot.state.empty()) {
+        TF_RETURN_IF_ERROR(DeserializeInputState(
+            snapshot.state, [this, ctx](IteratorStateReader* reader) {
+              return this->RestoreInput(ctx, reader, input_impl_);
+            }));
+      }
+      int64 num_restored = 0;
+      while (position < target) {
+        std::vector<Tensor> element;
+        bool end_of_sequence = false;
+        TF_RETURN_IF_ERROR(input_impl_->GetNext(ctx, &element,
+                                                &end_of_sequence));
+        if (end_of_sequence) {
+          position = {position.epoch + 1, 0};
+          TF_RETURN_IF_ERROR(this->dataset()->input_->MakeIterator(
+              ctx, this->prefix(), &input_impl_));
+          continue;
+        }
+        auto it = indices.find(position);
+        if (it != indices.end()) {
+          buffer_[it->second] = std::move(element);
+          buffer_positions_[it->second] = position;
+          ++num_restored;
+        }
+        position.index++;
+      }
+      if (!(position == target) || num_restored != indices.size()) {
+        return errors::DataLoss(
+            "Failed to recompute the shuffle buffer from an incremental "
+            "checkpoint. This can happen if the input is not deterministic.");
+      }
+      if (end_of_input) {
+        input_impl_.reset();
+      }
+      input_snapshots_.Add(std::move(snapshot));
+      return Status::OK();
+    }
+
     // Used to represent slices of `buffer_` that belong to different epochs.
     // The invariant maintained by the implementation is: `start` <= `end`.
     // When using `start` and `end` to index into `buffer_`, their values
@@ -389,6 +588,14 @@ class ShuffleDatasetOpBase::ShuffleDatasetBase : public DatasetBase {
     random::SingleSampleAdapter<random::PhiloxRandom> generator_
         GUARDED_BY(mu_);
     int64 num_random_samples_ GUARDED_BY(mu_) = 0;
+    // Set from `IteratorContext::incremental_checkpoints()` when the input is
+    // created or restored.
+    bool incremental_checkpointing_ GUARDED_BY(mu_) = false;
+    // The input position of each element of `buffer_`.
+    std::unique_ptr<InputPosition[]> buffer_positions_ GUARDED_BY(mu_);
+    // The number of elements produced by `input_impl_`.
+    int64 input_index_ GUARDED_BY(mu_) = 0;
+    InputSnapshotLog input_snapshots_ GUARDED_BY(mu_);
   };
 
   const DatasetBase* const input_;
@@ -0,0 +1,152 @@
+/* Copyright 2019 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#ifndef TENSORFLOW_CORE_KERNELS_DATA_SPSC_QUEUE_H_
+#define TENSORFLOW_CORE_KERNELS_DATA_SPSC_QUEUE_H_
+
+#include <algorithm>
+#include <atomic>
+#include <utility>
+
+#include "tensorflow/core/platform/macros.h"
+#include "tensorflow/core/platform/types.h"
+
+namespace tensorflow {
+namespace data {
+
+// An unbounded FIFO queue that hands values from a producer to a consumer
+// without locking.
+//
+// At most one thread may act as the producer (`Push()`) and at most one
+// thread may act as the consumer (`Pop()`) at a time. Different threads may
+// take turns in either role, provided that the turns are ordered by some
+// other synchronization (e.g. a mutex per role). `size()` and `empty()` may
+// be called by any thread. `ForEach()` and `Clear()` require that neither
+// role is active.
+//
+// The queue is a linked list of nodes whose first node is a sentinel. The
+// consumer only advances the head of the list, and the producer recycles the
+// nodes that the consumer has passed, so once the queue has grown to its
+// working size it pushes and pops values without allocating.
+template <typename T>
+class SpscQueue {
+ public:
+  SpscQueue() {
+    Node* sentinel = new Node;
+    head_.store(sentinel, std::memory_order_relaxed);
+    tail_ = first_ = head_copy_ = sentinel;
+  }
+
+  ~SpscQueue() {
+    Node* node = first_;
+    while (node != nullptr) {
+      Node* next = node->next.load(std::memory_order_relaxed);
+      delete node;
+      node = next;
+    }
+  }
+
+  // Appends `value` to the queue. Must be called by the producer.
+  void Push(T value) {
+    Node* node = NewNode();
+    node->value = std::move(value);
+    node->next.store(nullptr, std::memory_order_relaxed);
+    tail_->next.store(node, std::memory_order_release);
+    tail_ = node;
+    size_.fetch_add(1, std::memory_order_seq_cst);
+  }
+
+  // Moves the value at the front of the queue to `*value` and removes it.
+  // Returns false if the queue is empty. Must be called by the consumer.
+  bool Pop(T* value) {
+    Node* head = head_.load(std::memory_order_relaxed);
+    Node* next = head->next.load(std::memory_order_acquire);
+    if (next == nullptr) {
+      return false;
+    }
+    *value = std::move(next->value);
+    // `next` becomes the sentinel, so its moved-from value is never read.
+    head_.store(next, std::memory_order_release);
+    size_.fetch_sub(1, std::memory_order_seq_cst);
+    return true;
+  }
+
+  // Returns the number of values in the queue. The result may be stale if a
+  // role is active in another thread, but a consumer that observes a
+  // non-empty queue finds a value to pop.
+  int64 size() const {
+    // The count is updated after the list, so it can briefly be negative.
+    return std::max<int64>(size_.load(std::memory_order_seq_cst), 0);
+  }
+  bool empty() const { return size() == 0; }
+
+  // Calls `fn(index, value)` for each value in the queue, front to back.
+  template <typename Fn>
+  void ForEach(Fn fn) {
+    int64 index = 0;
+    Node* node = head_.load(std::memory_order_acquire)
+                     ->next.load(std::memory_order_acquire);
+    while (node != nullptr) {
+      fn(index++, node->value);
+      node = node->next.load(std::memory_order_acquire);
+    }
+  }
+
+  // Removes all values from the queue.
+  void Clear() {
+    T value;
+    while (Pop(&value)) {
+      value = T();
+    }
+  }
+
+ private:
+  struct Node {
+    std::atomic<Node*> next{nullptr};
+    T value;
+  };
+
+  // Returns a node that the consumer has passed, or a new node if there is
+  // none. Must be called by the producer.
+  Node* NewNode() {
+    if (first_ == head_copy_) {
+      head_copy_ = head_.load(std::memory_order_acquire);
+    }
+    if (first_ != head_copy_) {
+      Node* node = first_;
+      first_ = first_->next.load(std::memory_order_relaxed);
+      // Release the buffers of a value that the consumer did not move from.
+      node->value = T();
+      return node;
+    }
+    return new Node;
+  }
+
+  // Consumer state: the sentinel node, whose successor is the front value.
+  std::atomic<Node*> head_;
+  // Producer state: the last node, the oldest node of the list, and the last
+  // sentinel that the producer has observed. The nodes from `first_` up to
+  // (excluding) `head_copy_` have been passed by the consumer.
+  Node* tail_;
+  Node* first_;
+  Node* head_copy_;
+  std::atomic<int64> size_{0};
+
+  TF_DISALLOW_COPY_AND_ASSIGN(SpscQueue);
+};
+
+}  // namespace data
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_CORE_KERNELS_DATA_SPSC_QUEUE_H_
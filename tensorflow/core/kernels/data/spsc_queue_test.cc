@@ -0,0 +1,90 @@
+/* Copyright 2019 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#include "tensorflow/core/kernels/data/spsc_queue.h"
+
+#include <memory>
+#include <vector>
+
+#include "tensorflow/core/platform/env.h"
+#include "tensorflow/core/platform/test.h"
+
+namespace tensorflow {
+namespace data {
+namespace {
+
+TEST(SpscQueueTest, PushAndPop) {
+  SpscQueue<std::vector<int>> queue;
+  EXPECT_TRUE(queue.empty());
+  // Reuses the nodes of popped values across rounds.
+  for (int round = 0; round < 3; ++round) {
+    for (int i = 0; i < 5; ++i) {
+      queue.Push({round, i});
+    }
+    EXPECT_EQ(queue.size(), 5);
+    std::vector<int> value;
+    for (int i = 0; i < 5; ++i) {
+      ASSERT_TRUE(queue.Pop(&value));
+      EXPECT_EQ(value, std::vector<int>({round, i}));
+    }
+    EXPECT_TRUE(queue.empty());
+    EXPECT_FALSE(queue.Pop(&value));
+  }
+}
+
+TEST(SpscQueueTest, ForEachAndClear) {
+  SpscQueue<int> queue;
+  for (int i = 0; i < 4; ++i) {
+    queue.Push(i * 10);
+  }
+  int popped;
+  ASSERT_TRUE(queue.Pop(&popped));
+  std::vector<int> values;
+  queue.ForEach([&values](int64 index, int value) {
+    EXPECT_EQ(index, values.size());
+    values.push_back(value);
+  });
+  EXPECT_EQ(values, std::vector<int>({10, 20, 30}));
+  queue.Clear();
+  EXPECT_TRUE(queue.empty());
+  queue.Push(40);
+  ASSERT_TRUE(queue.Pop(&popped));
+  EXPECT_EQ(popped, 40);
+}
+
+TEST(SpscQueueTest, ConcurrentProducerAndConsumer) {
+  constexpr int kNumValues = 100000;
+  SpscQueue<std::unique_ptr<int>> queue;
+  std::unique_ptr<Thread> producer(
+      Env::Default()->StartThread({}, "producer", [&queue]() {
+        for (int i = 0; i < kNumValues; ++i) {
+          // Keeps the queue short so that its nodes are recycled.
+          while (queue.size() > 16) {
+          }
+          queue.Push(std::unique_ptr<int>(new int(i)));
+        }
+      }));
+  std::unique_ptr<int> value;
+  for (int i = 0; i < kNumValues; ++i) {
+    while (!queue.Pop(&value)) {
+    }
+    EXPECT_EQ(*value, i);
+  }
+  producer.reset();
+  EXPECT_TRUE(queue.empty());
+}
+
+}  // namespace
+}  // namespace data
+}  // namespace tensorflow
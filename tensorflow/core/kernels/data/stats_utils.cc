@@ -32,6 +32,9 @@ ABSL_CONST_INIT const char kDroppedElements[] = "dropped_elements";
 ABSL_CONST_INIT const char kFeaturesCount[] = "features_count";
 ABSL_CONST_INIT const char kFeatureValuesCount[] = "feature_values_count";
 ABSL_CONST_INIT const char kExamplesCount[] = "examples_count";
+ABSL_CONST_INIT const char kThroughput[] = "throughput";
+ABSL_CONST_INIT const char kWaitTime[] = "wait_time";
+ABSL_CONST_INIT const char kBottleneck[] = "bottleneck";
 
 string ExecutionTimeHistogramName(const string& prefix) {
   return strings::StrCat(prefix, kDelimiter, kExecutionTime);
@@ -69,6 +72,18 @@ string FeatureValueHistogramName(const string& prefix) {
   return strings::StrCat(prefix, kDelimiter, kFeatureValuesCount);
 }
 
+string ThroughputScalarName(const string& prefix) {
+  return strings::StrCat(prefix, kDelimiter, kThroughput);
+}
+
+string WaitTimeScalarName(const string& prefix) {
+  return strings::StrCat(prefix, kDelimiter, kWaitTime);
+}
+
+string BottleneckScalarName(const string& prefix) {
+  return strings::StrCat(prefix, kDelimiter, kBottleneck);
+}
+
 }  // namespace stats_utils
 }  // namespace data
 }  // namespace tensorflow
@@ -31,6 +31,9 @@ extern const char kDroppedElements[];
 extern const char kFeaturesCount[];
 extern const char kFeatureValuesCount[];
 extern const char kExamplesCount[];
+extern const char kThroughput[];
+extern const char kWaitTime[];
+extern const char kBottleneck[];
 
 // Name for tf.data function execution time (in ns) histogram metrics.
 string ExecutionTimeHistogramName(const string& prefix);
@@ -61,6 +64,17 @@ string FeatureHistogramName(const string& prefix);
 // Name for feature-values count histogram metrics.
 string FeatureValueHistogramName(const string& prefix);
 
+// Name for throughput (elements produced per second) scalar metrics.
+string ThroughputScalarName(const string& prefix);
+
+// Name for predicted per-element wait time (in ns) scalar metrics.
+string WaitTimeScalarName(const string& prefix);
+
+// Name for bottleneck indicator (1 if the model predicts that the
+// transformation limits the throughput of the input pipeline and 0 otherwise)
+// scalar metrics.
+string BottleneckScalarName(const string& prefix);
+
 }  // namespace stats_utils
 }  // namespace data
 }  // namespace tensorflow
@@ -35,22 +35,29 @@ namespace data {
 /* static */ constexpr const char* const TFRecordDatasetOp::kFileNames;
 /* static */ constexpr const char* const TFRecordDatasetOp::kCompressionType;
 /* static */ constexpr const char* const TFRecordDatasetOp::kBufferSize;
+/* static */ constexpr const char* const TFRecordDatasetOp::kUseDirectIO;
 
 constexpr char kCurrentFileIndex[] = "current_file_index";
 constexpr char kOffset[] = "offset";
+// Number of buffers of the next records of a file that are read ahead of the
+// iterator.
+constexpr int kNumReadAheadBuffers = 4;
 
 class TFRecordDatasetOp::Dataset : public DatasetBase {
  public:
   explicit Dataset(OpKernelContext* ctx, std::vector<string> filenames,
-                   const string& compression_type, int64 buffer_size)
+                   const string& compression_type, int64 buffer_size,
+                   bool use_direct_io)
       : DatasetBase(DatasetContext(ctx)),
         filenames_(std::move(filenames)),
         compression_type_(compression_type),
+        use_direct_io_(use_direct_io),
         options_(io::RecordReaderOptions::CreateRecordReaderOptions(
             compression_type)) {
     if (buffer_size > 0) {
       options_.buffer_size = buffer_size;
     }
+    options_.num_read_ahead = kNumReadAheadBuffers;
   }
 
   std::unique_ptr<IteratorBase> MakeIteratorInternal(
@@ -86,8 +93,11 @@ class TFRecordDatasetOp::Dataset : public DatasetBase {
     TF_RETURN_IF_ERROR(b->AddScalar(compression_type_, &compression_type));
     Node* buffer_size = nullptr;
     TF_RETURN_IF_ERROR(b->AddScalar(options_.buffer_size, &buffer_size));
+    AttrValue use_direct_io;
+    b->BuildAttrValue(use_direct_io_, &use_direct_io);
     TF_RETURN_IF_ERROR(b->AddDataset(
-        this, {filenames, compression_type, buffer_size}, output));
+        this, {filenames, compression_type, buffer_size},
+        {std::make_pair(kUseDirectIO, use_direct_io)}, output));
     return Status::OK();
   }
 
@@ -186,7 +196,18 @@ class TFRecordDatasetOp::Dataset : public DatasetBase {
 
       // Actually move on to next file.
       const string& next_filename = dataset()->filenames_[current_file_index_];
-      TF_RETURN_IF_ERROR(env->NewRandomAccessFile(next_filename, &file_));
+      if (dataset()->use_direct_io_) {
+        Status s = env->NewDirectRandomAccessFile(next_filename, &file_);
+        if (errors::IsUnimplemented(s)) {
+          LOG_FIRST_N(WARNING, 1)
+              << "Reading TFRecord files through the page cache: "
+              << s.error_message();
+          s = env->NewRandomAccessFile(next_filename, &file_);
+        }
+        TF_RETURN_IF_ERROR(s);
+      } else {
+        TF_RETURN_IF_ERROR(env->NewRandomAccessFile(next_filename, &file_));
+      }
       reader_ = absl::make_unique<io::SequentialRecordReader>(
           file_.get(), dataset()->options_);
       return Status::OK();
@@ -209,11 +230,14 @@ class TFRecordDatasetOp::Dataset : public DatasetBase {
 
   const std::vector<string> filenames_;
   const tstring compression_type_;
+  const bool use_direct_io_;
   io::RecordReaderOptions options_;
 };
 
 TFRecordDatasetOp::TFRecordDatasetOp(OpKernelConstruction* ctx)
-    : DatasetOpKernel(ctx) {}
+    : DatasetOpKernel(ctx) {
+  OP_REQUIRES_OK(ctx, ctx->GetAttr(kUseDirectIO, &use_direct_io_));
+}
 
 void TFRecordDatasetOp::MakeDataset(OpKernelContext* ctx,
                                     DatasetBase** output) {
@@ -241,8 +265,8 @@ void TFRecordDatasetOp::MakeDataset(OpKernelContext* ctx,
               errors::InvalidArgument(
                   "`buffer_size` must be >= 0 (0 == no buffering)"));
 
-  *output =
-      new Dataset(ctx, std::move(filenames), compression_type, buffer_size);
+  *output = new Dataset(ctx, std::move(filenames), compression_type,
+                        buffer_size, use_direct_io_);
 }
 
 namespace {
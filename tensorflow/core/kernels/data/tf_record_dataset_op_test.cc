@@ -23,12 +23,13 @@ class TFRecordDatasetParams : public DatasetParams {
  public:
   TFRecordDatasetParams(std::vector<tstring> filenames,
                         CompressionType compression_type, int64 buffer_size,
-                        string node_name)
+                        bool use_direct_io, string node_name)
       : DatasetParams({DT_STRING}, {PartialTensorShape({})},
                       std::move(node_name)),
         filenames_(std::move(filenames)),
         compression_type_(compression_type),
-        buffer_size_(buffer_size) {}
+        buffer_size_(buffer_size),
+        use_direct_io_(use_direct_io) {}
 
   std::vector<Tensor> GetInputTensors() const override {
     int num_files = filenames_.size();
@@ -49,7 +50,7 @@ class TFRecordDatasetParams : public DatasetParams {
   }
 
   Status GetAttributes(AttributeVector* attr_vector) const override {
-    *attr_vector = {};
+    *attr_vector = {{TFRecordDatasetOp::kUseDirectIO, use_direct_io_}};
     return Status::OK();
   }
 
@@ -61,6 +62,7 @@ class TFRecordDatasetParams : public DatasetParams {
   std::vector<tstring> filenames_;
   CompressionType compression_type_;
   int64 buffer_size_;
+  bool use_direct_io_;
 };
 
 class TFRecordDatasetOpTest : public DatasetOpsTestBaseV2 {};
@@ -98,6 +100,7 @@ TFRecordDatasetParams TFRecordDatasetParams1() {
   return TFRecordDatasetParams(filenames,
                                /*compression_type=*/compression_type,
                                /*buffer_size=*/10,
+                               /*use_direct_io=*/false,
                                /*node_name=*/kNodeName);
 }
 
@@ -116,6 +119,7 @@ TFRecordDatasetParams TFRecordDatasetParams2() {
   return TFRecordDatasetParams(filenames,
                                /*compression_type=*/compression_type,
                                /*buffer_size=*/10,
+                               /*use_direct_io=*/false,
                                /*node_name=*/kNodeName);
 }
 
@@ -134,6 +138,27 @@ TFRecordDatasetParams TFRecordDatasetParams3() {
   return TFRecordDatasetParams(filenames,
                                /*compression_type=*/compression_type,
                                /*buffer_size=*/10,
+                               /*use_direct_io=*/false,
+                               /*node_name=*/kNodeName);
+}
+
+// Test case 4: multiple uncompressed files read with direct I/O, which falls
+// back to buffered reads if the file system does not support it.
+TFRecordDatasetParams TFRecordDatasetParams4() {
+  std::vector<tstring> filenames = {
+      absl::StrCat(testing::TmpDir(), "/tf_record_DIRECT_IO_1"),
+      absl::StrCat(testing::TmpDir(), "/tf_record_DIRECT_IO_2")};
+  std::vector<std::vector<string>> contents = {{"1", "22", "333"},
+                                               {"a", "bb", "ccc"}};
+  CompressionType compression_type = CompressionType::UNCOMPRESSED;
+  if (!CreateTestFiles(filenames, contents, compression_type).ok()) {
+    VLOG(WARNING) << "Failed to create the test files: "
+                  << absl::StrJoin(filenames, ", ");
+  }
+  return TFRecordDatasetParams(filenames,
+                               /*compression_type=*/compression_type,
+                               /*buffer_size=*/10,
+                               /*use_direct_io=*/true,
                                /*node_name=*/kNodeName);
 }
 
@@ -147,6 +172,9 @@ std::vector<GetNextTestCase<TFRecordDatasetParams>> GetNextTestCases() {
        CreateTensors<tstring>(
            TensorShape({}), {{"1"}, {"22"}, {"333"}, {"a"}, {"bb"}, {"ccc"}})},
       {/*dataset_params=*/TFRecordDatasetParams3(),
+       CreateTensors<tstring>(
+           TensorShape({}), {{"1"}, {"22"}, {"333"}, {"a"}, {"bb"}, {"ccc"}})},
+      {/*dataset_params=*/TFRecordDatasetParams4(),
        CreateTensors<tstring>(
            TensorShape({}), {{"1"}, {"22"}, {"333"}, {"a"}, {"bb"}, {"ccc"}})}};
 }
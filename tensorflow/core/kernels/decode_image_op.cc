@@ -15,7 +15,10 @@ limitations under the License.
 
 // See docs in ../ops/image_ops.cc
 
+#include <algorithm>
+#include <cmath>
 #include <memory>
+#include <vector>
 
 #include "absl/strings/escaping.h"
 #include "tensorflow/core/framework/op_kernel.h"
@@ -65,6 +68,33 @@ string FileFormatString(FileFormat magic, StringPiece data) {
   }
 }
 
+// Reads the JPEG decoding attrs shared by the JPEG decoding ops into `flags`.
+Status GetJpegAttrs(OpKernelConstruction* context,
+                    jpeg::UncompressFlags* flags) {
+  // The TensorFlow-chosen default for jpeg decoding is IFAST, sacrificing
+  // image quality for speed.
+  flags->dct_method = JDCT_IFAST;
+  TF_RETURN_IF_ERROR(
+      context->GetAttr("fancy_upscaling", &flags->fancy_upscaling));
+  TF_RETURN_IF_ERROR(context->GetAttr("try_recover_truncated",
+                                      &flags->try_recover_truncated_jpeg));
+  TF_RETURN_IF_ERROR(context->GetAttr("acceptable_fraction",
+                                      &flags->min_acceptable_fraction));
+
+  string dct_method;
+  TF_RETURN_IF_ERROR(context->GetAttr("dct_method", &dct_method));
+  if (!dct_method.empty() && dct_method != "INTEGER_FAST" &&
+      dct_method != "INTEGER_ACCURATE") {
+    return errors::InvalidArgument(
+        "dct_method must be one of "
+        "{'', 'INTEGER_FAST', 'INTEGER_ACCURATE'}");
+  }
+  if (dct_method == "INTEGER_ACCURATE") {
+    flags->dct_method = JDCT_ISLOW;
+  }
+  return Status::OK();
+}
+
 // Decode an image (either jpeg, png, or gif).  We use a single op so that
 // users don't have to care about which format they have.
 class DecodeImageOp : public OpKernel {
@@ -111,10 +141,6 @@ class DecodeImageOp : public OpKernel {
       }
     }
 
-    // The TensorFlow-chosen default for jpeg decoding is IFAST, sacrificing
-    // image quality for speed.
-    flags_.dct_method = JDCT_IFAST;
-
     if (format_ == kJpgFormat) {
       OP_REQUIRES_OK(context, context->GetAttr("ratio", &flags_.ratio));
       OP_REQUIRES(context,
@@ -122,28 +148,7 @@ class DecodeImageOp : public OpKernel {
                       flags_.ratio == 8,
                   errors::InvalidArgument("ratio must be 1, 2, 4, or 8, got ",
                                           flags_.ratio));
-      OP_REQUIRES_OK(context, context->GetAttr("fancy_upscaling",
-                                               &flags_.fancy_upscaling));
-      OP_REQUIRES_OK(context,
-                     context->GetAttr("try_recover_truncated",
-                                      &flags_.try_recover_truncated_jpeg));
-      OP_REQUIRES_OK(context,
-                     context->GetAttr("acceptable_fraction",
-                                      &flags_.min_acceptable_fraction));
-
-      string dct_method;
-      OP_REQUIRES_OK(context, context->GetAttr("dct_method", &dct_method));
-      OP_REQUIRES(
-          context,
-          (dct_method.empty() || dct_method == "INTEGER_FAST" ||
-           dct_method == "INTEGER_ACCURATE"),
-          errors::InvalidArgument("dct_method must be one of "
-                                  "{'', 'INTEGER_FAST', 'INTEGER_ACCURATE'}"));
-      if (dct_method == "INTEGER_FAST") {
-        flags_.dct_method = JDCT_IFAST;
-      } else if (dct_method == "INTEGER_ACCURATE") {
-        flags_.dct_method = JDCT_ISLOW;
-      }
+      OP_REQUIRES_OK(context, GetJpegAttrs(context, &flags_));
     }
   }
 
@@ -336,11 +341,200 @@ class DecodeImageOp : public OpKernel {
   jpeg::UncompressFlags flags_;
 };
 
+// Decodes a crop window of a JPEG image and resizes it with bilinear
+// interpolation. The image is decoded at the smallest of the 1/8, 1/4 and 1/2
+// scales of the DCT that keeps at least the output size in the crop window,
+// and only the rows and columns of the window are decoded, so that resizing a
+// large image to a small size decodes a fraction of its pixels.
+class DecodeCropAndResizeJpegOp : public OpKernel {
+ public:
+  explicit DecodeCropAndResizeJpegOp(OpKernelConstruction* context)
+      : OpKernel(context) {
+    OP_REQUIRES_OK(context, context->GetAttr("channels", &channels_));
+    OP_REQUIRES(context, channels_ == 0 || channels_ == 1 || channels_ == 3,
+                errors::InvalidArgument(
+                    "channels must be 0, 1, or 3 for JPEG, got ", channels_));
+    flags_.components = channels_;
+    OP_REQUIRES_OK(context, GetJpegAttrs(context, &flags_));
+  }
+
+  void Compute(OpKernelContext* context) override {
+    const Tensor& contents = context->input(0);
+    OP_REQUIRES(context, TensorShapeUtils::IsScalar(contents.shape()),
+                errors::InvalidArgument("contents must be scalar, got shape ",
+                                        contents.shape().DebugString()));
+    const StringPiece input = contents.scalar<tstring>()();
+    const auto magic = ClassifyFileFormat(input);
+    OP_REQUIRES(context, magic == kJpgFormat,
+                errors::InvalidArgument("Expected image (JPEG), got ",
+                                        FileFormatString(magic, input)));
+    OP_REQUIRES(context, input.size() <= std::numeric_limits<int>::max(),
+                errors::InvalidArgument("JPEG contents are too large for int: ",
+                                        input.size()));
+
+    const Tensor& crop_window = context->input(1);
+    OP_REQUIRES(context,
+                TensorShapeUtils::IsVector(crop_window.shape()) &&
+                    crop_window.NumElements() == 4,
+                errors::InvalidArgument("crop_window must have shape [4], got ",
+                                        crop_window.shape().DebugString()));
+    const Tensor& size = context->input(2);
+    OP_REQUIRES(context,
+                TensorShapeUtils::IsVector(size.shape()) &&
+                    size.NumElements() == 2,
+                errors::InvalidArgument("size must have shape [2], got ",
+                                        size.shape().DebugString()));
+    const auto crop_window_vec = crop_window.vec<int32>();
+    const int crop_y = crop_window_vec(0);
+    const int crop_x = crop_window_vec(1);
+    const int crop_height = crop_window_vec(2);
+    const int crop_width = crop_window_vec(3);
+    const int out_height = size.vec<int32>()(0);
+    const int out_width = size.vec<int32>()(1);
+    OP_REQUIRES(context, out_height > 0 && out_width > 0,
+                errors::InvalidArgument("size must be positive, got ",
+                                        out_height, "x", out_width));
+
+    int width, height, components;
+    OP_REQUIRES(context,
+                jpeg::GetImageInfo(input.data(), input.size(), &width, &height,
+                                   &components),
+                errors::InvalidArgument("Invalid JPEG data, data size ",
+                                        input.size()));
+    OP_REQUIRES(
+        context,
+        crop_y >= 0 && crop_x >= 0 && crop_height > 0 && crop_width > 0 &&
+            crop_height <= height - crop_y && crop_width <= width - crop_x,
+        errors::InvalidArgument("Invalid crop window [", crop_y, ", ", crop_x,
+                                ", ", crop_height, ", ", crop_width,
+                                "] for a ", height, "x", width, " image"));
+
+    // The largest scaling denominator that keeps at least `out_height` rows
+    // and `out_width` columns in the crop window, so that the image is only
+    // downsampled after decoding.
+    int ratio = 8;
+    while (ratio > 1 && (crop_height / ratio < out_height ||
+                         crop_width / ratio < out_width)) {
+      ratio /= 2;
+    }
+    // libjpeg rounds the scaled dimensions up. The scaled crop window covers
+    // the pixels of the scaled image that overlap the crop window.
+    const int scaled_height = (height + ratio - 1) / ratio;
+    const int scaled_width = (width + ratio - 1) / ratio;
+    const int scaled_y = crop_y / ratio;
+    const int scaled_x = crop_x / ratio;
+    jpeg::UncompressFlags flags = flags_;
+    flags.ratio = ratio;
+    flags.crop = true;
+    flags.crop_y = scaled_y;
+    flags.crop_x = scaled_x;
+    flags.crop_height =
+        std::min((crop_y + crop_height + ratio - 1) / ratio, scaled_height) -
+        scaled_y;
+    flags.crop_width =
+        std::min((crop_x + crop_width + ratio - 1) / ratio, scaled_width) -
+        scaled_x;
+
+    Tensor decoded;
+    OP_REQUIRES(
+        context,
+        jpeg::Uncompress(
+            input.data(), input.size(), flags, nullptr /* nwarn */,
+            [=, &decoded](int decoded_width, int decoded_height,
+                          int decoded_channels) -> uint8* {
+              Status status(context->allocate_temp(
+                  DT_UINT8,
+                  TensorShape(
+                      {decoded_height, decoded_width, decoded_channels}),
+                  &decoded));
+              if (!status.ok()) {
+                VLOG(1) << status;
+                context->SetStatus(status);
+                return nullptr;
+              }
+              return decoded.flat<uint8>().data();
+            }),
+        errors::InvalidArgument("Invalid JPEG data, data size ",
+                                input.size()));
+
+    const int channels = decoded.dim_size(2);
+    Tensor* output = nullptr;
+    OP_REQUIRES_OK(context,
+                   context->allocate_output(
+                       0, TensorShape({out_height, out_width, channels}),
+                       &output));
+    // Maps the centers of the output pixels to the decoded pixels, whose
+    // centers are at `(i + 0.5) * ratio` in the full image.
+    const std::vector<Interpolation> ys = ComputeInterpolation(
+        crop_y, crop_height, out_height, ratio, scaled_y, decoded.dim_size(0));
+    std::vector<Interpolation> xs = ComputeInterpolation(
+        crop_x, crop_width, out_width, ratio, scaled_x, decoded.dim_size(1));
+    for (Interpolation& x : xs) {
+      x.lower *= channels;
+      x.upper *= channels;
+    }
+    const uint8* decoded_data = decoded.flat<uint8>().data();
+    const int64 decoded_row_size = decoded.dim_size(1) * channels;
+    float* out = output->flat<float>().data();
+    for (const Interpolation& y : ys) {
+      const uint8* top = decoded_data + y.lower * decoded_row_size;
+      const uint8* bottom = decoded_data + y.upper * decoded_row_size;
+      for (const Interpolation& x : xs) {
+        for (int c = 0; c < channels; ++c) {
+          const float top_left = top[x.lower + c];
+          const float top_right = top[x.upper + c];
+          const float bottom_left = bottom[x.lower + c];
+          const float bottom_right = bottom[x.upper + c];
+          const float top_value = top_left + (top_right - top_left) * x.lerp;
+          const float bottom_value =
+              bottom_left + (bottom_right - bottom_left) * x.lerp;
+          *out++ = top_value + (bottom_value - top_value) * y.lerp;
+        }
+      }
+    }
+  }
+
+ private:
+  struct Interpolation {
+    int64 lower;
+    int64 upper;
+    float lerp;
+  };
+
+  // Returns the decoded pixels to interpolate for each of the `out_size`
+  // output pixels along a dimension, with half pixel centers, for a crop
+  // window at `crop_start` of `crop_size` pixels in the full image, decoded at
+  // 1/`ratio` scale from `decoded_start` into `decoded_size` pixels.
+  static std::vector<Interpolation> ComputeInterpolation(
+      int crop_start, int crop_size, int out_size, int ratio,
+      int decoded_start, int64 decoded_size) {
+    std::vector<Interpolation> interpolation(out_size);
+    const double scale = static_cast<double>(crop_size) / out_size;
+    for (int i = 0; i < out_size; ++i) {
+      const double in =
+          (crop_start + (i + 0.5) * scale) / ratio - 0.5 - decoded_start;
+      const double in_floor = std::floor(in);
+      interpolation[i].lower = std::min(
+          std::max(static_cast<int64>(in_floor), int64{0}), decoded_size - 1);
+      interpolation[i].upper = std::min(
+          std::max(static_cast<int64>(std::ceil(in)), int64{0}),
+          decoded_size - 1);
+      interpolation[i].lerp = in - in_floor;
+    }
+    return interpolation;
+  }
+
+  int channels_;
+  jpeg::UncompressFlags flags_;
+};
+
 REGISTER_KERNEL_BUILDER(Name("DecodeJpeg").Device(DEVICE_CPU), DecodeImageOp);
 REGISTER_KERNEL_BUILDER(Name("DecodePng").Device(DEVICE_CPU), DecodeImageOp);
 REGISTER_KERNEL_BUILDER(Name("DecodeGif").Device(DEVICE_CPU), DecodeImageOp);
 REGISTER_KERNEL_BUILDER(Name("DecodeAndCropJpeg").Device(DEVICE_CPU),
                         DecodeImageOp);
+REGISTER_KERNEL_BUILDER(Name("DecodeCropAndResizeJpeg").Device(DEVICE_CPU),
+                        DecodeCropAndResizeJpegOp);
 
 }  // namespace
 }  // namespace tensorflow
@@ -24,6 +24,7 @@ limitations under the License.
 #include "tensorflow/core/framework/register_types.h"
 #include "tensorflow/core/framework/tensor.h"
 #include "tensorflow/core/framework/tensor_shape.h"
+#include "tensorflow/core/framework/types.h"
 #include "tensorflow/core/kernels/transpose_functor.h"
 #include "tensorflow/core/lib/core/status.h"
 #include "tensorflow/core/lib/strings/str_util.h"
@@ -181,12 +182,14 @@ void TransposeOp::Compute(OpKernelContext* ctx) {
                                         absl::StrJoin(permutation, ","), "}."));
   }
 
+  // Conjugating a real tensor does nothing.
+  const bool conjugate = IsConjugate() && DataTypeIsComplex(input.dtype());
   // 0-D, 1-D, and identity transposes do nothing.
-  if (!IsConjugate() && (dims <= 1 || is_identity)) {
+  if (!conjugate && (dims <= 1 || is_identity)) {
     ctx->set_output(0, input);
     return;
-  } else if (!IsConjugate() && internal::NonSingletonDimensionsAlign(
-                                   input.shape(), permutation)) {
+  } else if (!conjugate && internal::NonSingletonDimensionsAlign(
+                               input.shape(), permutation)) {
     Tensor output;
     OP_REQUIRES(ctx, output.CopyFrom(input, shape),
                 errors::Unknown("Error reshaping Tensor."));
@@ -0,0 +1,82 @@
+/* Copyright 2019 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/lib/io/aligned_buffer_pool.h"
+
+#include "tensorflow/core/platform/logging.h"
+#include "tensorflow/core/platform/mem.h"
+
+namespace tensorflow {
+namespace io {
+namespace {
+
+// Bytes of released buffers that the global pool caches.
+constexpr size_t kGlobalPoolCachedBytes = 256 << 20;
+
+}  // namespace
+
+AlignedBufferPool::AlignedBufferPool(size_t max_cached_bytes)
+    : max_cached_bytes_(max_cached_bytes) {}
+
+AlignedBufferPool::~AlignedBufferPool() {
+  for (auto& entry : buffers_) {
+    for (char* buffer : entry.second) {
+      port::AlignedFree(buffer);
+    }
+  }
+}
+
+AlignedBufferPool* AlignedBufferPool::Global() {
+  static AlignedBufferPool* pool =
+      new AlignedBufferPool(kGlobalPoolCachedBytes);
+  return pool;
+}
+
+char* AlignedBufferPool::Allocate(size_t size, size_t alignment) {
+  {
+    mutex_lock l(mu_);
+    auto it = buffers_.find({size, alignment});
+    if (it != buffers_.end() && !it->second.empty()) {
+      char* buffer = it->second.back();
+      it->second.pop_back();
+      cached_bytes_ -= size;
+      return buffer;
+    }
+  }
+  char* buffer = static_cast<char*>(port::AlignedMalloc(size, alignment));
+  CHECK(buffer != nullptr) << "Failed to allocate " << size
+                           << " bytes aligned to " << alignment;
+  return buffer;
+}
+
+void AlignedBufferPool::Release(char* buffer, size_t size, size_t alignment) {
+  {
+    mutex_lock l(mu_);
+    if (cached_bytes_ + size <= max_cached_bytes_) {
+      buffers_[{size, alignment}].push_back(buffer);
+      cached_bytes_ += size;
+      return;
+    }
+  }
+  port::AlignedFree(buffer);
+}
+
+size_t AlignedBufferPool::cached_bytes() const {
+  mutex_lock l(mu_);
+  return cached_bytes_;
+}
+
+}  // namespace io
+}  // namespace tensorflow
@@ -0,0 +1,71 @@
+/* Copyright 2019 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_CORE_LIB_IO_ALIGNED_BUFFER_POOL_H_
+#define TENSORFLOW_CORE_LIB_IO_ALIGNED_BUFFER_POOL_H_
+
+#include <map>
+#include <utility>
+#include <vector>
+
+#include "tensorflow/core/platform/macros.h"
+#include "tensorflow/core/platform/mutex.h"
+#include "tensorflow/core/platform/thread_annotations.h"
+#include "tensorflow/core/platform/types.h"
+
+namespace tensorflow {
+namespace io {
+
+// Recycles the buffers of readers of files opened with direct I/O, whose
+// reads avoid a copy only if the buffer is aligned (see
+// `RandomAccessFile::ReadAlignment()`). Such readers are typically created
+// once per file of a dataset, and reuse the buffers of the files read before.
+//
+// AlignedBufferPool is thread-safe.
+class AlignedBufferPool {
+ public:
+  // Caches up to `max_cached_bytes` bytes of released buffers.
+  explicit AlignedBufferPool(size_t max_cached_bytes);
+  ~AlignedBufferPool();
+
+  // Returns the pool shared by the readers of lib/io.
+  static AlignedBufferPool* Global();
+
+  // Returns a buffer of `size` bytes whose address is a multiple of
+  // `alignment`, which must be a power of two.
+  char* Allocate(size_t size, size_t alignment);
+
+  // Returns `buffer`, which was returned by `Allocate(size, alignment)`, to
+  // the pool.
+  void Release(char* buffer, size_t size, size_t alignment);
+
+  // Returns the number of bytes of the buffers cached by the pool.
+  size_t cached_bytes() const;
+
+ private:
+  const size_t max_cached_bytes_;
+  mutable mutex mu_;
+  // The cached buffers, keyed by size and alignment.
+  std::map<std::pair<size_t, size_t>, std::vector<char*>> buffers_
+      GUARDED_BY(mu_);
+  size_t cached_bytes_ GUARDED_BY(mu_) = 0;
+
+  TF_DISALLOW_COPY_AND_ASSIGN(AlignedBufferPool);
+};
+
+}  // namespace io
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_CORE_LIB_IO_ALIGNED_BUFFER_POOL_H_
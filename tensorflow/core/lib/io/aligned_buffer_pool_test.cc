@@ -0,0 +1,60 @@
+/* Copyright 2019 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/lib/io/aligned_buffer_pool.h"
+
+#include "tensorflow/core/platform/test.h"
+
+namespace tensorflow {
+namespace io {
+namespace {
+
+TEST(AlignedBufferPoolTest, ReturnsAlignedBuffers) {
+  AlignedBufferPool pool(/*max_cached_bytes=*/1 << 20);
+  for (size_t alignment : {1, 64, 4096}) {
+    char* buffer = pool.Allocate(10000, alignment);
+    EXPECT_EQ(reinterpret_cast<uintptr_t>(buffer) % alignment, 0);
+    // The whole buffer is writable.
+    memset(buffer, 1, 10000);
+    pool.Release(buffer, 10000, alignment);
+  }
+}
+
+TEST(AlignedBufferPoolTest, ReusesReleasedBuffers) {
+  AlignedBufferPool pool(/*max_cached_bytes=*/1 << 20);
+  char* buffer = pool.Allocate(8192, 4096);
+  pool.Release(buffer, 8192, 4096);
+  EXPECT_EQ(pool.cached_bytes(), 8192);
+  // Only a buffer of the same size and alignment is reused.
+  char* other = pool.Allocate(4096, 4096);
+  EXPECT_NE(other, buffer);
+  EXPECT_EQ(pool.Allocate(8192, 4096), buffer);
+  EXPECT_EQ(pool.cached_bytes(), 0);
+  pool.Release(other, 4096, 4096);
+  pool.Release(buffer, 8192, 4096);
+}
+
+TEST(AlignedBufferPoolTest, BoundsCachedBytes) {
+  AlignedBufferPool pool(/*max_cached_bytes=*/10000);
+  char* first = pool.Allocate(8192, 4096);
+  char* second = pool.Allocate(8192, 4096);
+  pool.Release(first, 8192, 4096);
+  pool.Release(second, 8192, 4096);
+  EXPECT_EQ(pool.cached_bytes(), 8192);
+}
+
+}  // namespace
+}  // namespace io
+}  // namespace tensorflow
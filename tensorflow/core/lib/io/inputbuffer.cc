@@ -15,6 +15,7 @@ limitations under the License.
 
 #include "tensorflow/core/lib/io/inputbuffer.h"
 #include "tensorflow/core/lib/core/errors.h"
+#include "tensorflow/core/lib/io/aligned_buffer_pool.h"
 #include "tensorflow/core/platform/logging.h"
 
 namespace tensorflow {
@@ -23,22 +24,50 @@ namespace io {
 InputBuffer::InputBuffer(RandomAccessFile* file, size_t buffer_bytes)
     : file_(file),
       file_pos_(0),
-      size_(buffer_bytes),
-      buf_(new char[size_]),
+      alignment_(file->ReadAlignment()),
+      size_((buffer_bytes + alignment_ - 1) / alignment_ * alignment_),
+      buf_(alignment_ > 1
+               ? AlignedBufferPool::Global()->Allocate(size_, alignment_)
+               : new char[size_]),
       pos_(buf_),
       limit_(buf_) {}
 
-InputBuffer::~InputBuffer() { delete[] buf_; }
+InputBuffer::InputBuffer(RandomAccessFile* file, size_t buffer_bytes,
+                         int num_read_ahead)
+    : InputBuffer(file, buffer_bytes) {
+  if (num_read_ahead > 0) {
+    read_ahead_.reset(new ReadAhead(file, buffer_bytes, num_read_ahead));
+  }
+}
+
+InputBuffer::~InputBuffer() {
+  // The reads in flight must complete before the buffers are released.
+  read_ahead_.reset();
+  if (alignment_ > 1) {
+    AlignedBufferPool::Global()->Release(buf_, size_, alignment_);
+  } else {
+    delete[] buf_;
+  }
+}
 
 Status InputBuffer::FillBuffer() {
+  // The read starts at an aligned offset, so after a seek to an unaligned
+  // position the buffer starts with the bytes before "file_pos_".
+  const size_t skip = file_pos_ % alignment_;
+  const int64 read_pos = file_pos_ - skip;
   StringPiece data;
-  Status s = file_->Read(file_pos_, size_, &data, buf_);
+  Status s = read_ahead_ ? read_ahead_->Read(read_pos, size_, &data, buf_)
+                         : file_->Read(read_pos, size_, &data, buf_);
   if (data.data() != buf_) {
     memmove(buf_, data.data(), data.size());
   }
-  pos_ = buf_;
-  limit_ = pos_ + data.size();
-  file_pos_ += data.size();
+  if (data.size() <= skip) {
+    pos_ = limit_ = buf_;
+    return s;
+  }
+  pos_ = buf_ + skip;
+  limit_ = buf_ + data.size();
+  file_pos_ = read_pos + data.size();
   return s;
 }
 
@@ -61,7 +90,7 @@ Status InputBuffer::ReadLine(T* result) {
     if (buf_remain > 0) result->append(pos_, buf_remain);
     // Get more data into buffer
     s = FillBuffer();
-    DCHECK_EQ(pos_, buf_);
+    DCHECK_LT(static_cast<size_t>(pos_ - buf_), alignment_);
   } while (limit_ != buf_);
   if (!result->empty() && result->back() == '\r') {
     result->resize(result->size() - 1);
@@ -16,10 +16,12 @@ limitations under the License.
 #ifndef TENSORFLOW_LIB_IO_INPUTBUFFER_H_
 #define TENSORFLOW_LIB_IO_INPUTBUFFER_H_
 
+#include <memory>
 #include <string>
 
 #include "tensorflow/core/lib/core/coding.h"
 #include "tensorflow/core/lib/core/status.h"
+#include "tensorflow/core/lib/io/read_ahead.h"
 #include "tensorflow/core/platform/env.h"
 #include "tensorflow/core/platform/macros.h"
 #include "tensorflow/core/platform/types.h"
@@ -34,7 +36,16 @@ class InputBuffer {
  public:
   // Create an InputBuffer for "file" with a buffer size of
   // "buffer_bytes" bytes.  'file' must outlive *this.
+  //
+  // If "file" was opened with direct I/O, the buffer and the reads of "file"
+  // are aligned to its ReadAlignment(), and the buffer size is rounded up to
+  // a multiple of it.
   InputBuffer(RandomAccessFile* file, size_t buffer_bytes);
+
+  // Like above, but also keeps up to "num_read_ahead" reads of
+  // "buffer_bytes" bytes that follow the buffered data in flight, so that
+  // refilling the buffer of a sequential reader does not wait for the file.
+  InputBuffer(RandomAccessFile* file, size_t buffer_bytes, int num_read_ahead);
   ~InputBuffer();
 
   // Read one text line of data into "*result" until end-of-file or a
@@ -98,11 +109,13 @@ class InputBuffer {
 
   RandomAccessFile* file_;  // Not owned
   int64 file_pos_;          // Next position to read from in "file_"
+  size_t alignment_;        // Alignment of the reads of "file_"
   size_t size_;             // Size of "buf_"
   char* buf_;               // The buffer itself
   // [pos_,limit_) hold the "limit_ - pos_" bytes just before "file_pos_"
   char* pos_;    // Current position in "buf"
   char* limit_;  // Just past end of valid data in "buf"
+  std::unique_ptr<ReadAhead> read_ahead_;  // Null without read-ahead
 
   TF_DISALLOW_COPY_AND_ASSIGN(InputBuffer);
 };
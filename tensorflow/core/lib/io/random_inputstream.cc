@@ -19,11 +19,32 @@ limitations under the License.
 namespace tensorflow {
 namespace io {
 
+// Size of the chunks through which files opened with direct I/O are read.
+static constexpr size_t kDirectIOChunkBytes = 256 * 1024;
+
 RandomAccessInputStream::RandomAccessInputStream(RandomAccessFile* file,
                                                  bool owns_file)
-    : file_(file), owns_file_(owns_file) {}
+    : RandomAccessInputStream(file, owns_file, kDirectIOChunkBytes,
+                              /*num_read_ahead=*/0) {}
+
+RandomAccessInputStream::RandomAccessInputStream(RandomAccessFile* file,
+                                                 bool owns_file,
+                                                 size_t chunk_bytes,
+                                                 int num_read_ahead)
+    : file_(file), owns_file_(owns_file) {
+  if (num_read_ahead > 0) {
+    read_ahead_.reset(new ReadAhead(file, chunk_bytes, num_read_ahead));
+  } else if (file->ReadAlignment() > 1) {
+    // Reads of files opened with direct I/O bypass the page cache, so small
+    // unaligned reads would each read their blocks from the device. Reading
+    // aligned chunks ahead serves them from memory.
+    read_ahead_.reset(new ReadAhead(file, kDirectIOChunkBytes, 1));
+  }
+}
 
 RandomAccessInputStream::~RandomAccessInputStream() {
+  // The reads in flight must complete before the file is deleted.
+  read_ahead_.reset();
   if (owns_file_) {
     delete file_;
   }
@@ -38,7 +59,10 @@ Status RandomAccessInputStream::ReadNBytes(int64 bytes_to_read,
   result->resize(bytes_to_read);
   char* result_buffer = &(*result)[0];
   StringPiece data;
-  Status s = file_->Read(pos_, bytes_to_read, &data, result_buffer);
+  Status s =
+      read_ahead_
+          ? read_ahead_->Read(pos_, bytes_to_read, &data, result_buffer)
+          : file_->Read(pos_, bytes_to_read, &data, result_buffer);
   if (data.data() != result_buffer) {
     memmove(result_buffer, data.data(), data.size());
   }
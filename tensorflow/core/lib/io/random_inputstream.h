@@ -17,6 +17,7 @@ limitations under the License.
 #define TENSORFLOW_CORE_LIB_IO_RANDOM_INPUTSTREAM_H_
 
 #include "tensorflow/core/lib/io/inputstream_interface.h"
+#include "tensorflow/core/lib/io/read_ahead.h"
 #include "tensorflow/core/platform/cord.h"
 #include "tensorflow/core/platform/file_system.h"
 
@@ -28,9 +29,16 @@ namespace io {
 class RandomAccessInputStream : public InputStreamInterface {
  public:
   // Does not take ownership of 'file' unless owns_file is set to true. 'file'
-  // must outlive *this.
+  // must outlive *this. Files opened with direct I/O are read through aligned
+  // chunks.
   RandomAccessInputStream(RandomAccessFile* file, bool owns_file = false);
 
+  // Like above, but also keeps up to 'num_read_ahead' reads of 'chunk_bytes'
+  // bytes that follow the current position in flight. Sequential reads are
+  // served from these chunks.
+  RandomAccessInputStream(RandomAccessFile* file, bool owns_file,
+                          size_t chunk_bytes, int num_read_ahead);
+
   ~RandomAccessInputStream();
 
   Status ReadNBytes(int64 bytes_to_read, tstring* result) override;
@@ -54,6 +62,7 @@ class RandomAccessInputStream : public InputStreamInterface {
   RandomAccessFile* file_;  // Not owned.
   int64 pos_ = 0;           // Tracks where we are in the file.
   bool owns_file_ = false;
+  std::unique_ptr<ReadAhead> read_ahead_;  // Null without read-ahead.
 };
 
 }  // namespace io
@@ -0,0 +1,138 @@
+/* Copyright 2019 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/lib/io/read_ahead.h"
+
+#include <string.h>
+
+#include <algorithm>
+
+#include "tensorflow/core/lib/io/aligned_buffer_pool.h"
+#include "tensorflow/core/platform/logging.h"
+
+namespace tensorflow {
+namespace io {
+
+ReadAhead::ReadAhead(RandomAccessFile* file, size_t chunk_bytes,
+                     int num_chunks)
+    : file_(file),
+      alignment_(file->ReadAlignment()),
+      chunk_bytes_((chunk_bytes + alignment_ - 1) / alignment_ * alignment_),
+      num_chunks_(num_chunks) {
+  CHECK_GT(chunk_bytes_, 0);
+  CHECK_GT(num_chunks_, 0);
+}
+
+ReadAhead::~ReadAhead() {
+  Restart(0);
+  for (auto& chunk : free_chunks_) {
+    if (alignment_ > 1) {
+      AlignedBufferPool::Global()->Release(chunk->buffer, chunk_bytes_,
+                                           alignment_);
+    } else {
+      delete[] chunk->buffer;
+    }
+  }
+}
+
+void ReadAhead::IssueReads() {
+  while (chunks_.size() < static_cast<size_t>(num_chunks_)) {
+    std::unique_ptr<Chunk> chunk;
+    if (free_chunks_.empty()) {
+      chunk.reset(new Chunk);
+      // Files opened with direct I/O only read into aligned buffers without
+      // an extra copy.
+      chunk->buffer =
+          alignment_ > 1
+              ? AlignedBufferPool::Global()->Allocate(chunk_bytes_, alignment_)
+              : new char[chunk_bytes_];
+      chunk->requests.resize(1);
+    } else {
+      chunk = std::move(free_chunks_.back());
+      free_chunks_.pop_back();
+    }
+    RandomAccessFile::ReadRequest& request = chunk->requests[0];
+    request.offset = next_chunk_offset_;
+    request.n = chunk_bytes_;
+    request.scratch = chunk->buffer;
+    chunk->done.reset(new Notification);
+    next_chunk_offset_ += chunk_bytes_;
+    Notification* done = chunk->done.get();
+    std::vector<RandomAccessFile::ReadRequest>* requests = &chunk->requests;
+    chunks_.push_back(std::move(chunk));
+    file_->ReadAsync(requests, [done]() { done->Notify(); });
+  }
+}
+
+void ReadAhead::Restart(uint64 offset) {
+  for (auto& chunk : chunks_) {
+    chunk->done->WaitForNotification();
+    free_chunks_.push_back(std::move(chunk));
+  }
+  chunks_.clear();
+  pos_ = offset;
+  // The first chunk starts at an aligned offset, before `offset` if `offset`
+  // is not aligned.
+  next_chunk_offset_ = offset - offset % alignment_;
+}
+
+Status ReadAhead::Read(uint64 offset, size_t n, StringPiece* result,
+                       char* scratch) {
+  if (offset != pos_) {
+    Restart(offset);
+  }
+  Status s;
+  char* dst = scratch;
+  while (n > 0) {
+    if (chunks_.empty()) {
+      IssueReads();
+    }
+    Chunk* chunk = chunks_.front().get();
+    chunk->done->WaitForNotification();
+    const RandomAccessFile::ReadRequest& request = chunk->requests[0];
+    // The chunk contains `pos_` unless it ends before `pos_`, at the end of
+    // the file.
+    const size_t chunk_pos =
+        std::min<uint64>(pos_ - request.offset, request.result.size());
+    const size_t bytes_to_copy =
+        std::min(n, request.result.size() - chunk_pos);
+    memcpy(dst, request.result.data() + chunk_pos, bytes_to_copy);
+    dst += bytes_to_copy;
+    n -= bytes_to_copy;
+    pos_ += bytes_to_copy;
+    if (chunk_pos + bytes_to_copy < request.result.size()) {
+      continue;
+    }
+    if (!request.status.ok()) {
+      if (n == 0) {
+        // The next read returns the status.
+        break;
+      }
+      // The chunk ends at the end of the file or at an error. The chunks that
+      // follow it are discarded, and the next read retries at `pos_`.
+      s = request.status;
+      Restart(pos_);
+      break;
+    }
+    free_chunks_.push_back(std::move(chunks_.front()));
+    chunks_.pop_front();
+    IssueReads();
+  }
+  *result = StringPiece(scratch, dst - scratch);
+  return s;
+}
+
+}  // namespace io
+}  // namespace tensorflow
@@ -0,0 +1,87 @@
+/* Copyright 2019 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_CORE_LIB_IO_READ_AHEAD_H_
+#define TENSORFLOW_CORE_LIB_IO_READ_AHEAD_H_
+
+#include <deque>
+#include <memory>
+#include <vector>
+
+#include "tensorflow/core/lib/core/notification.h"
+#include "tensorflow/core/lib/core/status.h"
+#include "tensorflow/core/platform/file_system.h"
+#include "tensorflow/core/platform/macros.h"
+#include "tensorflow/core/platform/types.h"
+
+namespace tensorflow {
+namespace io {
+
+// Reads a RandomAccessFile sequentially while keeping the reads of the
+// chunks that follow the current position in flight with
+// `RandomAccessFile::ReadAsync()`, so that the reader overlaps I/O with the
+// processing of the data it has read.
+//
+// A given instance of ReadAhead is NOT safe for concurrent use by multiple
+// threads.
+class ReadAhead {
+ public:
+  // Keeps up to `num_chunks` reads of `chunk_bytes` bytes in flight. `file`
+  // must outlive *this. The chunks are aligned to the `ReadAlignment()` of
+  // `file`, so that files opened with direct I/O read them without a copy.
+  ReadAhead(RandomAccessFile* file, size_t chunk_bytes, int num_chunks);
+
+  // Waits for the reads in flight.
+  ~ReadAhead();
+
+  // Has the semantics of `RandomAccessFile::Read()`. A read that starts where
+  // the previous read ended is served from the chunks in flight, and any other
+  // read restarts the read-ahead at `offset`.
+  Status Read(uint64 offset, size_t n, StringPiece* result, char* scratch);
+
+ private:
+  struct Chunk {
+    char* buffer = nullptr;
+    // A single request, which `ReadAsync()` takes as a vector.
+    std::vector<RandomAccessFile::ReadRequest> requests;
+    std::unique_ptr<Notification> done;
+  };
+
+  // Issues the reads of the chunks that follow the last chunk in flight.
+  void IssueReads();
+
+  // Waits for and discards the reads in flight, and restarts the read-ahead
+  // at `offset`.
+  void Restart(uint64 offset);
+
+  RandomAccessFile* const file_;  // Not owned.
+  const size_t alignment_;
+  const size_t chunk_bytes_;
+  const int num_chunks_;
+  // The chunks in flight, in file order.
+  std::deque<std::unique_ptr<Chunk>> chunks_;
+  std::vector<std::unique_ptr<Chunk>> free_chunks_;
+  // The offset that the next read of `Read()` is expected to start at.
+  uint64 pos_ = 0;
+  // The offset of the next chunk to issue.
+  uint64 next_chunk_offset_ = 0;
+
+  TF_DISALLOW_COPY_AND_ASSIGN(ReadAhead);
+};
+
+}  // namespace io
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_CORE_LIB_IO_READ_AHEAD_H_
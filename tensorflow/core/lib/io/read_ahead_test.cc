@@ -0,0 +1,96 @@
+/* Copyright 2019 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/lib/io/read_ahead.h"
+
+#include <algorithm>
+
+#include "tensorflow/core/lib/core/errors.h"
+#include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/platform/env.h"
+#include "tensorflow/core/platform/test.h"
+
+namespace tensorflow {
+namespace io {
+namespace {
+
+// Returns the first `n` bytes of a file whose byte at offset `i` is the
+// letter `'a' + i % 26`.
+string MakeContents(size_t n) {
+  string contents(n, ' ');
+  for (size_t i = 0; i < n; ++i) {
+    contents[i] = 'a' + i % 26;
+  }
+  return contents;
+}
+
+class ReadAheadTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    fname_ = testing::TmpDir() + "/read_ahead_test";
+    contents_ = MakeContents(1000);
+    TF_ASSERT_OK(WriteStringToFile(Env::Default(), fname_, contents_));
+    TF_ASSERT_OK(Env::Default()->NewRandomAccessFile(fname_, &file_));
+  }
+
+  string fname_;
+  string contents_;
+  std::unique_ptr<RandomAccessFile> file_;
+};
+
+TEST_F(ReadAheadTest, SequentialReads) {
+  for (size_t chunk_bytes : {1, 7, 64, 1000, 4096}) {
+    for (int num_chunks : {1, 2, 8}) {
+      ReadAhead read_ahead(file_.get(), chunk_bytes, num_chunks);
+      char scratch[100];
+      StringPiece result;
+      uint64 offset = 0;
+      while (offset + 30 <= contents_.size()) {
+        TF_ASSERT_OK(read_ahead.Read(offset, 30, &result, scratch));
+        EXPECT_EQ(result, StringPiece(contents_).substr(offset, 30));
+        offset += 30;
+      }
+      Status s = read_ahead.Read(offset, 30, &result, scratch);
+      EXPECT_TRUE(errors::IsOutOfRange(s)) << s;
+      EXPECT_EQ(result, StringPiece(contents_).substr(offset));
+      s = read_ahead.Read(contents_.size(), 30, &result, scratch);
+      EXPECT_TRUE(errors::IsOutOfRange(s)) << s;
+      EXPECT_TRUE(result.empty());
+    }
+  }
+}
+
+TEST_F(ReadAheadTest, RandomReads) {
+  ReadAhead read_ahead(file_.get(), /*chunk_bytes=*/16, /*num_chunks=*/4);
+  char scratch[100];
+  StringPiece result;
+  for (uint64 offset : {500, 10, 11, 990, 0, 300, 310}) {
+    const size_t n = std::min<size_t>(10, contents_.size() - offset);
+    TF_ASSERT_OK(read_ahead.Read(offset, n, &result, scratch));
+    EXPECT_EQ(result, StringPiece(contents_).substr(offset, n));
+  }
+}
+
+TEST_F(ReadAheadTest, LargeRead) {
+  ReadAhead read_ahead(file_.get(), /*chunk_bytes=*/16, /*num_chunks=*/2);
+  std::unique_ptr<char[]> scratch(new char[contents_.size()]);
+  StringPiece result;
+  TF_ASSERT_OK(read_ahead.Read(0, contents_.size(), &result, scratch.get()));
+  EXPECT_EQ(result, contents_);
+}
+
+}  // namespace
+}  // namespace io
+}  // namespace tensorflow
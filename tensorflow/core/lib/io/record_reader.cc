@@ -28,6 +28,8 @@ limitations under the License.
 namespace tensorflow {
 namespace io {
 
+constexpr int64 RecordReaderOptions::kDefaultReadAheadBytes;
+
 RecordReaderOptions RecordReaderOptions::CreateRecordReaderOptions(
     const string& compression_type) {
   RecordReaderOptions options;
@@ -57,7 +59,11 @@ RecordReaderOptions RecordReaderOptions::CreateRecordReaderOptions(
 RecordReader::RecordReader(RandomAccessFile* file,
                            const RecordReaderOptions& options)
     : options_(options),
-      input_stream_(new RandomAccessInputStream(file)),
+      input_stream_(new RandomAccessInputStream(
+          file, /*owns_file=*/false,
+          options.buffer_size > 0 ? options.buffer_size
+                                  : RecordReaderOptions::kDefaultReadAheadBytes,
+          options.num_read_ahead)),
       last_read_failed_(false) {
   if (options.buffer_size > 0) {
     input_stream_.reset(new BufferedInputStream(input_stream_.release(),
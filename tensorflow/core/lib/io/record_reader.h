@@ -42,6 +42,13 @@ class RecordReaderOptions {
   // compressed files.) Consider using SequentialRecordReader.
   int64 buffer_size = 0;
 
+  // If num_read_ahead is positive, up to that many reads of the data that
+  // follows the current position are kept in flight, so that sequential reads
+  // do not wait for the file. Each read is of buffer_size bytes, or of
+  // kDefaultReadAheadBytes bytes if buffer_size is zero.
+  int num_read_ahead = 0;
+  static constexpr int64 kDefaultReadAheadBytes = 256 * 1024;
+
   static RecordReaderOptions CreateRecordReaderOptions(
       const string& compression_type);
 
@@ -490,6 +490,7 @@ def tf_additional_lib_hdrs(exclude = []):
         "posix/error.h",
     ], exclude = exclude + [
         "default/subprocess.h",
+        "default/posix_async_io.h",
         "default/posix_file_system.h",
     ])
     return select({
@@ -511,6 +512,7 @@ def tf_additional_lib_srcs(exclude = []):
         "default/load_library.cc",
         "default/net.cc",
         "default/port.cc",
+        "default/posix_async_io.cc",
         "default/posix_file_system.cc",
         "default/subprocess.cc",
         "default/stacktrace_handler.cc",
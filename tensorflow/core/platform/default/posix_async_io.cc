@@ -0,0 +1,460 @@
+/* Copyright 2019 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/platform/default/posix_async_io.h"
+
+#include <errno.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <deque>
+
+#if defined(__linux__) && defined(__has_include)
+#if __has_include(<linux/io_uring.h>)
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#if defined(__NR_io_uring_setup) && defined(__NR_io_uring_enter)
+#define TF_POSIX_ASYNC_IO_URING 1
+#endif
+#endif
+#endif
+
+#include "tensorflow/core/platform/env.h"
+#include "tensorflow/core/platform/error.h"
+#include "tensorflow/core/platform/logging.h"
+#include "tensorflow/core/platform/mutex.h"
+#include "tensorflow/core/protobuf/error_codes.pb.h"
+
+namespace tensorflow {
+namespace {
+
+// Number of reads that the global io_uring reader keeps in flight.
+constexpr int kIoUringQueueDepth = 128;
+
+// Number of threads of the global thread pool reader.
+constexpr int kNumReaderThreads = 16;
+
+// Tracks the completion of the requests of one call to `Read()`.
+class ReadBatch {
+ public:
+  ReadBatch(size_t num_requests, std::function<void()> done)
+      : num_pending_(num_requests), done_(std::move(done)) {}
+
+  // Records that one of the requests has completed. The last call runs the
+  // callback of the batch and deletes the batch.
+  void RequestDone() {
+    if (num_pending_.fetch_sub(1) == 1) {
+      done_();
+      delete this;
+    }
+  }
+
+ private:
+  std::atomic<size_t> num_pending_;
+  const std::function<void()> done_;
+};
+
+// A request that has not completed yet.
+struct PendingRead {
+  int fd = -1;
+  const string* filename = nullptr;
+  size_t alignment = 1;
+  RandomAccessFile::ReadRequest* request = nullptr;
+  ReadBatch* batch = nullptr;
+  // Number of bytes read so far, which is less than `request->n` after a
+  // short read.
+  size_t bytes_read = 0;
+#if defined(TF_POSIX_ASYNC_IO_URING)
+  struct iovec iov;
+#endif
+};
+
+class ThreadPoolReader : public PosixAsyncReader {
+ public:
+  explicit ThreadPoolReader(int num_threads) {
+    for (int i = 0; i < num_threads; ++i) {
+      threads_.emplace_back(Env::Default()->StartThread(
+          ThreadOptions(), "tf_posix_async_io", [this]() { WorkerLoop(); }));
+    }
+  }
+
+  ~ThreadPoolReader() override {
+    {
+      mutex_lock l(mu_);
+      cancelled_ = true;
+      cond_var_.notify_all();
+    }
+    // The workers complete the queued reads before they exit.
+    threads_.clear();
+  }
+
+  void Read(int fd, const string& filename, size_t alignment,
+            std::vector<RandomAccessFile::ReadRequest>* requests,
+            std::function<void()> done) override {
+    if (requests->empty()) {
+      done();
+      return;
+    }
+    ReadBatch* batch = new ReadBatch(requests->size(), std::move(done));
+    mutex_lock l(mu_);
+    for (auto& request : *requests) {
+      PendingRead read;
+      read.fd = fd;
+      read.filename = &filename;
+      read.alignment = alignment;
+      read.request = &request;
+      read.batch = batch;
+      queue_.push_back(read);
+    }
+    cond_var_.notify_all();
+  }
+
+ private:
+  void WorkerLoop() {
+    while (true) {
+      PendingRead read;
+      {
+        mutex_lock l(mu_);
+        while (!cancelled_ && queue_.empty()) {
+          cond_var_.wait(l);
+        }
+        if (queue_.empty()) {
+          return;
+        }
+        read = queue_.front();
+        queue_.pop_front();
+      }
+      RandomAccessFile::ReadRequest* request = read.request;
+      request->status = PosixPread(read.fd, *read.filename, request->offset,
+                                   request->n, read.alignment,
+                                   &request->result, request->scratch);
+      read.batch->RequestDone();
+    }
+  }
+
+  mutex mu_;
+  condition_variable cond_var_;
+  std::deque<PendingRead> queue_ GUARDED_BY(mu_);
+  bool cancelled_ GUARDED_BY(mu_) = false;
+  std::vector<std::unique_ptr<Thread>> threads_;
+};
+
+#if defined(TF_POSIX_ASYNC_IO_URING)
+
+// Submits reads to an io_uring, the Linux interface for asynchronous I/O that
+// shares a submission and a completion queue with the kernel. The submitting
+// threads fill the submission queue under a mutex, and a background thread
+// waits for completions and runs the callbacks.
+class IoUringReader : public PosixAsyncReader {
+ public:
+  static std::unique_ptr<PosixAsyncReader> Create(int queue_depth) {
+    struct io_uring_params params;
+    memset(&params, 0, sizeof(params));
+    int ring_fd = syscall(__NR_io_uring_setup, queue_depth, &params);
+    if (ring_fd < 0) {
+      VLOG(1) << "io_uring is not available: " << strerror(errno);
+      return nullptr;
+    }
+    std::unique_ptr<IoUringReader> reader(new IoUringReader(ring_fd, params));
+    if (!reader->MapRings()) {
+      return nullptr;
+    }
+    reader->reaper_.reset(Env::Default()->StartThread(
+        ThreadOptions(), "tf_posix_io_uring",
+        [reader = reader.get()]() { reader->ReapLoop(); }));
+    return std::move(reader);
+  }
+
+  ~IoUringReader() override {
+    if (reaper_ != nullptr) {
+      mutex_lock l(mu_);
+      while (num_in_flight_ > 0) {
+        cond_var_.wait(l);
+      }
+      // A no-op with a null `user_data` stops the reaper thread.
+      PushLocked(IORING_OP_NOP, -1, 0, nullptr);
+      SubmitLocked();
+    }
+    reaper_.reset();
+    if (sqes_ != MAP_FAILED) munmap(sqes_, sqes_size_);
+    if (cq_ring_ != MAP_FAILED) munmap(cq_ring_, cq_ring_size_);
+    if (sq_ring_ != MAP_FAILED) munmap(sq_ring_, sq_ring_size_);
+    close(ring_fd_);
+  }
+
+  void Read(int fd, const string& filename, size_t alignment,
+            std::vector<RandomAccessFile::ReadRequest>* requests,
+            std::function<void()> done) override {
+    if (requests->empty()) {
+      done();
+      return;
+    }
+    ReadBatch* batch = new ReadBatch(requests->size(), std::move(done));
+    mutex_lock l(mu_);
+    for (auto& request : *requests) {
+      // Bounding the reads in flight keeps the completion queue, which has
+      // room for twice as many entries, from overflowing.
+      while (num_in_flight_ >= sq_entries_) {
+        SubmitLocked();
+        cond_var_.wait(l);
+      }
+      PendingRead* read = new PendingRead;
+      read->fd = fd;
+      read->filename = &filename;
+      read->alignment = alignment;
+      read->request = &request;
+      read->batch = batch;
+      PushReadLocked(read);
+    }
+    SubmitLocked();
+  }
+
+ private:
+  IoUringReader(int ring_fd, const struct io_uring_params& params)
+      : ring_fd_(ring_fd), params_(params), sq_entries_(params.sq_entries) {}
+
+  bool MapRings() {
+    sq_ring_size_ = params_.sq_off.array + params_.sq_entries * sizeof(__u32);
+    cq_ring_size_ =
+        params_.cq_off.cqes + params_.cq_entries * sizeof(struct io_uring_cqe);
+    sqes_size_ = params_.sq_entries * sizeof(struct io_uring_sqe);
+    sq_ring_ = mmap(nullptr, sq_ring_size_, PROT_READ | PROT_WRITE,
+                    MAP_SHARED | MAP_POPULATE, ring_fd_, IORING_OFF_SQ_RING);
+    cq_ring_ = mmap(nullptr, cq_ring_size_, PROT_READ | PROT_WRITE,
+                    MAP_SHARED | MAP_POPULATE, ring_fd_, IORING_OFF_CQ_RING);
+    sqes_ = mmap(nullptr, sqes_size_, PROT_READ | PROT_WRITE,
+                 MAP_SHARED | MAP_POPULATE, ring_fd_, IORING_OFF_SQES);
+    if (sq_ring_ == MAP_FAILED || cq_ring_ == MAP_FAILED ||
+        sqes_ == MAP_FAILED) {
+      LOG(WARNING) << "Failed to map the io_uring queues: " << strerror(errno);
+      return false;
+    }
+    char* sq = static_cast<char*>(sq_ring_);
+    sq_head_ = reinterpret_cast<__u32*>(sq + params_.sq_off.head);
+    sq_tail_ = reinterpret_cast<__u32*>(sq + params_.sq_off.tail);
+    sq_mask_ = *reinterpret_cast<__u32*>(sq + params_.sq_off.ring_mask);
+    sq_array_ = reinterpret_cast<__u32*>(sq + params_.sq_off.array);
+    char* cq = static_cast<char*>(cq_ring_);
+    cq_head_ = reinterpret_cast<__u32*>(cq + params_.cq_off.head);
+    cq_tail_ = reinterpret_cast<__u32*>(cq + params_.cq_off.tail);
+    cq_mask_ = *reinterpret_cast<__u32*>(cq + params_.cq_off.ring_mask);
+    cqes_ = reinterpret_cast<struct io_uring_cqe*>(cq + params_.cq_off.cqes);
+    return true;
+  }
+
+  // Adds a read of the remaining bytes of `read` to the submission queue.
+  void PushReadLocked(PendingRead* read) EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+    RandomAccessFile::ReadRequest* request = read->request;
+    read->iov.iov_base = request->scratch + read->bytes_read;
+    read->iov.iov_len = request->n - read->bytes_read;
+    PushLocked(IORING_OP_READV, read->fd, request->offset + read->bytes_read,
+               read);
+  }
+
+  void PushLocked(__u8 opcode, int fd, uint64 offset, PendingRead* read)
+      EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+    // The kernel consumes all submitted entries before `io_uring_enter`
+    // returns, so the queue only fills up with unsubmitted entries.
+    if (num_unsubmitted_ == sq_entries_) {
+      SubmitLocked();
+    }
+    const __u32 tail = *sq_tail_;
+    const __u32 index = tail & sq_mask_;
+    struct io_uring_sqe* sqe = &static_cast<struct io_uring_sqe*>(sqes_)[index];
+    memset(sqe, 0, sizeof(*sqe));
+    sqe->opcode = opcode;
+    sqe->fd = fd;
+    sqe->off = offset;
+    if (read != nullptr) {
+      sqe->addr = reinterpret_cast<uintptr_t>(&read->iov);
+      sqe->len = 1;
+    }
+    sqe->user_data = reinterpret_cast<uintptr_t>(read);
+    sq_array_[index] = index;
+    // Publishes the entry to the kernel.
+    __atomic_store_n(sq_tail_, tail + 1, __ATOMIC_RELEASE);
+    ++num_unsubmitted_;
+    ++num_in_flight_;
+  }
+
+  void SubmitLocked() EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+    while (num_unsubmitted_ > 0) {
+      int ret = syscall(__NR_io_uring_enter, ring_fd_, num_unsubmitted_, 0, 0,
+                        nullptr, 0);
+      if (ret >= 0) {
+        num_unsubmitted_ -= ret;
+      } else if (errno != EINTR && errno != EAGAIN && errno != EBUSY) {
+        LOG(FATAL) << "Failed to submit reads to io_uring: "
+                   << strerror(errno);
+      }
+    }
+  }
+
+  void ReapLoop() {
+    while (true) {
+      const __u32 head = *cq_head_;
+      if (head == __atomic_load_n(cq_tail_, __ATOMIC_ACQUIRE)) {
+        int ret = syscall(__NR_io_uring_enter, ring_fd_, 0, 1,
+                          IORING_ENTER_GETEVENTS, nullptr, 0);
+        if (ret < 0 && errno != EINTR) {
+          LOG(FATAL) << "Failed to wait for io_uring completions: "
+                     << strerror(errno);
+        }
+        continue;
+      }
+      const struct io_uring_cqe& cqe = cqes_[head & cq_mask_];
+      PendingRead* read = reinterpret_cast<PendingRead*>(cqe.user_data);
+      const int result = cqe.res;
+      // Releases the completion queue entry to the kernel.
+      __atomic_store_n(cq_head_, head + 1, __ATOMIC_RELEASE);
+      if (read == nullptr) {
+        return;
+      }
+      CompleteRead(read, result);
+    }
+  }
+
+  void CompleteRead(PendingRead* read, int result) {
+    RandomAccessFile::ReadRequest* request = read->request;
+    Status status;
+    if (result > 0) {
+      read->bytes_read += result;
+      if (read->bytes_read < request->n &&
+          (request->offset + read->bytes_read) % read->alignment != 0) {
+        status = Status(error::OUT_OF_RANGE, "Read less bytes than requested");
+      }
+    } else if (result == 0) {
+      status = Status(error::OUT_OF_RANGE, "Read less bytes than requested");
+    } else if (result != -EINTR && result != -EAGAIN) {
+      status = IOError(*read->filename, -result);
+    }
+    {
+      mutex_lock l(mu_);
+      --num_in_flight_;
+      if (status.ok() && read->bytes_read < request->n) {
+        // Reads the rest after a short read, or retries an interrupted read.
+        PushReadLocked(read);
+        SubmitLocked();
+        return;
+      }
+      cond_var_.notify_all();
+    }
+    request->result = StringPiece(request->scratch, read->bytes_read);
+    request->status = status;
+    ReadBatch* batch = read->batch;
+    delete read;
+    batch->RequestDone();
+  }
+
+  const int ring_fd_;
+  const struct io_uring_params params_;
+  const __u32 sq_entries_;
+
+  void* sq_ring_ = MAP_FAILED;
+  void* cq_ring_ = MAP_FAILED;
+  void* sqes_ = MAP_FAILED;
+  size_t sq_ring_size_ = 0;
+  size_t cq_ring_size_ = 0;
+  size_t sqes_size_ = 0;
+  __u32* sq_head_ = nullptr;
+  __u32* sq_tail_ = nullptr;
+  __u32 sq_mask_ = 0;
+  __u32* sq_array_ = nullptr;
+  __u32* cq_head_ = nullptr;
+  __u32* cq_tail_ = nullptr;
+  __u32 cq_mask_ = 0;
+  struct io_uring_cqe* cqes_ = nullptr;
+
+  mutex mu_;
+  // Notified when a read completes.
+  condition_variable cond_var_;
+  __u32 num_in_flight_ GUARDED_BY(mu_) = 0;
+  __u32 num_unsubmitted_ GUARDED_BY(mu_) = 0;
+  std::unique_ptr<Thread> reaper_;
+};
+
+#endif  // TF_POSIX_ASYNC_IO_URING
+
+}  // namespace
+
+Status PosixPread(int fd, const string& filename, uint64 offset, size_t n,
+                  size_t alignment, StringPiece* result, char* scratch) {
+  Status s;
+  char* dst = scratch;
+  while (n > 0 && s.ok()) {
+    // Some platforms, notably macs, throw EINVAL if pread is asked to read
+    // more than fits in a 32-bit integer.
+    size_t requested_read_length;
+    if (n > INT32_MAX) {
+      requested_read_length = INT32_MAX;
+    } else {
+      requested_read_length = n;
+    }
+    ssize_t r =
+        pread(fd, dst, requested_read_length, static_cast<off_t>(offset));
+    if (r > 0) {
+      dst += r;
+      n -= r;
+      offset += r;
+      if (n > 0 && offset % alignment != 0) {
+        s = Status(error::OUT_OF_RANGE, "Read less bytes than requested");
+      }
+    } else if (r == 0) {
+      s = Status(error::OUT_OF_RANGE, "Read less bytes than requested");
+    } else if (errno == EINTR || errno == EAGAIN) {
+      // Retry
+    } else {
+      s = IOError(filename, errno);
+    }
+  }
+  *result = StringPiece(scratch, dst - scratch);
+  return s;
+}
+
+PosixAsyncReader* PosixAsyncReader::Global() {
+  static PosixAsyncReader* reader = []() {
+    const char* backend = getenv("TF_POSIX_ASYNC_IO");
+    if (backend == nullptr || strcmp(backend, "threads") != 0) {
+      std::unique_ptr<PosixAsyncReader> io_uring_reader =
+          CreateIoUringReader(kIoUringQueueDepth);
+      if (io_uring_reader != nullptr) {
+        return io_uring_reader.release();
+      }
+    }
+    return CreateThreadPoolReader(kNumReaderThreads).release();
+  }();
+  return reader;
+}
+
+std::unique_ptr<PosixAsyncReader> PosixAsyncReader::CreateIoUringReader(
+    int queue_depth) {
+#if defined(TF_POSIX_ASYNC_IO_URING)
+  return IoUringReader::Create(queue_depth);
+#else
+  return nullptr;
+#endif  // TF_POSIX_ASYNC_IO_URING
+}
+
+std::unique_ptr<PosixAsyncReader> PosixAsyncReader::CreateThreadPoolReader(
+    int num_threads) {
+  return std::unique_ptr<PosixAsyncReader>(new ThreadPoolReader(num_threads));
+}
+
+}  // namespace tensorflow
@@ -0,0 +1,66 @@
+/* Copyright 2019 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_CORE_PLATFORM_DEFAULT_POSIX_ASYNC_IO_H_
+#define TENSORFLOW_CORE_PLATFORM_DEFAULT_POSIX_ASYNC_IO_H_
+
+#include <functional>
+#include <memory>
+#include <vector>
+
+#include "tensorflow/core/platform/file_system.h"
+
+namespace tensorflow {
+
+// Reads up to `n` bytes at `offset` of the file descriptor `fd` with
+// pread(), with the semantics of `RandomAccessFile::Read()`. `filename` is
+// used in error messages. `alignment` is the alignment that reads of `fd`
+// require, which is more than 1 for files opened with direct I/O: a short
+// read that ends at an unaligned offset ends at the end of the file.
+Status PosixPread(int fd, const string& filename, uint64 offset, size_t n,
+                  size_t alignment, StringPiece* result, char* scratch);
+
+// Issues the reads of `RandomAccessFile::ReadAsync()` for POSIX files.
+class PosixAsyncReader {
+ public:
+  virtual ~PosixAsyncReader() {}
+
+  // Returns the reader shared by all POSIX files. It submits the reads to an
+  // io_uring if the kernel supports it, and otherwise issues pread() calls
+  // from a pool of threads. Setting the environment variable
+  // `TF_POSIX_ASYNC_IO` to "threads" forces the use of the thread pool.
+  static PosixAsyncReader* Global();
+
+  // Returns a reader that keeps up to `queue_depth` reads in flight in an
+  // io_uring, or nullptr if io_uring is not supported.
+  static std::unique_ptr<PosixAsyncReader> CreateIoUringReader(
+      int queue_depth);
+
+  // Returns a reader that issues pread() calls from `num_threads` threads.
+  static std::unique_ptr<PosixAsyncReader> CreateThreadPoolReader(
+      int num_threads);
+
+  // Issues the reads in `*requests` of the file descriptor `fd` and calls
+  // `done` once all of them have completed. `filename` and `alignment` are as
+  // in `PosixPread()`. `fd`, `filename` and `*requests` must stay valid until
+  // `done` is called.
+  virtual void Read(int fd, const string& filename, size_t alignment,
+                    std::vector<RandomAccessFile::ReadRequest>* requests,
+                    std::function<void()> done) = 0;
+};
+
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_CORE_PLATFORM_DEFAULT_POSIX_ASYNC_IO_H_
@@ -28,12 +28,17 @@ limitations under the License.
 #include <time.h>
 #include <unistd.h>
 
+#include <algorithm>
+
+#include "tensorflow/core/lib/core/errors.h"
 #include "tensorflow/core/lib/core/status.h"
+#include "tensorflow/core/platform/default/posix_async_io.h"
 #include "tensorflow/core/platform/default/posix_file_system.h"
 #include "tensorflow/core/platform/env.h"
 #include "tensorflow/core/platform/error.h"
 #include "tensorflow/core/platform/file_system_helper.h"
 #include "tensorflow/core/platform/logging.h"
+#include "tensorflow/core/platform/mem.h"
 #include "tensorflow/core/platform/strcat.h"
 #include "tensorflow/core/protobuf/error_codes.pb.h"
 
@@ -60,34 +65,105 @@ class PosixRandomAccessFile : public RandomAccessFile {
 
   Status Read(uint64 offset, size_t n, StringPiece* result,
               char* scratch) const override {
+    return PosixPread(fd_, filename_, offset, n, /*alignment=*/1, result,
+                      scratch);
+  }
+
+  void ReadAsync(std::vector<ReadRequest>* requests,
+                 std::function<void()> done) const override {
+    PosixAsyncReader::Global()->Read(fd_, filename_, /*alignment=*/1, requests,
+                                     std::move(done));
+  }
+};
+
+// Alignment of the offsets, sizes and buffers of direct I/O. This is a
+// multiple of the logical block size of common devices.
+constexpr size_t kDirectIOAlignment = 4096;
+
+// Size of the aligned buffer through which unaligned direct reads go.
+constexpr size_t kDirectIOBounceBufferSize = 1 << 20;
+
+// pread() based random-access of a file opened with direct I/O, whose reads
+// bypass the page cache.
+class PosixDirectRandomAccessFile : public RandomAccessFile {
+ private:
+  string filename_;
+  int fd_;
+
+  static size_t RoundUpToAlignment(size_t n) {
+    return (n + kDirectIOAlignment - 1) / kDirectIOAlignment *
+           kDirectIOAlignment;
+  }
+
+  static bool IsAligned(uint64 offset, size_t n, const char* scratch) {
+    return offset % kDirectIOAlignment == 0 && n % kDirectIOAlignment == 0 &&
+           reinterpret_cast<uintptr_t>(scratch) % kDirectIOAlignment == 0;
+  }
+
+ public:
+  PosixDirectRandomAccessFile(const string& fname, int fd)
+      : filename_(fname), fd_(fd) {}
+  ~PosixDirectRandomAccessFile() override { close(fd_); }
+
+  Status Name(StringPiece* result) const override {
+    *result = filename_;
+    return Status::OK();
+  }
+
+  Status Read(uint64 offset, size_t n, StringPiece* result,
+              char* scratch) const override {
+    if (IsAligned(offset, n, scratch)) {
+      return PosixPread(fd_, filename_, offset, n, kDirectIOAlignment, result,
+                        scratch);
+    }
+    // Reads the aligned blocks that contain the requested range through an
+    // aligned buffer, and copies the requested range out of it.
+    uint64 block_offset = offset - offset % kDirectIOAlignment;
+    size_t skip = offset - block_offset;
+    const size_t buffer_size =
+        std::min(kDirectIOBounceBufferSize, RoundUpToAlignment(skip + n));
+    std::unique_ptr<char, void (*)(void*)> buffer(
+        static_cast<char*>(
+            port::AlignedMalloc(buffer_size, kDirectIOAlignment)),
+        port::AlignedFree);
     Status s;
     char* dst = scratch;
     while (n > 0 && s.ok()) {
-      // Some platforms, notably macs, throw EINVAL if pread is asked to read
-      // more than fits in a 32-bit integer.
-      size_t requested_read_length;
-      if (n > INT32_MAX) {
-        requested_read_length = INT32_MAX;
-      } else {
-        requested_read_length = n;
-      }
-      ssize_t r =
-          pread(fd_, dst, requested_read_length, static_cast<off_t>(offset));
-      if (r > 0) {
-        dst += r;
-        n -= r;
-        offset += r;
-      } else if (r == 0) {
-        s = Status(error::OUT_OF_RANGE, "Read less bytes than requested");
-      } else if (errno == EINTR || errno == EAGAIN) {
-        // Retry
-      } else {
-        s = IOError(filename_, errno);
+      const size_t to_read =
+          std::min(buffer_size, RoundUpToAlignment(skip + n));
+      StringPiece data;
+      s = PosixPread(fd_, filename_, block_offset, to_read, kDirectIOAlignment,
+                     &data, buffer.get());
+      if (data.size() > skip) {
+        const size_t to_copy = std::min(n, data.size() - skip);
+        memcpy(dst, data.data() + skip, to_copy);
+        dst += to_copy;
+        n -= to_copy;
       }
+      block_offset += to_read;
+      skip = 0;
+    }
+    if (n == 0 && s.code() == error::OUT_OF_RANGE) {
+      // The end of the file is in the last block, after the requested range.
+      s = Status::OK();
     }
     *result = StringPiece(scratch, dst - scratch);
     return s;
   }
+
+  void ReadAsync(std::vector<ReadRequest>* requests,
+                 std::function<void()> done) const override {
+    for (const auto& request : *requests) {
+      if (!IsAligned(request.offset, request.n, request.scratch)) {
+        RandomAccessFile::ReadAsync(requests, std::move(done));
+        return;
+      }
+    }
+    PosixAsyncReader::Global()->Read(fd_, filename_, kDirectIOAlignment,
+                                     requests, std::move(done));
+  }
+
+  size_t ReadAlignment() const override { return kDirectIOAlignment; }
 };
 
 class PosixWritableFile : public WritableFile {
@@ -186,6 +262,32 @@ Status PosixFileSystem::NewRandomAccessFile(
   return s;
 }
 
+Status PosixFileSystem::NewDirectRandomAccessFile(
+    const string& fname, std::unique_ptr<RandomAccessFile>* result) {
+  string translated_fname = TranslateName(fname);
+#if defined(O_DIRECT)
+  int fd = open(translated_fname.c_str(), O_RDONLY | O_DIRECT);
+  if (fd < 0 && errno == EINVAL) {
+    // The file system of the file does not support O_DIRECT (e.g. tmpfs).
+    return errors::Unimplemented("Direct I/O is not supported for ", fname);
+  }
+#elif defined(F_NOCACHE)
+  int fd = open(translated_fname.c_str(), O_RDONLY);
+  if (fd >= 0 && fcntl(fd, F_NOCACHE, 1) < 0) {
+    close(fd);
+    return errors::Unimplemented("Direct I/O is not supported for ", fname);
+  }
+#else
+  int fd = -1;
+  errno = ENOTSUP;
+#endif
+  if (fd < 0) {
+    return IOError(fname, errno);
+  }
+  result->reset(new PosixDirectRandomAccessFile(translated_fname, fd));
+  return Status::OK();
+}
+
 Status PosixFileSystem::NewWritableFile(const string& fname,
                                         std::unique_ptr<WritableFile>* result) {
   string translated_fname = TranslateName(fname);
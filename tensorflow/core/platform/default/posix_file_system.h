@@ -31,6 +31,10 @@ class PosixFileSystem : public FileSystem {
       const string& filename,
       std::unique_ptr<RandomAccessFile>* result) override;
 
+  Status NewDirectRandomAccessFile(
+      const string& filename,
+      std::unique_ptr<RandomAccessFile>* result) override;
+
   Status NewWritableFile(const string& fname,
                          std::unique_ptr<WritableFile>* result) override;
 
@@ -100,6 +100,14 @@ class Env {
   Status NewRandomAccessFile(const string& fname,
                              std::unique_ptr<RandomAccessFile>* result);
 
+  /// \brief Like `NewRandomAccessFile()`, but the reads of the returned file
+  /// bypass the page cache of the operating system.
+  ///
+  /// Returns UNIMPLEMENTED if the file system of `fname` does not support
+  /// direct I/O. See `FileSystem::NewDirectRandomAccessFile()`.
+  Status NewDirectRandomAccessFile(const string& fname,
+                                   std::unique_ptr<RandomAccessFile>* result);
+
   /// \brief Creates an object that writes to a new file with the specified
   /// name.
   ///
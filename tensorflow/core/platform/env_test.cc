@@ -19,6 +19,7 @@ limitations under the License.
 
 #include "tensorflow/core/framework/graph.pb.h"
 #include "tensorflow/core/framework/node_def.pb.h"
+#include "tensorflow/core/lib/core/notification.h"
 #include "tensorflow/core/lib/core/status_test_util.h"
 #include "tensorflow/core/lib/core/stringpiece.h"
 #include "tensorflow/core/lib/io/path.h"
@@ -90,6 +91,35 @@ TEST_F(DefaultEnvTest, IncompleteReadOutOfRange) {
   EXPECT_EQ(input, result);
 }
 
+TEST_F(DefaultEnvTest, ReadAsync) {
+  const string filename = io::JoinPath(BaseDir(), "read_async");
+  const string input = CreateTestFile(env_, filename, 1000);
+  std::unique_ptr<RandomAccessFile> f;
+  TF_EXPECT_OK(env_->NewRandomAccessFile(filename, &f));
+
+  // Reads of the whole file in chunks of 100 bytes, followed by a read that
+  // crosses the end of the file and one that starts past it.
+  std::vector<RandomAccessFile::ReadRequest> requests(12);
+  std::vector<string> scratch(requests.size(), string(100, 0));
+  for (int i = 0; i < requests.size(); ++i) {
+    requests[i].offset = i < 10 ? i * 100 : 950 + (i - 10) * 100;
+    requests[i].n = 100;
+    requests[i].scratch = &scratch[i][0];
+  }
+  Notification done;
+  f->ReadAsync(&requests, [&done]() { done.Notify(); });
+  done.WaitForNotification();
+
+  for (int i = 0; i < 10; ++i) {
+    TF_EXPECT_OK(requests[i].status);
+    EXPECT_EQ(requests[i].result, StringPiece(input).substr(i * 100, 100));
+  }
+  EXPECT_EQ(error::OUT_OF_RANGE, requests[10].status.code());
+  EXPECT_EQ(requests[10].result, StringPiece(input).substr(950));
+  EXPECT_EQ(error::OUT_OF_RANGE, requests[11].status.code());
+  EXPECT_TRUE(requests[11].result.empty());
+}
+
 TEST_F(DefaultEnvTest, ReadFileToString) {
   for (const int length : {0, 1, 1212, 2553, 4928, 8196, 9000, (1 << 20) - 1,
                            1 << 20, (1 << 20) + 1, (256 << 20) + 100}) {
@@ -51,8 +51,22 @@ Status FileSystem::IsDirectory(const string& name) {
 
 void FileSystem::FlushCaches() {}
 
+Status FileSystem::NewDirectRandomAccessFile(
+    const string& fname, std::unique_ptr<RandomAccessFile>* result) {
+  return errors::Unimplemented("Direct I/O is not supported for ", fname);
+}
+
 RandomAccessFile::~RandomAccessFile() {}
 
+void RandomAccessFile::ReadAsync(std::vector<ReadRequest>* requests,
+                                 std::function<void()> done) const {
+  for (auto& request : *requests) {
+    request.status = Read(request.offset, request.n, &request.result,
+                          request.scratch);
+  }
+  done();
+}
+
 WritableFile::~WritableFile() {}
 
 FileSystemRegistry::~FileSystemRegistry() {}
@@ -63,6 +63,18 @@ class FileSystem {
   virtual Status NewRandomAccessFile(
       const string& fname, std::unique_ptr<RandomAccessFile>* result) = 0;
 
+  /// \brief Like `NewRandomAccessFile()`, but the reads of the returned file
+  /// bypass the page cache of the operating system.
+  ///
+  /// Large scans of data that is not read again should use direct I/O, so
+  /// that they do not evict the rest of the page cache. Reads whose offset,
+  /// size and scratch buffer are multiples of the `ReadAlignment()` of the
+  /// file go straight to the scratch buffer; other reads are slower.
+  ///
+  /// The default implementation returns UNIMPLEMENTED.
+  virtual Status NewDirectRandomAccessFile(
+      const string& fname, std::unique_ptr<RandomAccessFile>* result);
+
   /// \brief Creates an object that writes to a new file with the specified
   /// name.
   ///
@@ -263,6 +275,39 @@ class RandomAccessFile {
   virtual Status Read(uint64 offset, size_t n, StringPiece* result,
                       char* scratch) const = 0;
 
+  /// \brief A read of up to `n` bytes from the file starting at `offset`,
+  /// issued by `ReadAsync()`.
+  struct ReadRequest {
+    uint64 offset = 0;
+    size_t n = 0;
+    char* scratch = nullptr;
+    /// Set when the read completes, as by
+    /// `status = Read(offset, n, &result, scratch)`.
+    StringPiece result;
+    Status status;
+  };
+
+  /// \brief Issues the reads in `*requests` and calls `done` once all of
+  /// them have completed.
+  ///
+  /// `*requests`, their scratch buffers and the file must stay live until
+  /// `done` is called. `done` may be called before `ReadAsync()` returns,
+  /// possibly on the calling thread.
+  ///
+  /// The default implementation issues the reads one after another with
+  /// `Read()` and then calls `done`. Implementations that can keep several
+  /// reads in flight should override it.
+  ///
+  /// Safe for concurrent use by multiple threads.
+  virtual void ReadAsync(std::vector<ReadRequest>* requests,
+                         std::function<void()> done) const;
+
+  /// \brief Returns the alignment of the offsets, sizes and scratch buffers
+  /// of the reads that the file serves without an extra copy.
+  ///
+  /// This is 1 unless the file was opened with direct I/O.
+  virtual size_t ReadAlignment() const { return 1; }
+
   // TODO(ebrevdo): Remove this ifdef when absl is updated.
 #if defined(PLATFORM_GOOGLE)
   /// \brief Read up to `n` bytes from the file starting at `offset`.
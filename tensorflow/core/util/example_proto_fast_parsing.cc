@@ -14,6 +14,12 @@ limitations under the License.
 ==============================================================================*/
 #include "tensorflow/core/util/example_proto_fast_parsing.h"
 
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#include <algorithm>
+#include <unordered_set>
 #include <vector>
 
 #include "absl/base/casts.h"
@@ -64,6 +70,65 @@ constexpr uint8 kVarintTag(uint32 tag) { return (tag << 3) | 0; }
 constexpr uint8 kDelimitedTag(uint32 tag) { return (tag << 3) | 2; }
 constexpr uint8 kFixed32Tag(uint32 tag) { return (tag << 3) | 5; }
 
+// Returns the number of varints in the packed field [begin, end), or -1 if
+// its last varint is truncated. Each varint ends with its only byte whose
+// most significant bit is clear, so the varints are counted 16 bytes at a
+// time where SSE2 is available.
+int64 CountPackedVarints(const uint8* begin, const uint8* end) {
+  if (begin != end && (end[-1] & 0x80) != 0) return -1;
+  int64 count = 0;
+  const uint8* ptr = begin;
+#ifdef __SSE2__
+  for (; end - ptr >= 16; ptr += 16) {
+    const __m128i bytes =
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(ptr));
+    // Bit i of the mask is set iff byte i is followed by more bytes of the
+    // same varint.
+    count += 16 - __builtin_popcount(_mm_movemask_epi8(bytes));
+  }
+#endif
+  for (; ptr < end; ++ptr) {
+    count += (*ptr & 0x80) == 0;
+  }
+  return count;
+}
+
+// Decodes the first `count` varints of a packed field that starts at `ptr`,
+// whose varints CountPackedVarints() has checked, into `out`. Returns false
+// if a varint is longer than 10 bytes.
+bool DecodePackedVarints(const uint8* ptr, int64 count, int64* out) {
+  int64 i = 0;
+  while (i < count) {
+#ifdef __SSE2__
+    // Small values, such as ids and counts, take one byte each. 16 varints
+    // take at least 16 bytes, so the load stays within the field.
+    if (count - i >= 16) {
+      const __m128i bytes =
+          _mm_loadu_si128(reinterpret_cast<const __m128i*>(ptr));
+      if (_mm_movemask_epi8(bytes) == 0) {
+        for (int j = 0; j < 16; ++j) {
+          out[i + j] = ptr[j];
+        }
+        ptr += 16;
+        i += 16;
+        continue;
+      }
+    }
+#endif
+    uint64 value = 0;
+    int shift = 0;
+    uint8 byte;
+    do {
+      if (shift >= 70) return false;
+      byte = *ptr++;
+      value |= static_cast<uint64>(byte & 0x7F) << shift;
+      shift += 7;
+    } while ((byte & 0x80) != 0);
+    out[i++] = static_cast<int64>(value);
+  }
+  return true;
+}
+
 namespace parsed {
 
 // ParseDataType has to be called first, then appropriate ParseZzzzList.
@@ -238,15 +303,33 @@ class Feature {
         if (!stream.ExpectTag(kDelimitedTag(1))) return false;  // packed tag
         uint32 packed_length;
         if (!stream.ReadVarint32(&packed_length)) return false;
-        auto packed_limit = stream.PushLimit(packed_length);
-
-        while (!stream.ExpectAtEnd()) {
-          protobuf_uint64 n;  // There is no API for int64
-          if (!stream.ReadVarint64(&n)) return false;
-          int64_list->push_back(static_cast<int64>(n));
+        if (packed_length > 0) {
+          // Decode the varints from the serialized buffer directly rather than
+          // one at a time through the stream.
+          const void* packed_data;
+          int packed_data_size;
+          if (!stream.GetDirectBufferPointer(&packed_data,
+                                             &packed_data_size) ||
+              static_cast<uint32>(packed_data_size) < packed_length) {
+            return false;
+          }
+          const uint8* begin = static_cast<const uint8*>(packed_data);
+          const int64 num_elements =
+              CountPackedVarints(begin, begin + packed_length);
+          if (num_elements < 0) return false;
+
+          const size_t initial_size = int64_list->size();
+          int64_list->resize(initial_size + num_elements);
+          // The output can be shorter than requested in resize in case of a
+          // LimitedArraySlice, whose caller reports the overflow.
+          const int64 num_elements_to_decode =
+              int64_list->size() - initial_size;
+          if (!DecodePackedVarints(begin, num_elements_to_decode,
+                                   int64_list->data() + initial_size)) {
+            return false;
+          }
+          if (!stream.Skip(packed_length)) return false;
         }
-
-        stream.PopLimit(packed_limit);
       } else {  // non-packed
         while (!stream.ExpectAtEnd()) {
           if (!stream.ExpectTag(kVarintTag(1))) return false;
@@ -486,6 +569,39 @@ struct SeededHasher {
   uint64 seed{0xDECAFCAFFE};
 };
 
+// Returns the name of the feature with index `d` and type `type` in `config`.
+const string& ConfigFeatureName(const Config& config, size_t d, Type type) {
+  if (type == Type::Dense) return config.dense[d].feature_name;
+  if (type == Type::Ragged) return config.ragged[d].feature_name;
+  return config.sparse[d].feature_name;
+}
+
+// Finds the features of a config by the hashes of their names, for
+// FastParseExample(), which builds the index for each batch.
+class HashedConfigIndex {
+ public:
+  HashedConfigIndex(const Config& config,
+                    const PresizedCuckooMap<std::pair<size_t, Type>>& map,
+                    SeededHasher hasher)
+      : config_(config), map_(map), hasher_(hasher) {}
+
+  // Returns true and sets `*d_and_type` to the index and type of the feature
+  // named `feature_name` if the config has one.
+  bool Find(StringPiece feature_name,
+            std::pair<size_t, Type>* d_and_type) const {
+    if (!map_.Find(hasher_(feature_name), d_and_type)) return false;
+    // Testing for PresizedCuckooMap collision.
+    // TODO(lew): Use dense_hash_map and avoid this and hasher creation.
+    return feature_name ==
+           ConfigFeatureName(config_, d_and_type->first, d_and_type->second);
+  }
+
+ private:
+  const Config& config_;
+  const PresizedCuckooMap<std::pair<size_t, Type>>& map_;
+  const SeededHasher hasher_;
+};
+
 template <typename T>
 class LimitedArraySlice {
  public:
@@ -545,11 +661,11 @@ void LogSparseFeatureDataLoss(StringPiece feature_name) {
   duplicated_sparse_feature->GetCell()->IncrementBy(1);
 }
 
+template <typename ConfigIndex>
 Status FastParseSerializedExample(
     const string& serialized_example, const string& example_name,
     const size_t example_index, const Config& config,
-    const PresizedCuckooMap<std::pair<size_t, Type>>& config_index,
-    SeededHasher hasher, std::vector<Tensor>* output_dense,
+    const ConfigIndex& config_index, std::vector<Tensor>* output_dense,
     std::vector<SparseBuffer>* output_varlen_dense,
     std::vector<SparseBuffer>* output_sparse,
     std::vector<SparseBuffer>* output_ragged,
@@ -586,23 +702,12 @@ Status FastParseSerializedExample(
     parsed::Feature& feature = name_and_feature.second;
 
     std::pair<size_t, Type> d_and_type;
-    uint64 h = hasher(feature_name);
-    if (!config_index.Find(h, &d_and_type)) continue;
+    if (!config_index.Find(feature_name, &d_and_type)) continue;
 
     size_t d = d_and_type.first;
     bool is_dense = d_and_type.second == Type::Dense;
     bool is_ragged = d_and_type.second == Type::Ragged;
 
-    {
-      // Testing for PresizedCuckooMap collision.
-      // TODO(lew): Use dense_hash_map and avoid this and hasher creation.
-      const string& config_feature_name =
-          is_dense ? config.dense[d].feature_name
-                   : (is_ragged ? config.ragged[d].feature_name
-                                : config.sparse[d].feature_name);
-      if (feature_name != config_feature_name) continue;
-    }
-
     auto example_error = [&](StringPiece suffix) {
       return errors::InvalidArgument("Name: ", example_name,
                                      ", Key: ", feature_name,
@@ -1086,51 +1191,21 @@ void CopySparseBufferToTensor(DataType dtype, size_t offset, SparseBuffer* src,
   }
 }
 
-}  // namespace
-
-Status FastParseExample(const Config& config,
-                        gtl::ArraySlice<tstring> serialized,
-                        gtl::ArraySlice<tstring> example_names,
-                        thread::ThreadPool* thread_pool, Result* result) {
+// Parses a batch of serialized Example protos into `result` with
+// `config_index` finding the features of `config` by name.
+template <typename ConfigIndex>
+Status FastParseExampleWithIndex(const Config& config,
+                                 const ConfigIndex& config_index,
+                                 bool collect_feature_stats,
+                                 gtl::ArraySlice<tstring> serialized,
+                                 gtl::ArraySlice<tstring> example_names,
+                                 thread::ThreadPool* thread_pool,
+                                 Result* result) {
   DCHECK(result != nullptr);
-  // Check config so we can safely CHECK(false) in switches on config.*.dtype
-  TF_RETURN_IF_ERROR(CheckConfigDataTypes(config));
-
-  if (config.collect_feature_stats) {
+  if (collect_feature_stats) {
     result->feature_stats.resize(serialized.size());
   }
 
-  size_t config_size =
-      config.dense.size() + config.sparse.size() + config.ragged.size();
-  SeededHasher hasher;
-  // Build config index.
-  PresizedCuckooMap<std::pair<size_t, Type>> config_index(config_size);
-  bool ok = true;
-  for (size_t i = 0; i < 1000; ++i) {
-    for (size_t d = 0; d < config.dense.size(); ++d) {
-      ok &= config_index.InsertUnique(hasher(config.dense[d].feature_name),
-                                      {d, Type::Dense});
-    }
-    for (size_t d = 0; d < config.sparse.size(); ++d) {
-      ok &= config_index.InsertUnique(hasher(config.sparse[d].feature_name),
-                                      {d, Type::Sparse});
-    }
-    for (size_t d = 0; d < config.ragged.size(); ++d) {
-      ok &= config_index.InsertUnique(hasher(config.ragged[d].feature_name),
-                                      {d, Type::Ragged});
-    }
-    if (ok) break;
-    LOG(WARNING) << "Collision found. This should happen only if you have "
-                    "around 2^32 entries in your config.";
-    hasher.seed++;
-    config_index.Clear(config_size);
-    ok = true;
-  }
-  if (!ok) {
-    return errors::Internal(
-        "Could not avoid collision. This should not happen.");
-  }
-
   // Allocate dense output for fixed length dense values
   // (variable-length dense and sparse and ragged have to be buffered).
   std::vector<Tensor> fixed_dense_values(config.dense.size());
@@ -1194,13 +1269,13 @@ Status FastParseExample(const Config& config,
     size_t end = first_example_of_minibatch(minibatch + 1);
     for (size_t e = start; e < end; ++e) {
       PerExampleFeatureStats* stats = nullptr;
-      if (config.collect_feature_stats) {
+      if (collect_feature_stats) {
         stats = &result->feature_stats[e];
       }
       status_of_minibatch[minibatch] = FastParseSerializedExample(
           serialized[e],
           (!example_names.empty() ? example_names[e] : "<unknown>"), e, config,
-          config_index, hasher, &fixed_dense_values,
+          config_index, &fixed_dense_values,
           &varlen_dense_buffers[minibatch], &sparse_buffers[minibatch],
           &ragged_buffers[minibatch], stats);
       if (!status_of_minibatch[minibatch].ok()) break;
@@ -1392,6 +1467,216 @@ Status FastParseExample(const Config& config,
   return Status::OK();
 }
 
+}  // namespace
+
+Status FastParseExample(const Config& config,
+                        gtl::ArraySlice<tstring> serialized,
+                        gtl::ArraySlice<tstring> example_names,
+                        thread::ThreadPool* thread_pool, Result* result) {
+  DCHECK(result != nullptr);
+  // Check config so we can safely CHECK(false) in switches on config.*.dtype
+  TF_RETURN_IF_ERROR(CheckConfigDataTypes(config));
+
+  size_t config_size =
+      config.dense.size() + config.sparse.size() + config.ragged.size();
+  SeededHasher hasher;
+  // Build config index.
+  PresizedCuckooMap<std::pair<size_t, Type>> config_index(config_size);
+  bool ok = true;
+  for (size_t i = 0; i < 1000; ++i) {
+    for (size_t d = 0; d < config.dense.size(); ++d) {
+      ok &= config_index.InsertUnique(hasher(config.dense[d].feature_name),
+                                      {d, Type::Dense});
+    }
+    for (size_t d = 0; d < config.sparse.size(); ++d) {
+      ok &= config_index.InsertUnique(hasher(config.sparse[d].feature_name),
+                                      {d, Type::Sparse});
+    }
+    for (size_t d = 0; d < config.ragged.size(); ++d) {
+      ok &= config_index.InsertUnique(hasher(config.ragged[d].feature_name),
+                                      {d, Type::Ragged});
+    }
+    if (ok) break;
+    LOG(WARNING) << "Collision found. This should happen only if you have "
+                    "around 2^32 entries in your config.";
+    hasher.seed++;
+    config_index.Clear(config_size);
+    ok = true;
+  }
+  if (!ok) {
+    return errors::Internal(
+        "Could not avoid collision. This should not happen.");
+  }
+
+  return FastParseExampleWithIndex(
+      config, HashedConfigIndex(config, config_index, hasher),
+      config.collect_feature_stats, serialized, example_names, thread_pool,
+      result);
+}
+
+// A perfect hash over the feature names of a config: each name maps to its
+// own slot. The hash of a name selects a bucket, and a seed chosen for each
+// bucket when the index is built spreads the names of the bucket over free
+// slots ("hash and displace").
+class CompiledExampleParser::FeatureIndex {
+ public:
+  // Returns nullptr if the config has duplicate feature names.
+  static std::unique_ptr<const FeatureIndex> Build(const Config& config) {
+    std::vector<Slot> features;
+    for (size_t d = 0; d < config.dense.size(); ++d) {
+      features.push_back({config.dense[d].feature_name, {d, Type::Dense}});
+    }
+    for (size_t d = 0; d < config.sparse.size(); ++d) {
+      features.push_back({config.sparse[d].feature_name, {d, Type::Sparse}});
+    }
+    for (size_t d = 0; d < config.ragged.size(); ++d) {
+      features.push_back({config.ragged[d].feature_name, {d, Type::Ragged}});
+    }
+    std::unordered_set<StringPiece, StringPieceHasher> names;
+    for (const Slot& feature : features) {
+      if (!names.insert(feature.name).second) return nullptr;
+    }
+    // Start with twice as many slots as features, and four times as many
+    // slots as buckets, which finds the bucket seeds at the first try but
+    // for pathological names.
+    size_t num_slots = 1;
+    while (num_slots < 2 * features.size()) num_slots *= 2;
+    std::unique_ptr<FeatureIndex> index(new FeatureIndex);
+    SeededHasher hasher;
+    while (!index->TryBuild(features, hasher, num_slots)) {
+      ++hasher.seed;
+      num_slots *= 2;
+    }
+    return std::move(index);
+  }
+
+  // Returns true and sets `*d_and_type` to the index and type of the feature
+  // named `feature_name` if the config has one.
+  bool Find(StringPiece feature_name,
+            std::pair<size_t, Type>* d_and_type) const {
+    const uint64 h = hasher_(feature_name);
+    const Slot& slot = slots_[SlotIndex(h, bucket_seeds_[BucketIndex(h)])];
+    if (!slot.occupied || slot.name != feature_name) return false;
+    *d_and_type = slot.d_and_type;
+    return true;
+  }
+
+ private:
+  struct Slot {
+    Slot() {}
+    Slot(string name, std::pair<size_t, Type> d_and_type)
+        : name(std::move(name)), d_and_type(d_and_type), occupied(true) {}
+
+    string name;
+    std::pair<size_t, Type> d_and_type;
+    bool occupied = false;
+  };
+
+  // The number of seeds to try for each bucket before growing the table.
+  static constexpr uint32 kMaxBucketSeeds = 1 << 16;
+
+  FeatureIndex() {}
+
+  size_t BucketIndex(uint64 h) const { return (h >> 32) & bucket_mask_; }
+
+  size_t SlotIndex(uint64 h, uint32 bucket_seed) const {
+    // The finalizer of MurmurHash3 mixes the seed into all bits of the hash.
+    h ^= bucket_seed * 0x9E3779B97F4A7C15ULL;
+    h ^= h >> 33;
+    h *= 0xFF51AFD7ED558CCDULL;
+    h ^= h >> 33;
+    return h & slot_mask_;
+  }
+
+  bool TryBuild(const std::vector<Slot>& features, SeededHasher hasher,
+                size_t num_slots) {
+    hasher_ = hasher;
+    slot_mask_ = num_slots - 1;
+    bucket_mask_ = std::max<size_t>(num_slots / 4, 1) - 1;
+    slots_.assign(num_slots, Slot());
+    bucket_seeds_.assign(bucket_mask_ + 1, 0);
+
+    std::vector<std::vector<std::pair<uint64, const Slot*>>> buckets(
+        bucket_mask_ + 1);
+    for (const Slot& feature : features) {
+      const uint64 h = hasher_(feature.name);
+      buckets[BucketIndex(h)].emplace_back(h, &feature);
+    }
+    // Place the largest buckets first, while most slots are free.
+    std::vector<size_t> order(buckets.size());
+    for (size_t b = 0; b < order.size(); ++b) order[b] = b;
+    std::sort(order.begin(), order.end(), [&buckets](size_t a, size_t b) {
+      return buckets[a].size() > buckets[b].size();
+    });
+
+    std::vector<size_t> bucket_slots;
+    for (size_t b : order) {
+      if (buckets[b].empty()) break;
+      bool placed = false;
+      for (uint32 seed = 0; seed < kMaxBucketSeeds && !placed; ++seed) {
+        bucket_slots.clear();
+        placed = true;
+        for (const auto& h_and_feature : buckets[b]) {
+          const size_t slot = SlotIndex(h_and_feature.first, seed);
+          if (slots_[slot].occupied ||
+              std::find(bucket_slots.begin(), bucket_slots.end(), slot) !=
+                  bucket_slots.end()) {
+            placed = false;
+            break;
+          }
+          bucket_slots.push_back(slot);
+        }
+        if (placed) {
+          bucket_seeds_[b] = seed;
+          for (size_t i = 0; i < bucket_slots.size(); ++i) {
+            slots_[bucket_slots[i]] = *buckets[b][i].second;
+          }
+        }
+      }
+      if (!placed) return false;
+    }
+    return true;
+  }
+
+  SeededHasher hasher_;
+  size_t slot_mask_ = 0;
+  size_t bucket_mask_ = 0;
+  std::vector<Slot> slots_;
+  std::vector<uint32> bucket_seeds_;
+};
+
+constexpr uint32 CompiledExampleParser::FeatureIndex::kMaxBucketSeeds;
+
+/* static */ Status CompiledExampleParser::Create(
+    FastParseExampleConfig config,
+    std::unique_ptr<CompiledExampleParser>* parser) {
+  // Check config so we can safely CHECK(false) in switches on config.*.dtype
+  TF_RETURN_IF_ERROR(CheckConfigDataTypes(config));
+  std::unique_ptr<const FeatureIndex> index = FeatureIndex::Build(config);
+  if (index == nullptr) {
+    return errors::InvalidArgument(
+        "The config of an Example parser has duplicate feature names.");
+  }
+  parser->reset(new CompiledExampleParser(std::move(config), std::move(index)));
+  return Status::OK();
+}
+
+CompiledExampleParser::CompiledExampleParser(
+    FastParseExampleConfig config, std::unique_ptr<const FeatureIndex> index)
+    : config_(std::move(config)), index_(std::move(index)) {}
+
+CompiledExampleParser::~CompiledExampleParser() {}
+
+Status CompiledExampleParser::Parse(gtl::ArraySlice<tstring> serialized,
+                                    gtl::ArraySlice<tstring> example_names,
+                                    bool collect_feature_stats,
+                                    thread::ThreadPool* thread_pool,
+                                    Result* result) const {
+  return FastParseExampleWithIndex(config_, *index_, collect_feature_stats,
+                                   serialized, example_names, thread_pool,
+                                   result);
+}
+
 Status FastParseSingleExample(const Config& config,
                               absl::string_view serialized, Result* result) {
   DCHECK(result != nullptr);
@@ -1870,18 +2155,29 @@ inline int ParseFloatFeature(protobuf::io::CodedInputStream* stream,
           !stream->ReadVarint32(&packed_length)) {
         return -1;
       }
-      auto packed_limit = stream->PushLimit(packed_length);
-      while (!stream->ExpectAtEnd()) {
-        uint32 buffer32;
-        if (!stream->ReadLittleEndian32(&buffer32)) {
+      constexpr uint32 kNumFloatBytes = 4;
+      if (packed_length % kNumFloatBytes != 0) {
+        return -1;
+      }
+      num_elements = packed_length / kNumFloatBytes;
+      if (out == nullptr) {
+        if (!stream->Skip(packed_length)) {
           return -1;
         }
-        if (out != nullptr) {
+      } else if (port::kLittleEndian) {
+        // The packed floats have the layout of the output.
+        if (!stream->ReadRaw(out, packed_length)) {
+          return -1;
+        }
+      } else {
+        for (int i = 0; i < num_elements; ++i) {
+          uint32 buffer32;
+          if (!stream->ReadLittleEndian32(&buffer32)) {
+            return -1;
+          }
           *out++ = absl::bit_cast<float>(buffer32);
         }
-        num_elements++;
       }
-      stream->PopLimit(packed_limit);
     } else if (peek_tag == kFixed32Tag(1)) {
       while (!stream->ExpectAtEnd()) {
         uint32 buffer32;
@@ -1921,18 +2217,25 @@ inline int ParseInt64Feature(protobuf::io::CodedInputStream* stream,
           !stream->ReadVarint32(&packed_length)) {
         return -1;
       }
-      auto packed_limit = stream->PushLimit(packed_length);
-      while (!stream->ExpectAtEnd()) {
-        protobuf_uint64 n;  // There is no API for int64
-        if (!stream->ReadVarint64(&n)) {
+      if (packed_length > 0) {
+        const void* packed_data;
+        int packed_data_size;
+        if (!stream->GetDirectBufferPointer(&packed_data, &packed_data_size) ||
+            static_cast<uint32>(packed_data_size) < packed_length) {
           return -1;
         }
-        if (out != nullptr) {
-          *out++ = n;
+        const uint8* begin = static_cast<const uint8*>(packed_data);
+        num_elements = CountPackedVarints(begin, begin + packed_length);
+        if (num_elements < 0) {
+          return -1;
+        }
+        if (out != nullptr && !DecodePackedVarints(begin, num_elements, out)) {
+          return -1;
+        }
+        if (!stream->Skip(packed_length)) {
+          return -1;
         }
-        num_elements++;
       }
-      stream->PopLimit(packed_limit);
     } else if (peek_tag == kVarintTag(1)) {
       while (!stream->ExpectAtEnd()) {
         protobuf_uint64 n;  // There is no API for int64
@@ -16,6 +16,7 @@ limitations under the License.
 #ifndef TENSORFLOW_CORE_UTIL_EXAMPLE_PROTO_FAST_PARSING_H_
 #define TENSORFLOW_CORE_UTIL_EXAMPLE_PROTO_FAST_PARSING_H_
 
+#include <memory>
 #include <string>
 #include <unordered_map>
 #include <vector>
@@ -28,6 +29,7 @@ limitations under the License.
 #include "tensorflow/core/framework/tensor.h"
 #include "tensorflow/core/framework/types.h"
 #include "tensorflow/core/lib/gtl/array_slice.h"
+#include "tensorflow/core/platform/macros.h"
 #include "tensorflow/core/platform/types.h"
 #include "tensorflow/core/util/sparse/sparse_tensor.h"
 
@@ -113,6 +115,43 @@ Status FastParseExample(const FastParseExampleConfig& config,
                         gtl::ArraySlice<tstring> example_names,
                         thread::ThreadPool* thread_pool, Result* result);
 
+// Parses batches of serialized Example protos like FastParseExample(), for a
+// config that does not change between batches. The parser is built once from
+// the config, and finds the features of an example with a perfect hash over
+// the feature names of the config, instead of building a hash table for each
+// batch.
+//
+// A CompiledExampleParser is thread-safe.
+class CompiledExampleParser {
+ public:
+  // Builds a parser for `config` in `*parser`.
+  static Status Create(FastParseExampleConfig config,
+                       std::unique_ptr<CompiledExampleParser>* parser);
+
+  ~CompiledExampleParser();
+
+  const FastParseExampleConfig& config() const { return config_; }
+
+  // Has the semantics of FastParseExample() for `config()`, except that it
+  // collects feature stats if `collect_feature_stats` is true, regardless of
+  // `config().collect_feature_stats`.
+  Status Parse(gtl::ArraySlice<tstring> serialized,
+               gtl::ArraySlice<tstring> example_names,
+               bool collect_feature_stats, thread::ThreadPool* thread_pool,
+               Result* result) const;
+
+ private:
+  class FeatureIndex;
+
+  CompiledExampleParser(FastParseExampleConfig config,
+                        std::unique_ptr<const FeatureIndex> index);
+
+  const FastParseExampleConfig config_;
+  const std::unique_ptr<const FeatureIndex> index_;
+
+  TF_DISALLOW_COPY_AND_ASSIGN(CompiledExampleParser);
+};
+
 // TODO(mrry): Move the hash table construction into the config object.
 typedef FastParseExampleConfig FastParseSingleExampleConfig;
 
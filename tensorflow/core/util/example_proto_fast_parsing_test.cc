@@ -249,6 +249,41 @@ static string ExampleWithSomeFeatures() {
 
 TEST(FastParse, SomeFeatures) { TestCorrectness(ExampleWithSomeFeatures()); }
 
+TEST(FastParse, PackedInt64Lists) {
+  // Runs of one-byte varints longer and shorter than 16, mixed with longer
+  // varints, including the 10-byte varints of negative values.
+  const std::vector<std::vector<int64>> lists = {
+      {},
+      {0},
+      {1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15},
+      {1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 16},
+      {1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 16, 17},
+      {127, 128, 300, -1, 0, kint64max, kint64min, 1, 2, 3, 4, 5, 6, 7, 8, 9,
+       10, 11, 12, 13, 14, 15, 16, 17, 16384, 5}};
+  for (const auto& list : lists) {
+    Example example;
+    Int64List* int64_list =
+        (*example.mutable_features()->mutable_feature())["int64_list"]
+            .mutable_int64_list();
+    for (int64 value : list) {
+      int64_list->add_value(value);
+    }
+    TestCorrectness(Serialize(example));
+  }
+}
+
+TEST(FastParse, TruncatedPackedInt64List) {
+  Example example;
+  (*example.mutable_features()->mutable_feature())["int64_list"]
+      .mutable_int64_list()
+      ->add_value(300);
+  // The last byte of the serialized example is the last byte of the varint.
+  string serialized = Serialize(example);
+  serialized.back() |= 0x80;
+  Example fast_example;
+  EXPECT_FALSE(TestFastParse(serialized, &fast_example));
+}
+
 static void AddDenseFeature(const char* feature_name, DataType dtype,
                             PartialTensorShape shape, bool variable_length,
                             size_t elements_per_stride,
@@ -321,6 +356,90 @@ TEST(FastParse, StatsCollection) {
   }
 }
 
+void ExpectResultsEqual(const Result& expected, const Result& actual) {
+  auto expect_tensors_equal = [](const std::vector<Tensor>& expected,
+                                 const std::vector<Tensor>& actual) {
+    ASSERT_EQ(expected.size(), actual.size());
+    for (size_t i = 0; i < expected.size(); ++i) {
+      EXPECT_EQ(expected[i].DebugString(/*num_values=*/1000),
+                actual[i].DebugString(/*num_values=*/1000));
+    }
+  };
+  expect_tensors_equal(expected.sparse_indices, actual.sparse_indices);
+  expect_tensors_equal(expected.sparse_values, actual.sparse_values);
+  expect_tensors_equal(expected.sparse_shapes, actual.sparse_shapes);
+  expect_tensors_equal(expected.dense_values, actual.dense_values);
+  expect_tensors_equal(expected.ragged_values, actual.ragged_values);
+  expect_tensors_equal(expected.ragged_splits, actual.ragged_splits);
+  EXPECT_EQ(expected.feature_stats.size(), actual.feature_stats.size());
+}
+
+TEST(CompiledExampleParser, MatchesFastParseExample) {
+  std::vector<tstring> serialized(5, ExampleWithSomeFeatures());
+
+  FastParseExampleConfig config;
+  AddDenseFeature("bytes_list", DT_STRING, {2}, false, 2, &config);
+  AddDenseFeature("float_list", DT_FLOAT, {-1}, true, 1, &config);
+  AddSparseFeature("int64_list", DT_INT64, &config);
+  AddSparseFeature("missing", DT_FLOAT, &config);
+  config.ragged.push_back({"empty_int64_list", DT_INT64, DT_INT32});
+
+  std::unique_ptr<CompiledExampleParser> parser;
+  TF_CHECK_OK(CompiledExampleParser::Create(config, &parser));
+  for (bool collect_feature_stats : {false, true}) {
+    config.collect_feature_stats = collect_feature_stats;
+    Result expected;
+    TF_CHECK_OK(FastParseExample(config, serialized, {}, nullptr, &expected));
+    Result actual;
+    TF_CHECK_OK(parser->Parse(serialized, {}, collect_feature_stats, nullptr,
+                              &actual));
+    ExpectResultsEqual(expected, actual);
+  }
+}
+
+TEST(CompiledExampleParser, ManyFeatures) {
+  // Features of the config that the examples have, features that they do not
+  // have, and features of the examples that the config does not have.
+  FastParseExampleConfig config;
+  std::vector<string> names;
+  for (int i = 0; i < 1000; ++i) {
+    names.push_back(strings::StrCat("feature_", i));
+  }
+  for (int i = 0; i < 500; ++i) {
+    AddSparseFeature(names[i].c_str(), DT_INT64, &config);
+  }
+  Example example;
+  for (int i = 250; i < 1000; ++i) {
+    (*example.mutable_features()->mutable_feature())[names[i]]
+        .mutable_int64_list()
+        ->add_value(i);
+  }
+  std::vector<tstring> serialized = {Serialize(example)};
+
+  std::unique_ptr<CompiledExampleParser> parser;
+  TF_CHECK_OK(CompiledExampleParser::Create(config, &parser));
+  Result result;
+  TF_CHECK_OK(parser->Parse(serialized, {}, false, nullptr, &result));
+  ASSERT_EQ(500, result.sparse_values.size());
+  for (int i = 0; i < 500; ++i) {
+    const Tensor& values = result.sparse_values[i];
+    if (i < 250) {
+      EXPECT_EQ(0, values.NumElements());
+    } else {
+      ASSERT_EQ(1, values.NumElements());
+      EXPECT_EQ(i, values.flat<int64>()(0));
+    }
+  }
+}
+
+TEST(CompiledExampleParser, DuplicateFeatureNames) {
+  FastParseExampleConfig config;
+  AddSparseFeature("feature", DT_INT64, &config);
+  AddDenseFeature("feature", DT_INT64, {1}, false, 1, &config);
+  std::unique_ptr<CompiledExampleParser> parser;
+  EXPECT_FALSE(CompiledExampleParser::Create(config, &parser).ok());
+}
+
 string RandStr(random::SimplePhilox* rng) {
   static const char key_char_lookup[] =
       "0123456789{}~`!@#$%^&*()"
@@ -413,6 +532,35 @@ TEST(FastParse, FuzzTest) {
   }
 }
 
+TEST(FastParse, DenseInt64List) {
+  Example example;
+  Int64List* int64_list =
+      (*example.mutable_features()->mutable_feature())["int64_list"]
+          .mutable_int64_list();
+  for (int i = 0; i < 20; ++i) {
+    int64_list->add_value(i * 100);
+  }
+  std::vector<tstring> serialized = {Serialize(example)};
+
+  FastParseExampleConfig config;
+  AddDenseFeature("int64_list", DT_INT64, {20}, false, 20, &config);
+  Result result;
+  TF_CHECK_OK(FastParseExample(config, serialized, {}, nullptr, &result));
+  ASSERT_EQ(1, result.dense_values.size());
+  auto values = result.dense_values[0].flat<int64>();
+  for (int i = 0; i < 20; ++i) {
+    EXPECT_EQ(i * 100, values(i));
+  }
+
+  // The output of a dense feature does not fit a longer list.
+  int64_list->add_value(2000);
+  serialized = {Serialize(example)};
+  Result overflow_result;
+  EXPECT_FALSE(
+      FastParseExample(config, serialized, {}, nullptr, &overflow_result)
+          .ok());
+}
+
 TEST(TestFastParseExample, Empty) {
   Result result;
   FastParseExampleConfig config;
@@ -423,6 +571,98 @@ TEST(TestFastParseExample, Empty) {
   EXPECT_TRUE(status.ok()) << status;
 }
 
+// Benchmarks FastParseExample, or a CompiledExampleParser if `compiled` is
+// true, over a batch of `batch_size` examples, each with `num_features`
+// features. `add_feature` adds the i-th feature to an example and to the
+// config. Reports the number of features parsed.
+template <typename AddFeature>
+void BenchmarkFastParseExample(int iters, int batch_size, int num_features,
+                               AddFeature add_feature, bool compiled = false) {
+  testing::StopTiming();
+  static std::vector<string>* feature_names = new std::vector<string>;
+  while (feature_names->size() < static_cast<size_t>(num_features)) {
+    feature_names->push_back(strings::StrCat("f", feature_names->size()));
+  }
+  Example example;
+  FastParseExampleConfig config;
+  for (int i = 0; i < num_features; ++i) {
+    add_feature((*feature_names)[i].c_str(), &example, &config);
+  }
+  std::vector<tstring> serialized(batch_size, Serialize(example));
+  std::unique_ptr<CompiledExampleParser> parser;
+  TF_CHECK_OK(CompiledExampleParser::Create(config, &parser));
+  testing::ItemsProcessed(static_cast<int64>(iters) * batch_size *
+                          num_features);
+  testing::BytesProcessed(static_cast<int64>(iters) * batch_size *
+                          serialized[0].size());
+  testing::StartTiming();
+  for (int i = 0; i < iters; ++i) {
+    Result result;
+    if (compiled) {
+      TF_CHECK_OK(parser->Parse(serialized, {}, false, nullptr, &result));
+    } else {
+      TF_CHECK_OK(FastParseExample(config, serialized, {}, nullptr, &result));
+    }
+  }
+}
+
+// Many sparse features with a few small ids each, as in ranking models.
+void AddSparseIdsFeature(const char* name, Example* example,
+                         FastParseExampleConfig* config) {
+  Int64List* list =
+      (*example->mutable_features()->mutable_feature())[name]
+          .mutable_int64_list();
+  for (int64 id : {3, 270, 17, 86942, 5}) {
+    list->add_value(id);
+  }
+  AddSparseFeature(name, DT_INT64, config);
+}
+
+static void BM_FastParseSparseIds(int iters, int num_features) {
+  BenchmarkFastParseExample(iters, /*batch_size=*/128, num_features,
+                            AddSparseIdsFeature);
+}
+BENCHMARK(BM_FastParseSparseIds)->Arg(10)->Arg(100)->Arg(1000);
+
+static void BM_CompiledParseSparseIds(int iters, int num_features) {
+  BenchmarkFastParseExample(iters, /*batch_size=*/128, num_features,
+                            AddSparseIdsFeature, /*compiled=*/true);
+}
+BENCHMARK(BM_CompiledParseSparseIds)->Arg(10)->Arg(100)->Arg(1000);
+
+// Long lists of one-byte varints, such as token ids of a small vocabulary.
+static void BM_FastParseLongInt64Lists(int iters, int list_length) {
+  BenchmarkFastParseExample(
+      iters, /*batch_size=*/128, /*num_features=*/10,
+      [list_length](const char* name, Example* example,
+                    FastParseExampleConfig* config) {
+        Int64List* list = (*example->mutable_features()->mutable_feature())
+                              [name].mutable_int64_list();
+        for (int i = 0; i < list_length; ++i) {
+          list->add_value(i % 100);
+        }
+        AddDenseFeature(name, DT_INT64, {-1}, true, 1, config);
+      });
+}
+BENCHMARK(BM_FastParseLongInt64Lists)->Arg(10)->Arg(100)->Arg(1000);
+
+// Dense features with long float lists, such as embeddings.
+static void BM_FastParseLongFloatLists(int iters, int list_length) {
+  BenchmarkFastParseExample(
+      iters, /*batch_size=*/128, /*num_features=*/10,
+      [list_length](const char* name, Example* example,
+                    FastParseExampleConfig* config) {
+        FloatList* list = (*example->mutable_features()->mutable_feature())
+                              [name].mutable_float_list();
+        for (int i = 0; i < list_length; ++i) {
+          list->add_value(i * 0.5f);
+        }
+        AddDenseFeature(name, DT_FLOAT, {list_length}, false, list_length,
+                        config);
+      });
+}
+BENCHMARK(BM_FastParseLongFloatLists)->Arg(10)->Arg(100)->Arg(1000);
+
 }  // namespace
 }  // namespace example
 }  // namespace tensorflow
@@ -25,6 +25,7 @@ See [Importing Data](https://tensorflow.org/guide/datasets) for an overview.
 @@AutoShardPolicy
 @@Counter
 @@CheckpointInputPipelineHook
+@@ColumnarDataset
 @@CsvDataset
 @@DatasetStructure
 @@DistributeOptions
@@ -117,6 +118,7 @@ from tensorflow.python.data.experimental.ops.parsing_ops import parse_example_da
 from tensorflow.python.data.experimental.ops.prefetching_ops import copy_to_device
 from tensorflow.python.data.experimental.ops.prefetching_ops import prefetch_to_device
 from tensorflow.python.data.experimental.ops.random_ops import RandomDataset
+from tensorflow.python.data.experimental.ops.readers import ColumnarDataset
 from tensorflow.python.data.experimental.ops.readers import CsvDataset
 from tensorflow.python.data.experimental.ops.readers import make_batched_features_dataset
 from tensorflow.python.data.experimental.ops.readers import make_csv_dataset
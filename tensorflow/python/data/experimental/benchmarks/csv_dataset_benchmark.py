@@ -40,6 +40,7 @@ class CsvDatasetBenchmark(test.Benchmark):
 
   FLOAT_VAL = '1.23456E12'
   STR_VAL = string.ascii_letters * 10
+  QUOTED_STR_VAL = '"%s""%s"' % (STR_VAL, STR_VAL)
 
   def _set_up(self, str_val):
     # Since this isn't test.TestCase, have to manually create a test dir
@@ -127,5 +128,14 @@ class CsvDatasetBenchmark(test.Benchmark):
       self._run_benchmark(dataset, num_cols, 'csv_strings_fused_dataset')
     self._tear_down()
 
+  def benchmark_csv_dataset_with_quoted_strings(self):
+    self._set_up(self.QUOTED_STR_VAL)
+    for i in range(len(self._filenames)):
+      num_cols = self._num_cols[i]
+      kwargs = {'record_defaults': [['']] * num_cols}
+      dataset = readers.CsvDataset(self._filenames[i], **kwargs).repeat()  # pylint: disable=cell-var-from-loop
+      self._run_benchmark(dataset, num_cols, 'csv_quoted_strings_fused_dataset')
+    self._tear_down()
+
 if __name__ == '__main__':
   test.main()
@@ -24,6 +24,7 @@ from tensorflow.python.data.experimental.ops import batching
 from tensorflow.python.data.kernel_tests import test_base
 from tensorflow.python.data.ops import dataset_ops
 from tensorflow.python.framework import combinations
+from tensorflow.python.framework import dtypes
 from tensorflow.python.framework import errors
 from tensorflow.python.framework import sparse_tensor
 from tensorflow.python.ops import array_ops
@@ -124,6 +125,35 @@ class RaggedBatchTest(test_base.DatasetTestBase, parameterized.TestCase):
       self.assertAllEqual(result['sparse'].values, rows)
       self.assertAllEqual(result['sparse'].dense_shape, [4, 100])
 
+  @combinations.generate(
+      combinations.times(
+          test_base.default_test_combinations(),
+          combinations.combine(row_splits_dtype=[dtypes.int32, dtypes.int64])))
+  def testRaggedBatchDatasetRowSplitsDtype(self, row_splits_dtype):
+    dataset = _make_matrix_ds(6).apply(
+        batching.dense_to_ragged_batch(4, row_splits_dtype=row_splits_dtype))
+    self.assertEqual(dataset.element_spec.row_splits_dtype, row_splits_dtype)
+    self.assertEqual(dataset.element_spec.shape.as_list(), [None, None, 2])
+    get_next = self.getNext(dataset)
+
+    result = self.evaluate(get_next())
+    self.assertEqual(result.row_splits.dtype, row_splits_dtype.as_numpy_dtype)
+    self.assertAllEqual(result.row_splits, [0, 0, 1, 3, 6])
+    self.assertAllEqual(result, [[[r, r]] * r for r in range(4)])
+    result = self.evaluate(get_next())
+    self.assertAllEqual(result.row_splits, [0, 4, 9])
+    with self.assertRaises(errors.OutOfRangeError):
+      self.evaluate(get_next())
+
+  @combinations.generate(test_base.default_test_combinations())
+  def testRaggedBatchDatasetMismatchedInnerDimensions(self):
+    dataset = _make_scalar_ds(4).map(lambda x: array_ops.fill([1, x], x))
+    dataset = dataset.apply(batching.dense_to_ragged_batch(2))
+    get_next = self.getNext(dataset)
+    with self.assertRaisesRegexp(errors.InvalidArgumentError,
+                                 "inner dimensions differ"):
+      self.evaluate(get_next())
+
 
 if __name__ == '__main__':
   test.main()
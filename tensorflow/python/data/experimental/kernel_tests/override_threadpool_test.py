@@ -121,6 +121,37 @@ class OverrideThreadpoolTest(test_base.DatasetTestBase,
 
     self._testNumThreadsHelper(num_threads, override_threadpool_fn)
 
+  @parameterized.named_parameters(
+      ("1", None),
+      ("2", 1),
+      ("3", 4),
+  )
+  def testNumaAware(self, num_threads_per_node):
+
+    def override_threadpool_fn(dataset):
+      options = dataset_ops.Options()
+      options.experimental_threading.numa_aware = True
+      if num_threads_per_node is not None:
+        options.experimental_threading.private_threadpool_size = (
+            num_threads_per_node)
+      return dataset.with_options(options)
+
+    # The number of threads is only bounded on hosts with several NUMA nodes.
+    self._testNumThreadsHelper(None, override_threadpool_fn)
+
+  def testNumaAwareProducesInput(self):
+    dataset = dataset_ops.Dataset.range(100).map(
+        lambda x: x * 2, num_parallel_calls=4).prefetch(2)
+    dataset = dataset_ops._NumaAwareDataset(dataset, 0)
+    self.assertDatasetProduces(dataset, [x * 2 for x in range(100)])
+
+  def testNumaAwareAsGraphDefInternal(self):
+    dataset = dataset_ops.Dataset.from_tensors(0)
+    dataset = dataset_ops._NumaAwareDataset(dataset, 2)
+    graph = graph_pb2.GraphDef().FromString(
+        self.evaluate(dataset._as_serialized_graph()))
+    self.assertTrue(any(node.op == "NumaAwareDataset" for node in graph.node))
+
   def testMaxIntraOpParallelismAsGraphDefInternal(self):
     dataset = dataset_ops.Dataset.from_tensors(0)
     dataset = dataset_ops._MaxIntraOpParallelismDataset(dataset, 1)
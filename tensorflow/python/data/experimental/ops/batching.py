@@ -79,6 +79,9 @@ def dense_to_ragged_batch(batch_size,
   """
 
   def _apply_fn(dataset):
+    if _DenseToRaggedBatchDataset.supports(dataset.element_spec):
+      return _DenseToRaggedBatchDataset(dataset, batch_size, drop_remainder,
+                                        row_splits_dtype)
     ragged_dataset = _DenseToRaggedDataset(dataset, row_splits_dtype)
     return dataset_ops.BatchDataset(
         ragged_dataset, batch_size=batch_size, drop_remainder=drop_remainder)
@@ -425,3 +428,67 @@ class _DenseToRaggedDataset(dataset_ops.UnaryDataset):
   @property
   def element_spec(self):
     return self._structure
+
+
+class _DenseToRaggedBatchDataset(dataset_ops.UnaryDataset):
+  """A `Dataset` that batches dense elements into `tf.RaggedTensor`s.
+
+  Unlike batching the output of `_DenseToRaggedDataset`, which encodes each
+  element as a ragged tensor before the batch is decoded back into one, this
+  concatenates the values of the elements of a batch and computes their row
+  splits directly.
+  """
+
+  def __init__(self, input_dataset, batch_size, drop_remainder,
+               row_splits_dtype):
+    """See `dense_to_ragged_batch()` for details."""
+    self._input_dataset = input_dataset
+    self._batch_size = ops.convert_to_tensor(
+        batch_size, dtype=dtypes.int64, name="batch_size")
+    self._drop_remainder = ops.convert_to_tensor(
+        drop_remainder, dtype=dtypes.bool, name="drop_remainder")
+    self._row_splits_dtype = dtypes.as_dtype(row_splits_dtype)
+
+    constant_drop_remainder = tensor_util.constant_value(self._drop_remainder)
+    if constant_drop_remainder:
+      batch_dim = tensor_util.constant_value(self._batch_size)
+    else:
+      batch_dim = None
+
+    def to_ragged_batch_spec(spec):
+      if isinstance(spec, tensor_spec.TensorSpec) and spec.shape.ndims != 0:
+        spec = ragged_tensor.RaggedTensorSpec(
+            shape=spec.shape,
+            dtype=spec.dtype,
+            ragged_rank=0,
+            row_splits_dtype=self._row_splits_dtype)
+      return spec._batch(batch_dim)  # pylint: disable=protected-access
+
+    self._element_spec = nest.map_structure(to_ragged_batch_spec,
+                                            input_dataset.element_spec)
+    variant_tensor = ged_ops.dense_to_ragged_batch_dataset(
+        self._input_dataset._variant_tensor,  # pylint: disable=protected-access
+        batch_size=self._batch_size,
+        drop_remainder=self._drop_remainder,
+        row_splits_dtype=self._row_splits_dtype,
+        **self._flat_structure)
+    super(_DenseToRaggedBatchDataset, self).__init__(input_dataset,
+                                                     variant_tensor)
+
+  @staticmethod
+  def supports(element_spec):
+    """Returns whether the kernel can batch elements of `element_spec`."""
+    for spec in nest.flatten(element_spec):
+      if isinstance(spec, tensor_spec.TensorSpec):
+        # The kernel stacks variant tensors instead of batching them into
+        # ragged tensors.
+        if spec.dtype == dtypes.variant and spec.shape.ndims != 0:
+          return False
+      elif not isinstance(spec, (ragged_tensor.RaggedTensorSpec,
+                                 sparse_tensor.SparseTensorSpec)):
+        return False
+    return True
+
+  @property
+  def element_spec(self):
+    return self._element_spec
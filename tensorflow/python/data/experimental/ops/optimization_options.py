@@ -141,6 +141,16 @@ class OptimizationOptions(options.OptionsBase):
       "Whether to fuse map and filter transformations. If None, defaults to "
       "False.")
 
+  map_element_batching = options.create_option(
+      name="map_element_batching",
+      ty=bool,
+      docstring=
+      "Whether parallel map transformations may group input elements into "
+      "invocations of a batched version of their function, which amortizes "
+      "the overhead of invoking the function. The number of elements per "
+      "invocation is tuned at runtime. Only applies to stateless functions. "
+      "If None, defaults to False.")
+
   map_fusion = options.create_option(
       name="map_fusion",
       ty=bool,
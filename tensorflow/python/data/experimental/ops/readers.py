@@ -747,6 +747,85 @@ class CsvDatasetV1(dataset_ops.DatasetV1Adapter):
     super(CsvDatasetV1, self).__init__(wrapped)
 
 
+@tf_export("data.experimental.ColumnarDataset", v1=[])
+class ColumnarDatasetV2(dataset_ops.DatasetSource):
+  """A `Dataset` comprising the row groups of one or more columnar files."""
+
+  def __init__(self, filenames, columns, output_types, predicate=None):
+    """Creates a `ColumnarDataset` by reading columnar files.
+
+    A columnar file stores a table whose rows are split into row groups, and
+    stores the values of each column of a row group contiguously, along with
+    their minimum and maximum. Each element of this dataset is a tuple with a
+    vector per column in `columns`, which holds the values of the column in a
+    row group. Only the columns in `columns` (and the predicate column) are
+    read, and the row groups whose statistics show that no row satisfies the
+    predicate are skipped without being read.
+
+    For example, to read the `id` and `score` columns of the rows whose `day`
+    is between 10 and 20:
+
+    ```python
+    dataset = tf.data.experimental.ColumnarDataset(
+        "/path/to/table-*.col",
+        columns=["id", "score"],
+        output_types=[tf.int64, tf.float32],
+        predicate=("day", 10, 20))
+    ```
+
+    Args:
+      filenames: A `tf.string` tensor containing one or more filenames.
+      columns: A list of the names of the columns to read.
+      output_types: A list of the `tf.DType` of each column in `columns`, one of
+        `tf.int32`, `tf.int64`, `tf.float32`, `tf.float64` and `tf.string`.
+      predicate: (Optional.) A `(column, min, max)` tuple. If set, only the
+        rows whose numeric `column` is in the closed interval `[min, max]` are
+        produced, and row groups with no such rows are skipped.
+    """
+    if len(columns) != len(output_types):
+      raise ValueError("`columns` and `output_types` must have the same "
+                       "length, but got %d and %d." %
+                       (len(columns), len(output_types)))
+    if predicate is None:
+      predicate = ("", 0.0, 0.0)
+    predicate_column, predicate_min, predicate_max = predicate
+    self._filenames = ops.convert_to_tensor(
+        filenames, dtype=dtypes.string, name="filenames")
+    self._columns = ops.convert_to_tensor(
+        columns, dtype=dtypes.string, name="columns")
+    self._predicate_column = ops.convert_to_tensor(
+        predicate_column, dtype=dtypes.string, name="predicate_column")
+    self._predicate_min = ops.convert_to_tensor(
+        predicate_min, dtype=dtypes.float64, name="predicate_min")
+    self._predicate_max = ops.convert_to_tensor(
+        predicate_max, dtype=dtypes.float64, name="predicate_max")
+    self._element_spec = tuple(
+        tensor_spec.TensorSpec([None], dtypes.as_dtype(dtype))
+        for dtype in output_types)
+    variant_tensor = gen_experimental_dataset_ops.columnar_dataset(
+        filenames=self._filenames,
+        columns=self._columns,
+        predicate_column=self._predicate_column,
+        predicate_min=self._predicate_min,
+        predicate_max=self._predicate_max,
+        **self._flat_structure)
+    super(ColumnarDatasetV2, self).__init__(variant_tensor)
+
+  @property
+  def element_spec(self):
+    return self._element_spec
+
+
+@tf_export(v1=["data.experimental.ColumnarDataset"])
+class ColumnarDatasetV1(dataset_ops.DatasetV1Adapter):
+  """A `Dataset` comprising the row groups of one or more columnar files."""
+
+  @functools.wraps(ColumnarDatasetV2.__init__)
+  def __init__(self, filenames, columns, output_types, predicate=None):
+    wrapped = ColumnarDatasetV2(filenames, columns, output_types, predicate)
+    super(ColumnarDatasetV1, self).__init__(wrapped)
+
+
 @tf_export("data.experimental.make_batched_features_dataset", v1=[])
 def make_batched_features_dataset_v2(file_pattern,
                                      batch_size,
@@ -1046,11 +1125,13 @@ class SqlDatasetV1(dataset_ops.DatasetV1Adapter):
 
 
 if tf2.enabled():
+  ColumnarDataset = ColumnarDatasetV2
   CsvDataset = CsvDatasetV2
   SqlDataset = SqlDatasetV2
   make_batched_features_dataset = make_batched_features_dataset_v2
   make_csv_dataset = make_csv_dataset_v2
 else:
+  ColumnarDataset = ColumnarDatasetV1
   CsvDataset = CsvDatasetV1
   SqlDataset = SqlDatasetV1
   make_batched_features_dataset = make_batched_features_dataset_v1
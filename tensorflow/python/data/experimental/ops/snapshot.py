@@ -45,7 +45,8 @@ class _SnapshotDataset(dataset_ops.UnaryUnchangedStructureDataset):
                num_writer_threads=None,
                writer_buffer_size=None,
                shuffle_on_read=None,
-               seed=None):
+               seed=None,
+               max_store_size_bytes=None):
 
     self._compression = compression if compression is not None else ""
     self._reader_path_prefix = (
@@ -68,6 +69,9 @@ class _SnapshotDataset(dataset_ops.UnaryUnchangedStructureDataset):
     self._shuffle_on_read = (
         shuffle_on_read if shuffle_on_read is not None else False)
 
+    self._max_store_size_bytes = (
+        max_store_size_bytes if max_store_size_bytes is not None else -1)
+
     self._seed, self._seed2 = random_seed.get_seed(seed)
 
     self._input_dataset = input_dataset
@@ -88,6 +92,7 @@ class _SnapshotDataset(dataset_ops.UnaryUnchangedStructureDataset):
         shuffle_on_read=self._shuffle_on_read,
         seed=self._seed,
         seed2=self._seed2,
+        max_store_size_bytes=self._max_store_size_bytes,
         **self._flat_structure)
     super(_SnapshotDataset, self).__init__(input_dataset, variant_tensor)
 
@@ -103,13 +108,18 @@ def snapshot(path,
              num_writer_threads=None,
              writer_buffer_size=None,
              shuffle_on_read=None,
-             seed=None):
+             seed=None,
+             max_store_size_bytes=None):
   """Writes to/reads from a snapshot of a dataset.
 
   This function attempts to determine whether a valid snapshot exists at the
   `path`, and reads from the snapshot if so. If not, it will run the
   preprocessing pipeline as usual, and write out a snapshot of the data
-  processed for future use.
+  processed for future use. If the snapshot of the whole dataset does not
+  exist, but a snapshot at `path` was written for a dataset that the pipeline
+  starts with (e.g. by an earlier version of the pipeline that applied fewer
+  transformations), the pipeline reads the shared transformations from that
+  snapshot instead of recomputing them.
 
   Args:
     path: A directory where we want to save our snapshots and/or read from a
@@ -145,6 +155,10 @@ def snapshot(path,
       produced when reading from a snapshot will be random. Defaults to False.
     seed: If seed is set, the random number generator is seeded by the given
       seed. Otherwise, it is seeded by a random seed.
+    max_store_size_bytes: The maximum total size of the snapshots at `path`.
+      When a snapshot is finalized, the least recently used snapshots are
+      deleted until the total size is within this limit. Defaults to None
+      (unbounded).
   Returns:
     A `Dataset` transformation function, which can be passed to
     `tf.data.Dataset.apply`.
@@ -155,6 +169,7 @@ def snapshot(path,
                             writer_path_prefix, shard_size_bytes,
                             pending_snapshot_expiry_seconds, num_reader_threads,
                             reader_buffer_size, num_writer_threads,
-                            writer_buffer_size, shuffle_on_read, seed)
+                            writer_buffer_size, shuffle_on_read, seed,
+                            max_store_size_bytes)
 
   return _apply_fn
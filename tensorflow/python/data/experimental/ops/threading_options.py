@@ -43,6 +43,18 @@ class ThreadingOptions(options.OptionsBase):
       docstring=
       "If set, it overrides the maximum degree of intra-op parallelism.")
 
+  numa_aware = options.create_option(
+      name="numa_aware",
+      ty=bool,
+      docstring=
+      "Whether to run each iterator of the dataset on a single NUMA node, "
+      "using threads with affinity to the node and memory local to it. The "
+      "iterators created by a thread with affinity to a node run on that "
+      "node, and other iterators are spread over the nodes. If set, "
+      "`private_threadpool_size` is the size of the threadpool of each node. "
+      "Has no effect on hosts with a single NUMA node. If None, defaults to "
+      "False.")
+
   private_threadpool_size = options.create_option(
       name="private_threadpool_size",
       ty=int,
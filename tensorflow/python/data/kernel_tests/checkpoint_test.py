@@ -390,6 +390,34 @@ class CheckpointTest(test_base.DatasetTestBase, parameterized.TestCase):
         self.assertEqual(i * 2 + j, self.evaluate(get_next()))
       checkpoint.save(file_prefix=checkpoint_prefix)
 
+  @combinations.generate(
+      combinations.combine(tf_api_version=[1, 2], mode="eager"))
+  def testIncrementalCheckpoints(self):
+    checkpoint_directory = self.get_temp_dir()
+    checkpoint_prefix = os.path.join(checkpoint_directory, "ckpt")
+    dataset = dataset_ops.Dataset.range(100).shuffle(
+        10, seed=1, reshuffle_each_iteration=False).prefetch(4)
+    options = dataset_ops.Options()
+    options.experimental_incremental_checkpoints = True
+    dataset = dataset.with_options(options)
+    iterator = iter(dataset)
+    get_next = iterator.get_next
+    checkpoint = trackable_utils.Checkpoint(iterator=iterator)
+    for _ in range(5):
+      get_next()
+    # The first checkpoint saves the buffered elements, and the second one can
+    # recompute them from the input state saved by the first one.
+    checkpoint.save(checkpoint_prefix)
+    for _ in range(20):
+      get_next()
+    save_path = checkpoint.save(checkpoint_prefix)
+    expected = [self.evaluate(get_next()) for _ in range(75)]
+    checkpoint.restore(save_path).run_restore_ops()
+    actual = [self.evaluate(get_next()) for _ in range(75)]
+    self.assertAllEqual(expected, actual)
+    with self.assertRaises(errors.OutOfRangeError):
+      get_next()
+
 
 if __name__ == "__main__":
   test.main()
@@ -1106,6 +1106,21 @@ class MapTest(test_base.DatasetTestBase, parameterized.TestCase):
     with self.assertRaises(errors.InvalidArgumentError):
       self.evaluate(get_next())
 
+  @parameterized.named_parameters(
+      ("Uniform", lambda x: x * x, [x * x for x in range(100)]),
+      # Elements of different shapes cannot be stacked, so each group is
+      # transformed one element at a time.
+      ("Ragged", lambda x: array_ops.fill([x % 3], x),
+       [[x] * (x % 3) for x in range(100)]),
+  )
+  def testMapElementBatching(self, map_fn, expected_output):
+    dataset = dataset_ops.Dataset.range(100).map(
+        map_fn, num_parallel_calls=8)
+    options = dataset_ops.Options()
+    options.experimental_optimization.map_element_batching = True
+    dataset = dataset.with_options(options)
+    self.assertDatasetProduces(dataset, expected_output=expected_output)
+
   # NOTE: collection test is specific to graph mode only, no eager coverage.
   @test_util.run_v1_only("graph specific test")
   def testSkipEagerCollectionCopy(self):
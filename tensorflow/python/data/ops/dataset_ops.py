@@ -314,9 +314,21 @@ class DatasetV2(tracking_base.Trackable, composite_tensor.CompositeTensor):
       if t_options.max_intra_op_parallelism is not None:
         dataset = _MaxIntraOpParallelismDataset(
             dataset, t_options.max_intra_op_parallelism)
-      if t_options.private_threadpool_size is not None:
+      if t_options.numa_aware:
+        dataset = _NumaAwareDataset(dataset,
+                                    t_options.private_threadpool_size or 0)
+      elif t_options.private_threadpool_size is not None:
         dataset = _PrivateThreadPoolDataset(dataset,
                                             t_options.private_threadpool_size)
+    map_element_batching = (
+        options.experimental_optimization is not None and
+        options.experimental_optimization.map_element_batching)
+    if options.experimental_incremental_checkpoints or map_element_batching:
+      dataset = _IteratorOptionsDataset(
+          dataset,
+          incremental_checkpoints=bool(
+              options.experimental_incremental_checkpoints),
+          map_element_batching=bool(map_element_batching))
     # pylint: disable=protected-access
     static_optimizations = options._static_optimizations()
     static_optimization_configs = options._static_optimization_configs()
@@ -2421,6 +2433,17 @@ class Options(options_lib.OptionsBase):
       "`tf.data.experimental.DistributeOptions` for more details.",
       default_factory=distribute_options.DistributeOptions)
 
+  experimental_incremental_checkpoints = options_lib.create_option(
+      name="experimental_incremental_checkpoints",
+      ty=bool,
+      docstring=
+      "Whether iterators that buffer elements (such as those of `shuffle` and "
+      "`prefetch`) save checkpoints from which the buffered elements can be "
+      "recomputed by replaying their input, instead of the buffered elements "
+      "themselves. This makes checkpoints smaller and faster to save, and "
+      "restoring them slower. It requires the input of those iterators to be "
+      "deterministic. If None, defaults to False.")
+
   experimental_optimization = options_lib.create_option(
       name="experimental_optimization",
       ty=optimization_options.OptimizationOptions,
@@ -4023,6 +4046,23 @@ class _SetStatsAggregatorDataset(UnaryUnchangedStructureDataset):
                                                      variant_tensor)
 
 
+class _IteratorOptionsDataset(UnaryUnchangedStructureDataset):
+  """A `Dataset` that acts as an identity, setting options of its iterators."""
+
+  def __init__(self,
+               input_dataset,
+               incremental_checkpoints=False,
+               map_element_batching=False):
+    self._input_dataset = input_dataset
+    variant_tensor = ged_ops.iterator_options_dataset(
+        input_dataset._variant_tensor,  # pylint: disable=protected-access
+        incremental_checkpoints=incremental_checkpoints,
+        map_element_batching=map_element_batching,
+        **self._flat_structure)
+    super(_IteratorOptionsDataset, self).__init__(input_dataset,
+                                                  variant_tensor)
+
+
 class _MaxIntraOpParallelismDataset(UnaryUnchangedStructureDataset):
   """A `Dataset` that acts as an identity, overriding intra-op parallelism."""
 
@@ -4040,6 +4080,20 @@ class _MaxIntraOpParallelismDataset(UnaryUnchangedStructureDataset):
                                                         variant_tensor)
 
 
+class _NumaAwareDataset(UnaryUnchangedStructureDataset):
+  """A `Dataset` that acts as an identity, pinning its input to a NUMA node."""
+
+  def __init__(self, input_dataset, num_threads_per_node):
+    self._input_dataset = input_dataset
+    self._num_threads_per_node = ops.convert_to_tensor(
+        num_threads_per_node, dtype=dtypes.int64, name="num_threads_per_node")
+    variant_tensor = ged_ops.numa_aware_dataset(
+        input_dataset._variant_tensor,  # pylint: disable=protected-access
+        self._num_threads_per_node,
+        **self._flat_structure)
+    super(_NumaAwareDataset, self).__init__(input_dataset, variant_tensor)
+
+
 class _PrivateThreadPoolDataset(UnaryUnchangedStructureDataset):
   """A `Dataset` that acts as an identity, setting a private threadpool."""
 
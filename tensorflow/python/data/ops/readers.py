@@ -202,7 +202,11 @@ class TextLineDatasetV1(dataset_ops.DatasetV1Adapter):
 class _TFRecordDataset(dataset_ops.DatasetSource):
   """A `Dataset` comprising records from one or more TFRecord files."""
 
-  def __init__(self, filenames, compression_type=None, buffer_size=None):
+  def __init__(self,
+               filenames,
+               compression_type=None,
+               buffer_size=None,
+               use_direct_io=False):
     """Creates a `TFRecordDataset`.
 
     Args:
@@ -211,6 +215,8 @@ class _TFRecordDataset(dataset_ops.DatasetSource):
         `""` (no compression), `"ZLIB"`, or `"GZIP"`.
       buffer_size: (Optional.) A `tf.int64` scalar representing the number of
         bytes in the read buffer. 0 means no buffering.
+      use_direct_io: (Optional.) A Python boolean indicating whether to read
+        the files with direct I/O, bypassing the page cache.
     """
     self._filenames = filenames
     self._compression_type = convert.optional_param_to_tensor(
@@ -222,9 +228,11 @@ class _TFRecordDataset(dataset_ops.DatasetSource):
         "buffer_size",
         buffer_size,
         argument_default=_DEFAULT_READER_BUFFER_SIZE_BYTES)
-    variant_tensor = gen_dataset_ops.tf_record_dataset(self._filenames,
-                                                       self._compression_type,
-                                                       self._buffer_size)
+    variant_tensor = gen_dataset_ops.tf_record_dataset(
+        self._filenames,
+        self._compression_type,
+        self._buffer_size,
+        use_direct_io=use_direct_io)
     super(_TFRecordDataset, self).__init__(variant_tensor)
 
   @property
@@ -290,7 +298,8 @@ class TFRecordDatasetV2(dataset_ops.DatasetV2):
                filenames,
                compression_type=None,
                buffer_size=None,
-               num_parallel_reads=None):
+               num_parallel_reads=None,
+               use_direct_io=False):
     """Creates a `TFRecordDataset` to read one or more TFRecord files.
 
     Args:
@@ -308,6 +317,12 @@ class TFRecordDatasetV2(dataset_ops.DatasetV2):
         input pipeline is I/O bottlenecked, consider setting this parameter to a
         value greater than one to parallelize the I/O. If `None`, files will be
         read sequentially.
+      use_direct_io: (Optional.) A Python boolean indicating whether to read
+        the files with direct I/O, bypassing the page cache of the operating
+        system. Consider setting this parameter to `True` for large sequential
+        scans of local files that are read once per epoch and would otherwise
+        evict more useful data from the page cache. File systems that do not
+        support direct I/O read the files through the page cache.
 
     Raises:
       TypeError: If any argument does not have the expected type.
@@ -319,9 +334,11 @@ class TFRecordDatasetV2(dataset_ops.DatasetV2):
     self._compression_type = compression_type
     self._buffer_size = buffer_size
     self._num_parallel_reads = num_parallel_reads
+    self._use_direct_io = use_direct_io
 
     def creator_fn(filename):
-      return _TFRecordDataset(filename, compression_type, buffer_size)
+      return _TFRecordDataset(filename, compression_type, buffer_size,
+                              use_direct_io)
 
     self._impl = _create_dataset_reader(creator_fn, filenames,
                                         num_parallel_reads)
@@ -332,11 +349,13 @@ class TFRecordDatasetV2(dataset_ops.DatasetV2):
              filenames=None,
              compression_type=None,
              buffer_size=None,
-             num_parallel_reads=None):
+             num_parallel_reads=None,
+             use_direct_io=None):
     return TFRecordDatasetV2(filenames or self._filenames, compression_type or
                              self._compression_type, buffer_size or
                              self._buffer_size, num_parallel_reads or
-                             self._num_parallel_reads)
+                             self._num_parallel_reads, use_direct_io or
+                             self._use_direct_io)
 
   def _inputs(self):
     return self._impl._inputs()  # pylint: disable=protected-access
@@ -354,9 +373,10 @@ class TFRecordDatasetV1(dataset_ops.DatasetV1Adapter):
                filenames,
                compression_type=None,
                buffer_size=None,
-               num_parallel_reads=None):
+               num_parallel_reads=None,
+               use_direct_io=False):
     wrapped = TFRecordDatasetV2(filenames, compression_type, buffer_size,
-                                num_parallel_reads)
+                                num_parallel_reads, use_direct_io)
     super(TFRecordDatasetV1, self).__init__(wrapped)
 
   __init__.__doc__ = TFRecordDatasetV2.__init__.__doc__
@@ -365,13 +385,15 @@ class TFRecordDatasetV1(dataset_ops.DatasetV1Adapter):
              filenames=None,
              compression_type=None,
              buffer_size=None,
-             num_parallel_reads=None):
+             num_parallel_reads=None,
+             use_direct_io=None):
     # pylint: disable=protected-access
     return TFRecordDatasetV1(
         filenames or self._dataset._filenames, compression_type or
         self._dataset._compression_type, buffer_size or
         self._dataset._buffer_size, num_parallel_reads or
-        self._dataset._num_parallel_reads)
+        self._dataset._num_parallel_reads, use_direct_io or
+        self._dataset._use_direct_io)
 
   @property
   def _filenames(self):
@@ -44,7 +44,8 @@ class DecodeJpegBenchmark(test.Benchmark):
                       num_iters,
                       crop_during_decode=None,
                       crop_window=None,
-                      tile=None):
+                      tile=None,
+                      size=None):
     """Evaluate DecodeJpegOp for the given image.
 
     TODO(tanmingxing): add decoding+cropping as well.
@@ -58,6 +59,9 @@ class DecodeJpegBenchmark(test.Benchmark):
       crop_window: if not None, crop the decoded image. Depending on
           crop_during_decode, cropping could happen during or after decoding.
       tile: if not None, tile the image to composite a larger fake image.
+      size: if not None, resize the cropped image to `size`. Depending on
+          crop_during_decode, cropping and resizing could happen during or
+          after decoding. It is ignored if crop_window is None.
 
     Returns:
       The duration of the run in seconds.
@@ -86,6 +90,10 @@ class DecodeJpegBenchmark(test.Benchmark):
         if crop_window is None:
           # No crop.
           image = image_ops.decode_jpeg(image_content, channels=3)
+        elif size is not None and crop_during_decode:
+          # combined decode, crop and resize.
+          image = image_ops.decode_crop_and_resize_jpeg(
+              image_content, crop_window, size, channels=3)
         elif crop_during_decode:
           # combined decode and crop.
           image = image_ops.decode_and_crop_jpeg(
@@ -99,6 +107,10 @@ class DecodeJpegBenchmark(test.Benchmark):
               offset_width=crop_window[1],
               target_height=crop_window[2],
               target_width=crop_window[3])
+          if size is not None:
+            image = image_ops.resize_bilinear(
+                array_ops.expand_dims(image, 0), size,
+                half_pixel_centers=True)[0]
 
         images.append(image)
       r = control_flow_ops.group(*images)
@@ -187,6 +199,28 @@ class DecodeJpegBenchmark(test.Benchmark):
           iters=num_iters,
           wall_time=duration_decode_after_crop)
 
+  def benchmarkDecodeCropAndResizeJpegLarge(self):
+    """Evaluate DecodeCropAndResizeJpegOp for large size image."""
+    num_iters = 10
+    crop_window = [0, 0, 1500, 2000]
+    size = [224, 224]
+    tile = [4, 4, 1]
+    for parallelism in [1, 100]:
+      # Tile the medium size image to composite a larger fake image.
+      duration_decode_crop_resize = self._evalDecodeJpeg(
+          'medium.jpg', parallelism, num_iters, False, crop_window, tile,
+          size)
+      duration_decode_and_crop_resize = self._evalDecodeJpeg(
+          'medium.jpg', parallelism, num_iters, True, crop_window, tile, size)
+      self.report_benchmark(
+          name='decode_crop_resize_jpeg_large_p%d' % (parallelism),
+          iters=num_iters,
+          wall_time=duration_decode_crop_resize)
+      self.report_benchmark(
+          name='decode_and_crop_resize_jpeg_large_p%d' % (parallelism),
+          iters=num_iters,
+          wall_time=duration_decode_and_crop_resize)
+
 
 if __name__ == '__main__':
   test.main()
@@ -2203,6 +2203,13 @@ tf_export(
     v1=['io.decode_and_crop_jpeg', 'image.decode_and_crop_jpeg'])(
         gen_image_ops.decode_and_crop_jpeg)
 
+tf_export(
+    'io.decode_crop_and_resize_jpeg',
+    'image.decode_crop_and_resize_jpeg',
+    v1=[
+        'io.decode_crop_and_resize_jpeg', 'image.decode_crop_and_resize_jpeg'
+    ])(gen_image_ops.decode_crop_and_resize_jpeg)
+
 tf_export(
     'io.decode_bmp',
     'image.decode_bmp',
@@ -3858,6 +3858,64 @@ class JpegTest(test_util.TensorFlowTestCase):
             lambda e: "Invalid JPEG data or crop window" in str(e)):
           self.evaluate(result)
 
+  def testDecodeCropAndResizeJpeg(self):
+    with self.cached_session():
+      base = "tensorflow/core/lib/jpeg/testdata"
+      jpeg0 = io_ops.read_file(os.path.join(base, "jpeg_merge_test1.jpg"))
+
+      h, w = 256, 128
+      # The crop windows are upsampled, so the image is decoded at full scale.
+      for crop_window, size in [([0, 0, h, w], [h + 10, w]),
+                                ([6, 5, 15, 10], [30, 20]),
+                                ([h - 6, w - 5, 6, 5], [7, 11])]:
+        # Explicit three stages: decode + crop + resize.
+        image1 = image_ops.decode_jpeg(jpeg0)
+        y, x, crop_h, crop_w = crop_window
+        image1 = image_ops.crop_to_bounding_box(image1, y, x, crop_h, crop_w)
+        image1 = gen_image_ops.resize_bilinear(
+            array_ops.expand_dims(image1, 0), size, half_pixel_centers=True)[0]
+
+        # Fused decode+crop+resize.
+        image2 = image_ops.decode_crop_and_resize_jpeg(jpeg0, crop_window, size)
+        self.assertAllEqual(image1.get_shape().as_list(),
+                            image2.get_shape().as_list())
+        image1, image2 = self.evaluate([image1, image2])
+        self.assertAllClose(image1, image2, atol=1e-3)
+
+  def testDecodeCropAndResizeJpegDownscaled(self):
+    with self.cached_session():
+      base = "tensorflow/core/lib/jpeg/testdata"
+      jpeg0 = io_ops.read_file(os.path.join(base, "jpeg_merge_test1.jpg"))
+
+      # Downscaling by 8 decodes at 1/8 scale, which averages 8x8 blocks like
+      # an area resize does.
+      image1 = image_ops.decode_jpeg(jpeg0, dct_method="INTEGER_ACCURATE")
+      image1 = image_ops.resize_images_v2(
+          image1, [32, 16], method=image_ops.ResizeMethod.AREA)
+      image2 = image_ops.decode_crop_and_resize_jpeg(
+          jpeg0, [0, 0, 256, 128], [32, 16], dct_method="INTEGER_ACCURATE")
+      image1, image2 = self.evaluate([image1, image2])
+      self.assertEqual(image2.shape, (32, 16, 3))
+      self.assertLess(self.averageError(image1, image2), 3)
+
+  @test_util.run_deprecated_v1
+  def testDecodeCropAndResizeJpegWithInvalidArguments(self):
+    with self.cached_session():
+      base = "tensorflow/core/lib/jpeg/testdata"
+      jpeg0 = io_ops.read_file(os.path.join(base, "jpeg_merge_test1.jpg"))
+
+      h, w, _ = 256, 128, 3
+      for crop_window, size, message in [
+          ([-1, 11, 11, 11], [8, 8], "Invalid crop window"),
+          ([11, 11, 0, 11], [8, 8], "Invalid crop window"),
+          ([0, 0, h + 1, w], [8, 8], "Invalid crop window"),
+          ([0, 0, h, w], [0, 8], "size must be positive")]:
+        result = image_ops.decode_crop_and_resize_jpeg(jpeg0, crop_window, size)
+        with self.assertRaisesWithPredicateMatch(
+            errors.InvalidArgumentError,
+            lambda e, message=message: message in str(e)):
+          self.evaluate(result)
+
   def testSynthetic(self):
     with self.cached_session(use_gpu=True) as sess:
       # Encode it, then decode it, then encode it